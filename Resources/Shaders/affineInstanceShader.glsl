@@ -0,0 +1,36 @@
+#include "common.glh"
+
+varying vec2 texCoord0;
+
+#if defined(VS_BUILD)
+Layout(0) attribute vec3 position;
+Layout(1) attribute vec2 texCoord;
+// Rows of an AffineMatrix, see Math/AffineMatrix.h
+Layout(4) attribute vec4 instanceRow0;
+Layout(5) attribute vec4 instanceRow1;
+Layout(6) attribute vec4 instanceRow2;
+
+layout(std140) uniform ViewData
+{
+	mat4 viewProjection;
+};
+
+void main()
+{
+	vec4 localPosition = vec4(position, 1.0);
+	vec3 worldPosition = vec3(dot(instanceRow0, localPosition),
+			dot(instanceRow1, localPosition), dot(instanceRow2, localPosition));
+
+	gl_Position = vec4(worldPosition, 1.0) * viewProjection;
+	texCoord0 = texCoord;
+}
+
+#elif defined(FS_BUILD)
+uniform sampler2D diffuse;
+
+DeclareFragOutput(0, vec4);
+void main()
+{
+	SetFragOutput(0, texture2D(diffuse, texCoord0));
+}
+#endif
@@ -0,0 +1,43 @@
+#include "common.glh"
+
+varying vec2 texCoord0;
+
+#if defined(VS_BUILD)
+Layout(0) attribute vec3 position;
+Layout(1) attribute vec2 texCoord;
+// ELEMENT_FORMAT_COMPACT_TRANSFORM, see Rendering/InstanceData.h
+Layout(4) attribute vec4 instanceTranslationScaleX;
+Layout(5) attribute vec4 instanceRotation;
+Layout(6) attribute vec2 instanceScaleYZ;
+
+layout(std140) uniform ViewData
+{
+	mat4 viewProjection;
+};
+
+vec3 quatRotate(vec4 q, vec3 v)
+{
+	vec3 t = 2.0 * cross(q.xyz, v);
+	return v + q.w * t + cross(q.xyz, t);
+}
+
+void main()
+{
+	// The rotation was quantized to 16 bits, renormalize to avoid skewing
+	vec4 rotation = normalize(instanceRotation);
+	vec3 scale = vec3(instanceTranslationScaleX.w, instanceScaleYZ);
+	vec3 worldPosition = quatRotate(rotation, position * scale) + instanceTranslationScaleX.xyz;
+
+	gl_Position = vec4(worldPosition, 1.0) * viewProjection;
+	texCoord0 = texCoord;
+}
+
+#elif defined(FS_BUILD)
+uniform sampler2D diffuse;
+
+DeclareFragOutput(0, vec4);
+void main()
+{
+	SetFragOutput(0, texture2D(diffuse, texCoord0));
+}
+#endif
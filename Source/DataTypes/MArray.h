@@ -1,6 +1,539 @@
 #pragma once
 
-#include <vector>
+#include "EngineCore/MemoryManager.h"
+#include <algorithm>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
 
-#define Array std::vector
+/*
+ *	Whether a T can be moved to another address with a plain memcpy, leaving
+ *	nothing to destroy behind. True for trivially copyable types; specialize
+ *	it for types that only hold pointers to memory they own elsewhere.
+ **/
+template<typename T>
+struct IsTriviallyRelocatable
+{
+	static const bool Value = std::is_trivially_copyable<T>::value;
+};
 
+/** Whether Allocator has reallocate(Ptr, OldCount, NewCount), like MemoryStlAllocator. */
+template<typename Allocator>
+struct AllocatorCanReallocate
+{
+	template<typename U> static char Test(decltype(&U::reallocate));
+	template<typename U> static int32 Test(...);
+	static const bool Value = sizeof(Test<Allocator>(nullptr)) == 1;
+};
+
+/** Room for Capacity elements inside the array itself. */
+template<typename T, uint32 Capacity>
+struct ArrayInlineStorage
+{
+	FORCEINLINE T* GetInlineData() { return (T*)Bytes; }
+	FORCEINLINE const T* GetInlineData() const { return (const T*)Bytes; }
+private:
+	alignas(T) uint8 Bytes[Capacity * sizeof(T)];
+};
+
+template<typename T>
+struct ArrayInlineStorage<T, 0>
+{
+	FORCEINLINE T* GetInlineData() { return nullptr; }
+	FORCEINLINE const T* GetInlineData() const { return nullptr; }
+};
+
+/*
+ *	Contiguous, growable array with the interface of std::vector, so it
+ *	works with the standard algorithms.
+ *
+ *	The first InlineCapacity elements live inside the array itself, and only
+ *	arrays that outgrow them touch the Allocator. Growing moves trivially
+ *	relocatable elements with memcpy, or in place through the allocator's
+ *	reallocate when it has one.
+ **/
+template<typename T, typename Allocator = MemoryStlAllocator<T>, uint32 InlineCapacity = 0>
+class Array : private Allocator, private ArrayInlineStorage<T, InlineCapacity>
+{
+public:
+	typedef T value_type;
+	typedef Allocator allocator_type;
+	typedef std::size_t size_type;
+	typedef std::ptrdiff_t difference_type;
+	typedef T& reference;
+	typedef const T& const_reference;
+	typedef T* pointer;
+	typedef const T* const_pointer;
+	typedef T* iterator;
+	typedef const T* const_iterator;
+	typedef std::reverse_iterator<iterator> reverse_iterator;
+	typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+	FORCEINLINE Array() :
+		Data(this->GetInlineData()),
+		Num(0),
+		Capacity(InlineCapacity) {}
+
+	FORCEINLINE explicit Array(const Allocator& InAllocator) :
+		Allocator(InAllocator),
+		Data(this->GetInlineData()),
+		Num(0),
+		Capacity(InlineCapacity) {}
+
+	/** Value initializes Count elements, like std::vector. */
+	explicit Array(size_type Count) :
+		Array()
+	{
+		resize(Count);
+	}
+
+	Array(size_type Count, const T& Value) :
+		Array()
+	{
+		resize(Count, Value);
+	}
+
+	Array(std::initializer_list<T> Values) :
+		Array()
+	{
+		assign(Values.begin(), Values.end());
+	}
+
+	template<typename InputIterator, typename = typename std::enable_if<!std::is_integral<InputIterator>::value>::type>
+	Array(InputIterator First, InputIterator Last) :
+		Array()
+	{
+		assign(First, Last);
+	}
+
+	Array(const Array& Other) :
+		Allocator(Other),
+		Data(this->GetInlineData()),
+		Num(0),
+		Capacity(InlineCapacity)
+	{
+		assign(Other.begin(), Other.end());
+	}
+
+	Array(Array&& Other) noexcept :
+		Allocator(std::move((Allocator&)Other)),
+		Data(this->GetInlineData()),
+		Num(0),
+		Capacity(InlineCapacity)
+	{
+		TakeElements(Other);
+	}
+
+	~Array()
+	{
+		DestroyElements(Data, Num);
+		FreeData();
+	}
+
+	Array& operator=(const Array& Other)
+	{
+		if (this != &Other)
+		{
+			assign(Other.begin(), Other.end());
+		}
+		return *this;
+	}
+
+	Array& operator=(Array&& Other) noexcept
+	{
+		if (this != &Other)
+		{
+			clear();
+			FreeData();
+			Data = this->GetInlineData();
+			Capacity = InlineCapacity;
+			(Allocator&)*this = std::move((Allocator&)Other);
+			TakeElements(Other);
+		}
+		return *this;
+	}
+
+	Array& operator=(std::initializer_list<T> Values)
+	{
+		assign(Values.begin(), Values.end());
+		return *this;
+	}
+
+	template<typename InputIterator>
+	void assign(InputIterator First, InputIterator Last)
+	{
+		clear();
+		ReserveForRange(First, Last, typename std::iterator_traits<InputIterator>::iterator_category());
+		for (; First != Last; ++First)
+		{
+			emplace_back(*First);
+		}
+	}
+
+	FORCEINLINE iterator begin() { return Data; }
+	FORCEINLINE const_iterator begin() const { return Data; }
+	FORCEINLINE const_iterator cbegin() const { return Data; }
+	FORCEINLINE iterator end() { return Data + Num; }
+	FORCEINLINE const_iterator end() const { return Data + Num; }
+	FORCEINLINE const_iterator cend() const { return Data + Num; }
+	FORCEINLINE reverse_iterator rbegin() { return reverse_iterator(end()); }
+	FORCEINLINE const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+	FORCEINLINE reverse_iterator rend() { return reverse_iterator(begin()); }
+	FORCEINLINE const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+	FORCEINLINE size_type size() const { return Num; }
+	FORCEINLINE size_type capacity() const { return Capacity; }
+	FORCEINLINE bool empty() const { return Num == 0; }
+	FORCEINLINE size_type max_size() const { return ((size_type)-1) / sizeof(T); }
+	FORCEINLINE allocator_type get_allocator() const { return *this; }
+
+	FORCEINLINE T* data() { return Data; }
+	FORCEINLINE const T* data() const { return Data; }
+
+	FORCEINLINE T& operator[](size_type Index)
+	{
+		assertCheck(Index < Num);
+		return Data[Index];
+	}
+
+	FORCEINLINE const T& operator[](size_type Index) const
+	{
+		assertCheck(Index < Num);
+		return Data[Index];
+	}
+
+	FORCEINLINE T& front() { assertCheck(Num > 0); return Data[0]; }
+	FORCEINLINE const T& front() const { assertCheck(Num > 0); return Data[0]; }
+	FORCEINLINE T& back() { assertCheck(Num > 0); return Data[Num - 1]; }
+	FORCEINLINE const T& back() const { assertCheck(Num > 0); return Data[Num - 1]; }
+
+	/** Whether the elements are still in the inline storage. */
+	FORCEINLINE bool IsInline() const { return InlineCapacity != 0 && Data == this->GetInlineData(); }
+
+	void reserve(size_type NewCapacity)
+	{
+		if (NewCapacity > Capacity)
+		{
+			Reallocate(NewCapacity);
+		}
+	}
+
+	void shrink_to_fit()
+	{
+		if (Capacity > Num && Capacity > InlineCapacity)
+		{
+			Reallocate(Num);
+		}
+	}
+
+	void resize(size_type NewNum)
+	{
+		if (NewNum > Num)
+		{
+			if (NewNum > Capacity)
+			{
+				Reallocate(GetGrownCapacity(NewNum));
+			}
+			for (size_type Index = Num; Index < NewNum; Index++)
+			{
+				new (Data + Index) T();
+			}
+		}
+		else
+		{
+			DestroyElements(Data + NewNum, Num - NewNum);
+		}
+		Num = NewNum;
+	}
+
+	void resize(size_type NewNum, const T& Value)
+	{
+		if (NewNum > Num)
+		{
+			if (NewNum > Capacity)
+			{
+				T _Value(Value);
+				Reallocate(GetGrownCapacity(NewNum));
+				ConstructCopies(Data + Num, NewNum - Num, _Value);
+			}
+			else
+			{
+				ConstructCopies(Data + Num, NewNum - Num, Value);
+			}
+		}
+		else
+		{
+			DestroyElements(Data + NewNum, Num - NewNum);
+		}
+		Num = NewNum;
+	}
+
+	FORCEINLINE void clear()
+	{
+		DestroyElements(Data, Num);
+		Num = 0;
+	}
+
+	FORCEINLINE void push_back(const T& Value) { emplace_back(Value); }
+	FORCEINLINE void push_back(T&& Value) { emplace_back(std::move(Value)); }
+
+	template<typename... ArgTypes>
+	FORCEINLINE T& emplace_back(ArgTypes&&... Args)
+	{
+		if (Num == Capacity)
+		{
+			return EmplaceBackGrow(std::forward<ArgTypes>(Args)...);
+		}
+		new (Data + Num) T(std::forward<ArgTypes>(Args)...);
+		return Data[Num++];
+	}
+
+	/*
+	 *	Appends Count elements without constructing them and returns the first,
+	 *	for bulk fills that write every element right away. T must be trivially
+	 *	copyable.
+	 **/
+	FORCEINLINE T* PushBackUninitialized(size_type Count = 1)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "PushBackUninitialized skips constructors");
+		if (Num + Count > Capacity)
+		{
+			Reallocate(GetGrownCapacity(Num + Count));
+		}
+		T* _Result = Data + Num;
+		Num += Count;
+		return _Result;
+	}
+
+	FORCEINLINE void pop_back()
+	{
+		assertCheck(Num > 0);
+		Num--;
+		Data[Num].~T();
+	}
+
+	iterator insert(const_iterator Position, const T& Value)
+	{
+		T _Value(Value);
+		return emplace(Position, std::move(_Value));
+	}
+
+	iterator insert(const_iterator Position, T&& Value)
+	{
+		return emplace(Position, std::move(Value));
+	}
+
+	template<typename InputIterator, typename = typename std::enable_if<!std::is_integral<InputIterator>::value>::type>
+	iterator insert(const_iterator Position, InputIterator First, InputIterator Last)
+	{
+		size_type _Index = (size_type)(Position - Data);
+		size_type _OldNum = Num;
+		for (; First != Last; ++First)
+		{
+			emplace_back(*First);
+		}
+		std::rotate(Data + _Index, Data + _OldNum, Data + Num);
+		return Data + _Index;
+	}
+
+	template<typename... ArgTypes>
+	iterator emplace(const_iterator Position, ArgTypes&&... Args)
+	{
+		size_type _Index = (size_type)(Position - Data);
+		assertCheck(_Index <= Num);
+		emplace_back(std::forward<ArgTypes>(Args)...);
+		std::rotate(Data + _Index, Data + Num - 1, Data + Num);
+		return Data + _Index;
+	}
+
+	iterator erase(const_iterator Position)
+	{
+		return erase(Position, Position + 1);
+	}
+
+	iterator erase(const_iterator First, const_iterator Last)
+	{
+		T* _First = Data + (First - Data);
+		T* _Last = Data + (Last - Data);
+		assertCheck(_First <= _Last && _Last <= Data + Num);
+		T* _NewEnd = std::move(_Last, Data + Num, _First);
+		DestroyElements(_NewEnd, (size_type)(Data + Num - _NewEnd));
+		Num = (size_type)(_NewEnd - Data);
+		return _First;
+	}
+
+	void swap(Array& Other)
+	{
+		Array _Temp(std::move(Other));
+		Other = std::move(*this);
+		*this = std::move(_Temp);
+	}
+private:
+	T* Data;
+	size_type Num;
+	size_type Capacity;
+
+	FORCEINLINE size_type GetGrownCapacity(size_type MinCapacity) const
+	{
+		size_type _Grown = Capacity + Capacity / 2;
+		if (_Grown < 4)
+		{
+			_Grown = 4;
+		}
+		return _Grown > MinCapacity ? _Grown : MinCapacity;
+	}
+
+	template<typename... ArgTypes>
+	T& EmplaceBackGrow(ArgTypes&&... Args)
+	{
+		// Args may refer to an element, so build the value before the elements move
+		T _Value(std::forward<ArgTypes>(Args)...);
+		Reallocate(GetGrownCapacity(Num + 1));
+		new (Data + Num) T(std::move(_Value));
+		return Data[Num++];
+	}
+
+	template<typename InputIterator>
+	FORCEINLINE void ReserveForRange(InputIterator, InputIterator, std::input_iterator_tag) {}
+
+	template<typename ForwardIterator>
+	FORCEINLINE void ReserveForRange(ForwardIterator First, ForwardIterator Last, std::forward_iterator_tag)
+	{
+		reserve(Num + (size_type)std::distance(First, Last));
+	}
+
+	void Reallocate(size_type NewCapacity)
+	{
+		assertCheck(NewCapacity >= Num);
+		if (NewCapacity <= InlineCapacity)
+		{
+			if (!IsInline())
+			{
+				T* _OldData = Data;
+				RelocateElements(this->GetInlineData(), _OldData, Num);
+				Allocator::deallocate(_OldData, Capacity);
+				Data = this->GetInlineData();
+			}
+			Capacity = InlineCapacity;
+			return;
+		}
+
+		if (!IsInline() && Data != nullptr && IsTriviallyRelocatable<T>::Value)
+		{
+			T* _NewData = ReallocateData(NewCapacity,
+					std::integral_constant<bool, AllocatorCanReallocate<Allocator>::Value>());
+			if (_NewData != nullptr)
+			{
+				Data = _NewData;
+				Capacity = NewCapacity;
+				return;
+			}
+		}
+
+		T* _NewData = Allocator::allocate(NewCapacity);
+		RelocateElements(_NewData, Data, Num);
+		FreeData();
+		Data = _NewData;
+		Capacity = NewCapacity;
+	}
+
+	FORCEINLINE T* ReallocateData(size_type NewCapacity, std::true_type)
+	{
+		return Allocator::reallocate(Data, Capacity, NewCapacity);
+	}
+
+	FORCEINLINE T* ReallocateData(size_type, std::false_type)
+	{
+		return nullptr;
+	}
+
+	FORCEINLINE void FreeData()
+	{
+		if (!IsInline() && Data != nullptr)
+		{
+			Allocator::deallocate(Data, Capacity);
+		}
+	}
+
+	/** Moves Other's elements here, leaving it empty. This array must have no elements. */
+	void TakeElements(Array& Other)
+	{
+		if (Other.IsInline())
+		{
+			RelocateElements(Data, Other.Data, Other.Num);
+		}
+		else
+		{
+			Data = Other.Data;
+			Capacity = Other.Capacity;
+			Other.Data = Other.GetInlineData();
+			Other.Capacity = InlineCapacity;
+		}
+		Num = Other.Num;
+		Other.Num = 0;
+	}
+
+	static FORCEINLINE void RelocateElements(T* Dest, T* Source, size_type Count)
+	{
+		if (IsTriviallyRelocatable<T>::Value)
+		{
+			// memcpy wants valid pointers even for no bytes, and empty arrays have none
+			if (Count != 0)
+			{
+				Memory::memcpy(Dest, Source, Count * sizeof(T));
+			}
+		}
+		else
+		{
+			for (size_type Index = 0; Index < Count; Index++)
+			{
+				new (Dest + Index) T(std::move(Source[Index]));
+				Source[Index].~T();
+			}
+		}
+	}
+
+	static FORCEINLINE void ConstructCopies(T* Dest, size_type Count, const T& Value)
+	{
+		for (size_type Index = 0; Index < Count; Index++)
+		{
+			new (Dest + Index) T(Value);
+		}
+	}
+
+	static FORCEINLINE void DestroyElements(T* Elements, size_type Count)
+	{
+		if (!std::is_trivially_destructible<T>::value)
+		{
+			for (size_type Index = 0; Index < Count; Index++)
+			{
+				Elements[Index].~T();
+			}
+		}
+	}
+};
+
+/** An array on the heap only holds a pointer to its elements, so it can be moved bytewise. */
+template<typename T, typename Allocator>
+struct IsTriviallyRelocatable<Array<T, Allocator, 0>>
+{
+	static const bool Value = std::is_empty<Allocator>::value;
+};
+
+/** Array keeping its first Capacity elements inline, off the heap. */
+template<typename T, uint32 Capacity, typename Allocator = MemoryStlAllocator<T>>
+using InlineArray = Array<T, Allocator, Capacity>;
+
+template<typename T, typename Allocator, uint32 InlineCapacity>
+bool operator==(const Array<T, Allocator, InlineCapacity>& A, const Array<T, Allocator, InlineCapacity>& B)
+{
+	return A.size() == B.size() && std::equal(A.begin(), A.end(), B.begin());
+}
+
+template<typename T, typename Allocator, uint32 InlineCapacity>
+bool operator!=(const Array<T, Allocator, InlineCapacity>& A, const Array<T, Allocator, InlineCapacity>& B)
+{
+	return !(A == B);
+}
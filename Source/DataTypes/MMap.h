@@ -1,5 +1,671 @@
 #pragma once
 
-#include <map>
+#include "EngineCore/MemoryManager.h"
+#include "DataTypes/MArray.h"
+#include "DataTypes/MString.h"
+#include "Math/Math.h"
+#include "Platform/PlatformSIMDInclude.h"
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 
-#define Map std::map
+#if SIMD_CPU_ARCH != SIMD_CPU_ARCH_OTHER && SIMD_SUPPORTED_LEVEL >= SIMD_LEVEL_x86_SSE2
+	#define MAP_GROUP_SIMD 1
+#else
+	#define MAP_GROUP_SIMD 0
+#endif
+
+/*
+ *	Default hash for Map. Strings hash by content whether they are a String or
+ *	a C string, so either can be used to look up String keys.
+ **/
+struct MapHash
+{
+	static FORCEINLINE uint64 Mix(uint64 Key)
+	{
+		Key ^= Key >> 33;
+		Key *= 0xff51afd7ed558ccdull;
+		Key ^= Key >> 33;
+		Key *= 0xc4ceb9fe1a85ec53ull;
+		Key ^= Key >> 33;
+		return Key;
+	}
+
+	static FORCEINLINE uint64 HashBytes(const void* Data, uintptr Length)
+	{
+		uint64 _Hash = 0xcbf29ce484222325ull;
+		for (uintptr Index = 0; Index < Length; Index++)
+		{
+			_Hash = (_Hash ^ ((const uint8*)Data)[Index]) * 0x100000001b3ull;
+		}
+		return Mix(_Hash);
+	}
+
+	template<typename T>
+	FORCEINLINE typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value, uint64>::type
+		operator()(T Key) const
+	{
+		return Mix((uint64)Key);
+	}
+
+	template<typename T>
+	FORCEINLINE uint64 operator()(T* Key) const { return Mix((uint64)(uintptr)Key); }
+
+	FORCEINLINE uint64 operator()(const char* Key) const { return HashBytes(Key, strlen(Key)); }
+	FORCEINLINE uint64 operator()(char* Key) const { return HashBytes(Key, strlen(Key)); }
+	FORCEINLINE uint64 operator()(const String& Key) const { return HashBytes(Key.data(), Key.size()); }
+
+	/** Ids that stand for something else, such as StringId and Handle, hash by their GetValue. */
+	template<typename T>
+	FORCEINLINE auto operator()(const T& Key) const -> decltype((uint64)Key.GetValue())
+	{
+		return Mix((uint64)Key.GetValue());
+	}
+};
+
+/** Default key comparison for Map. Compares any two types that have an operator==. */
+struct MapEqual
+{
+	template<typename A, typename B>
+	FORCEINLINE bool operator()(const A& Lhs, const B& Rhs) const { return Lhs == Rhs; }
+};
+
+/*
+ *	Control bytes of MapGroup::WIDTH consecutive slots. A full slot's byte
+ *	holds 7 bits of its key's hash; empty and deleted slots have the high bit
+ *	set. Matching a whole group is a compare and a movemask.
+ **/
+struct MapGroup
+{
+	enum
+	{
+		WIDTH = 16
+	};
+
+	static const int8 CTRL_EMPTY = -128;
+	static const int8 CTRL_DELETED = -2;
+
+#if MAP_GROUP_SIMD
+	FORCEINLINE explicit MapGroup(const int8* Ctrl) :
+		Bytes(_mm_loadu_si128((const __m128i*)Ctrl)) {}
+
+	/** One bit per slot whose byte equals H2. */
+	FORCEINLINE uint32 Match(int8 H2) const
+	{
+		return (uint32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(H2), Bytes));
+	}
+
+	FORCEINLINE uint32 MatchEmptyOrDeleted() const
+	{
+		return (uint32)_mm_movemask_epi8(_mm_cmplt_epi8(Bytes, _mm_set1_epi8(-1)));
+	}
+private:
+	__m128i Bytes;
+#else
+	FORCEINLINE explicit MapGroup(const int8* Ctrl)
+	{
+		memcpy(Bytes, Ctrl, WIDTH);
+	}
+
+	FORCEINLINE uint32 Match(int8 H2) const
+	{
+		uint32 _Result = 0;
+		for (uint32 Index = 0; Index < WIDTH; Index++)
+		{
+			_Result |= (uint32)(Bytes[Index] == H2) << Index;
+		}
+		return _Result;
+	}
+
+	FORCEINLINE uint32 MatchEmptyOrDeleted() const
+	{
+		uint32 _Result = 0;
+		for (uint32 Index = 0; Index < WIDTH; Index++)
+		{
+			_Result |= (uint32)(Bytes[Index] < -1) << Index;
+		}
+		return _Result;
+	}
+private:
+	int8 Bytes[WIDTH];
+#endif
+public:
+	FORCEINLINE uint32 MatchEmpty() const { return Match(CTRL_EMPTY); }
+};
+
+/*
+ *	Open addressing hash map in the style of SwissTable. Keys and values sit
+ *	in one flat slot array next to an array of control bytes, and a lookup
+ *	probes a group of 16 control bytes at a time, touching a slot only when
+ *	7 bits of its hash already match.
+ *
+ *	Unlike std::map it is unordered, and inserting can move every element,
+ *	invalidating iterators and references; erasing moves nothing. find,
+ *	count, erase and operator[] take any key type that Hash and Equal
+ *	accept, so a String keyed map can be searched with a const char*
+ *	without building a String. Keys must not be changed through iterators.
+ **/
+template<typename K, typename V, typename Hash = MapHash, typename Equal = MapEqual,
+		typename Allocator = MemoryStlAllocator<std::pair<K, V>>>
+class Map : private Allocator
+{
+public:
+	typedef K key_type;
+	typedef V mapped_type;
+	typedef std::pair<K, V> value_type;
+	typedef std::size_t size_type;
+	typedef std::ptrdiff_t difference_type;
+	typedef Hash hasher;
+	typedef Equal key_equal;
+	typedef Allocator allocator_type;
+
+	template<bool bConst>
+	class Iterator
+	{
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef typename Map::value_type value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef typename std::conditional<bConst, const value_type*, value_type*>::type pointer;
+		typedef typename std::conditional<bConst, const value_type&, value_type&>::type reference;
+
+		FORCEINLINE Iterator() : Slot(nullptr), Ctrl(nullptr), CtrlEnd(nullptr) {}
+		FORCEINLINE Iterator(const Iterator<false>& Other) :
+			Slot(Other.Slot), Ctrl(Other.Ctrl), CtrlEnd(Other.CtrlEnd) {}
+
+		FORCEINLINE reference operator*() const { return *Slot; }
+		FORCEINLINE pointer operator->() const { return Slot; }
+
+		FORCEINLINE Iterator& operator++()
+		{
+			++Slot;
+			++Ctrl;
+			SkipFree();
+			return *this;
+		}
+
+		FORCEINLINE Iterator operator++(int)
+		{
+			Iterator _Result = *this;
+			++*this;
+			return _Result;
+		}
+
+		FORCEINLINE bool operator==(const Iterator& Other) const { return Slot == Other.Slot; }
+		FORCEINLINE bool operator!=(const Iterator& Other) const { return Slot != Other.Slot; }
+	private:
+		friend class Map;
+		friend class Iterator<true>;
+
+		pointer Slot;
+		const int8* Ctrl;
+		const int8* CtrlEnd;
+
+		FORCEINLINE Iterator(pointer InSlot, const int8* InCtrl, const int8* InCtrlEnd) :
+			Slot(InSlot), Ctrl(InCtrl), CtrlEnd(InCtrlEnd) {}
+
+		FORCEINLINE void SkipFree()
+		{
+			while (Ctrl != CtrlEnd && *Ctrl < 0)
+			{
+				++Slot;
+				++Ctrl;
+			}
+		}
+	};
+
+	typedef Iterator<false> iterator;
+	typedef Iterator<true> const_iterator;
+
+	FORCEINLINE Map() :
+		Ctrl(nullptr),
+		Slots(nullptr),
+		Num(0),
+		Capacity(0),
+		GrowthLeft(0) {}
+
+	FORCEINLINE explicit Map(const Allocator& InAllocator) :
+		Allocator(InAllocator),
+		Ctrl(nullptr),
+		Slots(nullptr),
+		Num(0),
+		Capacity(0),
+		GrowthLeft(0) {}
+
+	Map(std::initializer_list<value_type> Values) :
+		Map()
+	{
+		reserve(Values.size());
+		for (const value_type& Value : Values)
+		{
+			insert(Value);
+		}
+	}
+
+	Map(const Map& Other) :
+		Allocator(Other),
+		Ctrl(nullptr),
+		Slots(nullptr),
+		Num(0),
+		Capacity(0),
+		GrowthLeft(0)
+	{
+		if (Other.Num == 0)
+		{
+			return;
+		}
+		AllocateTable(Other.Capacity);
+		Memory::memcpy(Ctrl, Other.Ctrl, Capacity);
+		for (size_type Index = 0; Index < Capacity; Index++)
+		{
+			if (Ctrl[Index] >= 0)
+			{
+				new (Slots + Index) value_type(Other.Slots[Index]);
+			}
+		}
+		Num = Other.Num;
+		GrowthLeft = Other.GrowthLeft;
+	}
+
+	Map(Map&& Other) :
+		Allocator(std::move((Allocator&)Other)),
+		Ctrl(Other.Ctrl),
+		Slots(Other.Slots),
+		Num(Other.Num),
+		Capacity(Other.Capacity),
+		GrowthLeft(Other.GrowthLeft)
+	{
+		Other.ForgetTable();
+	}
+
+	~Map()
+	{
+		DestroyTable();
+	}
+
+	Map& operator=(const Map& Other)
+	{
+		if (this != &Other)
+		{
+			Map _Copy(Other);
+			swap(_Copy);
+		}
+		return *this;
+	}
+
+	Map& operator=(Map&& Other)
+	{
+		if (this != &Other)
+		{
+			DestroyTable();
+			(Allocator&)*this = std::move((Allocator&)Other);
+			Ctrl = Other.Ctrl;
+			Slots = Other.Slots;
+			Num = Other.Num;
+			Capacity = Other.Capacity;
+			GrowthLeft = Other.GrowthLeft;
+			Other.ForgetTable();
+		}
+		return *this;
+	}
+
+	FORCEINLINE iterator begin()
+	{
+		iterator _Result(Slots, Ctrl, Ctrl + Capacity);
+		_Result.SkipFree();
+		return _Result;
+	}
+
+	FORCEINLINE const_iterator begin() const
+	{
+		const_iterator _Result(Slots, Ctrl, Ctrl + Capacity);
+		_Result.SkipFree();
+		return _Result;
+	}
+
+	FORCEINLINE const_iterator cbegin() const { return begin(); }
+	FORCEINLINE iterator end() { return iterator(Slots + Capacity, Ctrl + Capacity, Ctrl + Capacity); }
+	FORCEINLINE const_iterator end() const { return const_iterator(Slots + Capacity, Ctrl + Capacity, Ctrl + Capacity); }
+	FORCEINLINE const_iterator cend() const { return end(); }
+
+	FORCEINLINE size_type size() const { return Num; }
+	FORCEINLINE bool empty() const { return Num == 0; }
+	/** Number of slots. At most 7/8 of them are filled before the table grows. */
+	FORCEINLINE size_type capacity() const { return Capacity; }
+	FORCEINLINE allocator_type get_allocator() const { return *this; }
+
+	template<typename LookupKey>
+	FORCEINLINE iterator find(const LookupKey& Key)
+	{
+		size_type _Index = FindIndex(Key, Hash()(Key));
+		return _Index == INVALID_INDEX ? end() : MakeIterator(_Index);
+	}
+
+	template<typename LookupKey>
+	FORCEINLINE const_iterator find(const LookupKey& Key) const
+	{
+		size_type _Index = FindIndex(Key, Hash()(Key));
+		return _Index == INVALID_INDEX ? end() : const_iterator(Slots + _Index, Ctrl + _Index, Ctrl + Capacity);
+	}
+
+	template<typename LookupKey>
+	FORCEINLINE size_type count(const LookupKey& Key) const
+	{
+		return FindIndex(Key, Hash()(Key)) == INVALID_INDEX ? 0 : 1;
+	}
+
+	/** Returns the value at Key, default constructing it first if Key is missing. */
+	template<typename LookupKey>
+	FORCEINLINE V& operator[](LookupKey&& Key)
+	{
+		return try_emplace(std::forward<LookupKey>(Key)).first->second;
+	}
+
+	/*
+	 *	Constructs the value at Key from Args unless Key is already there.
+	 *	Returns the element at Key and whether it was added.
+	 **/
+	template<typename LookupKey, typename... ArgTypes>
+	std::pair<iterator, bool> try_emplace(LookupKey&& Key, ArgTypes&&... Args)
+	{
+		uint64 _Hash = Hash()(Key);
+		size_type _Index = FindIndex(Key, _Hash);
+		if (_Index != INVALID_INDEX)
+		{
+			return std::make_pair(MakeIterator(_Index), false);
+		}
+
+		_Index = PrepareInsert(_Hash);
+		new (Slots + _Index) value_type(std::piecewise_construct,
+				std::forward_as_tuple(std::forward<LookupKey>(Key)),
+				std::forward_as_tuple(std::forward<ArgTypes>(Args)...));
+		return std::make_pair(MakeIterator(_Index), true);
+	}
+
+	template<typename KeyArg, typename ValueArg>
+	FORCEINLINE std::pair<iterator, bool> emplace(KeyArg&& Key, ValueArg&& Value)
+	{
+		return try_emplace(std::forward<KeyArg>(Key), std::forward<ValueArg>(Value));
+	}
+
+	FORCEINLINE std::pair<iterator, bool> insert(const value_type& Value)
+	{
+		return try_emplace(Value.first, Value.second);
+	}
+
+	FORCEINLINE std::pair<iterator, bool> insert(value_type&& Value)
+	{
+		return try_emplace(std::move(Value.first), std::move(Value.second));
+	}
+
+	/** Returns the iterator past the erased element. */
+	iterator erase(const_iterator Position)
+	{
+		size_type _Index = (size_type)(Position.Slot - Slots);
+		assertCheck(_Index < Capacity && Ctrl[_Index] >= 0);
+		Slots[_Index].~value_type();
+		Num--;
+
+		// Lookups stop at the first group with an empty slot, so if this group
+		// already has one nothing probes past it and the slot can be empty too
+		if (MapGroup(Ctrl + (_Index & ~(size_type)(MapGroup::WIDTH - 1))).MatchEmpty() != 0)
+		{
+			Ctrl[_Index] = MapGroup::CTRL_EMPTY;
+			GrowthLeft++;
+		}
+		else
+		{
+			Ctrl[_Index] = MapGroup::CTRL_DELETED;
+		}
+
+		iterator _Next = MakeIterator(_Index);
+		++_Next;
+		return _Next;
+	}
+
+	FORCEINLINE iterator erase(iterator Position)
+	{
+		return erase(const_iterator(Position));
+	}
+
+	template<typename LookupKey>
+	FORCEINLINE typename std::enable_if<!std::is_convertible<LookupKey, const_iterator>::value, size_type>::type
+		erase(const LookupKey& Key)
+	{
+		size_type _Index = FindIndex(Key, Hash()(Key));
+		if (_Index == INVALID_INDEX)
+		{
+			return 0;
+		}
+		erase(MakeIterator(_Index));
+		return 1;
+	}
+
+	/** Removes every element but keeps the table. */
+	void clear()
+	{
+		if (Capacity == 0)
+		{
+			return;
+		}
+		DestroyElements();
+		Memory::memset(Ctrl, (uint8)MapGroup::CTRL_EMPTY, Capacity);
+		Num = 0;
+		GrowthLeft = GetMaxLoad(Capacity);
+	}
+
+	/** Makes room for Count elements in total without growing. */
+	void reserve(size_type Count)
+	{
+		size_type _NewCapacity = Capacity != 0 ? Capacity : (size_type)MIN_CAPACITY;
+		while (GetMaxLoad(_NewCapacity) < Count)
+		{
+			_NewCapacity *= 2;
+		}
+		if (_NewCapacity > Capacity)
+		{
+			Rehash(_NewCapacity);
+		}
+	}
+
+	void swap(Map& Other)
+	{
+		std::swap((Allocator&)*this, (Allocator&)Other);
+		std::swap(Ctrl, Other.Ctrl);
+		std::swap(Slots, Other.Slots);
+		std::swap(Num, Other.Num);
+		std::swap(Capacity, Other.Capacity);
+		std::swap(GrowthLeft, Other.GrowthLeft);
+	}
+private:
+	typedef typename Allocator::template rebind<int8>::other CtrlAllocator;
+
+	static const size_type INVALID_INDEX = (size_type)-1;
+
+	enum
+	{
+		MIN_CAPACITY = MapGroup::WIDTH
+	};
+
+	int8* Ctrl;
+	value_type* Slots;
+	size_type Num;
+	/** Always 0 or a power of two of at least MIN_CAPACITY. */
+	size_type Capacity;
+	/** Empty slots that can still be filled before the table must grow. */
+	size_type GrowthLeft;
+
+	static FORCEINLINE size_type GetMaxLoad(size_type InCapacity) { return InCapacity - InCapacity / 8; }
+	static FORCEINLINE int8 GetH2(uint64 InHash) { return (int8)(InHash & 0x7F); }
+
+	FORCEINLINE iterator MakeIterator(size_type Index)
+	{
+		return iterator(Slots + Index, Ctrl + Index, Ctrl + Capacity);
+	}
+
+	template<typename LookupKey>
+	size_type FindIndex(const LookupKey& Key, uint64 InHash) const
+	{
+		if (Capacity == 0)
+		{
+			return INVALID_INDEX;
+		}
+
+		int8 _H2 = GetH2(InHash);
+		size_type _GroupMask = Capacity / MapGroup::WIDTH - 1;
+		size_type _Group = (size_type)(InHash >> 7) & _GroupMask;
+		// Triangular steps visit every group when the group count is a power of two
+		for (size_type Step = 1; ; Step++)
+		{
+			size_type _GroupStart = _Group * MapGroup::WIDTH;
+			MapGroup _Bytes(Ctrl + _GroupStart);
+			for (uint32 Matches = _Bytes.Match(_H2); Matches != 0; Matches &= Matches - 1)
+			{
+				size_type _Index = _GroupStart + Math::GetNumTrailingZeroes(Matches);
+				if (Equal()(Slots[_Index].first, Key))
+				{
+					return _Index;
+				}
+			}
+			if (_Bytes.MatchEmpty() != 0)
+			{
+				return INVALID_INDEX;
+			}
+			_Group = (_Group + Step) & _GroupMask;
+		}
+	}
+
+	/** First empty or deleted slot on the probe sequence for InHash. The table must have one. */
+	size_type FindFreeIndex(uint64 InHash) const
+	{
+		size_type _GroupMask = Capacity / MapGroup::WIDTH - 1;
+		size_type _Group = (size_type)(InHash >> 7) & _GroupMask;
+		for (size_type Step = 1; ; Step++)
+		{
+			uint32 _Free = MapGroup(Ctrl + _Group * MapGroup::WIDTH).MatchEmptyOrDeleted();
+			if (_Free != 0)
+			{
+				return _Group * MapGroup::WIDTH + Math::GetNumTrailingZeroes(_Free);
+			}
+			_Group = (_Group + Step) & _GroupMask;
+		}
+	}
+
+	/** Claims a slot for a new key with hash InHash, growing first if needed. */
+	size_type PrepareInsert(uint64 InHash)
+	{
+		if (GrowthLeft == 0)
+		{
+			// Mostly deleted slots get cleaned out at the same size rather than doubling
+			size_type _NewCapacity = Capacity == 0 ? (size_type)MIN_CAPACITY
+					: (Num * 2 < GetMaxLoad(Capacity) ? Capacity : Capacity * 2);
+			Rehash(_NewCapacity);
+		}
+
+		size_type _Index = FindFreeIndex(InHash);
+		if (Ctrl[_Index] == MapGroup::CTRL_EMPTY)
+		{
+			GrowthLeft--;
+		}
+		Ctrl[_Index] = GetH2(InHash);
+		Num++;
+		return _Index;
+	}
+
+	void Rehash(size_type NewCapacity)
+	{
+		int8* _OldCtrl = Ctrl;
+		value_type* _OldSlots = Slots;
+		size_type _OldCapacity = Capacity;
+
+		AllocateTable(NewCapacity);
+		GrowthLeft = GetMaxLoad(NewCapacity) - Num;
+		for (size_type Index = 0; Index < _OldCapacity; Index++)
+		{
+			if (_OldCtrl[Index] >= 0)
+			{
+				uint64 _Hash = Hash()(_OldSlots[Index].first);
+				size_type _NewIndex = FindFreeIndex(_Hash);
+				Ctrl[_NewIndex] = GetH2(_Hash);
+				RelocateSlot(Slots + _NewIndex, _OldSlots + Index);
+			}
+		}
+
+		if (_OldCapacity != 0)
+		{
+			FreeTable(_OldCtrl, _OldSlots, _OldCapacity);
+		}
+	}
+
+	static FORCEINLINE void RelocateSlot(value_type* Dest, value_type* Source)
+	{
+		if (IsTriviallyRelocatable<K>::Value && IsTriviallyRelocatable<V>::Value)
+		{
+			Memory::memcpy(Dest, Source, sizeof(value_type));
+		}
+		else
+		{
+			new (Dest) value_type(std::move(*Source));
+			Source->~value_type();
+		}
+	}
+
+	void AllocateTable(size_type NewCapacity)
+	{
+		CtrlAllocator _CtrlAllocator(*this);
+		Ctrl = _CtrlAllocator.allocate(NewCapacity);
+		Slots = Allocator::allocate(NewCapacity);
+		Capacity = NewCapacity;
+		Memory::memset(Ctrl, (uint8)MapGroup::CTRL_EMPTY, NewCapacity);
+	}
+
+	void FreeTable(int8* OldCtrl, value_type* OldSlots, size_type OldCapacity)
+	{
+		CtrlAllocator _CtrlAllocator(*this);
+		_CtrlAllocator.deallocate(OldCtrl, OldCapacity);
+		Allocator::deallocate(OldSlots, OldCapacity);
+	}
+
+	void DestroyElements()
+	{
+		if (!std::is_trivially_destructible<value_type>::value)
+		{
+			for (size_type Index = 0; Index < Capacity; Index++)
+			{
+				if (Ctrl[Index] >= 0)
+				{
+					Slots[Index].~value_type();
+				}
+			}
+		}
+	}
+
+	void DestroyTable()
+	{
+		if (Capacity != 0)
+		{
+			DestroyElements();
+			FreeTable(Ctrl, Slots, Capacity);
+		}
+		ForgetTable();
+	}
+
+	FORCEINLINE void ForgetTable()
+	{
+		Ctrl = nullptr;
+		Slots = nullptr;
+		Num = 0;
+		Capacity = 0;
+		GrowthLeft = 0;
+	}
+};
+
+/** The table only holds pointers to its slots, so the map itself can be moved bytewise. */
+template<typename K, typename V, typename Hash, typename Equal, typename Allocator>
+struct IsTriviallyRelocatable<Map<K, V, Hash, Equal, Allocator>>
+{
+	static const bool Value = std::is_empty<Allocator>::value;
+};
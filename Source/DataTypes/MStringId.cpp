@@ -0,0 +1,147 @@
+#include "MStringId.h"
+#include "Platform/PlatformMemoryManager.h"
+#include <atomic>
+
+namespace
+{
+	enum
+	{
+		/** Most distinct names that can be interned; the table never grows. */
+		TABLE_CAPACITY = 1 << 16,
+		TEXT_CHUNK_SIZE = 16 * 1024,
+		/** Longer names get an allocation of their own rather than a chunk's tail. */
+		MAX_CHUNK_TEXT = TEXT_CHUNK_SIZE / 8
+	};
+
+	/** Published by storing Text after Value has been claimed. */
+	struct InternEntry
+	{
+		std::atomic<uint64> Value;
+		std::atomic<const char*> Text;
+	};
+
+	struct TextChunk
+	{
+		std::atomic<uint32> Used;
+		char Data[TEXT_CHUNK_SIZE];
+	};
+
+	InternEntry g_Table[TABLE_CAPACITY];
+	std::atomic<uint32> g_NumInterned(0);
+	std::atomic<TextChunk*> g_TextChunk(nullptr);
+
+	FORCEINLINE uint32 GetFirstSlot(uint64 Value)
+	{
+		return (uint32)(Value ^ (Value >> 32)) & (TABLE_CAPACITY - 1);
+	}
+
+	/*
+	 *	Copies Text into storage that lives until exit. Taken straight from
+	 *	PlatformMemory so that the memory tracker does not report it as leaked.
+	 **/
+	const char* StoreText(const char* Text, uintptr Length)
+	{
+		char* _Copy = nullptr;
+		uint32 _Size = (uint32)Length + 1;
+		if (Length >= MAX_CHUNK_TEXT)
+		{
+			_Copy = (char*)PlatformMemory::Malloc(_Size, 1);
+		}
+		while (_Copy == nullptr)
+		{
+			TextChunk* _Chunk = g_TextChunk.load(std::memory_order_acquire);
+			if (_Chunk != nullptr)
+			{
+				uint32 _Offset = _Chunk->Used.fetch_add(_Size, std::memory_order_relaxed);
+				if (_Offset + _Size <= TEXT_CHUNK_SIZE)
+				{
+					_Copy = _Chunk->Data + _Offset;
+					break;
+				}
+			}
+
+			// Full, or the first use: whoever wins the swap provides the next chunk
+			TextChunk* _NewChunk = (TextChunk*)PlatformMemory::Malloc(sizeof(TextChunk), alignof(TextChunk));
+			_NewChunk->Used.store(0, std::memory_order_relaxed);
+			if (!g_TextChunk.compare_exchange_strong(_Chunk, _NewChunk, std::memory_order_acq_rel))
+			{
+				PlatformMemory::Free(_NewChunk);
+			}
+		}
+
+		PlatformMemory::Memcpy(_Copy, Text, Length);
+		_Copy[Length] = '\0';
+		return _Copy;
+	}
+
+#ifdef DEBUG
+	void CheckCollision(const InternEntry& Entry, const char* Text, uintptr Length)
+	{
+		const char* _Existing;
+		while ((_Existing = Entry.Text.load(std::memory_order_acquire)) == nullptr)
+		{
+			// Another thread claimed the slot and is still copying its text
+		}
+		assert((strncmp(_Existing, Text, Length) == 0 && _Existing[Length] == '\0')
+				&& "Two names hash to the same StringId");
+	}
+#endif
+}
+
+StringId StringId::Intern(const char* Text, uintptr Length)
+{
+	uint64 _Value = Hash(Text, Length);
+	for (uint32 _Slot = GetFirstSlot(_Value), _Probes = 0; _Probes < TABLE_CAPACITY;
+			_Slot = (_Slot + 1) & (TABLE_CAPACITY - 1), _Probes++)
+	{
+		InternEntry& _Entry = g_Table[_Slot];
+		uint64 _Existing = _Entry.Value.load(std::memory_order_acquire);
+		if (_Existing == 0)
+		{
+			if (_Entry.Value.compare_exchange_strong(_Existing, _Value, std::memory_order_acq_rel))
+			{
+				_Entry.Text.store(StoreText(Text, Length), std::memory_order_release);
+				g_NumInterned.fetch_add(1, std::memory_order_relaxed);
+				return StringId(_Value);
+			}
+			// Lost the slot to another thread; _Existing now holds its value
+		}
+		if (_Existing == _Value)
+		{
+#ifdef DEBUG
+			CheckCollision(_Entry, Text, Length);
+#endif
+			return StringId(_Value);
+		}
+	}
+
+	DEBUG_LOG("StringId", LOG_ERROR, "Intern table is full, \"%.*s\" was not recorded", (int)Length, Text);
+	return StringId(_Value);
+}
+
+uint32 StringId::GetNumInterned()
+{
+	return g_NumInterned.load(std::memory_order_relaxed);
+}
+
+const char* StringId::GetString() const
+{
+	if (Value == 0)
+	{
+		return nullptr;
+	}
+	for (uint32 _Slot = GetFirstSlot(Value), _Probes = 0; _Probes < TABLE_CAPACITY;
+			_Slot = (_Slot + 1) & (TABLE_CAPACITY - 1), _Probes++)
+	{
+		uint64 _Existing = g_Table[_Slot].Value.load(std::memory_order_acquire);
+		if (_Existing == Value)
+		{
+			return g_Table[_Slot].Text.load(std::memory_order_acquire);
+		}
+		if (_Existing == 0)
+		{
+			return nullptr;
+		}
+	}
+	return nullptr;
+}
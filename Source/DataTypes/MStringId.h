@@ -0,0 +1,65 @@
+#pragma once
+
+#include "EngineCore/EngineUtils.h"
+#include "DataTypes/MString.h"
+#include <cstring>
+#include <type_traits>
+
+/*
+ *	A name reduced to its 64-bit FNV-1a hash, so comparing, hashing and
+ *	copying it costs no more than an integer. STRING_ID("name") hashes a
+ *	literal at compile time; Intern hashes a runtime string and records its
+ *	text, so GetString can give it back for logging. Both produce the same
+ *	id for the same text.
+ *
+ *	Two names hashing to the same id is assumed never to happen. Debug
+ *	builds assert on it when both names are interned.
+ **/
+class StringId
+{
+public:
+	CONSTEXPR StringId() :
+		Value(0) {}
+	explicit CONSTEXPR StringId(uint64 InValue) :
+		Value(InValue) {}
+
+	/** Hash of a null terminated string, usable in constant expressions. */
+	static CONSTEXPR uint64 HashLiteral(const char* Text, uint64 Hash = 0xcbf29ce484222325ull)
+	{
+		return *Text == '\0' ? Hash : HashLiteral(Text + 1, (Hash ^ (uint8)*Text) * 0x100000001b3ull);
+	}
+
+	static FORCEINLINE uint64 Hash(const char* Text, uintptr Length)
+	{
+		uint64 _Hash = 0xcbf29ce484222325ull;
+		for (uintptr Index = 0; Index < Length; Index++)
+		{
+			_Hash = (_Hash ^ (uint8)Text[Index]) * 0x100000001b3ull;
+		}
+		return _Hash;
+	}
+
+	/*
+	 *	Id of Text, recording the text the first time it is seen. Takes no
+	 *	locks, and only allocates for text that is new.
+	 **/
+	static StringId Intern(const char* Text, uintptr Length);
+	static FORCEINLINE StringId Intern(const char* Text) { return Intern(Text, strlen(Text)); }
+	static FORCEINLINE StringId Intern(const String& Text) { return Intern(Text.data(), Text.size()); }
+	static uint32 GetNumInterned();
+
+	/** Text the id was interned from, or nullptr if it never was. */
+	const char* GetString() const;
+
+	FORCEINLINE CONSTEXPR bool IsValid() const { return Value != 0; }
+	FORCEINLINE CONSTEXPR uint64 GetValue() const { return Value; }
+
+	FORCEINLINE CONSTEXPR bool operator==(const StringId& Other) const { return Value == Other.Value; }
+	FORCEINLINE CONSTEXPR bool operator!=(const StringId& Other) const { return Value != Other.Value; }
+	FORCEINLINE CONSTEXPR bool operator<(const StringId& Other) const { return Value < Other.Value; }
+private:
+	uint64 Value;
+};
+
+/** StringId of a string literal, hashed at compile time. */
+#define STRING_ID(Literal) StringId(std::integral_constant<uint64, StringId::HashLiteral(Literal)>::value)
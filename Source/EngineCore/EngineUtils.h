@@ -84,16 +84,6 @@ typedef uintptr_t					uintptr;
 	T(const T& other) {(void)other;} \
 	void operator=(const T& other) { (void)other; }
 
-#define LOG_ERROR "Error"
-#define LOG_WARNING "Warning"
-#define LOG_TYPE_RENDERER "Renderer"
-#define LOG_TYPE_IO "IO"
-#define DEBUG_LOG(category, level, message, ...) \
-	fprintf(stderr, "[%s] ", category); \
-	fprintf(stderr, "[%s] (%s:%d): ", level, __FILE__, __LINE__); \
-	fprintf(stderr, message, ##__VA_ARGS__); \
-	fprintf(stderr, "\n")
-#define DEBUG_LOG_TEMP(message, ...) DEBUG_LOG("TEMP", "TEMP", message, ##__VA_ARGS__)
-#define DEBUG_LOG_TEMP2(message) DEBUG_LOG("TEMP", "TEMP", "%s", message)
 #define ARRAY_SIZE_IN_ELEMENTS(a) (sizeof(a)/sizeof(a[0]))
 
+#include "EngineCore/Logger.h"
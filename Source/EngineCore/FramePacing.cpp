@@ -0,0 +1,37 @@
+#include "FramePacing.h"
+#include "EngineCore/TimerManager.h"
+
+uint64 FrameLimiter::Wait()
+{
+	uint64 _Now = Time::getNanoseconds();
+	if (NextDeadline == 0 || _Now > NextDeadline + PeriodNanoseconds)
+	{
+		NextDeadline = _Now;
+	}
+	Time::sleepUntil(NextDeadline);
+
+	uint64 _Deadline = NextDeadline;
+	NextDeadline += PeriodNanoseconds;
+	return _Deadline;
+}
+
+uint64 FixedStepScheduler::WaitForStep()
+{
+	uint64 _Now = Time::getNanoseconds();
+	if (NextDeadline == 0)
+	{
+		NextDeadline = _Now;
+	}
+	else if (_Now > NextDeadline + MaxLateSteps * StepNanoseconds)
+	{
+		uint64 _Dropped = (_Now - NextDeadline) / StepNanoseconds - MaxLateSteps;
+		NextDeadline += _Dropped * StepNanoseconds;
+		NumDroppedSteps += _Dropped;
+	}
+	Time::sleepUntil(NextDeadline);
+
+	uint64 _Deadline = NextDeadline;
+	NextDeadline += StepNanoseconds;
+	NumSteps++;
+	return _Deadline;
+}
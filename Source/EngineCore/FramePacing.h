@@ -0,0 +1,61 @@
+#pragma once
+
+#include "EngineCore/EngineUtils.h"
+
+/*
+ *	Holds a loop to one iteration per period. Each wait is for an absolute
+ *	deadline a period after the last one, so the time spent in the loop and
+ *	any oversleeping do not add up over frames. A frame that starts more
+ *	than a period late restarts the schedule from now rather than rushing
+ *	the next frames out to catch up.
+ **/
+class FrameLimiter
+{
+public:
+	explicit FrameLimiter(uint64 PeriodNanosecondsIn) :
+		PeriodNanoseconds(PeriodNanosecondsIn),
+		NextDeadline(0) {}
+
+	/** Sleeps until the next frame is due and returns when that was, in Time::getNanoseconds time. */
+	uint64 Wait();
+
+	FORCEINLINE uint64 GetPeriod() const { return PeriodNanoseconds; }
+	/** Takes effect from the frame after the next one. */
+	FORCEINLINE void SetPeriod(uint64 PeriodNanosecondsIn) { PeriodNanoseconds = PeriodNanosecondsIn; }
+private:
+	uint64 PeriodNanoseconds;
+	/** 0 until the first Wait. */
+	uint64 NextDeadline;
+};
+
+/*
+ *	Due times for a fixed-step simulation, a step apart from the first call
+ *	on. A caller that falls behind gets the steps it missed back to back, up
+ *	to MaxLateSteps of them; steps later than that are dropped, keeping the
+ *	schedule's phase, so one long stall is not followed by a spiral of
+ *	catching up.
+ **/
+class FixedStepScheduler
+{
+public:
+	FixedStepScheduler(uint64 StepNanosecondsIn, uint32 MaxLateStepsIn = 4) :
+		StepNanoseconds(StepNanosecondsIn),
+		MaxLateSteps(MaxLateStepsIn),
+		NextDeadline(0),
+		NumSteps(0),
+		NumDroppedSteps(0) {}
+
+	/** Sleeps until the next step is due and returns when that was, in Time::getNanoseconds time. */
+	uint64 WaitForStep();
+
+	FORCEINLINE uint64 GetStepNanoseconds() const { return StepNanoseconds; }
+	FORCEINLINE uint64 GetNumSteps() const { return NumSteps; }
+	FORCEINLINE uint64 GetNumDroppedSteps() const { return NumDroppedSteps; }
+private:
+	uint64 StepNanoseconds;
+	uint32 MaxLateSteps;
+	/** 0 until the first WaitForStep. */
+	uint64 NextDeadline;
+	uint64 NumSteps;
+	uint64 NumDroppedSteps;
+};
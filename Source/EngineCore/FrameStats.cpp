@@ -0,0 +1,139 @@
+#include "FrameStats.h"
+#include "EngineCore/MemoryManager.h"
+#include "Math/Math.h"
+
+static const double BUCKET_WIDTH_MS = 0.1;
+
+void FrameHistogram::Add(double Milliseconds)
+{
+	Milliseconds = Math::Max(Milliseconds, 0.0);
+	double _Bucket = Milliseconds/BUCKET_WIDTH_MS;
+	Buckets[_Bucket < (double)NUM_BUCKETS ? (uint32)_Bucket : (uint32)NUM_BUCKETS]++;
+	Count++;
+	Total += Milliseconds;
+	Max = Math::Max(Max, Milliseconds);
+}
+
+void FrameHistogram::Reset()
+{
+	Memory::memset(Buckets, 0, sizeof(Buckets));
+	Count = 0;
+	Total = 0.0;
+	Max = 0.0;
+}
+
+double FrameHistogram::GetPercentile(double Percentile) const
+{
+	if (Count == 0)
+	{
+		return 0.0;
+	}
+
+	// Rank of the sample at the percentile, counting from 1
+	uint32 _Rank = (uint32)Math::CeilToDouble(Percentile * 0.01 * (double)Count);
+	_Rank = Math::Clamp(_Rank, (uint32)1, Count);
+
+	uint32 _Seen = 0;
+	for (uint32 Index = 0; Index < NUM_BUCKETS; Index++)
+	{
+		_Seen += Buckets[Index];
+		if (_Seen >= _Rank)
+		{
+			return Math::Min((double)(Index + 1) * BUCKET_WIDTH_MS, Max);
+		}
+	}
+	return Max;
+}
+
+void FrameStats::AddFrame(const FrameSample& Sample)
+{
+	FrameTimes.Add(Sample.FrameTime);
+	CPUTimes.Add(Sample.FrameTime - Sample.SleepTime - Sample.PresentTime);
+	SleepTimes.Add(Sample.SleepTime);
+	PresentTimes.Add(Sample.PresentTime);
+
+	if (Sample.FrameTime > HitchThresholdMs)
+	{
+		NumHitches++;
+	}
+	MaxUpdates = Math::Max(MaxUpdates, Sample.NumUpdates);
+	TotalUpdates += Sample.NumUpdates;
+}
+
+void FrameStats::Reset()
+{
+	FrameTimes.Reset();
+	CPUTimes.Reset();
+	SleepTimes.Reset();
+	PresentTimes.Reset();
+	NumHitches = 0;
+	MaxUpdates = 0;
+	TotalUpdates = 0;
+}
+
+void FrameStats::Log(const char* Label) const
+{
+	const FrameHistogram* _Histograms[] = { &FrameTimes, &CPUTimes, &SleepTimes, &PresentTimes };
+	const char* _Names[] = { "frame", "cpu", "sleep", "present" };
+
+	DEBUG_LOG("FrameStats", LOG_INFO, "%s: %u frames, %u hitches (> %.1f ms), %.2f updates/frame (max %u)",
+			Label, GetNumFrames(), NumHitches, HitchThresholdMs, GetMeanUpdatesPerFrame(), MaxUpdates);
+	for (uint32 Index = 0; Index < ARRAY_SIZE_IN_ELEMENTS(_Histograms); Index++)
+	{
+		const FrameHistogram& _Histogram = *_Histograms[Index];
+		DEBUG_LOG("FrameStats", LOG_INFO, "%s: %-8s p50 %6.1f  p95 %6.1f  p99 %6.1f  max %6.1f ms",
+				Label, _Names[Index], _Histogram.GetPercentile(50.0), _Histogram.GetPercentile(95.0),
+				_Histogram.GetPercentile(99.0), _Histogram.GetMax());
+	}
+}
+
+bool FrameStats::WriteCSV(const String& FileName) const
+{
+	FILE* _File = fopen(FileName.c_str(), "w");
+	if (_File == nullptr)
+	{
+		DEBUG_LOG(LOG_TYPE_IO, LOG_ERROR, "Could not open %s for writing", FileName.c_str());
+		return false;
+	}
+
+	const FrameHistogram* _Histograms[] = { &FrameTimes, &CPUTimes, &SleepTimes, &PresentTimes };
+	const char* _Names[] = { "frame", "cpu", "sleep", "present" };
+
+	fprintf(_File, "timing,frames,mean_ms,p50_ms,p95_ms,p99_ms,max_ms,hitches,hitch_threshold_ms\n");
+	for (uint32 Index = 0; Index < ARRAY_SIZE_IN_ELEMENTS(_Histograms); Index++)
+	{
+		const FrameHistogram& _Histogram = *_Histograms[Index];
+		fprintf(_File, "%s,%u,%.3f,%.3f,%.3f,%.3f,%.3f,%u,%.3f\n", _Names[Index],
+				_Histogram.GetCount(), _Histogram.GetMean(), _Histogram.GetPercentile(50.0),
+				_Histogram.GetPercentile(95.0), _Histogram.GetPercentile(99.0), _Histogram.GetMax(),
+				NumHitches, HitchThresholdMs);
+	}
+	return fclose(_File) == 0;
+}
+
+bool FrameStats::WriteJSON(const String& FileName) const
+{
+	FILE* _File = fopen(FileName.c_str(), "w");
+	if (_File == nullptr)
+	{
+		DEBUG_LOG(LOG_TYPE_IO, LOG_ERROR, "Could not open %s for writing", FileName.c_str());
+		return false;
+	}
+
+	const FrameHistogram* _Histograms[] = { &FrameTimes, &CPUTimes, &SleepTimes, &PresentTimes };
+	const char* _Names[] = { "frame", "cpu", "sleep", "present" };
+
+	fprintf(_File, "{\n\t\"frames\": %u,\n\t\"hitches\": %u,\n\t\"hitchThresholdMs\": %.3f,\n",
+			GetNumFrames(), NumHitches, HitchThresholdMs);
+	fprintf(_File, "\t\"meanUpdatesPerFrame\": %.3f,\n\t\"maxUpdatesPerFrame\": %u",
+			GetMeanUpdatesPerFrame(), MaxUpdates);
+	for (uint32 Index = 0; Index < ARRAY_SIZE_IN_ELEMENTS(_Histograms); Index++)
+	{
+		const FrameHistogram& _Histogram = *_Histograms[Index];
+		fprintf(_File, ",\n\t\"%s\": { \"meanMs\": %.3f, \"p50Ms\": %.3f, \"p95Ms\": %.3f, \"p99Ms\": %.3f, \"maxMs\": %.3f }",
+				_Names[Index], _Histogram.GetMean(), _Histogram.GetPercentile(50.0),
+				_Histogram.GetPercentile(95.0), _Histogram.GetPercentile(99.0), _Histogram.GetMax());
+	}
+	fprintf(_File, "\n}\n");
+	return fclose(_File) == 0;
+}
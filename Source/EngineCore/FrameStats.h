@@ -0,0 +1,92 @@
+#pragma once
+
+#include "EngineCore/EngineUtils.h"
+#include "DataTypes/MString.h"
+
+/*
+ *	Fixed size histogram of millisecond timings, in 0.1ms buckets. Anything
+ *	at or above 100ms lands in a single overflow bucket, where percentiles
+ *	fall back to the exact maximum.
+ **/
+class FrameHistogram
+{
+public:
+	enum
+	{
+		NUM_BUCKETS = 1000
+	};
+
+	FrameHistogram() { Reset(); }
+
+	void Add(double Milliseconds);
+	void Reset();
+
+	/** Upper edge of the bucket holding the given percentile, in [0, 100]. */
+	double GetPercentile(double Percentile) const;
+	FORCEINLINE double GetMax() const { return Max; }
+	FORCEINLINE double GetMean() const { return Count == 0 ? 0.0 : Total/(double)Count; }
+	FORCEINLINE uint32 GetCount() const { return Count; }
+private:
+	uint32 Buckets[NUM_BUCKETS + 1];
+	uint32 Count;
+	double Total;
+	double Max;
+};
+
+/** Timings of one presented frame, in milliseconds. */
+struct FrameSample
+{
+	/** Present to present. */
+	double FrameTime;
+	/** Part of FrameTime spent sleeping while waiting for the next update. */
+	double SleepTime;
+	/** Part of FrameTime spent in Window::present. */
+	double PresentTime;
+	/** Fixed update steps run for this frame. */
+	uint32 NumUpdates;
+};
+
+/*
+ *	Collects FrameSamples into histograms so hitches show up, rather than
+ *	averaging them away the way an FPS counter does. A frame is a hitch
+ *	when its FrameTime is above the threshold given on construction.
+ **/
+class FrameStats
+{
+public:
+	explicit FrameStats(double HitchThresholdMsIn) :
+		HitchThresholdMs(HitchThresholdMsIn) { Reset(); }
+
+	void AddFrame(const FrameSample& Sample);
+	void Reset();
+
+	/** Logs p50/p95/p99/max of every timing, and the hitch count. */
+	void Log(const char* Label) const;
+	bool WriteCSV(const String& FileName) const;
+	bool WriteJSON(const String& FileName) const;
+
+	FORCEINLINE const FrameHistogram& GetFrameTimes() const { return FrameTimes; }
+	FORCEINLINE const FrameHistogram& GetCPUTimes() const { return CPUTimes; }
+	FORCEINLINE const FrameHistogram& GetSleepTimes() const { return SleepTimes; }
+	FORCEINLINE const FrameHistogram& GetPresentTimes() const { return PresentTimes; }
+	FORCEINLINE uint32 GetNumFrames() const { return FrameTimes.GetCount(); }
+	FORCEINLINE uint32 GetNumHitches() const { return NumHitches; }
+	FORCEINLINE uint32 GetMaxUpdatesPerFrame() const { return MaxUpdates; }
+	FORCEINLINE double GetMeanUpdatesPerFrame() const;
+private:
+	double HitchThresholdMs;
+	/** Frame time minus sleep and present, ie. what the engine itself spent. */
+	FrameHistogram CPUTimes;
+	FrameHistogram FrameTimes;
+	FrameHistogram SleepTimes;
+	FrameHistogram PresentTimes;
+	uint32 NumHitches;
+	uint32 MaxUpdates;
+	uint64 TotalUpdates;
+};
+
+FORCEINLINE double FrameStats::GetMeanUpdatesPerFrame() const
+{
+	uint32 _NumFrames = GetNumFrames();
+	return _NumFrames == 0 ? 0.0 : (double)TotalUpdates/(double)_NumFrames;
+}
@@ -0,0 +1,174 @@
+#pragma once
+
+#include "EngineCore/EngineUtils.h"
+#include "DataTypes/MArray.h"
+
+/*
+ *	Reference to an object in a HandlePool. The index picks a slot of the
+ *	pool and the generation tells apart the objects that have used that
+ *	slot, so a handle to a released object is caught rather than reaching
+ *	whatever took its place. Tag keeps handles of different pools apart.
+ *
+ *	Live handles never have generation 0, so the default handle is invalid.
+ *	A slot's generation wraps around after MAX_GENERATION reuses.
+ **/
+template<typename Tag>
+class Handle
+{
+public:
+	enum
+	{
+		INDEX_BITS = 20,
+		GENERATION_BITS = 32 - INDEX_BITS,
+		MAX_INDEX = (1 << INDEX_BITS) - 1,
+		MAX_GENERATION = (1 << GENERATION_BITS) - 1
+	};
+
+	FORCEINLINE Handle() :
+		Value(0) {}
+
+	static FORCEINLINE Handle Make(uint32 Index, uint32 Generation)
+	{
+		assertCheck(Index <= MAX_INDEX && Generation != 0 && Generation <= MAX_GENERATION);
+		Handle _Result;
+		_Result.Value = (Generation << INDEX_BITS) | Index;
+		return _Result;
+	}
+
+	FORCEINLINE uint32 GetIndex() const { return Value & MAX_INDEX; }
+	FORCEINLINE uint32 GetGeneration() const { return Value >> INDEX_BITS; }
+	FORCEINLINE bool IsValid() const { return Value != 0; }
+	/** Index and generation packed together, for sort keys and hashing. */
+	FORCEINLINE uint32 GetValue() const { return Value; }
+
+	FORCEINLINE bool operator==(const Handle& Other) const { return Value == Other.Value; }
+	FORCEINLINE bool operator!=(const Handle& Other) const { return Value != Other.Value; }
+	FORCEINLINE bool operator<(const Handle& Other) const { return Value < Other.Value; }
+private:
+	uint32 Value;
+};
+
+/*
+ *	Hands out generational handles to objects kept densely packed, so
+ *	walking every live object is a linear pass over arrays. The pool only
+ *	tracks which dense index each handle maps to; the owner keeps the
+ *	object's data in one Array per field (its columns), all indexed by
+ *	dense index:
+ *
+ *		Handle = Pool.Allocate();        then push_back a value onto every column
+ *		Index = Pool.GetDenseIndex(Handle);
+ *		Pool.Free(Handle, ColumnA, ColumnB, ...);
+ *
+ *	Freeing moves the last object into the freed dense index, so dense
+ *	indices are only stable until the next Free.
+ **/
+template<typename Tag>
+class HandlePool
+{
+public:
+	typedef Handle<Tag> HandleType;
+
+	static const uint32 INVALID_INDEX = 0xFFFFFFFF;
+
+	HandlePool() :
+		FirstFree(INVALID_INDEX) {}
+
+	/** Adds an object at dense index GetNum() - 1. Its columns must be appended to match. */
+	HandleType Allocate()
+	{
+		uint32 _SlotIndex;
+		if (FirstFree != INVALID_INDEX)
+		{
+			_SlotIndex = FirstFree;
+			FirstFree = Slots[_SlotIndex].DenseIndex;
+		}
+		else
+		{
+			_SlotIndex = (uint32)Slots.size();
+			assertCheck(_SlotIndex <= HandleType::MAX_INDEX);
+			Slot _NewSlot = { 1, 0 };
+			Slots.push_back(_NewSlot);
+		}
+
+		Slots[_SlotIndex].DenseIndex = (uint32)SlotIndices.size();
+		SlotIndices.push_back(_SlotIndex);
+		return HandleType::Make(_SlotIndex, Slots[_SlotIndex].Generation);
+	}
+
+	/** Dense index of Handle's object, or INVALID_INDEX if it was freed or never valid. */
+	FORCEINLINE uint32 Find(HandleType InHandle) const
+	{
+		uint32 _SlotIndex = InHandle.GetIndex();
+		if (_SlotIndex >= Slots.size() || Slots[_SlotIndex].Generation != InHandle.GetGeneration())
+		{
+			return INVALID_INDEX;
+		}
+		return Slots[_SlotIndex].DenseIndex;
+	}
+
+	/** Like Find, but a stale or invalid Handle is a bug, asserted on in debug builds. */
+	FORCEINLINE uint32 GetDenseIndex(HandleType InHandle) const
+	{
+		uint32 _Result = Find(InHandle);
+		assertCheck(_Result != INVALID_INDEX && "Use of a released or invalid handle");
+		return _Result;
+	}
+
+	FORCEINLINE bool IsValid(HandleType InHandle) const { return Find(InHandle) != INVALID_INDEX; }
+	FORCEINLINE uint32 GetNum() const { return (uint32)SlotIndices.size(); }
+
+	FORCEINLINE HandleType GetHandle(uint32 DenseIndex) const
+	{
+		uint32 _SlotIndex = SlotIndices[DenseIndex];
+		return HandleType::Make(_SlotIndex, Slots[_SlotIndex].Generation);
+	}
+
+	/*
+	 *	Frees Handle's object, which must be live. The last object moves into
+	 *	its dense index, in the pool and in each of Columns.
+	 **/
+	template<typename... ColumnTypes>
+	void Free(HandleType InHandle, ColumnTypes&... Columns)
+	{
+		uint32 _DenseIndex = GetDenseIndex(InHandle);
+		uint32 _LastIndex = GetNum() - 1;
+		int32 _Expand[] = { 0, (RemoveAtSwap(Columns, _DenseIndex, _LastIndex), 0)... };
+		(void)_Expand;
+
+		uint32 _MovedSlot = SlotIndices[_LastIndex];
+		SlotIndices[_DenseIndex] = _MovedSlot;
+		Slots[_MovedSlot].DenseIndex = _DenseIndex;
+		SlotIndices.pop_back();
+
+		Slot& _Freed = Slots[InHandle.GetIndex()];
+		_Freed.Generation = _Freed.Generation == HandleType::MAX_GENERATION ? 1 : _Freed.Generation + 1;
+		_Freed.DenseIndex = FirstFree;
+		FirstFree = InHandle.GetIndex();
+	}
+private:
+	struct Slot
+	{
+		uint32 Generation;
+		/** Dense index of the slot's object, or the next free slot while it is free. */
+		uint32 DenseIndex;
+	};
+
+	Array<Slot> Slots;
+	/** Slot of each dense index. */
+	Array<uint32> SlotIndices;
+	uint32 FirstFree;
+
+	template<typename ColumnType>
+	static FORCEINLINE void RemoveAtSwap(ColumnType& Column, uint32 Index, uint32 LastIndex)
+	{
+		assertCheck(Column.size() == LastIndex + 1);
+		if (Index != LastIndex)
+		{
+			Column[Index] = std::move(Column[LastIndex]);
+		}
+		Column.pop_back();
+	}
+};
+
+template<typename Tag>
+const uint32 HandlePool<Tag>::INVALID_INDEX;
@@ -0,0 +1,404 @@
+#include "JobSystem.h"
+#include "EngineCore/MemoryManager.h"
+#include "EngineCore/Profiler.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+	/*
+	 *	Chase-Lev deque, after Le et al., "Correct and Efficient Work-Stealing
+	 *	for Weak Memory Models". The owning thread pushes and pops at Bottom;
+	 *	any thread may steal at Top.
+	 **/
+	class JobQueue
+	{
+	public:
+		enum
+		{
+			CAPACITY = JobSystem::MAX_JOBS_PER_THREAD
+		};
+
+		JobQueue() :
+			Top(0),
+			Bottom(0) {}
+
+		/** Returns false, leaving the job to the caller, when the queue is full. */
+		bool Push(Job* InJob)
+		{
+			int64 _Bottom = Bottom.load(std::memory_order_relaxed);
+			int64 _Top = Top.load(std::memory_order_acquire);
+			if (_Bottom - _Top >= CAPACITY)
+			{
+				return false;
+			}
+			Jobs[_Bottom & (CAPACITY - 1)].store(InJob, std::memory_order_relaxed);
+			Bottom.store(_Bottom + 1, std::memory_order_release);
+			return true;
+		}
+
+		Job* Pop()
+		{
+			int64 _Bottom = Bottom.load(std::memory_order_relaxed) - 1;
+			Bottom.store(_Bottom, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64 _Top = Top.load(std::memory_order_relaxed);
+			if (_Top > _Bottom)
+			{
+				Bottom.store(_Bottom + 1, std::memory_order_relaxed);
+				return nullptr;
+			}
+
+			Job* _Job = Jobs[_Bottom & (CAPACITY - 1)].load(std::memory_order_relaxed);
+			if (_Top == _Bottom)
+			{
+				// Last job: race the stealers for it
+				if (!Top.compare_exchange_strong(_Top, _Top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				{
+					_Job = nullptr;
+				}
+				Bottom.store(_Bottom + 1, std::memory_order_relaxed);
+			}
+			return _Job;
+		}
+
+		Job* Steal()
+		{
+			int64 _Top = Top.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64 _Bottom = Bottom.load(std::memory_order_acquire);
+			if (_Top >= _Bottom)
+			{
+				return nullptr;
+			}
+
+			Job* _Job = Jobs[_Top & (CAPACITY - 1)].load(std::memory_order_relaxed);
+			if (!Top.compare_exchange_strong(_Top, _Top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			{
+				return nullptr;
+			}
+			return _Job;
+		}
+
+		bool IsEmpty() const
+		{
+			return Top.load(std::memory_order_acquire) >= Bottom.load(std::memory_order_acquire);
+		}
+	private:
+		alignas(64) std::atomic<int64> Top;
+		alignas(64) std::atomic<int64> Bottom;
+		alignas(64) std::atomic<Job*> Jobs[CAPACITY];
+	};
+
+	/** Jobs created by a thread. Freed when the thread exits. */
+	struct JobRing
+	{
+		Job* Jobs;
+		uint32 Next;
+
+		JobRing() :
+			Jobs(nullptr),
+			Next(0) {}
+		~JobRing()
+		{
+			Memory::free(Jobs);
+		}
+	};
+
+	JobQueue* g_Queues[JobSystem::MAX_THREADS];
+	uint32 g_NumThreads = 0;
+	std::thread* g_Workers = nullptr;
+	std::atomic<bool> g_bRunning(false);
+
+	/** Workers that found nothing to do sleep here until a job is pushed. */
+	std::mutex g_SleepMutex;
+	std::condition_variable g_SleepCondition;
+	std::atomic<uint32> g_NumSleeping(0);
+
+	char g_WorkerNames[JobSystem::MAX_THREADS][16];
+
+	thread_local JobRing t_Jobs;
+	/** Index of the calling thread's queue, or MAX_THREADS if it has none. */
+	thread_local uint32 t_QueueIndex = JobSystem::MAX_THREADS;
+	thread_local uint32 t_RandomState = 0;
+
+	enum
+	{
+		/** Rounds of looking for work that a worker spends spinning before it sleeps. */
+		SPIN_ROUNDS = 64
+	};
+
+	FORCEINLINE bool hasQueue()
+	{
+		return t_QueueIndex < JobSystem::MAX_THREADS && g_bRunning.load(std::memory_order_acquire);
+	}
+
+	FORCEINLINE uint32 nextRandom()
+	{
+		// xorshift32, seeded from the queue index
+		uint32 _State = t_RandomState != 0 ? t_RandomState : t_QueueIndex * 0x9E3779B9u + 1;
+		_State ^= _State << 13;
+		_State ^= _State >> 17;
+		_State ^= _State << 5;
+		t_RandomState = _State;
+		return _State;
+	}
+
+	void finish(Job* InJob)
+	{
+		Job* _Parent = InJob->Parent;
+		if (InJob->UnfinishedJobs.fetch_sub(1, std::memory_order_acq_rel) == 1 && _Parent != nullptr)
+		{
+			finish(_Parent);
+		}
+	}
+
+	FORCEINLINE void execute(Job* InJob)
+	{
+		InJob->Function(InJob, InJob->Data);
+		finish(InJob);
+	}
+
+	/** Pops from the calling thread's queue, or steals from another one. */
+	Job* findJob()
+	{
+		Job* _Job = g_Queues[t_QueueIndex]->Pop();
+		if (_Job != nullptr)
+		{
+			return _Job;
+		}
+
+		uint32 _NumThreads = g_NumThreads;
+		uint32 _Start = nextRandom() % _NumThreads;
+		for (uint32 Index = 0; Index < _NumThreads; Index++)
+		{
+			uint32 _Victim = (_Start + Index) % _NumThreads;
+			if (_Victim == t_QueueIndex)
+			{
+				continue;
+			}
+			_Job = g_Queues[_Victim]->Steal();
+			if (_Job != nullptr)
+			{
+				return _Job;
+			}
+		}
+		return nullptr;
+	}
+
+	bool anyQueued()
+	{
+		for (uint32 Index = 0; Index < g_NumThreads; Index++)
+		{
+			if (!g_Queues[Index]->IsEmpty())
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void wakeWorker()
+	{
+		// Pairs with the fence in sleepWorker, so either this sees the sleeper or it sees the job
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (g_NumSleeping.load(std::memory_order_relaxed) != 0)
+		{
+			std::lock_guard<std::mutex> _Lock(g_SleepMutex);
+			g_SleepCondition.notify_one();
+		}
+	}
+
+	void sleepWorker()
+	{
+		std::unique_lock<std::mutex> _Lock(g_SleepMutex);
+		g_NumSleeping.fetch_add(1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (!anyQueued() && g_bRunning.load(std::memory_order_acquire))
+		{
+			g_SleepCondition.wait(_Lock);
+		}
+		g_NumSleeping.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	void workerThread(uint32 QueueIndex)
+	{
+		t_QueueIndex = QueueIndex;
+		Profiler::SetThreadName(g_WorkerNames[QueueIndex]);
+
+		uint32 _IdleRounds = 0;
+		while (g_bRunning.load(std::memory_order_acquire))
+		{
+			Job* _Job = findJob();
+			if (_Job != nullptr)
+			{
+				execute(_Job);
+				_IdleRounds = 0;
+			}
+			else if (++_IdleRounds < SPIN_ROUNDS)
+			{
+				std::this_thread::yield();
+			}
+			else
+			{
+				sleepWorker();
+				_IdleRounds = 0;
+			}
+		}
+		t_QueueIndex = JobSystem::MAX_THREADS;
+	}
+}
+
+void JobSystem::Init(uint32 NumWorkers)
+{
+	assertCheck(!g_bRunning.load() && "JobSystem::Init called twice");
+	if (NumWorkers == DEFAULT_WORKERS)
+	{
+		uint32 _HardwareThreads = std::thread::hardware_concurrency();
+		NumWorkers = _HardwareThreads > 1 ? _HardwareThreads - 1 : 0;
+	}
+	if (NumWorkers > MAX_THREADS - 1)
+	{
+		NumWorkers = MAX_THREADS - 1;
+	}
+
+	g_NumThreads = NumWorkers + 1;
+	for (uint32 Index = 0; Index < g_NumThreads; Index++)
+	{
+		g_Queues[Index] = new (Memory::malloc(sizeof(JobQueue), alignof(JobQueue))) JobQueue();
+		snprintf(g_WorkerNames[Index], sizeof(g_WorkerNames[Index]), "Worker %u", Index);
+	}
+	t_QueueIndex = 0;
+	g_bRunning.store(true, std::memory_order_release);
+
+	g_Workers = new std::thread[NumWorkers];
+	for (uint32 Index = 0; Index < NumWorkers; Index++)
+	{
+		g_Workers[Index] = std::thread(workerThread, Index + 1);
+	}
+}
+
+void JobSystem::Shutdown()
+{
+	if (!g_bRunning.load(std::memory_order_acquire))
+	{
+		return;
+	}
+	assertCheck(t_QueueIndex == 0 && "JobSystem::Shutdown must be called by the thread that called Init");
+	// Let whatever is queued finish, so no job is left half run
+	while (Job* _Job = findJob())
+	{
+		execute(_Job);
+	}
+
+	{
+		std::lock_guard<std::mutex> _Lock(g_SleepMutex);
+		g_bRunning.store(false, std::memory_order_release);
+		g_SleepCondition.notify_all();
+	}
+	for (uint32 Index = 0; Index + 1 < g_NumThreads; Index++)
+	{
+		g_Workers[Index].join();
+	}
+	delete[] g_Workers;
+	g_Workers = nullptr;
+
+	for (uint32 Index = 0; Index < g_NumThreads; Index++)
+	{
+		g_Queues[Index]->~JobQueue();
+		Memory::free(g_Queues[Index]);
+		g_Queues[Index] = nullptr;
+	}
+	g_NumThreads = 0;
+	t_QueueIndex = MAX_THREADS;
+
+	// Everything has finished, so the calling thread's jobs can go now rather than at its exit
+	Memory::free(t_Jobs.Jobs);
+	t_Jobs.Jobs = nullptr;
+}
+
+uint32 JobSystem::GetNumThreads()
+{
+	return g_bRunning.load(std::memory_order_acquire) ? g_NumThreads : 1;
+}
+
+Job* JobSystem::CreateJob(JobFunction Function)
+{
+	if (t_Jobs.Jobs == nullptr)
+	{
+		t_Jobs.Jobs = (Job*)Memory::malloc(sizeof(Job) * MAX_JOBS_PER_THREAD, alignof(Job));
+		for (uint32 Index = 0; Index < MAX_JOBS_PER_THREAD; Index++)
+		{
+			new (&t_Jobs.Jobs[Index].UnfinishedJobs) std::atomic<int32>(0);
+		}
+	}
+
+	// Skip slots still in flight, such as a ParallelFor's root while its
+	// leaves cycle through the ring, and help out while every slot is
+	Job* _Job = nullptr;
+	while (_Job == nullptr)
+	{
+		for (uint32 Attempt = 0; Attempt < MAX_JOBS_PER_THREAD; Attempt++)
+		{
+			Job* _Slot = &t_Jobs.Jobs[t_Jobs.Next++ & (MAX_JOBS_PER_THREAD - 1)];
+			if (IsFinished(_Slot))
+			{
+				_Job = _Slot;
+				break;
+			}
+		}
+		if (_Job == nullptr)
+		{
+			assertCheck(hasQueue() && "Too many jobs in flight on a thread that runs its jobs inline");
+			Job* _Other = hasQueue() ? findJob() : nullptr;
+			if (_Other != nullptr)
+			{
+				execute(_Other);
+			}
+			else
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+	_Job->Function = Function;
+	_Job->Parent = nullptr;
+	_Job->UnfinishedJobs.store(1, std::memory_order_relaxed);
+	return _Job;
+}
+
+Job* JobSystem::CreateChildJob(Job* Parent, JobFunction Function)
+{
+	assertCheck(!IsFinished(Parent));
+	Parent->UnfinishedJobs.fetch_add(1, std::memory_order_relaxed);
+	Job* _Job = CreateJob(Function);
+	_Job->Parent = Parent;
+	return _Job;
+}
+
+void JobSystem::Run(Job* InJob)
+{
+	if (!hasQueue() || !g_Queues[t_QueueIndex]->Push(InJob))
+	{
+		execute(InJob);
+		return;
+	}
+	wakeWorker();
+}
+
+void JobSystem::Wait(const Job* InJob)
+{
+	while (!IsFinished(InJob))
+	{
+		Job* _Job = hasQueue() ? findJob() : nullptr;
+		if (_Job != nullptr)
+		{
+			execute(_Job);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+}
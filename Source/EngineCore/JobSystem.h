@@ -0,0 +1,162 @@
+#pragma once
+
+#include "EngineCore/EngineUtils.h"
+#include "DataTypes/MArray.h"
+#include <atomic>
+#include <new>
+#include <type_traits>
+
+struct Job;
+typedef void (*JobFunction)(Job* InJob, void* Data);
+
+/*
+ *	Unit of work for the JobSystem. A job is finished once its function has
+ *	returned and every child created for it has finished, so waiting on a
+ *	parent waits on the whole tree below it.
+ **/
+struct alignas(64) Job
+{
+	enum
+	{
+		DATA_SIZE = 64 - sizeof(JobFunction) - sizeof(Job*) - 2 * sizeof(int32)
+	};
+
+	JobFunction Function;
+	Job* Parent;
+	/** The job itself plus its children that have not finished yet. */
+	std::atomic<int32> UnfinishedJobs;
+	int32 Padding;
+	alignas(8) uint8 Data[DATA_SIZE];
+};
+
+static_assert(sizeof(Job) == 64, "Jobs should fill exactly one cache line");
+
+/*
+ *	Work-stealing job scheduler. Every worker thread, and the thread that
+ *	called Init, owns a Chase-Lev deque: it pushes and pops jobs at one end
+ *	while idle threads steal from the other, so jobs spawned together spread
+ *	across threads without a shared queue. Waiting threads run jobs instead
+ *	of blocking.
+ *
+ *	Jobs come from a ring of MAX_JOBS_PER_THREAD owned by the creating
+ *	thread, whose slots are only reused once their job has finished; a
+ *	thread with that many jobs in flight runs others until one finishes.
+ *	Threads other than the workers and the one that called Init run their
+ *	jobs inline, as does every thread before Init and after Shutdown.
+ **/
+namespace JobSystem
+{
+	enum
+	{
+		MAX_JOBS_PER_THREAD = 4096,
+		MAX_THREADS = 64,
+		/** Most batches ParallelFor splits into, which keeps its jobs well within a thread's ring. */
+		MAX_PARALLEL_FOR_BATCHES = MAX_JOBS_PER_THREAD / 4,
+		/** Passed to Init to get one worker per hardware thread, less the calling thread's. */
+		DEFAULT_WORKERS = 0xFFFFFFFF
+	};
+
+	void Init(uint32 NumWorkers = DEFAULT_WORKERS);
+	/** Call from the thread that called Init, once every job it cares about has finished. */
+	void Shutdown();
+	/** Threads running jobs, the one that called Init included. 1 when not initialized. */
+	uint32 GetNumThreads();
+
+	Job* CreateJob(JobFunction Function);
+	/** Job that Parent will not finish without. Parent must not have finished yet. */
+	Job* CreateChildJob(Job* Parent, JobFunction Function);
+
+	template<typename T>
+	Job* CreateJob(JobFunction Function, const T& Data);
+	template<typename T>
+	Job* CreateChildJob(Job* Parent, JobFunction Function, const T& Data);
+
+	void Run(Job* InJob);
+	/** Runs other jobs until InJob has finished. */
+	void Wait(const Job* InJob);
+
+	FORCEINLINE bool IsFinished(const Job* InJob)
+	{
+		return InJob->UnfinishedJobs.load(std::memory_order_acquire) == 0;
+	}
+
+	/*
+	 *	Calls InFunction(T* Items, uint32 Count) over consecutive ranges of
+	 *	at most BatchSize items that together cover Items[0, Count), in
+	 *	parallel, and returns once all of them have. BatchSize is raised as
+	 *	needed to make no more than MAX_PARALLEL_FOR_BATCHES ranges.
+	 **/
+	template<typename T, typename Function>
+	void ParallelFor(T* Items, uint32 Count, uint32 BatchSize, const Function& InFunction);
+
+	template<typename T, typename Allocator, uint32 InlineCapacity, typename Function>
+	FORCEINLINE void ParallelFor(Array<T, Allocator, InlineCapacity>& Items, uint32 BatchSize, const Function& InFunction)
+	{
+		ParallelFor(Items.data(), (uint32)Items.size(), BatchSize, InFunction);
+	}
+}
+
+template<typename T>
+Job* JobSystem::CreateJob(JobFunction Function, const T& Data)
+{
+	static_assert(sizeof(T) <= Job::DATA_SIZE, "Job data does not fit in a job");
+	static_assert(std::is_trivially_copyable<T>::value, "Job data is copied bytewise");
+	Job* _Job = CreateJob(Function);
+	new (_Job->Data) T(Data);
+	return _Job;
+}
+
+template<typename T>
+Job* JobSystem::CreateChildJob(Job* Parent, JobFunction Function, const T& Data)
+{
+	static_assert(sizeof(T) <= Job::DATA_SIZE, "Job data does not fit in a job");
+	static_assert(std::is_trivially_copyable<T>::value, "Job data is copied bytewise");
+	Job* _Job = CreateChildJob(Parent, Function);
+	new (_Job->Data) T(Data);
+	return _Job;
+}
+
+namespace JobSystem
+{
+	template<typename T, typename Function>
+	struct ParallelForData
+	{
+		T* Items;
+		uint32 Count;
+		uint32 BatchSize;
+		const Function* Func;
+	};
+
+	/** Halves its range into two children until it is no bigger than a batch. */
+	template<typename T, typename Function>
+	void ParallelForJob(Job* InJob, void* Data)
+	{
+		const ParallelForData<T, Function>& _Range = *(const ParallelForData<T, Function>*)Data;
+		if (_Range.Count <= _Range.BatchSize)
+		{
+			(*_Range.Func)(_Range.Items, _Range.Count);
+			return;
+		}
+
+		uint32 _LeftCount = _Range.Count / 2;
+		ParallelForData<T, Function> _Left = { _Range.Items, _LeftCount, _Range.BatchSize, _Range.Func };
+		ParallelForData<T, Function> _Right = { _Range.Items + _LeftCount, _Range.Count - _LeftCount, _Range.BatchSize, _Range.Func };
+		Run(CreateChildJob(InJob, &ParallelForJob<T, Function>, _Left));
+		Run(CreateChildJob(InJob, &ParallelForJob<T, Function>, _Right));
+	}
+}
+
+template<typename T, typename Function>
+void JobSystem::ParallelFor(T* Items, uint32 Count, uint32 BatchSize, const Function& InFunction)
+{
+	if (Count == 0)
+	{
+		return;
+	}
+	uint32 _MinBatchSize = (uint32)(((uint64)Count + MAX_PARALLEL_FOR_BATCHES - 1) / MAX_PARALLEL_FOR_BATCHES);
+	BatchSize = Math::Max(Math::Max(BatchSize, _MinBatchSize), 1u);
+	ParallelForData<T, Function> _Range = { Items, Count, BatchSize, &InFunction };
+	Job* _Root = CreateJob(&ParallelForJob<T, Function>, _Range);
+	Run(_Root);
+	Wait(_Root);
+}
@@ -0,0 +1,117 @@
+#include "LinearArena.h"
+#include "Math/Math.h"
+
+LinearArena::LinearArena(uintptr BlockSizeIn) :
+	Current(nullptr),
+	Cursor(nullptr),
+	End(nullptr),
+	Spare(nullptr),
+	BlockSize(BlockSizeIn)
+{
+	PushBlock(CreateBlock(BlockSize));
+}
+
+LinearArena::~LinearArena()
+{
+	while (Current != nullptr)
+	{
+		Block* _Prev = Current->Prev;
+		Memory::free(Current);
+		Current = _Prev;
+	}
+	Memory::free(Spare);
+}
+
+LinearArena::Block* LinearArena::CreateBlock(uintptr Size)
+{
+	Block* _Block = (Block*)Memory::malloc(sizeof(Block) + Size);
+	_Block->Prev = nullptr;
+	_Block->Size = Size;
+	return _Block;
+}
+
+void LinearArena::PushBlock(Block* NewBlock)
+{
+	NewBlock->Prev = Current;
+	Current = NewBlock;
+	Cursor = GetBlockStart(NewBlock);
+	End = Cursor + NewBlock->Size;
+}
+
+void* LinearArena::AllocateSlow(uintptr Amount, uintptr Alignment)
+{
+	uintptr _Size = Math::Max(BlockSize, Amount + Alignment);
+	if (Spare != nullptr && Spare->Size >= _Size)
+	{
+		PushBlock(Spare);
+		Spare = nullptr;
+	}
+	else
+	{
+		PushBlock(CreateBlock(_Size));
+	}
+
+	void* _Result = Memory::align(Cursor, Alignment);
+	Cursor = (uint8*)_Result + Amount;
+	return _Result;
+}
+
+void LinearArena::Rewind(const Marker& Mark)
+{
+	while (Current != Mark.Block)
+	{
+		Block* _Prev = Current->Prev;
+		if (Spare == nullptr || Spare->Size < Current->Size)
+		{
+			Memory::free(Spare);
+			Spare = Current;
+		}
+		else
+		{
+			Memory::free(Current);
+		}
+		Current = _Prev;
+	}
+	Cursor = Mark.Cursor;
+	End = GetBlockStart(Current) + Current->Size;
+}
+
+void LinearArena::Reset()
+{
+	if (Current->Prev == nullptr)
+	{
+		Cursor = GetBlockStart(Current);
+		return;
+	}
+
+	uintptr _TotalSize = 0;
+	while (Current != nullptr)
+	{
+		Block* _Prev = Current->Prev;
+		_TotalSize += Current->Size;
+		Memory::free(Current);
+		Current = _Prev;
+	}
+	Memory::free(Spare);
+	Spare = nullptr;
+
+	BlockSize = Math::Max(BlockSize, _TotalSize);
+	PushBlock(CreateBlock(BlockSize));
+}
+
+LinearArena& FrameArena::Get()
+{
+	static LinearArena _Arena(1024 * 1024);
+	return _Arena;
+}
+
+void FrameArena::EndFrame()
+{
+	Get().Reset();
+}
+
+LinearArena& ScratchAllocator::Get()
+{
+	static thread_local LinearArena _Arena;
+	return _Arena;
+}
@@ -0,0 +1,190 @@
+#pragma once
+
+#include "EngineCore/MemoryManager.h"
+#include "DataTypes/MString.h"
+
+/*
+ *	Bump allocator for short lived memory. Allocating is a pointer bump and
+ *	nothing is freed on its own: memory comes back all at once through
+ *	Rewind or Reset. When a block runs out a new one is chained on, so
+ *	pointers handed out stay valid until then.
+ **/
+class LinearArena
+{
+public:
+	enum
+	{
+		DEFAULT_BLOCK_SIZE = 64 * 1024
+	};
+
+	struct Marker
+	{
+		void* Block;
+		uint8* Cursor;
+	};
+
+	explicit LinearArena(uintptr BlockSizeIn = DEFAULT_BLOCK_SIZE);
+	~LinearArena();
+
+	FORCEINLINE void* Allocate(uintptr Amount, uintptr Alignment = Memory::DEFAULT_ALIGNMENT);
+
+	FORCEINLINE Marker GetMarker() const;
+	/** Frees everything allocated since Mark was taken. */
+	void Rewind(const Marker& Mark);
+	/*
+	 *	Frees everything. If the arena had to chain blocks since the last
+	 *	Reset, they are merged into one block big enough for all of them.
+	 **/
+	void Reset();
+
+	FORCEINLINE uintptr GetBlockSize() const { return BlockSize; }
+private:
+	struct Block
+	{
+		Block* Prev;
+		uintptr Size;
+	};
+
+	Block* Current;
+	uint8* Cursor;
+	uint8* End;
+	/** Most recent block dropped by Rewind, kept to avoid reallocating it right away. */
+	Block* Spare;
+	uintptr BlockSize;
+
+	void* AllocateSlow(uintptr Amount, uintptr Alignment);
+	void PushBlock(Block* NewBlock);
+	static Block* CreateBlock(uintptr Size);
+	static FORCEINLINE uint8* GetBlockStart(Block* InBlock) { return (uint8*)(InBlock + 1); }
+
+	NULL_COPY_AND_ASSIGN(LinearArena);
+};
+
+FORCEINLINE void* LinearArena::Allocate(uintptr Amount, uintptr Alignment)
+{
+	uintptr _Result = Memory::align((uintptr)Cursor, Alignment);
+	if (_Result + Amount > (uintptr)End)
+	{
+		return AllocateSlow(Amount, Alignment);
+	}
+	Cursor = (uint8*)(_Result + Amount);
+	return (void*)_Result;
+}
+
+FORCEINLINE LinearArena::Marker LinearArena::GetMarker() const
+{
+	Marker _Mark = { Current, Cursor };
+	return _Mark;
+}
+
+/*
+ *	Memory for the frame in progress, on the main thread. Everything in it
+ *	is released by EndFrame, so nothing allocated from it may outlive the
+ *	frame.
+ **/
+namespace FrameArena
+{
+	LinearArena& Get();
+
+	FORCEINLINE void* Allocate(uintptr Amount, uintptr Alignment = Memory::DEFAULT_ALIGNMENT)
+	{
+		return Get().Allocate(Amount, Alignment);
+	}
+
+	/** Call once per frame, once nothing from the frame is used anymore. */
+	void EndFrame();
+}
+
+/*
+ *	Per thread stack of temporary memory. Take a Mark before using it and
+ *	Rewind to it when done, or let a ScratchScope do both.
+ **/
+namespace ScratchAllocator
+{
+	LinearArena& Get();
+
+	FORCEINLINE void* Allocate(uintptr Amount, uintptr Alignment = Memory::DEFAULT_ALIGNMENT)
+	{
+		return Get().Allocate(Amount, Alignment);
+	}
+
+	FORCEINLINE LinearArena::Marker Mark() { return Get().GetMarker(); }
+	FORCEINLINE void Rewind(const LinearArena::Marker& Mark) { Get().Rewind(Mark); }
+}
+
+/** Rewinds the calling thread's scratch memory to where it was on construction. */
+class ScratchScope
+{
+public:
+	FORCEINLINE ScratchScope() :
+		Arena(&ScratchAllocator::Get()),
+		Mark(Arena->GetMarker()) {}
+
+	FORCEINLINE ~ScratchScope()
+	{
+		Arena->Rewind(Mark);
+	}
+private:
+	LinearArena* Arena;
+	LinearArena::Marker Mark;
+
+	NULL_COPY_AND_ASSIGN(ScratchScope);
+};
+
+/*
+ *	Standard library allocator over the arena returned by GetArena.
+ *	deallocate does nothing; containers using it must be destroyed before
+ *	their arena is rewound or reset.
+ **/
+template<typename T, LinearArena& (*GetArena)()>
+class ArenaStlAllocator
+{
+public:
+	typedef T value_type;
+	typedef T* pointer;
+	typedef const T* const_pointer;
+	typedef T& reference;
+	typedef const T& const_reference;
+	typedef std::size_t size_type;
+	typedef std::ptrdiff_t difference_type;
+
+	template<typename U>
+	struct rebind
+	{
+		typedef ArenaStlAllocator<U, GetArena> other;
+	};
+
+	ArenaStlAllocator() {}
+	template<typename U>
+	ArenaStlAllocator(const ArenaStlAllocator<U, GetArena>&) {}
+
+	FORCEINLINE T* allocate(std::size_t Count)
+	{
+		uintptr _Alignment = alignof(T) > Memory::MIN_ALIGNMENT ? (uintptr)alignof(T) : (uintptr)Memory::MIN_ALIGNMENT;
+		return (T*)GetArena().Allocate(Count * sizeof(T), _Alignment);
+	}
+
+	FORCEINLINE void deallocate(T*, std::size_t) {}
+
+	FORCEINLINE std::size_t max_size() const { return ((std::size_t)-1) / sizeof(T); }
+};
+
+template<typename T, typename U, LinearArena& (*GetArena)()>
+FORCEINLINE bool operator==(const ArenaStlAllocator<T, GetArena>&, const ArenaStlAllocator<U, GetArena>&)
+{
+	return true;
+}
+
+template<typename T, typename U, LinearArena& (*GetArena)()>
+FORCEINLINE bool operator!=(const ArenaStlAllocator<T, GetArena>&, const ArenaStlAllocator<U, GetArena>&)
+{
+	return false;
+}
+
+template<typename T> using FrameStlAllocator = ArenaStlAllocator<T, &FrameArena::Get>;
+template<typename T> using FrameArray = Array<T, FrameStlAllocator<T>>;
+typedef std::basic_string<char, std::char_traits<char>, FrameStlAllocator<char>> FrameString;
+
+template<typename T> using ScratchStlAllocator = ArenaStlAllocator<T, &ScratchAllocator::Get>;
+template<typename T> using ScratchArray = Array<T, ScratchStlAllocator<T>>;
+typedef std::basic_string<char, std::char_traits<char>, ScratchStlAllocator<char>> ScratchString;
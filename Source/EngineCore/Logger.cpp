@@ -0,0 +1,329 @@
+#include "Logger.h"
+#include "Platform/PlatformMemoryManager.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <thread>
+
+thread_local Logger::ThreadBuffer* Logger::CurrentThreadBuffer = nullptr;
+std::atomic<bool> Logger::bRunning(false);
+
+namespace
+{
+	enum
+	{
+		MAX_THREAD_BUFFERS = 64,
+		MAX_LINE_SIZE = 8 * 1024,
+		OUTPUT_SIZE = 64 * 1024,
+		/** How long the logger thread sleeps when there is nothing to write. */
+		IDLE_WAIT_MS = 2
+	};
+
+	/** Registered buffers, never freed. Only ever appended to, so readers need no lock. */
+	Logger::ThreadBuffer* g_Buffers[MAX_THREAD_BUFFERS];
+	std::atomic<uint32> g_NumBuffers(0);
+	std::mutex g_RegisterMutex;
+	/** Buffers of exited threads, handed to the next thread to register once drained. Guarded by g_RegisterMutex. */
+	bool g_bReleased[MAX_THREAD_BUFFERS];
+	bool g_bWarnedFull = false;
+	thread_local bool t_bExited = false;
+
+	/*
+	 *	Created on first use and never destroyed, so it is still there for
+	 *	Shutdown and for late wakeups however static destruction is ordered.
+	 **/
+	struct LoggerThread
+	{
+		std::thread Thread;
+		std::mutex WakeMutex;
+		std::condition_variable Wake;
+	};
+
+	LoggerThread* g_LoggerThread = nullptr;
+	std::atomic<FILE*> g_OutputFile(nullptr);
+	std::atomic<bool> g_bStopping(false);
+	/** Serializes formatting once the logger thread is gone. */
+	std::mutex g_DrainMutex;
+
+	/** Collects formatted lines so they reach stderr in a few large writes. */
+	struct Output
+	{
+		char Data[OUTPUT_SIZE];
+		uint32 Size;
+
+		Output() : Size(0) {}
+
+		void Append(const Logger::RecordHeader& Header)
+		{
+			if (Size + MAX_LINE_SIZE > OUTPUT_SIZE)
+			{
+				Write();
+			}
+			char* _Line = Data + Size;
+			int32 _Prefix = snprintf(_Line, MAX_LINE_SIZE, "[%s] [%s] (%s:%u): ", Header.Category,
+					Logger::GetLevelName(Header.Level), Header.File, Header.Line);
+			if (_Prefix < 0 || _Prefix > MAX_LINE_SIZE / 2)
+			{
+				_Prefix = _Prefix < 0 ? 0 : MAX_LINE_SIZE / 2;
+			}
+			int32 _Message = Header.Format(_Line + _Prefix, MAX_LINE_SIZE - _Prefix - 1, Header.Message,
+					(const uint8*)(&Header + 1));
+			uint32 _Length = (uint32)_Prefix + (_Message < 0 ? 0 : (uint32)_Message);
+			if (_Length > MAX_LINE_SIZE - 2)
+			{
+				_Length = MAX_LINE_SIZE - 2;
+			}
+			_Line[_Length] = '\n';
+			Size += _Length + 1;
+		}
+
+		void Write()
+		{
+			if (Size != 0)
+			{
+				FILE* _File = g_OutputFile.load(std::memory_order_acquire);
+				_File = _File != nullptr ? _File : stderr;
+				fwrite(Data, 1, Size, _File);
+				fflush(_File);
+				Size = 0;
+			}
+		}
+	};
+
+	/** Formats every record published in Buffer. Only one thread may drain a buffer at a time. */
+	bool drainBuffer(Logger::ThreadBuffer* Buffer, Output& Out)
+	{
+		uint64 _Tail = Buffer->Tail.load(std::memory_order_relaxed);
+		uint64 _Head = Buffer->Head.load(std::memory_order_acquire);
+		if (_Tail == _Head)
+		{
+			return false;
+		}
+		while (_Tail != _Head)
+		{
+			const Logger::RecordHeader* _Header =
+				(const Logger::RecordHeader*)(Buffer->Data + ((uint32)_Tail & (Logger::THREAD_BUFFER_SIZE - 1)));
+			if (_Header->Format != nullptr)
+			{
+				Out.Append(*_Header);
+			}
+			_Tail += _Header->Size;
+		}
+		Buffer->Tail.store(_Tail, std::memory_order_release);
+		return true;
+	}
+
+	bool drainAll(Output& Out)
+	{
+		bool _bWrote = false;
+		uint32 _NumBuffers = g_NumBuffers.load(std::memory_order_acquire);
+		for (uint32 Index = 0; Index < _NumBuffers; Index++)
+		{
+			_bWrote |= drainBuffer(g_Buffers[Index], Out);
+		}
+		Out.Write();
+		return _bWrote;
+	}
+
+	void loggerThread()
+	{
+		Output* _Out = new Output();
+		while (true)
+		{
+			bool _bStopping = g_bStopping.load(std::memory_order_acquire);
+			if (!drainAll(*_Out))
+			{
+				if (_bStopping)
+				{
+					break;
+				}
+				std::unique_lock<std::mutex> _Lock(g_LoggerThread->WakeMutex);
+				g_LoggerThread->Wake.wait_for(_Lock, std::chrono::milliseconds(IDLE_WAIT_MS));
+			}
+		}
+		delete _Out;
+	}
+
+	void wakeLogger()
+	{
+		g_LoggerThread->Wake.notify_one();
+	}
+}
+
+/** Gives the calling thread's buffer back once the thread exits. */
+struct ThreadBufferRelease
+{
+	~ThreadBufferRelease()
+	{
+		std::lock_guard<std::mutex> _Lock(g_RegisterMutex);
+		uint32 _NumBuffers = g_NumBuffers.load(std::memory_order_relaxed);
+		for (uint32 Index = 0; Index < _NumBuffers; Index++)
+		{
+			if (g_Buffers[Index] == Logger::CurrentThreadBuffer)
+			{
+				g_bReleased[Index] = true;
+			}
+		}
+		Logger::CurrentThreadBuffer = nullptr;
+		t_bExited = true;
+	}
+};
+
+Logger::ThreadBuffer* Logger::RegisterThread()
+{
+	std::lock_guard<std::mutex> _Lock(g_RegisterMutex);
+	uint32 _NumBuffers = g_NumBuffers.load(std::memory_order_relaxed);
+	ThreadBuffer* _Buffer = nullptr;
+	for (uint32 Index = 0; Index < _NumBuffers && _Buffer == nullptr; Index++)
+	{
+		// Records left by the thread that exited are still formatted from the buffer, so wait for them
+		ThreadBuffer* _Released = g_Buffers[Index];
+		if (g_bReleased[Index] && _Released->Tail.load(std::memory_order_acquire) == _Released->Head.load(std::memory_order_relaxed))
+		{
+			g_bReleased[Index] = false;
+			_Released->HeadLimit = _Released->Tail.load(std::memory_order_relaxed) + THREAD_BUFFER_SIZE;
+			_Buffer = _Released;
+		}
+	}
+
+	if (_Buffer == nullptr)
+	{
+		if (_NumBuffers == MAX_THREAD_BUFFERS)
+		{
+			if (!g_bWarnedFull)
+			{
+				fprintf(stderr, "[Logger] [%s]: more than %u threads are logging at once, dropping messages\n",
+						GetLevelName(LOG_LEVEL_WARNING), _NumBuffers);
+				g_bWarnedFull = true;
+			}
+			return nullptr;
+		}
+
+		// Straight from PlatformMemory, as buffers live until exit and should not show up as leaks
+		_Buffer = (ThreadBuffer*)PlatformMemory::Malloc(sizeof(ThreadBuffer), alignof(ThreadBuffer));
+		new (&_Buffer->Head) std::atomic<uint64>(0);
+		new (&_Buffer->Tail) std::atomic<uint64>(0);
+		_Buffer->HeadLimit = THREAD_BUFFER_SIZE;
+		g_Buffers[_NumBuffers] = _Buffer;
+		g_bReleased[_NumBuffers] = false;
+		g_NumBuffers.store(_NumBuffers + 1, std::memory_order_release);
+	}
+
+	if (g_LoggerThread == nullptr)
+	{
+		g_LoggerThread = new (PlatformMemory::Malloc(sizeof(LoggerThread), alignof(LoggerThread))) LoggerThread();
+		bRunning.store(true, std::memory_order_release);
+		g_LoggerThread->Thread = std::thread(loggerThread);
+		atexit(Shutdown);
+	}
+
+	CurrentThreadBuffer = _Buffer;
+	// A thread logging from destructors run after its release keeps the buffer for good
+	if (!t_bExited)
+	{
+		static thread_local ThreadBufferRelease _Release;
+		(void)_Release;
+	}
+	return _Buffer;
+}
+
+uint8* Logger::WaitForSpace(ThreadBuffer* Buffer, uint32 Size)
+{
+	uint64 _Head = Buffer->Head.load(std::memory_order_relaxed);
+	uint32 _Offset = (uint32)_Head & (THREAD_BUFFER_SIZE - 1);
+	uint32 _Padding = _Offset + Size > THREAD_BUFFER_SIZE ? THREAD_BUFFER_SIZE - _Offset : 0;
+
+	while (_Head + _Padding + Size > Buffer->Tail.load(std::memory_order_acquire) + THREAD_BUFFER_SIZE)
+	{
+		if (bRunning.load(std::memory_order_relaxed))
+		{
+			wakeLogger();
+			std::this_thread::yield();
+		}
+		else
+		{
+			Flush();
+		}
+	}
+
+	if (_Padding != 0)
+	{
+		RecordHeader* _Header = (RecordHeader*)(Buffer->Data + _Offset);
+		_Header->Size = _Padding;
+		_Header->Format = nullptr;
+		_Head += _Padding;
+		Buffer->Head.store(_Head, std::memory_order_release);
+	}
+	Buffer->HeadLimit = Buffer->Tail.load(std::memory_order_acquire) + THREAD_BUFFER_SIZE;
+	return Buffer->Data + ((uint32)_Head & (THREAD_BUFFER_SIZE - 1));
+}
+
+void Logger::Flush()
+{
+	if (!bRunning.load(std::memory_order_acquire))
+	{
+		std::lock_guard<std::mutex> _Lock(g_DrainMutex);
+		static Output s_Out;
+		drainAll(s_Out);
+		return;
+	}
+
+	uint64 _Heads[MAX_THREAD_BUFFERS];
+	uint32 _NumBuffers = g_NumBuffers.load(std::memory_order_acquire);
+	for (uint32 Index = 0; Index < _NumBuffers; Index++)
+	{
+		_Heads[Index] = g_Buffers[Index]->Head.load(std::memory_order_acquire);
+	}
+	wakeLogger();
+	for (uint32 Index = 0; Index < _NumBuffers; Index++)
+	{
+		while (g_Buffers[Index]->Tail.load(std::memory_order_acquire) < _Heads[Index])
+		{
+			if (!bRunning.load(std::memory_order_acquire))
+			{
+				// Shut down meanwhile; whatever is left gets written by the thread that logs next
+				return;
+			}
+			std::this_thread::yield();
+		}
+	}
+}
+
+void Logger::Shutdown()
+{
+	if (!bRunning.load(std::memory_order_acquire))
+	{
+		return;
+	}
+	g_bStopping.store(true, std::memory_order_release);
+	wakeLogger();
+	g_LoggerThread->Thread.join();
+	bRunning.store(false, std::memory_order_release);
+	Flush();
+}
+
+void Logger::SetOutput(FILE* File)
+{
+	Flush();
+	g_OutputFile.store(File, std::memory_order_release);
+}
+
+const char* Logger::GetLevelName(uint32 Level)
+{
+	static const char* _Names[NUM_LOG_LEVELS] = {
+		"Debug", "Info", "Warning", "Error"
+	};
+	return Level < NUM_LOG_LEVELS ? _Names[Level] : "Unknown";
+}
+
+int32 Logger::FormatArguments(char* Output, uint32 OutputSize, const char* Message, ...)
+{
+	va_list _Arguments;
+	va_start(_Arguments, Message);
+	int32 _Result = vsnprintf(Output, OutputSize, Message, _Arguments);
+	va_end(_Arguments);
+	return _Result;
+}
@@ -0,0 +1,275 @@
+#pragma once
+
+#include "EngineCore/EngineUtils.h"
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+
+enum LogLevel
+{
+	LOG_LEVEL_DEBUG,
+	LOG_LEVEL_INFO,
+	LOG_LEVEL_WARNING,
+	LOG_LEVEL_ERROR,
+	NUM_LOG_LEVELS
+};
+
+/*
+ *	DEBUG_LOG calls below LOG_MIN_LEVEL compile away, arguments included.
+ **/
+#ifndef LOG_MIN_LEVEL
+	#define LOG_MIN_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+#define LOG_ERROR LOG_LEVEL_ERROR
+#define LOG_WARNING LOG_LEVEL_WARNING
+#define LOG_INFO LOG_LEVEL_INFO
+#define LOG_DEBUG LOG_LEVEL_DEBUG
+#define LOG_TYPE_RENDERER "Renderer"
+#define LOG_TYPE_IO "IO"
+
+#if defined(COMPILER_GCC) || defined(COMPILER_CLANG)
+	#define LOG_FORMAT_CHECK __attribute__((format(printf, 1, 2)))
+#else
+	#define LOG_FORMAT_CHECK
+#endif
+
+/*
+ *	Queues a printf style message for the logger thread. Category and
+ *	message must be string literals; the arguments must be numbers, enums,
+ *	pointers or C strings, which are copied.
+ **/
+#define DEBUG_LOG(category, level, message, ...) \
+	do { \
+		if ((level) >= LOG_MIN_LEVEL) { \
+			if (false) { Logger::CheckFormat(message, ##__VA_ARGS__); } \
+			Logger::Write("" category, level, __FILE__, __LINE__, "" message, ##__VA_ARGS__); \
+		} \
+	} while (0)
+#define DEBUG_LOG_TEMP(message, ...) DEBUG_LOG("TEMP", LOG_DEBUG, message, ##__VA_ARGS__)
+#define DEBUG_LOG_TEMP2(message) DEBUG_LOG("TEMP", LOG_DEBUG, "%s", message)
+
+/*
+ *	Asynchronous logger. DEBUG_LOG copies the format string's address and
+ *	its arguments into a ring buffer owned by the calling thread, without
+ *	locking or formatting; a background thread formats the records and
+ *	writes each one to stderr as a whole line.
+ *
+ *	Errors wait for everything logged so far to be written, so they are on
+ *	stderr before the caller goes on to throw or abort. A thread whose
+ *	buffer is full waits for the logger thread to make room. Buffers of
+ *	exited threads are reused; while all 64 are held by live threads, the
+ *	messages of any further thread are dropped. After Shutdown, every
+ *	record is written by the thread that logs it.
+ **/
+namespace Logger
+{
+	enum
+	{
+		THREAD_BUFFER_SIZE = 1 << 16,
+		/** C string arguments longer than this are cut short. */
+		MAX_STRING_ARGUMENT = 1024,
+		MAX_ARGUMENTS = 16
+	};
+
+	typedef int32 (*FormatFunction)(char* Output, uint32 OutputSize, const char* Message, const uint8* Arguments);
+
+	/** Starts every record; the encoded arguments follow. */
+	struct RecordHeader
+	{
+		/** Of the whole record, a multiple of 8. */
+		uint32 Size;
+		uint32 Level;
+		/** Decodes the arguments and formats the message; nullptr for padding up to the buffer's end. */
+		FormatFunction Format;
+		const char* Message;
+		const char* Category;
+		const char* File;
+		uint32 Line;
+	};
+
+	struct ThreadBuffer
+	{
+		alignas(8) uint8 Data[THREAD_BUFFER_SIZE];
+		/** Written by the owning thread only. */
+		std::atomic<uint64> Head;
+		/** Written by whichever thread formats the records. */
+		std::atomic<uint64> Tail;
+		/** Head may go up to here without looking at Tail again. Owning thread only. */
+		uint64 HeadLimit;
+	};
+
+	extern thread_local ThreadBuffer* CurrentThreadBuffer;
+	extern std::atomic<bool> bRunning;
+	/** Returns nullptr when every buffer is taken. */
+	ThreadBuffer* RegisterThread();
+	/** Makes room for a record that did not fit before the end of the buffer or its free space. */
+	uint8* WaitForSpace(ThreadBuffer* Buffer, uint32 Size);
+
+	/** Blocks until every record logged before the call has been written. */
+	void Flush();
+	/** Writes what is left and stops the logger thread. Runs at exit. */
+	void Shutdown();
+	/** Sends what is logged from now on to File instead of stderr, or back to stderr if File is nullptr. */
+	void SetOutput(FILE* File);
+
+	const char* GetLevelName(uint32 Level);
+
+	FORCEINLINE ThreadBuffer* GetThreadBuffer()
+	{
+		ThreadBuffer* Buffer = CurrentThreadBuffer;
+		return Buffer != nullptr ? Buffer : RegisterThread();
+	}
+
+	/** Only used for its format attribute, in code that never runs. */
+	inline void CheckFormat(const char* Message, ...) LOG_FORMAT_CHECK;
+	inline void CheckFormat(const char* Message, ...) { (void)Message; }
+
+	/** Numbers, enums and pointers are stored as they are. */
+	template<typename T>
+	struct Argument
+	{
+		static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value,
+				"DEBUG_LOG arguments must be numbers, enums, pointers or C strings");
+		typedef T Stored;
+
+		static FORCEINLINE uint32 GetSize(T) { return sizeof(T); }
+		static FORCEINLINE uint8* Write(uint8* Output, T Value)
+		{
+			memcpy(Output, &Value, sizeof(T));
+			return Output + sizeof(T);
+		}
+		static FORCEINLINE const uint8* Read(const uint8* Input, T& Value)
+		{
+			memcpy(&Value, Input, sizeof(T));
+			return Input + sizeof(T);
+		}
+	};
+
+	/** C strings are copied, as the text may be gone by the time it is formatted. */
+	template<>
+	struct Argument<const char*>
+	{
+		typedef const char* Stored;
+
+		static FORCEINLINE uint32 GetLength(const char* Value)
+		{
+			if (Value == nullptr)
+			{
+				return 0;
+			}
+			uintptr _Length = strlen(Value);
+			return _Length < MAX_STRING_ARGUMENT ? (uint32)_Length : (uint32)MAX_STRING_ARGUMENT;
+		}
+		static FORCEINLINE uint32 GetSize(const char* Value) { return sizeof(uint32) + GetLength(Value) + 1; }
+		static FORCEINLINE uint8* Write(uint8* Output, const char* Value)
+		{
+			uint32 _Length = GetLength(Value);
+			memcpy(Output, &_Length, sizeof(uint32));
+			if (_Length != 0)
+			{
+				memcpy(Output + sizeof(uint32), Value, _Length);
+			}
+			Output[sizeof(uint32) + _Length] = '\0';
+			return Output + sizeof(uint32) + _Length + 1;
+		}
+		static FORCEINLINE const uint8* Read(const uint8* Input, const char*& Value)
+		{
+			uint32 _Length;
+			memcpy(&_Length, Input, sizeof(uint32));
+			Value = (const char*)Input + sizeof(uint32);
+			return Input + sizeof(uint32) + _Length + 1;
+		}
+	};
+
+	template<>
+	struct Argument<char*> : Argument<const char*> {};
+
+	template<typename T>
+	struct ArgumentOf : Argument<typename std::decay<T>::type> {};
+
+	FORCEINLINE uint32 GetArgumentsSize() { return 0; }
+	template<typename First, typename... Rest>
+	FORCEINLINE uint32 GetArgumentsSize(const First& InFirst, const Rest&... InRest)
+	{
+		return ArgumentOf<First>::GetSize(InFirst) + GetArgumentsSize(InRest...);
+	}
+
+	FORCEINLINE void WriteArguments(uint8*) {}
+	template<typename First, typename... Rest>
+	FORCEINLINE void WriteArguments(uint8* Output, const First& InFirst, const Rest&... InRest)
+	{
+		WriteArguments(ArgumentOf<First>::Write(Output, InFirst), InRest...);
+	}
+
+	int32 FormatArguments(char* Output, uint32 OutputSize, const char* Message, ...);
+
+	/** Reads the arguments back one at a time, then formats them all at once. */
+	template<typename... Args>
+	struct Decoder;
+
+	template<>
+	struct Decoder<>
+	{
+		template<typename... Values>
+		static int32 Format(char* Output, uint32 OutputSize, const char* Message, const uint8*, Values... InValues)
+		{
+			return FormatArguments(Output, OutputSize, Message, InValues...);
+		}
+	};
+
+	template<typename First, typename... Rest>
+	struct Decoder<First, Rest...>
+	{
+		template<typename... Values>
+		static int32 Format(char* Output, uint32 OutputSize, const char* Message, const uint8* Input, Values... InValues)
+		{
+			typename ArgumentOf<First>::Stored _Value;
+			Input = ArgumentOf<First>::Read(Input, _Value);
+			return Decoder<Rest...>::Format(Output, OutputSize, Message, Input, InValues..., _Value);
+		}
+	};
+
+	template<typename... Args>
+	int32 FormatRecord(char* Output, uint32 OutputSize, const char* Message, const uint8* Arguments)
+	{
+		return Decoder<Args...>::Format(Output, OutputSize, Message, Arguments);
+	}
+
+	template<typename... Args>
+	void Write(const char* Category, uint32 Level, const char* File, uint32 Line, const char* Message, const Args&... InArgs)
+	{
+		static_assert(sizeof...(Args) <= MAX_ARGUMENTS, "Too many DEBUG_LOG arguments");
+		uint32 _Size = (sizeof(RecordHeader) + GetArgumentsSize(InArgs...) + 7) & ~7u;
+
+		ThreadBuffer* _Buffer = GetThreadBuffer();
+		if (_Buffer == nullptr)
+		{
+			return;
+		}
+		uint64 _Head = _Buffer->Head.load(std::memory_order_relaxed);
+		uint32 _Offset = (uint32)_Head & (THREAD_BUFFER_SIZE - 1);
+		uint8* _Record = _Buffer->Data + _Offset;
+		if (_Offset + _Size > THREAD_BUFFER_SIZE || _Head + _Size > _Buffer->HeadLimit)
+		{
+			_Record = WaitForSpace(_Buffer, _Size);
+			_Head = _Buffer->Head.load(std::memory_order_relaxed);
+		}
+
+		RecordHeader* _Header = (RecordHeader*)_Record;
+		_Header->Size = _Size;
+		_Header->Level = Level;
+		_Header->Format = &FormatRecord<typename std::decay<Args>::type...>;
+		_Header->Message = Message;
+		_Header->Category = Category;
+		_Header->File = File;
+		_Header->Line = Line;
+		WriteArguments(_Record + sizeof(RecordHeader), InArgs...);
+		_Buffer->Head.store(_Head + _Size, std::memory_order_release);
+
+		if (Level >= LOG_LEVEL_ERROR || !bRunning.load(std::memory_order_relaxed))
+		{
+			Flush();
+		}
+	}
+}
@@ -2,7 +2,9 @@
 
 #include "EngineCore/EngineUtils.h"
 #include "Platform/PlatformMemoryManager.h"
+#include "EngineCore/MemoryTracker.h"
 #include <cstring>
+#include <cstddef>
 
 /**
  * Various memory functions. 
@@ -33,7 +35,7 @@ struct Memory
 
 	static inline void* memzero(void* dest, uintptr amt)
 	{
-		return PlatformMemory::Memset(dest, 0, amt);
+		return PlatformMemory::Memzero(dest, amt);
 	}
 
 	static inline void* memcpy(void* dest, const void* src, uintptr amt)
@@ -41,6 +43,12 @@ struct Memory
 		return PlatformMemory::Memcpy(dest, src, amt);
 	}
 
+	/** Copy into memory that will not be read back soon, bypassing the cache. */
+	static inline void* memcpyStreaming(void* dest, const void* src, uintptr amt)
+	{
+		return PlatformMemory::MemcpyStreaming(dest, src, amt);
+	}
+
 	static inline void memswap(void* a, void* b, uintptr size)
 	{
 		return PlatformMemory::Memswap(a, b, size);
@@ -58,6 +66,27 @@ struct Memory
 		return PlatformMemory::Align(ptr, alignment);
 	}
 
+#if MARS_MEMORY_TRACKING
+	static inline void* malloc(uintptr amt, uint32 alignment=DEFAULT_ALIGNMENT)
+	{
+		return MemoryTracker::Malloc(amt, alignment);
+	}
+
+	static inline void* realloc(void* ptr, uintptr amt, uint32 alignment=DEFAULT_ALIGNMENT)
+	{
+		return MemoryTracker::Realloc(ptr, amt, alignment);
+	}
+
+	static inline void* free(void* ptr)
+	{
+		return MemoryTracker::Free(ptr);
+	}
+
+	static inline uintptr getAllocSize(void* ptr)
+	{
+		return MemoryTracker::GetAllocSize(ptr);
+	}
+#else
 	static inline void* malloc(uintptr amt, uint32 alignment=DEFAULT_ALIGNMENT)
 	{
 		return PlatformMemory::Malloc(amt, alignment);
@@ -77,4 +106,67 @@ struct Memory
 	{
 		return PlatformMemory::GetAllocSize(ptr);
 	}
+#endif
 };
+
+/*
+ *	Standard library allocator over Memory::malloc. reallocate lets
+ *	containers that know their elements can be moved bytewise grow in place.
+ **/
+template<typename T>
+class MemoryStlAllocator
+{
+public:
+	typedef T value_type;
+	typedef T* pointer;
+	typedef const T* const_pointer;
+	typedef T& reference;
+	typedef const T& const_reference;
+	typedef std::size_t size_type;
+	typedef std::ptrdiff_t difference_type;
+
+	template<typename U>
+	struct rebind
+	{
+		typedef MemoryStlAllocator<U> other;
+	};
+
+	MemoryStlAllocator() {}
+	template<typename U>
+	MemoryStlAllocator(const MemoryStlAllocator<U>&) {}
+
+	FORCEINLINE T* allocate(std::size_t Count)
+	{
+		return (T*)Memory::malloc(Count * sizeof(T), GetAlignment());
+	}
+
+	FORCEINLINE T* reallocate(T* Ptr, std::size_t OldCount, std::size_t NewCount)
+	{
+		(void)OldCount;
+		return (T*)Memory::realloc(Ptr, NewCount * sizeof(T), GetAlignment());
+	}
+
+	FORCEINLINE void deallocate(T* Ptr, std::size_t)
+	{
+		Memory::free(Ptr);
+	}
+
+	FORCEINLINE std::size_t max_size() const { return ((std::size_t)-1) / sizeof(T); }
+private:
+	static FORCEINLINE uint32 GetAlignment()
+	{
+		return alignof(T) > Memory::MIN_ALIGNMENT ? (uint32)alignof(T) : (uint32)Memory::MIN_ALIGNMENT;
+	}
+};
+
+template<typename T, typename U>
+FORCEINLINE bool operator==(const MemoryStlAllocator<T>&, const MemoryStlAllocator<U>&)
+{
+	return true;
+}
+
+template<typename T, typename U>
+FORCEINLINE bool operator!=(const MemoryStlAllocator<T>&, const MemoryStlAllocator<U>&)
+{
+	return false;
+}
@@ -0,0 +1,350 @@
+#include "MemoryTracker.h"
+
+const char* MemoryTracker::GetTagName(enum MemoryTag Tag)
+{
+	static const char* _Names[NUM_MEMORY_TAGS] = {
+		"untagged", "renderer", "assets", "math", "ecs"
+	};
+	assertCheck(Tag < NUM_MEMORY_TAGS);
+	return _Names[Tag];
+}
+
+#if MARS_MEMORY_TRACKING
+
+#include "Platform/PlatformMemoryManager.h"
+#include "DataTypes/MArray.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+#if defined(OPERATING_SYSTEM_LINUX)
+	#include <execinfo.h>
+	#include <cstdlib>
+#elif defined(OPERATING_SYSTEM_WINDOWS)
+	#include <windows.h>
+#endif
+
+namespace
+{
+	/** Sits right before every tracked block. */
+	struct AllocHeader
+	{
+		uint64 Size;
+		/** From the start of the underlying allocation to the block. */
+		uint32 Offset;
+		uint16 Tag;
+		uint16 bSampled;
+	};
+
+	struct TagCounters
+	{
+		std::atomic<int64> CurrentBytes;
+		std::atomic<int64> PeakBytes;
+		std::atomic<uint64> TotalAllocations;
+		std::atomic<uint32> FrameAllocations;
+		std::atomic<uint32> FrameFrees;
+		uint32 LastFrameAllocations;
+		uint32 LastFrameFrees;
+	};
+
+	struct Sample
+	{
+		uint64 Size;
+		uint32 Tag;
+		uint32 Depth;
+		void* Frames[MemoryTracker::MAX_STACK_DEPTH];
+	};
+
+	struct LeakSite
+	{
+		const Sample* Site;
+		uint64 Count;
+		uint64 Bytes;
+
+		bool operator<(const LeakSite& Other) const { return Bytes > Other.Bytes; }
+	};
+
+	typedef std::unordered_map<void*, Sample> SampleMap;
+
+	TagCounters g_Tags[NUM_MEMORY_TAGS];
+
+	std::mutex g_SamplesMutex;
+	SampleMap* g_Samples = nullptr;
+
+	thread_local enum MemoryTag t_CurrentTag = MEMORY_TAG_UNTAGGED;
+	thread_local int32 t_SampleCountdown = MemoryTracker::SAMPLE_INTERVAL;
+	/** Set while the tracker allocates for itself, so it does not sample its own storage. */
+	thread_local bool t_bInTracker = false;
+}
+
+static FORCEINLINE AllocHeader* getHeader(void* Ptr)
+{
+	return (AllocHeader*)Ptr - 1;
+}
+
+static FORCEINLINE uint32 getHeaderSize(uint32 Alignment)
+{
+	return Alignment > sizeof(AllocHeader) ? Alignment : (uint32)sizeof(AllocHeader);
+}
+
+static void addBytes(uint32 Tag, int64 Bytes)
+{
+	TagCounters& _Tag = g_Tags[Tag];
+	int64 _Current = _Tag.CurrentBytes.fetch_add(Bytes, std::memory_order_relaxed) + Bytes;
+	int64 _Peak = _Tag.PeakBytes.load(std::memory_order_relaxed);
+	while (_Current > _Peak
+			&& !_Tag.PeakBytes.compare_exchange_weak(_Peak, _Current, std::memory_order_relaxed))
+	{
+	}
+}
+
+static uint32 captureStack(void** Frames)
+{
+#if defined(OPERATING_SYSTEM_LINUX)
+	return (uint32)backtrace(Frames, MemoryTracker::MAX_STACK_DEPTH);
+#elif defined(OPERATING_SYSTEM_WINDOWS)
+	return (uint32)CaptureStackBackTrace(0, MemoryTracker::MAX_STACK_DEPTH, Frames, NULL);
+#else
+	(void)Frames;
+	return 0;
+#endif
+}
+
+static void addSample(void* Ptr, AllocHeader* Header)
+{
+	t_bInTracker = true;
+	Sample _Sample;
+	_Sample.Size = Header->Size;
+	_Sample.Tag = Header->Tag;
+	_Sample.Depth = captureStack(_Sample.Frames);
+	{
+		std::lock_guard<std::mutex> _Lock(g_SamplesMutex);
+		if (g_Samples == nullptr)
+		{
+			g_Samples = new SampleMap();
+		}
+		(*g_Samples)[Ptr] = _Sample;
+	}
+	Header->bSampled = 1;
+	t_bInTracker = false;
+}
+
+static void removeSample(void* Ptr)
+{
+	bool _bWasInTracker = t_bInTracker;
+	t_bInTracker = true;
+	{
+		std::lock_guard<std::mutex> _Lock(g_SamplesMutex);
+		g_Samples->erase(Ptr);
+	}
+	t_bInTracker = _bWasInTracker;
+}
+
+static void onAlloc(void* Ptr, AllocHeader* Header)
+{
+	TagCounters& _Tag = g_Tags[Header->Tag];
+	addBytes(Header->Tag, (int64)Header->Size);
+	_Tag.TotalAllocations.fetch_add(1, std::memory_order_relaxed);
+	_Tag.FrameAllocations.fetch_add(1, std::memory_order_relaxed);
+
+	Header->bSampled = 0;
+	if (--t_SampleCountdown <= 0 && !t_bInTracker)
+	{
+		t_SampleCountdown = MemoryTracker::SAMPLE_INTERVAL;
+		addSample(Ptr, Header);
+	}
+}
+
+static void onFree(void* Ptr, AllocHeader* Header)
+{
+	addBytes(Header->Tag, -(int64)Header->Size);
+	g_Tags[Header->Tag].FrameFrees.fetch_add(1, std::memory_order_relaxed);
+	if (Header->bSampled)
+	{
+		removeSample(Ptr);
+	}
+}
+
+void* MemoryTracker::Malloc(uintptr Amount, uint32 Alignment)
+{
+	uint32 _HeaderSize = getHeaderSize(Alignment);
+	uint8* _Base = (uint8*)PlatformMemory::Malloc(Amount + _HeaderSize, Alignment);
+	if (_Base == nullptr)
+	{
+		return nullptr;
+	}
+
+	void* _Result = _Base + _HeaderSize;
+	AllocHeader* _Header = getHeader(_Result);
+	_Header->Size = Amount;
+	_Header->Offset = _HeaderSize;
+	_Header->Tag = (uint16)t_CurrentTag;
+	onAlloc(_Result, _Header);
+	return _Result;
+}
+
+void* MemoryTracker::Free(void* Ptr)
+{
+	if (Ptr == nullptr)
+	{
+		return nullptr;
+	}
+
+	AllocHeader* _Header = getHeader(Ptr);
+	onFree(Ptr, _Header);
+	return PlatformMemory::Free((uint8*)Ptr - _Header->Offset);
+}
+
+void* MemoryTracker::Realloc(void* Ptr, uintptr Amount, uint32 Alignment)
+{
+	if (Ptr == nullptr)
+	{
+		return Malloc(Amount, Alignment);
+	}
+	if (Amount == 0)
+	{
+		Free(Ptr);
+		return nullptr;
+	}
+
+	// The block keeps its header and tag, as long as the header still fits the alignment
+	AllocHeader _Old = *getHeader(Ptr);
+	if (_Old.Offset != getHeaderSize(Alignment))
+	{
+		void* _Result = Malloc(Amount, Alignment);
+		if (_Result != nullptr)
+		{
+			PlatformMemory::Memcpy(_Result, Ptr, _Old.Size < Amount ? _Old.Size : Amount);
+			Free(Ptr);
+		}
+		return _Result;
+	}
+
+	uint8* _Base = (uint8*)PlatformMemory::Realloc((uint8*)Ptr - _Old.Offset,
+			Amount + _Old.Offset, Alignment);
+	if (_Base == nullptr)
+	{
+		return nullptr;
+	}
+
+	void* _Result = _Base + _Old.Offset;
+	onFree(Ptr, &_Old);
+	AllocHeader* _Header = getHeader(_Result);
+	_Header->Size = Amount;
+	onAlloc(_Result, _Header);
+	return _Result;
+}
+
+uintptr MemoryTracker::GetAllocSize(void* Ptr)
+{
+	return (uintptr)getHeader(Ptr)->Size;
+}
+
+enum MemoryTag MemoryTracker::GetCurrentTag()
+{
+	return t_CurrentTag;
+}
+
+void MemoryTracker::SetCurrentTag(enum MemoryTag Tag)
+{
+	t_CurrentTag = Tag;
+}
+
+MemoryTagStats MemoryTracker::GetTagStats(enum MemoryTag Tag)
+{
+	const TagCounters& _Tag = g_Tags[Tag];
+	MemoryTagStats _Stats;
+	_Stats.CurrentBytes = _Tag.CurrentBytes.load(std::memory_order_relaxed);
+	_Stats.PeakBytes = _Tag.PeakBytes.load(std::memory_order_relaxed);
+	_Stats.TotalAllocations = _Tag.TotalAllocations.load(std::memory_order_relaxed);
+	_Stats.FrameAllocations = _Tag.LastFrameAllocations;
+	_Stats.FrameFrees = _Tag.LastFrameFrees;
+	return _Stats;
+}
+
+void MemoryTracker::EndFrame()
+{
+	for (uint32 Tag = 0; Tag < NUM_MEMORY_TAGS; Tag++)
+	{
+		TagCounters& _Tag = g_Tags[Tag];
+		_Tag.LastFrameAllocations = _Tag.FrameAllocations.exchange(0, std::memory_order_relaxed);
+		_Tag.LastFrameFrees = _Tag.FrameFrees.exchange(0, std::memory_order_relaxed);
+	}
+}
+
+void MemoryTracker::LogStats()
+{
+	for (uint32 Tag = 0; Tag < NUM_MEMORY_TAGS; Tag++)
+	{
+		MemoryTagStats _Stats = GetTagStats((enum MemoryTag)Tag);
+		DEBUG_LOG("Memory", LOG_INFO, "%-10s %10.1f KB live %10.1f KB peak %6u allocs %6u frees last frame",
+				GetTagName((enum MemoryTag)Tag), (double)_Stats.CurrentBytes / 1024.0,
+				(double)_Stats.PeakBytes / 1024.0, _Stats.FrameAllocations, _Stats.FrameFrees);
+	}
+}
+
+void MemoryTracker::ReportLeaks()
+{
+	enum { MAX_REPORTED_SITES = 16 };
+
+	t_bInTracker = true;
+	std::lock_guard<std::mutex> _Lock(g_SamplesMutex);
+	if (g_Samples == nullptr || g_Samples->empty())
+	{
+		DEBUG_LOG("Memory", LOG_INFO, "No sampled allocations left at shutdown");
+		t_bInTracker = false;
+		return;
+	}
+
+	Array<LeakSite> _Sites;
+	for (const SampleMap::value_type& _Entry : *g_Samples)
+	{
+		const Sample& _Sample = _Entry.second;
+		LeakSite* _Site = nullptr;
+		for (LeakSite& _Other : _Sites)
+		{
+			if (_Other.Site->Depth == _Sample.Depth && _Other.Site->Tag == _Sample.Tag
+					&& PlatformMemory::Memcmp(_Other.Site->Frames, _Sample.Frames, _Sample.Depth * sizeof(void*)) == 0)
+			{
+				_Site = &_Other;
+				break;
+			}
+		}
+		if (_Site == nullptr)
+		{
+			LeakSite _NewSite = { &_Sample, 0, 0 };
+			_Sites.push_back(_NewSite);
+			_Site = &_Sites.back();
+		}
+		_Site->Count += SAMPLE_INTERVAL;
+		_Site->Bytes += _Sample.Size * SAMPLE_INTERVAL;
+	}
+	std::sort(_Sites.begin(), _Sites.end());
+
+	DEBUG_LOG("Memory", LOG_WARNING, "%u allocation sites still live at shutdown (estimated from 1 in %d sampled allocations):",
+			(uint32)_Sites.size(), (int32)SAMPLE_INTERVAL);
+	for (uint32 Index = 0; Index < _Sites.size() && Index < MAX_REPORTED_SITES; Index++)
+	{
+		const LeakSite& _Site = _Sites[Index];
+		DEBUG_LOG("Memory", LOG_WARNING, "~%llu bytes in ~%llu allocations, tagged %s",
+				(unsigned long long)_Site.Bytes, (unsigned long long)_Site.Count,
+				GetTagName((enum MemoryTag)_Site.Site->Tag));
+#if defined(OPERATING_SYSTEM_LINUX)
+		char** _Symbols = backtrace_symbols(_Site.Site->Frames, (int)_Site.Site->Depth);
+		for (uint32 Frame = 0; _Symbols != nullptr && Frame < _Site.Site->Depth; Frame++)
+		{
+			DEBUG_LOG("Memory", LOG_WARNING, "    %s", _Symbols[Frame]);
+		}
+		::free(_Symbols);
+#else
+		for (uint32 Frame = 0; Frame < _Site.Site->Depth; Frame++)
+		{
+			DEBUG_LOG("Memory", LOG_WARNING, "    %p", _Site.Site->Frames[Frame]);
+		}
+#endif
+	}
+	t_bInTracker = false;
+}
+
+#endif
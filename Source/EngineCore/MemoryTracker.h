@@ -0,0 +1,105 @@
+#pragma once
+
+#include "EngineCore/EngineUtils.h"
+
+/*
+ *	Set MARS_MEMORY_TRACKING to 1 to route Memory::malloc, realloc and free
+ *	through MemoryTracker. When it is 0, the default, the tracker and every
+ *	MEMORY_TAG_SCOPE compile away.
+ **/
+#ifndef MARS_MEMORY_TRACKING
+	#define MARS_MEMORY_TRACKING 0
+#endif
+
+enum MemoryTag
+{
+	MEMORY_TAG_UNTAGGED,
+	MEMORY_TAG_RENDERER,
+	MEMORY_TAG_ASSETS,
+	MEMORY_TAG_MATH,
+	MEMORY_TAG_ECS,
+	NUM_MEMORY_TAGS
+};
+
+struct MemoryTagStats
+{
+	int64 CurrentBytes;
+	int64 PeakBytes;
+	uint64 TotalAllocations;
+	/** Allocations and frees made during the last frame closed by EndFrame. */
+	uint32 FrameAllocations;
+	uint32 FrameFrees;
+};
+
+#define MEMORY_TAG_CONCAT_INNER(a, b) a##b
+#define MEMORY_TAG_CONCAT(a, b) MEMORY_TAG_CONCAT_INNER(a, b)
+
+#if MARS_MEMORY_TRACKING
+	/** Charges allocations made in the rest of the enclosing scope, on this thread, to Tag. */
+	#define MEMORY_TAG_SCOPE(Tag) MemoryTagScope MEMORY_TAG_CONCAT(_MemoryTagScope, __LINE__)(Tag)
+#else
+	#define MEMORY_TAG_SCOPE(Tag)
+#endif
+
+/*
+ *	Counts live and peak bytes per tag, and allocations per frame. Tracked
+ *	blocks carry a small header holding their tag and size, so frees are
+ *	charged to whatever tag was active when the block was allocated.
+ *
+ *	One in SAMPLE_INTERVAL allocations also records its callstack; whatever
+ *	sampled allocation is still live at ReportLeaks is reported grouped by
+ *	stack, with its bytes scaled up by the interval as an estimate.
+ **/
+namespace MemoryTracker
+{
+	enum
+	{
+		SAMPLE_INTERVAL = 64,
+		MAX_STACK_DEPTH = 16
+	};
+
+	const char* GetTagName(enum MemoryTag Tag);
+
+#if MARS_MEMORY_TRACKING
+	void* Malloc(uintptr Amount, uint32 Alignment);
+	void* Realloc(void* Ptr, uintptr Amount, uint32 Alignment);
+	void* Free(void* Ptr);
+	uintptr GetAllocSize(void* Ptr);
+
+	enum MemoryTag GetCurrentTag();
+	void SetCurrentTag(enum MemoryTag Tag);
+
+	MemoryTagStats GetTagStats(enum MemoryTag Tag);
+	/** Closes the per frame counters. Call once per frame. */
+	void EndFrame();
+	/** Logs live and peak bytes of each tag along with the last frame's allocation counts. */
+	void LogStats();
+	/** Logs sampled allocations made since the tracker started that were never freed. */
+	void ReportLeaks();
+#else
+	FORCEINLINE void EndFrame() {}
+	FORCEINLINE void LogStats() {}
+	FORCEINLINE void ReportLeaks() {}
+#endif
+}
+
+#if MARS_MEMORY_TRACKING
+class MemoryTagScope
+{
+public:
+	FORCEINLINE explicit MemoryTagScope(enum MemoryTag Tag) :
+		PreviousTag(MemoryTracker::GetCurrentTag())
+	{
+		MemoryTracker::SetCurrentTag(Tag);
+	}
+
+	FORCEINLINE ~MemoryTagScope()
+	{
+		MemoryTracker::SetCurrentTag(PreviousTag);
+	}
+private:
+	enum MemoryTag PreviousTag;
+
+	NULL_COPY_AND_ASSIGN(MemoryTagScope);
+};
+#endif
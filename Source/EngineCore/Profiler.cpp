@@ -0,0 +1,203 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+// MString.h defines String as a macro, which would replace Writer::String
+#pragma push_macro("String")
+#undef String
+#include "rapidjson/writer.h"
+#include "rapidjson/stringbuffer.h"
+
+thread_local Profiler::ThreadBuffer* Profiler::CurrentThreadBuffer = nullptr;
+
+namespace
+{
+	struct ZoneSummary
+	{
+		const char* Name;
+		uint32 Count;
+		uint64 Ticks;
+
+		bool operator<(const ZoneSummary& Other) const { return Ticks > Other.Ticks; }
+	};
+
+	std::mutex g_BuffersMutex;
+	Array<Profiler::ThreadBuffer*> g_Buffers;
+
+	Array<ProfileEvent> g_LastFrame;
+	uint64 g_FrameStartTicks = Time::getTicks();
+	uint64 g_LastFrameStartTicks = g_FrameStartTicks;
+}
+
+static Profiler::ThreadBuffer* addBuffer(const char* Name)
+{
+	Profiler::ThreadBuffer* _Buffer = new Profiler::ThreadBuffer();
+	_Buffer->Head.store(0, std::memory_order_relaxed);
+	_Buffer->Tail = 0;
+	_Buffer->Depth = 0;
+	_Buffer->Name = Name;
+
+	std::lock_guard<std::mutex> _Lock(g_BuffersMutex);
+	_Buffer->ThreadId = (uint32)g_Buffers.size();
+	g_Buffers.push_back(_Buffer);
+	return _Buffer;
+}
+
+Profiler::ThreadBuffer* Profiler::RegisterThread()
+{
+	CurrentThreadBuffer = addBuffer(nullptr);
+	return CurrentThreadBuffer;
+}
+
+Profiler::ThreadBuffer* Profiler::RegisterTimeline(const char* Name)
+{
+	return addBuffer(Name);
+}
+
+void Profiler::SetThreadName(const char* Name)
+{
+	GetThreadBuffer()->Name = Name;
+}
+
+void Profiler::EndFrame()
+{
+	uint64 _FrameEndTicks = Time::getTicks();
+	ThreadBuffer* _CallerBuffer = GetThreadBuffer();
+	g_LastFrame.clear();
+
+	{
+		std::lock_guard<std::mutex> _Lock(g_BuffersMutex);
+		for (ThreadBuffer* _Buffer : g_Buffers)
+		{
+			uint64 _Head = _Buffer->Head.load(std::memory_order_acquire);
+			uint64 _Tail = _Buffer->Tail;
+			if (_Head - _Tail > THREAD_BUFFER_SIZE)
+			{
+				_Tail = _Head - THREAD_BUFFER_SIZE;
+			}
+			for (; _Tail != _Head; _Tail++)
+			{
+				g_LastFrame.push_back(_Buffer->Events[_Tail & (THREAD_BUFFER_SIZE - 1)]);
+			}
+			_Buffer->Tail = _Head;
+		}
+	}
+
+	ProfileEvent _Frame;
+	_Frame.Name = "Frame";
+	_Frame.StartTicks = g_FrameStartTicks;
+	_Frame.EndTicks = _FrameEndTicks;
+	_Frame.ThreadId = _CallerBuffer->ThreadId;
+	_Frame.Depth = 0;
+	g_LastFrame.push_back(_Frame);
+
+	g_LastFrameStartTicks = g_FrameStartTicks;
+	g_FrameStartTicks = _FrameEndTicks;
+}
+
+const Array<ProfileEvent>& Profiler::GetLastFrame()
+{
+	return g_LastFrame;
+}
+
+static void writeChromeTraceJson(rapidjson::StringBuffer& Json)
+{
+	const double _MicrosecondsPerTick = 1000000.0/Time::getTicksPerSecond();
+
+	rapidjson::Writer<rapidjson::StringBuffer> _Writer(Json);
+	_Writer.StartObject();
+	_Writer.Key("displayTimeUnit");
+	_Writer.String("ms");
+	_Writer.Key("traceEvents");
+	_Writer.StartArray();
+	{
+		std::lock_guard<std::mutex> _Lock(g_BuffersMutex);
+		for (const Profiler::ThreadBuffer* _Buffer : g_Buffers)
+		{
+			if (_Buffer->Name == nullptr)
+			{
+				continue;
+			}
+			_Writer.StartObject();
+			_Writer.Key("name"); _Writer.String("thread_name");
+			_Writer.Key("ph"); _Writer.String("M");
+			_Writer.Key("pid"); _Writer.Uint(0);
+			_Writer.Key("tid"); _Writer.Uint(_Buffer->ThreadId);
+			_Writer.Key("args");
+			_Writer.StartObject();
+			_Writer.Key("name"); _Writer.String(_Buffer->Name);
+			_Writer.EndObject();
+			_Writer.EndObject();
+		}
+	}
+	for (const ProfileEvent& _Event : g_LastFrame)
+	{
+		// Zones from other threads may have started before the frame did, and
+		// GPU zones are only read back a few frames after they ran
+		double _Start = ((double)_Event.StartTicks - (double)g_LastFrameStartTicks) * _MicrosecondsPerTick;
+		_Writer.StartObject();
+		_Writer.Key("name"); _Writer.String(_Event.Name);
+		_Writer.Key("ph"); _Writer.String("X");
+		_Writer.Key("ts"); _Writer.Double(_Start);
+		_Writer.Key("dur"); _Writer.Double((double)(_Event.EndTicks - _Event.StartTicks) * _MicrosecondsPerTick);
+		_Writer.Key("pid"); _Writer.Uint(0);
+		_Writer.Key("tid"); _Writer.Uint(_Event.ThreadId);
+		_Writer.EndObject();
+	}
+	_Writer.EndArray();
+	_Writer.EndObject();
+}
+#pragma pop_macro("String")
+
+bool Profiler::WriteChromeTrace(const String& FileName)
+{
+	rapidjson::StringBuffer _Json;
+	writeChromeTraceJson(_Json);
+
+	FILE* _File = fopen(FileName.c_str(), "wb");
+	if (_File == nullptr)
+	{
+		DEBUG_LOG(LOG_TYPE_IO, LOG_ERROR, "Could not open %s for writing", FileName.c_str());
+		return false;
+	}
+	bool _bWritten = fwrite(_Json.GetString(), 1, _Json.GetSize(), _File) == _Json.GetSize();
+	fclose(_File);
+	return _bWritten;
+}
+
+void Profiler::LogFrameSummary()
+{
+	const double _MillisecondsPerTick = 1000.0/Time::getTicksPerSecond();
+
+	// Zone names are literals, but the same literal is not guaranteed one
+	// address across translation units, so group them by content.
+	Array<ZoneSummary> _Zones;
+	for (const ProfileEvent& _Event : g_LastFrame)
+	{
+		ZoneSummary* _Zone = nullptr;
+		for (ZoneSummary& _Other : _Zones)
+		{
+			if (_Other.Name == _Event.Name || strcmp(_Other.Name, _Event.Name) == 0)
+			{
+				_Zone = &_Other;
+				break;
+			}
+		}
+		if (_Zone == nullptr)
+		{
+			ZoneSummary _NewZone = { _Event.Name, 0, 0 };
+			_Zones.push_back(_NewZone);
+			_Zone = &_Zones.back();
+		}
+		_Zone->Count++;
+		_Zone->Ticks += _Event.EndTicks - _Event.StartTicks;
+	}
+
+	std::sort(_Zones.begin(), _Zones.end());
+	for (const ZoneSummary& _Zone : _Zones)
+	{
+		DEBUG_LOG("Profiler", LOG_INFO, "%-32s %6u calls %9.3f ms", _Zone.Name, _Zone.Count,
+				(double)_Zone.Ticks * _MillisecondsPerTick);
+	}
+}
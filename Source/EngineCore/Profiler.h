@@ -0,0 +1,133 @@
+#pragma once
+
+#include <atomic>
+#include "EngineCore/TimerManager.h"
+#include "DataTypes/MString.h"
+
+/*
+ *	Set MARS_PROFILING to 0 to compile every PROFILE_SCOPE out.
+ **/
+#ifndef MARS_PROFILING
+	#define MARS_PROFILING 1
+#endif
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#if MARS_PROFILING
+	/** Times the rest of the enclosing scope. Name must be a string literal. */
+	#define PROFILE_SCOPE(Name) ProfileZone PROFILE_CONCAT(_ProfileZone, __LINE__)("" Name)
+#else
+	#define PROFILE_SCOPE(Name)
+#endif
+
+/** One finished zone. Times are in Time::getTicks units. */
+struct ProfileEvent
+{
+	const char* Name;
+	uint64 StartTicks;
+	uint64 EndTicks;
+	uint32 ThreadId;
+	uint32 Depth;
+};
+
+/*
+ *	Frame based profiler. Zones are recorded by the thread they run on into
+ *	a ring buffer owned by that thread, without any locking; EndFrame, called
+ *	once per frame from the main thread, drains every thread's buffer into
+ *	the frame that just finished.
+ *
+ *	A thread that records more than THREAD_BUFFER_SIZE zones between two
+ *	EndFrame calls loses its oldest ones.
+ **/
+namespace Profiler
+{
+	enum
+	{
+		THREAD_BUFFER_SIZE = 1 << 14
+	};
+
+	struct ThreadBuffer
+	{
+		ProfileEvent Events[THREAD_BUFFER_SIZE];
+		/** Written by the owning thread only, read by EndFrame. */
+		std::atomic<uint64> Head;
+		/** Only touched by EndFrame. */
+		uint64 Tail;
+		uint32 ThreadId;
+		uint32 Depth;
+		const char* Name;
+	};
+
+	extern thread_local ThreadBuffer* CurrentThreadBuffer;
+	ThreadBuffer* RegisterThread();
+
+	/*
+	 *	Adds a timeline that is not tied to a thread, for zones timed
+	 *	elsewhere, such as on the GPU. Only one thread may record into it.
+	 **/
+	ThreadBuffer* RegisterTimeline(const char* Name);
+
+	FORCEINLINE void RecordEvent(ThreadBuffer* Buffer, const char* Name,
+			uint64 StartTicks, uint64 EndTicks, uint32 Depth)
+	{
+		uint64 _Head = Buffer->Head.load(std::memory_order_relaxed);
+
+		ProfileEvent& _Event = Buffer->Events[_Head & (THREAD_BUFFER_SIZE - 1)];
+		_Event.Name = Name;
+		_Event.StartTicks = StartTicks;
+		_Event.EndTicks = EndTicks;
+		_Event.ThreadId = Buffer->ThreadId;
+		_Event.Depth = Depth;
+
+		Buffer->Head.store(_Head + 1, std::memory_order_release);
+	}
+
+	FORCEINLINE ThreadBuffer* GetThreadBuffer()
+	{
+		ThreadBuffer* Buffer = CurrentThreadBuffer;
+		return Buffer != nullptr ? Buffer : RegisterThread();
+	}
+
+	/** Name shown for the calling thread in traces and summaries. Name must outlive the profiler. */
+	void SetThreadName(const char* Name);
+
+	/*
+	 *	Closes the current frame: collects every zone finished since the last
+	 *	call and records a "Frame" zone spanning the time in between.
+	 **/
+	void EndFrame();
+
+	/** Zones of the last frame closed by EndFrame, in no particular order. */
+	const Array<ProfileEvent>& GetLastFrame();
+
+	/** Writes the last frame in Chrome's trace event format, for chrome://tracing. */
+	bool WriteChromeTrace(const String& FileName);
+
+	/** Logs count and total time of each zone in the last frame, slowest first. */
+	void LogFrameSummary();
+}
+
+class ProfileZone
+{
+public:
+	FORCEINLINE explicit ProfileZone(const char* NameIn) :
+		Name(NameIn),
+		Buffer(Profiler::GetThreadBuffer())
+	{
+		Buffer->Depth++;
+		StartTicks = Time::getTicks();
+	}
+
+	FORCEINLINE ~ProfileZone()
+	{
+		uint64 _EndTicks = Time::getTicks();
+		Profiler::RecordEvent(Buffer, Name, StartTicks, _EndTicks, --Buffer->Depth);
+	}
+private:
+	const char* Name;
+	Profiler::ThreadBuffer* Buffer;
+	uint64 StartTicks;
+
+	NULL_COPY_AND_ASSIGN(ProfileZone);
+};
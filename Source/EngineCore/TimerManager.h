@@ -10,9 +10,46 @@ namespace Time
 		return PlatformTiming::getTime();
 	}
 
+	inline uint64 getNanoseconds()
+	{
+		return PlatformTiming::getNanoseconds();
+	}
+
 	inline void sleep(uint32 milliseconds)
 	{
 		PlatformTiming::sleep(milliseconds);
 	}
+
+	/** Returns within microseconds of deadline, in getNanoseconds time. */
+	inline void sleepUntil(uint64 deadline)
+	{
+		PlatformTiming::sleepUntil(deadline);
+	}
+
+	/** How long before a deadline sleepUntil stops sleeping and starts spinning. */
+	inline uint64 getSleepMargin()
+	{
+		return PlatformTiming::getSleepMargin();
+	}
+
+	FORCEINLINE uint64 toNanoseconds(double seconds)
+	{
+		return (uint64)(seconds * (double)PlatformTiming::NANOSECONDS_PER_SECOND);
+	}
+
+	FORCEINLINE double toSeconds(uint64 nanoseconds)
+	{
+		return (double)nanoseconds / (double)PlatformTiming::NANOSECONDS_PER_SECOND;
+	}
+
+	FORCEINLINE uint64 getTicks()
+	{
+		return PlatformTiming::getTicks();
+	}
+
+	inline double getTicksPerSecond()
+	{
+		return PlatformTiming::getTicksPerSecond();
+	}
 };
 
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "EngineCore/EngineUtils.h"
+#include <atomic>
+
+/*
+ *	Hands the latest of a stream of values from one producer thread to one
+ *	consumer thread without either of them ever waiting. The producer fills
+ *	its buffer and publishes it; the consumer picks up whatever was
+ *	published last, skipping any it was too slow to see. Each side owns one
+ *	of the three buffers at any time, and the third is the one in flight.
+ **/
+template<typename T>
+class TripleBuffer
+{
+public:
+	/** Every buffer starts as a copy of Initial, so containers in T can be sized up front. */
+	explicit TripleBuffer(const T& Initial = T()) :
+		Shared(SHARED_START),
+		WriteIndex(WRITE_START),
+		ReadIndex(READ_START)
+	{
+		for (uint32 Index = 0; Index < 3; Index++)
+		{
+			Buffers[Index].Value = Initial;
+		}
+	}
+
+	/** Producer only. Left as it was two publishes ago, not as it was last published. */
+	FORCEINLINE T& GetWriteBuffer() { return Buffers[WriteIndex].Value; }
+
+	/** Producer only. Makes the write buffer the latest value and takes another one to write. */
+	FORCEINLINE void Publish()
+	{
+		WriteIndex = Shared.exchange(WriteIndex | NEW_DATA, std::memory_order_acq_rel) & INDEX_MASK;
+	}
+
+	/** Consumer only. Moves the read buffer on to the latest value; false if nothing new was published. */
+	FORCEINLINE bool Acquire()
+	{
+		if ((Shared.load(std::memory_order_relaxed) & NEW_DATA) == 0)
+		{
+			return false;
+		}
+		ReadIndex = Shared.exchange(ReadIndex, std::memory_order_acq_rel) & INDEX_MASK;
+		return true;
+	}
+
+	/** Consumer only. Stays the same until the next successful Acquire. */
+	FORCEINLINE const T& GetReadBuffer() const { return Buffers[ReadIndex].Value; }
+private:
+	enum
+	{
+		INDEX_MASK = 3,
+		/** Set in Shared while its buffer holds a value the consumer has not acquired. */
+		NEW_DATA = 4,
+		WRITE_START = 0,
+		SHARED_START = 1,
+		READ_START = 2
+	};
+
+	/** Producer and consumer touch different buffers; keep them off each other's cache lines. */
+	struct alignas(64) Slot
+	{
+		T Value;
+	};
+
+	Slot Buffers[3];
+	alignas(64) std::atomic<uint32> Shared;
+	alignas(64) uint32 WriteIndex;
+	alignas(64) uint32 ReadIndex;
+
+	NULL_COPY_AND_ASSIGN(TripleBuffer);
+};
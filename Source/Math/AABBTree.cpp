@@ -0,0 +1,352 @@
+#include "AABBTree.h"
+#include <utility>
+
+AABBTree::AABBTree(float Margin)
+	: Root(NULL_NODE)
+	, FreeList(NULL_NODE)
+	, NumProxies(0)
+	, Margin(Margin)
+{
+}
+
+uint32 AABBTree::CreateProxy(const AABB& Bounds, uint32 UserData)
+{
+	uint32 _Proxy = AllocateNode();
+	Node& _Node = Nodes[_Proxy];
+	_Node.Bounds = Bounds.Eexpand(Margin);
+	_Node.UserData = UserData;
+	_Node.Height = 0;
+	InsertLeaf(_Proxy);
+	NumProxies++;
+	return _Proxy;
+}
+
+void AABBTree::DestroyProxy(uint32 Proxy)
+{
+	assertCheck(Proxy < Nodes.size() && Nodes[Proxy].Height == 0);
+	RemoveLeaf(Proxy);
+	FreeNode(Proxy);
+	NumProxies--;
+}
+
+bool AABBTree::MoveProxy(uint32 Proxy, const AABB& Bounds, const Spatial3D& Displacement)
+{
+	assertCheck(Proxy < Nodes.size() && Nodes[Proxy].Height == 0);
+	Node& _Node = Nodes[Proxy];
+
+	AABB _FatBounds = Bounds.Eexpand(Margin);
+	Cartesian3D _Stretch = Displacement.Inner() * (float)DISPLACEMENT_MULTIPLIER;
+	_FatBounds = AABB(_FatBounds.GetMinExtents() + _Stretch.Min(Cartesian3D(0.0f)), _FatBounds.GetMaxExtents() + _Stretch.Max(Cartesian3D(0.0f)));
+
+	if (_Node.Bounds.Contains(Bounds) && _FatBounds.Eexpand(Margin * MAX_ENLARGEMENT).Contains(_Node.Bounds))
+	{
+		return false;
+	}
+
+	RemoveLeaf(Proxy);
+	_Node.Bounds = _FatBounds;
+	InsertLeaf(Proxy);
+	return true;
+}
+
+uint32 AABBTree::GetHeight() const
+{
+	return Root == NULL_NODE ? 0 : (uint32)Nodes[Root].Height;
+}
+
+void AABBTree::QueryPairs(Array<ProxyPair>& OutPairs) const
+{
+	// Every pair of leaves meets at exactly one inner node, their lowest common
+	// ancestor, with one leaf under each child. Crossing the two children of
+	// every inner node therefore finds each pair once.
+	for (uint32 Index = 0; Index < Nodes.size(); Index++)
+	{
+		const Node& _Node = Nodes[Index];
+		if (_Node.Height > 0)
+		{
+			QueryPairs(_Node.Children[0], _Node.Children[1], OutPairs);
+		}
+	}
+}
+
+void AABBTree::QueryPairs(uint32 A, uint32 B, Array<ProxyPair>& OutPairs) const
+{
+	InlineArray<ProxyPair, 64> _Stack;
+	_Stack.push_back(ProxyPair{ A, B });
+	while (!_Stack.empty())
+	{
+		ProxyPair _Pair = _Stack.back();
+		_Stack.pop_back();
+		const Node& _A = Nodes[_Pair.ProxyA];
+		const Node& _B = Nodes[_Pair.ProxyB];
+		if (!_A.Bounds.Intersects(_B.Bounds))
+		{
+			continue;
+		}
+
+		if (_A.IsLeaf() && _B.IsLeaf())
+		{
+			OutPairs.push_back(_Pair.ProxyA < _Pair.ProxyB ? _Pair : ProxyPair{ _Pair.ProxyB, _Pair.ProxyA });
+		}
+		// Split the taller of the two, so both sides shrink at about the same rate.
+		else if (_A.Height > _B.Height)
+		{
+			_Stack.push_back(ProxyPair{ _A.Children[0], _Pair.ProxyB });
+			_Stack.push_back(ProxyPair{ _A.Children[1], _Pair.ProxyB });
+		}
+		else
+		{
+			_Stack.push_back(ProxyPair{ _Pair.ProxyA, _B.Children[0] });
+			_Stack.push_back(ProxyPair{ _Pair.ProxyA, _B.Children[1] });
+		}
+	}
+}
+
+void AABBTree::Validate() const
+{
+	uint32 _NumLeaves = 0;
+	if (Root != NULL_NODE)
+	{
+		assertCheck(Nodes[Root].Parent == NULL_NODE);
+		ValidateNode(Root, _NumLeaves);
+	}
+	assertCheck(_NumLeaves == NumProxies);
+
+	uint32 _NumFree = 0;
+	for (uint32 Index = FreeList; Index != NULL_NODE; Index = Nodes[Index].Parent)
+	{
+		assertCheck(Nodes[Index].Height == -1);
+		_NumFree++;
+	}
+	// A tree of n leaves has n - 1 inner nodes.
+	assertCheck(_NumFree + (NumProxies > 0 ? NumProxies * 2 - 1 : 0) == Nodes.size());
+}
+
+int32 AABBTree::ValidateNode(uint32 NodeIndex, uint32& NumLeaves) const
+{
+	const Node& _Node = Nodes[NodeIndex];
+	if (_Node.IsLeaf())
+	{
+		assertCheck(_Node.Height == 0);
+		NumLeaves++;
+		return 0;
+	}
+
+	const Node& _Child0 = Nodes[_Node.Children[0]];
+	const Node& _Child1 = Nodes[_Node.Children[1]];
+	assertCheck(_Child0.Parent == NodeIndex && _Child1.Parent == NodeIndex);
+	assertCheck(_Node.Bounds == _Child0.Bounds.AddAABB(_Child1.Bounds));
+
+	int32 _Height = 1 + Math::Max(ValidateNode(_Node.Children[0], NumLeaves), ValidateNode(_Node.Children[1], NumLeaves));
+	assertCheck(_Node.Height == _Height);
+	return _Height;
+}
+
+uint32 AABBTree::AllocateNode()
+{
+	uint32 _NodeIndex = FreeList;
+	if (_NodeIndex == NULL_NODE)
+	{
+		_NodeIndex = (uint32)Nodes.size();
+		Nodes.push_back(Node());
+	}
+	else
+	{
+		FreeList = Nodes[_NodeIndex].Parent;
+	}
+
+	Node& _Node = Nodes[_NodeIndex];
+	_Node.Parent = NULL_NODE;
+	_Node.Children[0] = NULL_NODE;
+	_Node.Children[1] = NULL_NODE;
+	_Node.Height = 0;
+	_Node.UserData = 0;
+	return _NodeIndex;
+}
+
+void AABBTree::FreeNode(uint32 NodeIndex)
+{
+	Nodes[NodeIndex].Parent = FreeList;
+	Nodes[NodeIndex].Height = -1;
+	FreeList = NodeIndex;
+}
+
+void AABBTree::InsertLeaf(uint32 Leaf)
+{
+	if (Root == NULL_NODE)
+	{
+		Root = Leaf;
+		Nodes[Leaf].Parent = NULL_NODE;
+		return;
+	}
+
+	// Walk down to the sibling that adds the least surface area. Pairing the
+	// leaf with a node grows every ancestor of that node too, so the cost of
+	// going further down includes that inherited growth, and the walk stops
+	// once stopping here is cheaper than either child.
+	uint32 _NewParent = AllocateNode();
+	const AABB _LeafBounds = Nodes[Leaf].Bounds;
+	uint32 _Sibling = Root;
+	while (!Nodes[_Sibling].IsLeaf())
+	{
+		const Node& _Node = Nodes[_Sibling];
+		float _Area = _Node.Bounds.GetSurfaceArea();
+		float _CombinedArea = _Node.Bounds.AddAABB(_LeafBounds).GetSurfaceArea();
+		float _Cost = 2.0f * _CombinedArea;
+		float _InheritanceCost = 2.0f * (_CombinedArea - _Area);
+
+		float _ChildCosts[2];
+		for (uint32 Child = 0; Child < 2; Child++)
+		{
+			const Node& _Child = Nodes[_Node.Children[Child]];
+			float _ChildArea = _Child.Bounds.AddAABB(_LeafBounds).GetSurfaceArea();
+			if (!_Child.IsLeaf())
+			{
+				_ChildArea -= _Child.Bounds.GetSurfaceArea();
+			}
+			_ChildCosts[Child] = _ChildArea + _InheritanceCost;
+		}
+
+		if (_Cost < _ChildCosts[0] && _Cost < _ChildCosts[1])
+		{
+			break;
+		}
+		_Sibling = _Node.Children[_ChildCosts[0] < _ChildCosts[1] ? 0 : 1];
+	}
+
+	uint32 _OldParent = Nodes[_Sibling].Parent;
+	Node& _Parent = Nodes[_NewParent];
+	_Parent.Parent = _OldParent;
+	_Parent.Bounds = Nodes[_Sibling].Bounds.AddAABB(_LeafBounds);
+	_Parent.Height = Nodes[_Sibling].Height + 1;
+	_Parent.Children[0] = _Sibling;
+	_Parent.Children[1] = Leaf;
+	Nodes[_Sibling].Parent = _NewParent;
+	Nodes[Leaf].Parent = _NewParent;
+
+	if (_OldParent == NULL_NODE)
+	{
+		Root = _NewParent;
+	}
+	else
+	{
+		ReplaceChild(_OldParent, _Sibling, _NewParent);
+	}
+
+	FixUpwards(_OldParent);
+}
+
+void AABBTree::RemoveLeaf(uint32 Leaf)
+{
+	if (Leaf == Root)
+	{
+		Root = NULL_NODE;
+		return;
+	}
+
+	// The leaf's parent goes with it, and the sibling takes the parent's place.
+	uint32 _Parent = Nodes[Leaf].Parent;
+	uint32 _GrandParent = Nodes[_Parent].Parent;
+	uint32 _Sibling = Nodes[_Parent].Children[Nodes[_Parent].Children[0] == Leaf ? 1 : 0];
+
+	Nodes[_Sibling].Parent = _GrandParent;
+	if (_GrandParent == NULL_NODE)
+	{
+		Root = _Sibling;
+	}
+	else
+	{
+		ReplaceChild(_GrandParent, _Parent, _Sibling);
+	}
+	FreeNode(_Parent);
+
+	FixUpwards(_GrandParent);
+}
+
+void AABBTree::FixUpwards(uint32 NodeIndex)
+{
+	while (NodeIndex != NULL_NODE)
+	{
+		NodeIndex = Balance(NodeIndex);
+		Refit(NodeIndex);
+		NodeIndex = Nodes[NodeIndex].Parent;
+	}
+}
+
+uint32 AABBTree::Balance(uint32 A)
+{
+	const Node& _A = Nodes[A];
+	if (_A.Height < 2)
+	{
+		return A;
+	}
+
+	int32 _Balance = Nodes[_A.Children[1]].Height - Nodes[_A.Children[0]].Height;
+	if (_Balance > 1)
+	{
+		return RotateUp(A, _A.Children[1]);
+	}
+	if (_Balance < -1)
+	{
+		return RotateUp(A, _A.Children[0]);
+	}
+	return A;
+}
+
+uint32 AABBTree::RotateUp(uint32 A, uint32 Child)
+{
+	Node& _A = Nodes[A];
+	Node& _Child = Nodes[Child];
+	assertCheck(!_Child.IsLeaf());
+
+	// Child takes A's place, with A under it.
+	_Child.Parent = _A.Parent;
+	_A.Parent = Child;
+	if (_Child.Parent == NULL_NODE)
+	{
+		Root = Child;
+	}
+	else
+	{
+		ReplaceChild(_Child.Parent, A, Child);
+	}
+
+	// Child keeps its taller child, and A gets the shorter in Child's old place.
+	uint32 _Taller = _Child.Children[0];
+	uint32 _Shorter = _Child.Children[1];
+	if (Nodes[_Taller].Height < Nodes[_Shorter].Height)
+	{
+		std::swap(_Taller, _Shorter);
+	}
+	_Child.Children[0] = A;
+	_Child.Children[1] = _Taller;
+	ReplaceChild(A, Child, _Shorter);
+	Nodes[_Shorter].Parent = A;
+
+	Refit(A);
+	Refit(Child);
+	return Child;
+}
+
+void AABBTree::Refit(uint32 NodeIndex)
+{
+	Node& _Node = Nodes[NodeIndex];
+	const Node& _Child0 = Nodes[_Node.Children[0]];
+	const Node& _Child1 = Nodes[_Node.Children[1]];
+	_Node.Bounds = _Child0.Bounds.AddAABB(_Child1.Bounds);
+	_Node.Height = 1 + Math::Max(_Child0.Height, _Child1.Height);
+}
+
+void AABBTree::ReplaceChild(uint32 Parent, uint32 OldChild, uint32 NewChild)
+{
+	Node& _Parent = Nodes[Parent];
+	if (_Parent.Children[0] == OldChild)
+	{
+		_Parent.Children[0] = NewChild;
+	}
+	else
+	{
+		assertCheck(_Parent.Children[1] == OldChild);
+		_Parent.Children[1] = NewChild;
+	}
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "aabb.h"
+#include "DataTypes/MArray.h"
+
+/*
+ *	Broadphase for objects that move every frame: a binary tree of boxes
+ *	updated one proxy at a time instead of rebuilt. Each proxy is stored
+ *	with bounds fattened by a margin, so small moves that stay inside them
+ *	cost nothing. Proxies that do leave them are removed and reinserted
+ *	next to the sibling that grows the tree's surface area the least, and
+ *	every node above a change is rotated back into balance on the way up,
+ *	which keeps the tree O(log n) deep and create, move and destroy O(log n).
+ *
+ *	Proxy ids are node indices, stable for as long as the proxy lives and
+ *	reused after it is destroyed.
+ **/
+class AABBTree
+{
+public:
+	enum : uint32
+	{
+		NULL_NODE = 0xFFFFFFFF
+	};
+
+	struct ProxyPair
+	{
+		/** The smaller of the two proxy ids. */
+		uint32 ProxyA;
+		uint32 ProxyB;
+	};
+
+	/** Margin is how far proxy bounds are fattened on every side. */
+	explicit AABBTree(float Margin = 0.1f);
+
+	uint32 CreateProxy(const AABB& Bounds, uint32 UserData);
+	void DestroyProxy(uint32 Proxy);
+	/*
+	 *	Moves Proxy to Bounds, and returns whether that took reinserting it:
+	 *	nothing changes while Bounds stays inside its fat bounds and those are
+	 *	not far larger than Bounds needs. Displacement
+	 *	is how far it is expected to move next; the new fat bounds stretch that
+	 *	way, so a proxy moving steadily is reinserted less often.
+	 **/
+	bool MoveProxy(uint32 Proxy, const AABB& Bounds, const Spatial3D& Displacement = Spatial3D(0.0f, 0.0f, 0.0f));
+
+	FORCEINLINE uint32 GetUserData(uint32 Proxy) const;
+	FORCEINLINE const AABB& GetFatBounds(uint32 Proxy) const;
+	FORCEINLINE uint32 GetNumProxies() const { return NumProxies; }
+	/** Height of the root, 0 for a single proxy. */
+	uint32 GetHeight() const;
+
+	/** Calls InFunction(uint32 Proxy) for every proxy whose fat bounds AABB::Intersects Bounds. */
+	template<typename Function>
+	void Query(const AABB& Bounds, const Function& InFunction) const;
+
+	/*
+	 *	Appends every pair of proxies whose fat bounds AABB::Intersects each
+	 *	other's to OutPairs, each pair once. Pairs are found where they meet:
+	 *	the two subtrees of every inner node are descended together, so subtrees
+	 *	that do not overlap are never looked into.
+	 **/
+	void QueryPairs(Array<ProxyPair>& OutPairs) const;
+
+	/** Asserts that parents, heights and bounds are all consistent. */
+	void Validate() const;
+
+private:
+	enum
+	{
+		/** How much of Displacement the fat bounds stretch by. */
+		DISPLACEMENT_MULTIPLIER = 2,
+		/** Fat bounds this many margins past what a move needs are shrunk again, so a proxy that stopped does not keep the stretch. */
+		MAX_ENLARGEMENT = 4
+	};
+
+	struct Node
+	{
+		/** Fattened for leaves, the union of the children's otherwise. */
+		AABB Bounds;
+		/** The next free node while this one is free. */
+		uint32 Parent;
+		/** NULL_NODE for leaves. */
+		uint32 Children[2];
+		/** 0 for leaves, -1 while free. */
+		int32 Height;
+		uint32 UserData;
+
+		FORCEINLINE bool IsLeaf() const { return Children[0] == NULL_NODE; }
+	};
+
+	Array<Node> Nodes;
+	uint32 Root;
+	uint32 FreeList;
+	uint32 NumProxies;
+	float Margin;
+
+	uint32 AllocateNode();
+	void FreeNode(uint32 NodeIndex);
+	void InsertLeaf(uint32 Leaf);
+	void RemoveLeaf(uint32 Leaf);
+	/** Refits and rebalances every node from NodeIndex up to the root. */
+	void FixUpwards(uint32 NodeIndex);
+	/** Rotates A's taller child up if A's subtrees differ in height by more than one; returns what is now in A's place. */
+	uint32 Balance(uint32 A);
+	/** Makes Child, a child of A, A's parent, handing A the shorter of Child's children. */
+	uint32 RotateUp(uint32 A, uint32 Child);
+	/** Recomputes NodeIndex's bounds and height from its children. */
+	void Refit(uint32 NodeIndex);
+	void ReplaceChild(uint32 Parent, uint32 OldChild, uint32 NewChild);
+	/** Appends every overlapping pair with one proxy under A and the other under B. */
+	void QueryPairs(uint32 A, uint32 B, Array<ProxyPair>& OutPairs) const;
+	/** Returns the height of the subtree at NodeIndex, and counts its leaves into NumLeaves. */
+	int32 ValidateNode(uint32 NodeIndex, uint32& NumLeaves) const;
+
+	NULL_COPY_AND_ASSIGN(AABBTree);
+};
+
+FORCEINLINE uint32 AABBTree::GetUserData(uint32 Proxy) const
+{
+	assertCheck(Proxy < Nodes.size() && Nodes[Proxy].Height == 0);
+	return Nodes[Proxy].UserData;
+}
+
+FORCEINLINE const AABB& AABBTree::GetFatBounds(uint32 Proxy) const
+{
+	assertCheck(Proxy < Nodes.size() && Nodes[Proxy].Height == 0);
+	return Nodes[Proxy].Bounds;
+}
+
+template<typename Function>
+void AABBTree::Query(const AABB& Bounds, const Function& InFunction) const
+{
+	if (Root == NULL_NODE)
+	{
+		return;
+	}
+
+	InlineArray<uint32, 64> _Stack;
+	_Stack.push_back(Root);
+	while (!_Stack.empty())
+	{
+		uint32 _NodeIndex = _Stack.back();
+		_Stack.pop_back();
+		const Node& _Node = Nodes[_NodeIndex];
+		if (!_Node.Bounds.Intersects(Bounds))
+		{
+			continue;
+		}
+		if (_Node.IsLeaf())
+		{
+			InFunction(_NodeIndex);
+		}
+		else
+		{
+			_Stack.push_back(_Node.Children[0]);
+			_Stack.push_back(_Node.Children[1]);
+		}
+	}
+}
@@ -0,0 +1,49 @@
+#include "AffineMatrix.h"
+
+void AffineMatrix::GetColumns(Vector* columns) const
+{
+	float _m[3][4];
+	for (uint32 i = 0; i < 3; i++) 
+	{
+		m[i].Store4f(_m[i]);
+	}
+	for (uint32 i = 0; i < 4; i++) 
+	{
+		columns[i] = Vector::Make(_m[0][i], _m[1][i], _m[2][i], 0.0f);
+	}
+}
+
+AffineMatrix AffineMatrix::Inverse() const
+{
+	Vector _Columns[4];
+	GetColumns(_Columns);
+
+	// Rows of the inverse 3x3 are the cross products of the columns over the determinant
+	Vector _Rows[3];
+	_Rows[0] = _Columns[1].Cross3(_Columns[2]);
+	_Rows[1] = _Columns[2].Cross3(_Columns[0]);
+	_Rows[2] = _Columns[0].Cross3(_Columns[1]);
+	Vector _InvDeterminant = _Columns[0].Dot3(_Rows[0]).Reciprocal();
+
+	AffineMatrix result;
+	for (uint32 i = 0; i < 3; i++) 
+	{
+		_Rows[i] = _Rows[i] * _InvDeterminant;
+		result.m[i] = _Rows[i].Select(VectorConstants::MASK_W, -_Rows[i].Dot3(_Columns[3]));
+	}
+	return result;
+}
+
+AffineMatrix AffineMatrix::InverseRigid() const
+{
+	Vector _Columns[4];
+	GetColumns(_Columns);
+
+	// The rotation inverts by transposing, the translation by rotating it back
+	AffineMatrix result;
+	for (uint32 i = 0; i < 3; i++) 
+	{
+		result.m[i] = _Columns[i].Select(VectorConstants::MASK_W, -_Columns[i].Dot3(_Columns[3]));
+	}
+	return result;
+}
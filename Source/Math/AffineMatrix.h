@@ -0,0 +1,154 @@
+#pragma once
+
+#include "Matrix.h"
+
+/*
+ *	Matrix with an implicit (0, 0, 0, 1) last row, stored as the three rows
+ *	of a Matrix. Covers every translation/rotation/scale transform, and
+ *	skips the work (and the upload) that a constant last row would cost.
+ *
+ *	Uses the same convention as Matrix: row i is (axis_i, translation_i).
+ **/
+class AffineMatrix
+{
+public:
+	FORCEINLINE AffineMatrix();
+	FORCEINLINE AffineMatrix(const Vector& vecX, const Vector& vecY, const Vector& vecZ);
+	/** Drops the last row of Other, which must be (0, 0, 0, 1) for the result to be exact. */
+	FORCEINLINE explicit AffineMatrix(const Matrix& Other);
+
+	static FORCEINLINE AffineMatrix Identity();
+	static FORCEINLINE AffineMatrix TransformMatrix(const Cartesian3D& translation,
+			const Quaternion& rotation, const Cartesian3D& scale);
+
+	FORCEINLINE Matrix ToMatrix() const;
+
+	FORCEINLINE AffineMatrix operator* (const AffineMatrix& other) const;
+	FORCEINLINE AffineMatrix& operator*= (const AffineMatrix& other);
+	FORCEINLINE bool operator==(const AffineMatrix& other) const;
+	FORCEINLINE bool operator!=(const AffineMatrix& other) const;
+	FORCEINLINE bool Equals(const AffineMatrix& other, float errorMargin=1.e-4f) const;
+
+	/** Transforms point as if its w were 1, returns w = 1. */
+	FORCEINLINE Vector TransformPoint(const Vector& point) const;
+	/** Transforms direction as if its w were 0, returns w = 0. */
+	FORCEINLINE Vector TransformDirection(const Vector& direction) const;
+
+	FORCEINLINE float Determinant3x3() const;
+	/** Inverse of any invertible affine matrix. */
+	AffineMatrix Inverse() const;
+	/** Inverse of a matrix holding only rotation and translation, ie. no scale or shear. */
+	AffineMatrix InverseRigid() const;
+
+	FORCEINLINE Vector GetTranslation() const;
+
+	FORCEINLINE Vector operator[](uint32 index) const {
+		assertCheck(index < 3);
+		return m[index];
+	}
+private:
+	Vector m[3];
+
+	void GetColumns(Vector* columns) const;
+};
+
+FORCEINLINE AffineMatrix::AffineMatrix() {}
+
+FORCEINLINE AffineMatrix::AffineMatrix(const Vector& vecX, const Vector& vecY,
+		const Vector& vecZ)
+{
+	m[0] = vecX;
+	m[1] = vecY;
+	m[2] = vecZ;
+}
+
+FORCEINLINE AffineMatrix::AffineMatrix(const Matrix& other)
+{
+	m[0] = other[0];
+	m[1] = other[1];
+	m[2] = other[2];
+}
+
+FORCEINLINE AffineMatrix AffineMatrix::Identity()
+{
+	return AffineMatrix(
+			Vector::Make(1.0f, 0.0f, 0.0f, 0.0f),
+			Vector::Make(0.0f, 1.0f, 0.0f, 0.0f),
+			Vector::Make(0.0f, 0.0f, 1.0f, 0.0f));
+}
+
+FORCEINLINE AffineMatrix AffineMatrix::TransformMatrix(const Cartesian3D& translation,
+		const Quaternion& rotation, const Cartesian3D& scale)
+{
+	return AffineMatrix(Matrix::TransformMatrix(translation, rotation, scale));
+}
+
+FORCEINLINE Matrix AffineMatrix::ToMatrix() const
+{
+	return Matrix(m[0], m[1], m[2], Vector::Make(0.0f, 0.0f, 0.0f, 1.0f));
+}
+
+FORCEINLINE AffineMatrix AffineMatrix::operator* (const AffineMatrix& other) const
+{
+	AffineMatrix result;
+	for(uint32 i = 0; i < 3; i++) {
+		// The implicit last row of other only contributes our translation
+		Vector temp = VectorConstants::ZERO.Select(VectorConstants::MASK_W, m[i]);
+		temp = m[i].Replicate(0).Mad(other.m[0], temp);
+		temp = m[i].Replicate(1).Mad(other.m[1], temp);
+		result.m[i] = m[i].Replicate(2).Mad(other.m[2], temp);
+	}
+	return result;
+}
+
+FORCEINLINE AffineMatrix& AffineMatrix::operator*= (const AffineMatrix& other)
+{
+	*this = *this * other;
+	return *this;
+}
+
+FORCEINLINE bool AffineMatrix::operator==(const AffineMatrix& other) const
+{
+	for(uint32 i = 0; i < 3; i++) {
+		if(!(m[i] != other.m[i]).IsZero4f()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+FORCEINLINE bool AffineMatrix::operator!=(const AffineMatrix& other) const
+{
+	return !(*this == other);
+}
+
+FORCEINLINE bool AffineMatrix::Equals(const AffineMatrix& other, float errorMargin) const
+{
+	for(uint32 i = 0; i < 3; i++) {
+		if(!(m[i].NotEquals(other.m[i], errorMargin)).IsZero4f()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+FORCEINLINE Vector AffineMatrix::TransformPoint(const Vector& point) const
+{
+	Vector _Point = point.Select(VectorConstants::MASK_W, VectorConstants::ONE);
+	return Vector::Make(m[0].Dot4(_Point)[0], m[1].Dot4(_Point)[0], m[2].Dot4(_Point)[0], 1.0f);
+}
+
+FORCEINLINE Vector AffineMatrix::TransformDirection(const Vector& direction) const
+{
+	return Vector::Make(m[0].Dot3(direction)[0], m[1].Dot3(direction)[0], m[2].Dot3(direction)[0], 0.0f);
+}
+
+FORCEINLINE float AffineMatrix::Determinant3x3() const
+{
+	return m[0].Dot3(m[1].Cross3(m[2]))[0];
+}
+
+FORCEINLINE Vector AffineMatrix::GetTranslation() const
+{
+	return Vector::Make(m[0][3], m[1][3], m[2][3], 1.0f);
+}
@@ -0,0 +1,444 @@
+#include "BVH.h"
+#include "EngineCore/JobSystem.h"
+#include <algorithm>
+#include <atomic>
+#include <limits>
+
+namespace
+{
+	enum : uint32
+	{
+		INVALID_NODE = 0xFFFFFFFF
+	};
+
+	/** Relative to testing one box. */
+	const float TRAVERSAL_COST = 1.0f;
+
+	FORCEINLINE AABB getEmptyBounds()
+	{
+		float _Max = std::numeric_limits<float>::max();
+		return AABB(Spatial3D(_Max, _Max, _Max), Spatial3D(-_Max, -_Max, -_Max));
+	}
+
+	/** Node of the binary tree that is built first. Left is INVALID_NODE for leaves. */
+	struct BuildNode
+	{
+		AABB Bounds;
+		uint32 Left;
+		uint32 Right;
+		uint32 First;
+		uint32 Count;
+	};
+
+	struct BuildContext
+	{
+		const AABB* Boxes;
+		Array<Vector> Centroids;
+		/** Ranges of this are what the nodes cover; each range is partitioned as its node is split. */
+		Array<uint32> Indices;
+		Array<BuildNode> Nodes;
+		std::atomic<uint32> NumNodes;
+	};
+
+	struct BuildTask
+	{
+		BuildContext* Context;
+		uint32 NodeIndex;
+		uint32 First;
+		uint32 Count;
+		uint32 Depth;
+	};
+
+	struct Bin
+	{
+		Vector Min;
+		Vector Max;
+		uint32 Count;
+	};
+
+	/** Half the surface area, which is all SAH needs as it only compares costs. */
+	FORCEINLINE float getHalfArea(const Vector& Min, const Vector& Max)
+	{
+		float _Lengths[4];
+		(Max - Min).Store4f(_Lengths);
+		return _Lengths[0] * _Lengths[1] + _Lengths[1] * _Lengths[2] + _Lengths[2] * _Lengths[0];
+	}
+
+	void buildNode(Job* InJob, const BuildTask& Task);
+
+	void buildNodeJob(Job* InJob, void* Data)
+	{
+		buildNode(InJob, *(const BuildTask*)Data);
+	}
+
+	/** Splits at the median centroid along Axis; for ranges SAH cannot split, or that are already deep. */
+	uint32 splitAtMedian(BuildContext& Context, uint32 First, uint32 Count, uint32 Axis)
+	{
+		uint32* _Indices = Context.Indices.data() + First;
+		const Vector* _Centroids = Context.Centroids.data();
+		std::nth_element(_Indices, _Indices + Count / 2, _Indices + Count,
+			[=](uint32 Left, uint32 Right) { return _Centroids[Left][Axis] < _Centroids[Right][Axis]; });
+		return Count / 2;
+	}
+
+	/** Number of boxes that go left, or 0 to make a leaf. */
+	uint32 split(BuildContext& Context, uint32 First, uint32 Count, uint32 Depth, const AABB& Bounds)
+	{
+		const uint32* _Indices = Context.Indices.data() + First;
+		const Vector* _Centroids = Context.Centroids.data();
+
+		Vector _CentroidMin = _Centroids[_Indices[0]];
+		Vector _CentroidMax = _CentroidMin;
+		for (uint32 Index = 1; Index < Count; Index++)
+		{
+			_CentroidMin = _CentroidMin.Min(_Centroids[_Indices[Index]]);
+			_CentroidMax = _CentroidMax.Max(_Centroids[_Indices[Index]]);
+		}
+		float _Extents[4];
+		(_CentroidMax - _CentroidMin).Store4f(_Extents);
+		Vector _EmptyMin = Vector::Load1f(std::numeric_limits<float>::max());
+		Vector _EmptyMax = -_EmptyMin;
+		uint32 _LongestAxis = _Extents[0] > _Extents[1] ? (_Extents[0] > _Extents[2] ? 0 : 2) : (_Extents[1] > _Extents[2] ? 1 : 2);
+
+		if (_Extents[_LongestAxis] <= 0.0f)
+		{
+			// Every centroid is in the same place, so no split separates them
+			return Count <= BVH::MAX_LEAF_SIZE ? 0 : splitAtMedian(Context, First, Count, _LongestAxis);
+		}
+		if (Depth >= BVH::MAX_SAH_DEPTH)
+		{
+			return splitAtMedian(Context, First, Count, _LongestAxis);
+		}
+
+		// Bin every centroid along all three axes at once, with fewer bins for ranges that cannot fill them
+		uint32 _NumBins = Count < BVH::NUM_BINS ? Count : (uint32)BVH::NUM_BINS;
+		Bin _Bins[3][BVH::NUM_BINS];
+		for (uint32 Axis = 0; Axis < 3; Axis++)
+		{
+			for (uint32 BinIndex = 0; BinIndex < _NumBins; BinIndex++)
+			{
+				_Bins[Axis][BinIndex].Min = _EmptyMin;
+				_Bins[Axis][BinIndex].Max = _EmptyMax;
+				_Bins[Axis][BinIndex].Count = 0;
+			}
+		}
+		Vector _BinScale = (Vector::Load1f(_NumBins * 0.9999f) / (_CentroidMax - _CentroidMin))
+				.Select(_CentroidMax > _CentroidMin, VectorConstants::ZERO);
+		for (uint32 Index = 0; Index < Count; Index++)
+		{
+			uint32 _Box = _Indices[Index];
+			Vector _BoxMin = Context.Boxes[_Box].GetMinExtents().AsIntrinsic();
+			Vector _BoxMax = Context.Boxes[_Box].GetMaxExtents().AsIntrinsic();
+			float _BinIndices[4];
+			((_Centroids[_Box] - _CentroidMin) * _BinScale).Store4f(_BinIndices);
+			for (uint32 Axis = 0; Axis < 3; Axis++)
+			{
+				Bin& _Bin = _Bins[Axis][(uint32)_BinIndices[Axis]];
+				_Bin.Min = _Bin.Min.Min(_BoxMin);
+				_Bin.Max = _Bin.Max.Max(_BoxMax);
+				_Bin.Count++;
+			}
+		}
+
+		// Sweep from the right for the cost of everything right of each plane, then from the left
+		float _BestCost = std::numeric_limits<float>::max();
+		uint32 _BestAxis = 0;
+		uint32 _BestPlane = 0;
+		for (uint32 Axis = 0; Axis < 3; Axis++)
+		{
+			if (_Extents[Axis] <= 0.0f)
+			{
+				continue;
+			}
+			const Bin* _AxisBins = _Bins[Axis];
+			float _RightCosts[BVH::NUM_BINS];
+			Vector _RightMin = _EmptyMin;
+			Vector _RightMax = _EmptyMax;
+			uint32 _RightCount = 0;
+			for (uint32 Plane = _NumBins - 1; Plane > 0; Plane--)
+			{
+				_RightMin = _RightMin.Min(_AxisBins[Plane].Min);
+				_RightMax = _RightMax.Max(_AxisBins[Plane].Max);
+				_RightCount += _AxisBins[Plane].Count;
+				_RightCosts[Plane] = _RightCount > 0 ? getHalfArea(_RightMin, _RightMax) * _RightCount : 0.0f;
+			}
+			Vector _LeftMin = _EmptyMin;
+			Vector _LeftMax = _EmptyMax;
+			uint32 _LeftCount = 0;
+			for (uint32 Plane = 1; Plane < _NumBins; Plane++)
+			{
+				_LeftMin = _LeftMin.Min(_AxisBins[Plane - 1].Min);
+				_LeftMax = _LeftMax.Max(_AxisBins[Plane - 1].Max);
+				_LeftCount += _AxisBins[Plane - 1].Count;
+				if (_LeftCount == 0 || _LeftCount == Count)
+				{
+					continue;
+				}
+				float _Cost = getHalfArea(_LeftMin, _LeftMax) * _LeftCount + _RightCosts[Plane];
+				if (_Cost < _BestCost)
+				{
+					_BestCost = _Cost;
+					_BestAxis = Axis;
+					_BestPlane = Plane;
+				}
+			}
+		}
+
+		float _ParentArea = getHalfArea(Bounds.GetMinExtents().AsIntrinsic(), Bounds.GetMaxExtents().AsIntrinsic());
+		if (_BestCost == std::numeric_limits<float>::max())
+		{
+			return Count <= BVH::MAX_LEAF_SIZE ? 0 : splitAtMedian(Context, First, Count, _LongestAxis);
+		}
+		if (Count <= BVH::MAX_LEAF_SIZE && (float)Count * _ParentArea <= TRAVERSAL_COST * _ParentArea + _BestCost)
+		{
+			return 0;
+		}
+
+		float _Min = _CentroidMin[_BestAxis];
+		float _Scale = _BinScale[_BestAxis];
+		uint32* _Partition = std::partition(Context.Indices.data() + First, Context.Indices.data() + First + Count,
+			[=](uint32 Box) { return (uint32)((_Centroids[Box][_BestAxis] - _Min) * _Scale) < _BestPlane; });
+		uint32 _LeftCount = (uint32)(_Partition - (Context.Indices.data() + First));
+		if (_LeftCount == 0 || _LeftCount == Count)
+		{
+			// Rounding can put a centroid in a different bin than binning did
+			return splitAtMedian(Context, First, Count, _BestAxis);
+		}
+		return _LeftCount;
+	}
+
+	void buildNode(Job* InJob, const BuildTask& Task)
+	{
+		BuildContext& _Context = *Task.Context;
+		const uint32* _Indices = _Context.Indices.data() + Task.First;
+
+		AABB _Bounds = _Context.Boxes[_Indices[0]];
+		for (uint32 Index = 1; Index < Task.Count; Index++)
+		{
+			_Bounds = _Bounds.AddAABB(_Context.Boxes[_Indices[Index]]);
+		}
+
+		BuildNode& _Node = _Context.Nodes[Task.NodeIndex];
+		_Node.Bounds = _Bounds;
+		_Node.First = Task.First;
+		_Node.Count = Task.Count;
+		_Node.Left = INVALID_NODE;
+		_Node.Right = INVALID_NODE;
+
+		uint32 _LeftCount = Task.Count > 1 ? split(_Context, Task.First, Task.Count, Task.Depth, _Bounds) : 0;
+		if (_LeftCount == 0)
+		{
+			return;
+		}
+
+		_Node.Left = _Context.NumNodes.fetch_add(2, std::memory_order_relaxed);
+		_Node.Right = _Node.Left + 1;
+
+		BuildTask _Left = { &_Context, _Node.Left, Task.First, _LeftCount, Task.Depth + 1 };
+		BuildTask _Right = { &_Context, _Node.Right, Task.First + _LeftCount, Task.Count - _LeftCount, Task.Depth + 1 };
+		if (_Left.Count >= BVH::PARALLEL_THRESHOLD)
+		{
+			JobSystem::Run(JobSystem::CreateChildJob(InJob, &buildNodeJob, _Left));
+		}
+		else
+		{
+			buildNode(InJob, _Left);
+		}
+		buildNode(InJob, _Right);
+	}
+}
+
+BVH::Ray::Ray(const Spatial3D& Start, const Spatial3D& Direction)
+{
+	float _InvDirection[3];
+	for (uint32 Axis = 0; Axis < 3; Axis++)
+	{
+		// Keeps 0 * infinity out of the slab tests for rays parallel to an axis
+		float _Direction = Direction[Axis];
+		_InvDirection[Axis] = Math::Abs(_Direction) > SUPER_SMALL_NUMBER ? 1.0f / _Direction : (_Direction < 0.0f ? -1.e30f : 1.e30f);
+		Origin[Axis] = Vector::Load1f(Start[Axis]);
+		InvDirection[Axis] = Vector::Load1f(_InvDirection[Axis]);
+	}
+	OriginAll = Start.AsIntrinsic();
+	InvDirectionAll = Vector::Make(_InvDirection[0], _InvDirection[1], _InvDirection[2], 0.0f);
+}
+
+void BVH::Build(const AABB* InBoxes, uint32 Count)
+{
+	Clear();
+	if (Count == 0)
+	{
+		return;
+	}
+	assertCheck(Count <= (LEAF_BIT >> LEAF_COUNT_BITS));
+
+	BuildContext _Context;
+	_Context.Boxes = InBoxes;
+	_Context.Centroids.resize(Count);
+	_Context.Indices.resize(Count);
+	for (uint32 Index = 0; Index < Count; Index++)
+	{
+		_Context.Centroids[Index] = InBoxes[Index].GetCenter().AsIntrinsic();
+		_Context.Indices[Index] = Index;
+	}
+	// A binary tree over Count leaves never has more than 2 * Count - 1 nodes
+	_Context.Nodes.resize(2 * Count - 1);
+	_Context.NumNodes.store(1, std::memory_order_relaxed);
+
+	BuildTask _Root = { &_Context, 0, 0, Count, 0 };
+	Job* _RootJob = JobSystem::CreateJob(&buildNodeJob, _Root);
+	JobSystem::Run(_RootJob);
+	JobSystem::Wait(_RootJob);
+
+	Boxes.resize(Count);
+	Indices.resize(Count);
+	for (uint32 Index = 0; Index < Count; Index++)
+	{
+		Indices[Index] = _Context.Indices[Index];
+		Boxes[Index] = InBoxes[Indices[Index]];
+	}
+
+	// Collapse into nodes of four: each node starts with its binary node's
+	// children, then keeps replacing the largest inner child with its two
+	// children while there is room. A root that is a leaf gets a node of its own.
+	const Array<BuildNode>& _BuildNodes = _Context.Nodes;
+	struct Collapse
+	{
+		static uint32 Run(const Array<BuildNode>& BuildNodes, Array<Node>& OutNodes, uint32 BuildIndex)
+		{
+			uint32 _Children[4];
+			uint32 _NumChildren = 0;
+			const BuildNode& _Root = BuildNodes[BuildIndex];
+			if (_Root.Left == INVALID_NODE)
+			{
+				_Children[_NumChildren++] = BuildIndex;
+			}
+			else
+			{
+				_Children[_NumChildren++] = _Root.Left;
+				_Children[_NumChildren++] = _Root.Right;
+			}
+			while (_NumChildren < 4)
+			{
+				uint32 _Largest = INVALID_NODE;
+				float _LargestArea = -1.0f;
+				for (uint32 Child = 0; Child < _NumChildren; Child++)
+				{
+					const BuildNode& _Node = BuildNodes[_Children[Child]];
+					if (_Node.Left != INVALID_NODE && _Node.Bounds.GetSurfaceArea() > _LargestArea)
+					{
+						_Largest = Child;
+						_LargestArea = _Node.Bounds.GetSurfaceArea();
+					}
+				}
+				if (_Largest == INVALID_NODE)
+				{
+					break;
+				}
+				const BuildNode& _Expanded = BuildNodes[_Children[_Largest]];
+				_Children[_Largest] = _Expanded.Left;
+				_Children[_NumChildren++] = _Expanded.Right;
+			}
+
+			uint32 _NodeIndex = (uint32)OutNodes.size();
+			OutNodes.push_back(Node());
+			float _Max = std::numeric_limits<float>::max();
+			for (uint32 Lane = 0; Lane < 4; Lane++)
+			{
+				for (uint32 Axis = 0; Axis < 3; Axis++)
+				{
+					OutNodes[_NodeIndex].Min[Axis][Lane] = _Max;
+					OutNodes[_NodeIndex].Max[Axis][Lane] = -_Max;
+				}
+				OutNodes[_NodeIndex].Children[Lane] = INVALID_NODE;
+			}
+			OutNodes[_NodeIndex].NumChildren = _NumChildren;
+
+			for (uint32 Lane = 0; Lane < _NumChildren; Lane++)
+			{
+				const BuildNode& _Child = BuildNodes[_Children[Lane]];
+				uint32 _Encoded = _Child.Left == INVALID_NODE
+						? LEAF_BIT | (_Child.First << LEAF_COUNT_BITS) | (_Child.Count - 1)
+						: Run(BuildNodes, OutNodes, _Children[Lane]);
+
+				Node& _Node = OutNodes[_NodeIndex];
+				_Node.Children[Lane] = _Encoded;
+				for (uint32 Axis = 0; Axis < 3; Axis++)
+				{
+					_Node.Min[Axis][Lane] = _Child.Bounds.GetMinExtents()[Axis];
+					_Node.Max[Axis][Lane] = _Child.Bounds.GetMaxExtents()[Axis];
+				}
+			}
+			return _NodeIndex;
+		}
+	};
+	Nodes.reserve(_Context.NumNodes.load(std::memory_order_relaxed) / 2 + 1);
+	Collapse::Run(_BuildNodes, Nodes, 0);
+}
+
+void BVH::Refit(const AABB* InBoxes)
+{
+	for (uint32 Index = 0; Index < Boxes.size(); Index++)
+	{
+		Boxes[Index] = InBoxes[Indices[Index]];
+	}
+
+	// Children always come after their parents, so going backwards refits
+	// every child before the node that bounds it
+	Array<AABB> _NodeBounds(Nodes.size());
+	for (uint32 NodeIndex = (uint32)Nodes.size(); NodeIndex-- > 0;)
+	{
+		Node& _Node = Nodes[NodeIndex];
+		AABB _Bounds = getEmptyBounds();
+		for (uint32 Lane = 0; Lane < _Node.NumChildren; Lane++)
+		{
+			uint32 _Child = _Node.Children[Lane];
+			AABB _ChildBounds;
+			if (_Child & LEAF_BIT)
+			{
+				uint32 _First = GetLeafFirst(_Child);
+				uint32 _End = _First + GetLeafCount(_Child);
+				_ChildBounds = Boxes[_First];
+				for (uint32 Box = _First + 1; Box < _End; Box++)
+				{
+					_ChildBounds = _ChildBounds.AddAABB(Boxes[Box]);
+				}
+			}
+			else
+			{
+				_ChildBounds = _NodeBounds[_Child];
+			}
+
+			for (uint32 Axis = 0; Axis < 3; Axis++)
+			{
+				_Node.Min[Axis][Lane] = _ChildBounds.GetMinExtents()[Axis];
+				_Node.Max[Axis][Lane] = _ChildBounds.GetMaxExtents()[Axis];
+			}
+			_Bounds = _Bounds.AddAABB(_ChildBounds);
+		}
+		_NodeBounds[NodeIndex] = _Bounds;
+	}
+}
+
+void BVH::Clear()
+{
+	Nodes.clear();
+	Boxes.clear();
+	Indices.clear();
+}
+
+AABB BVH::GetBounds() const
+{
+	AABB _Bounds = getEmptyBounds();
+	if (Nodes.empty())
+	{
+		return _Bounds;
+	}
+	const Node& _Root = Nodes[0];
+	for (uint32 Lane = 0; Lane < _Root.NumChildren; Lane++)
+	{
+		_Bounds = _Bounds.AddAABB(AABB(Spatial3D(_Root.Min[0][Lane], _Root.Min[1][Lane], _Root.Min[2][Lane]),
+				Spatial3D(_Root.Max[0][Lane], _Root.Max[1][Lane], _Root.Max[2][Lane])));
+	}
+	return _Bounds;
+}
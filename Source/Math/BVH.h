@@ -0,0 +1,366 @@
+#pragma once
+
+#include "aabb.h"
+#include "Sphere.h"
+#include "Intersects.h"
+#include "DataTypes/MArray.h"
+
+/*
+ *	Bounding volume hierarchy over a fixed set of boxes, for ray and overlap
+ *	queries against static geometry. It is built top down with binned SAH,
+ *	with large ranges split in parallel on the JobSystem, then collapsed
+ *	into nodes of four children whose bounds are tested together, one child
+ *	per Vector lane. Nodes are stored depth first, parents before children,
+ *	and each leaf's boxes are copied next to each other in leaf order.
+ *
+ *	Queries report boxes by their index in the array the tree was built
+ *	from. Refit keeps the shape of the tree and recomputes its bounds, for
+ *	content that moves or deforms a little; rebuild once it has moved a lot.
+ **/
+class BVH
+{
+public:
+	enum
+	{
+		/** Most boxes in a leaf. */
+		MAX_LEAF_SIZE = 8,
+		/** Bins per axis that split positions are picked from. */
+		NUM_BINS = 16,
+		/** Ranges of at least this many boxes are split as a job of their own. */
+		PARALLEL_THRESHOLD = 4096,
+		/** Depth after which ranges are split at the median, which bounds the depth of the tree. */
+		MAX_SAH_DEPTH = 32,
+		MAX_STACK_SIZE = 256
+	};
+
+	FORCEINLINE BVH() {}
+
+	void Build(const AABB* InBoxes, uint32 Count);
+	/** InBoxes must have as many boxes as the tree was built from, in the same order. */
+	void Refit(const AABB* InBoxes);
+	void Clear();
+
+	FORCEINLINE uint32 GetNumBoxes() const { return (uint32)Boxes.size(); }
+	FORCEINLINE uint32 GetNumNodes() const { return (uint32)Nodes.size(); }
+	/** Bounds of every box; inverted when there are none. */
+	AABB GetBounds() const;
+
+	/*
+	 *	Closest hit along the ray from Start in Direction, no further than
+	 *	MaxDistance; distances are in lengths of Direction. IntersectBox is
+	 *	called as bool(uint32 Index, float& Distance) for boxes the ray
+	 *	reaches before the best hit so far, roughly nearest first, and
+	 *	returns whether it hit what the box bounds, and at what distance.
+	 **/
+	template<typename Function>
+	bool Raycast(const Spatial3D& Start, const Spatial3D& Direction, float MaxDistance,
+			const Function& IntersectBox, uint32& OutIndex, float& OutDistance) const;
+
+	/** Calls InFunction(uint32 Index) for every box the ray from Start in Direction touches within MaxDistance. */
+	template<typename Function>
+	void QueryRay(const Spatial3D& Start, const Spatial3D& Direction, float MaxDistance, const Function& InFunction) const;
+
+	/** Calls InFunction(uint32 Index) for every box that AABB::Intersects Bounds. */
+	template<typename Function>
+	void QueryAABB(const AABB& Bounds, const Function& InFunction) const;
+
+	/** Calls InFunction(uint32 Index) for every box that Intersects::intersectSphereAABB Bounds. */
+	template<typename Function>
+	void QuerySphere(const Sphere& Bounds, const Function& InFunction) const;
+
+private:
+	enum : uint32
+	{
+		/** Set in a child that is a leaf: the rest is its first box << LEAF_COUNT_BITS | its box count - 1. */
+		LEAF_BIT = 0x80000000,
+		LEAF_COUNT_BITS = 4,
+		LEAF_COUNT_MASK = (1 << LEAF_COUNT_BITS) - 1
+	};
+
+	/** Up to four children; lane i of each bound is child i's. Unused lanes have inverted bounds. */
+	struct alignas(64) Node
+	{
+		float Min[3][4];
+		float Max[3][4];
+		uint32 Children[4];
+		uint32 NumChildren;
+	};
+
+	struct Ray
+	{
+		Vector Origin[3];
+		Vector InvDirection[3];
+		Vector OriginAll;
+		Vector InvDirectionAll;
+
+		Ray(const Spatial3D& Start, const Spatial3D& Direction);
+	};
+
+	struct StackEntry
+	{
+		uint32 Child;
+		float Near;
+	};
+
+	Array<Node> Nodes;
+	/** In leaf order. */
+	Array<AABB> Boxes;
+	/** Index in the built from array of each box, in leaf order. */
+	Array<uint32> Indices;
+
+	/** Lanes whose child the ray reaches between 0 and MaxDistance, with where it enters them. */
+	static FORCEINLINE uint32 IntersectChildren(const Node& InNode, const Ray& InRay, const Vector& MaxDistance, Vector& OutNear);
+	/** Where the ray enters Box if it does between 0 and MaxDistance, or a negative number. */
+	static FORCEINLINE float IntersectRayBox(const AABB& Box, const Ray& InRay, float MaxDistance);
+
+	static FORCEINLINE uint32 GetValidMask(const Node& InNode) { return (1u << InNode.NumChildren) - 1; }
+	static FORCEINLINE uint32 GetLeafFirst(uint32 Child) { return (Child & ~LEAF_BIT) >> LEAF_COUNT_BITS; }
+	static FORCEINLINE uint32 GetLeafCount(uint32 Child) { return (Child & LEAF_COUNT_MASK) + 1; }
+
+	/** Pushes the children in Mask, farthest first so the nearest is popped first. */
+	static FORCEINLINE void PushNearestLast(const Node& InNode, uint32 Mask, const Vector& Near, StackEntry* Stack, uint32& StackSize);
+
+	/** Calls InFunction(uint32 Child) for the children of every node that ChildMask(const Node&) accepts. */
+	template<typename MaskFunction, typename Function>
+	FORCEINLINE void Traverse(const MaskFunction& ChildMask, const Function& InFunction) const;
+
+	NULL_COPY_AND_ASSIGN(BVH);
+};
+
+FORCEINLINE uint32 BVH::IntersectChildren(const Node& InNode, const Ray& InRay, const Vector& MaxDistance, Vector& OutNear)
+{
+	Vector _Near = VectorConstants::ZERO;
+	Vector _Far = MaxDistance;
+	for (uint32 Axis = 0; Axis < 3; Axis++)
+	{
+		Vector _T1 = (Vector::LoadAligned(InNode.Min[Axis]) - InRay.Origin[Axis]) * InRay.InvDirection[Axis];
+		Vector _T2 = (Vector::LoadAligned(InNode.Max[Axis]) - InRay.Origin[Axis]) * InRay.InvDirection[Axis];
+		_Near = _Near.Max(_T1.Min(_T2));
+		_Far = _Far.Min(_T1.Max(_T2));
+	}
+	OutNear = _Near;
+	return (_Near <= _Far).GetSignMask() & GetValidMask(InNode);
+}
+
+FORCEINLINE float BVH::IntersectRayBox(const AABB& Box, const Ray& InRay, float MaxDistance)
+{
+	Vector _T1 = (Box.GetMinExtents().AsIntrinsic() - InRay.OriginAll) * InRay.InvDirectionAll;
+	Vector _T2 = (Box.GetMaxExtents().AsIntrinsic() - InRay.OriginAll) * InRay.InvDirectionAll;
+	Vector _Near = _T1.Min(_T2);
+	Vector _Far = _T1.Max(_T2);
+	float _NearMax = Math::Max(0.0f, Math::Max3(_Near[0], _Near[1], _Near[2]));
+	float _FarMin = Math::Min(MaxDistance, Math::Min3(_Far[0], _Far[1], _Far[2]));
+	return _NearMax <= _FarMin ? _NearMax : -1.0f;
+}
+
+FORCEINLINE void BVH::PushNearestLast(const Node& InNode, uint32 Mask, const Vector& Near, StackEntry* Stack, uint32& StackSize)
+{
+	float _Near[4];
+	Near.Store4f(_Near);
+
+	StackEntry _Hits[4];
+	uint32 _NumHits = 0;
+	for (uint32 Lane = 0; Lane < 4; Lane++)
+	{
+		if (Mask & (1 << Lane))
+		{
+			// Insertion sort, farthest first
+			uint32 _Position = _NumHits++;
+			while (_Position > 0 && _Hits[_Position - 1].Near < _Near[Lane])
+			{
+				_Hits[_Position] = _Hits[_Position - 1];
+				_Position--;
+			}
+			_Hits[_Position].Child = InNode.Children[Lane];
+			_Hits[_Position].Near = _Near[Lane];
+		}
+	}
+	assertCheck(StackSize + _NumHits <= MAX_STACK_SIZE);
+	for (uint32 Hit = 0; Hit < _NumHits; Hit++)
+	{
+		Stack[StackSize++] = _Hits[Hit];
+	}
+}
+
+template<typename Function>
+bool BVH::Raycast(const Spatial3D& Start, const Spatial3D& Direction, float MaxDistance,
+		const Function& IntersectBox, uint32& OutIndex, float& OutDistance) const
+{
+	if (Nodes.empty())
+	{
+		return false;
+	}
+
+	Ray _Ray(Start, Direction);
+	float _Best = MaxDistance;
+	bool _bHit = false;
+
+	StackEntry _Stack[MAX_STACK_SIZE];
+	uint32 _StackSize = 0;
+	_Stack[_StackSize++] = { 0, 0.0f };
+	while (_StackSize > 0)
+	{
+		StackEntry _Entry = _Stack[--_StackSize];
+		if (_Entry.Near > _Best)
+		{
+			continue;
+		}
+
+		if (_Entry.Child & LEAF_BIT)
+		{
+			uint32 _First = GetLeafFirst(_Entry.Child);
+			uint32 _End = _First + GetLeafCount(_Entry.Child);
+			for (uint32 Box = _First; Box < _End; Box++)
+			{
+				float _Distance;
+				if (IntersectRayBox(Boxes[Box], _Ray, _Best) >= 0.0f && IntersectBox(Indices[Box], _Distance) && _Distance <= _Best)
+				{
+					_Best = _Distance;
+					OutIndex = Indices[Box];
+					_bHit = true;
+				}
+			}
+			continue;
+		}
+
+		const Node& _Node = Nodes[_Entry.Child];
+		Vector _Near;
+		uint32 _Mask = IntersectChildren(_Node, _Ray, Vector::Load1f(_Best), _Near);
+		PushNearestLast(_Node, _Mask, _Near, _Stack, _StackSize);
+	}
+
+	if (_bHit)
+	{
+		OutDistance = _Best;
+	}
+	return _bHit;
+}
+
+template<typename MaskFunction, typename Function>
+FORCEINLINE void BVH::Traverse(const MaskFunction& ChildMask, const Function& InFunction) const
+{
+	if (Nodes.empty())
+	{
+		return;
+	}
+
+	uint32 _Stack[MAX_STACK_SIZE];
+	uint32 _StackSize = 0;
+	_Stack[_StackSize++] = 0;
+	while (_StackSize > 0)
+	{
+		const Node& _Node = Nodes[_Stack[--_StackSize]];
+		uint32 _Mask = ChildMask(_Node);
+		for (uint32 Lane = 0; Lane < 4; Lane++)
+		{
+			if ((_Mask & (1 << Lane)) == 0)
+			{
+				continue;
+			}
+			uint32 _Child = _Node.Children[Lane];
+			if (_Child & LEAF_BIT)
+			{
+				InFunction(_Child);
+			}
+			else
+			{
+				assertCheck(_StackSize < MAX_STACK_SIZE);
+				_Stack[_StackSize++] = _Child;
+			}
+		}
+	}
+}
+
+template<typename Function>
+void BVH::QueryRay(const Spatial3D& Start, const Spatial3D& Direction, float MaxDistance, const Function& InFunction) const
+{
+	Ray _Ray(Start, Direction);
+	Vector _MaxDistance = Vector::Load1f(MaxDistance);
+	Traverse(
+		[&](const Node& InNode)
+		{
+			Vector _Near;
+			return IntersectChildren(InNode, _Ray, _MaxDistance, _Near);
+		},
+		[&](uint32 Child)
+		{
+			uint32 _First = GetLeafFirst(Child);
+			uint32 _End = _First + GetLeafCount(Child);
+			for (uint32 Box = _First; Box < _End; Box++)
+			{
+				if (IntersectRayBox(Boxes[Box], _Ray, MaxDistance) >= 0.0f)
+				{
+					InFunction(Indices[Box]);
+				}
+			}
+		});
+}
+
+template<typename Function>
+void BVH::QueryAABB(const AABB& Bounds, const Function& InFunction) const
+{
+	Vector _Min[3];
+	Vector _Max[3];
+	for (uint32 Axis = 0; Axis < 3; Axis++)
+	{
+		_Min[Axis] = Vector::Load1f(Bounds.GetMinExtents()[Axis]);
+		_Max[Axis] = Vector::Load1f(Bounds.GetMaxExtents()[Axis]);
+	}
+	Traverse(
+		[&](const Node& InNode)
+		{
+			Vector _Overlap = (Vector::LoadAligned(InNode.Min[0]) <= _Max[0]) & (Vector::LoadAligned(InNode.Max[0]) >= _Min[0]);
+			for (uint32 Axis = 1; Axis < 3; Axis++)
+			{
+				_Overlap = _Overlap & (Vector::LoadAligned(InNode.Min[Axis]) <= _Max[Axis]) & (Vector::LoadAligned(InNode.Max[Axis]) >= _Min[Axis]);
+			}
+			return _Overlap.GetSignMask() & GetValidMask(InNode);
+		},
+		[&](uint32 Child)
+		{
+			uint32 _First = GetLeafFirst(Child);
+			uint32 _End = _First + GetLeafCount(Child);
+			for (uint32 Box = _First; Box < _End; Box++)
+			{
+				if (Boxes[Box].Intersects(Bounds))
+				{
+					InFunction(Indices[Box]);
+				}
+			}
+		});
+}
+
+template<typename Function>
+void BVH::QuerySphere(const Sphere& Bounds, const Function& InFunction) const
+{
+	Vector _Center[3];
+	for (uint32 Axis = 0; Axis < 3; Axis++)
+	{
+		_Center[Axis] = Vector::Load1f(Bounds.getCenter()[Axis]);
+	}
+	Vector _RadiusSquared = Vector::Load1f(Bounds.getRadius() * Bounds.getRadius());
+	Traverse(
+		[&](const Node& InNode)
+		{
+			Vector _DistanceSquared = VectorConstants::ZERO;
+			for (uint32 Axis = 0; Axis < 3; Axis++)
+			{
+				Vector _Outside = (Vector::LoadAligned(InNode.Min[Axis]) - _Center[Axis]).Max(VectorConstants::ZERO)
+						+ (_Center[Axis] - Vector::LoadAligned(InNode.Max[Axis])).Max(VectorConstants::ZERO);
+				_DistanceSquared = _Outside.Mad(_Outside, _DistanceSquared);
+			}
+			return (_DistanceSquared <= _RadiusSquared).GetSignMask() & GetValidMask(InNode);
+		},
+		[&](uint32 Child)
+		{
+			uint32 _First = GetLeafFirst(Child);
+			uint32 _End = _First + GetLeafCount(Child);
+			for (uint32 Box = _First; Box < _End; Box++)
+			{
+				if (Intersects::intersectSphereAABB(Bounds, Boxes[Box]))
+				{
+					InFunction(Indices[Box]);
+				}
+			}
+		});
+}
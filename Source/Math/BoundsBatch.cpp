@@ -0,0 +1,295 @@
+#include "BoundsBatch.h"
+
+namespace
+{
+	enum
+	{
+		/** Volumes per Vector. */
+		WIDTH = 4
+	};
+
+	/*
+	 *	The top three rows of up to four matrices, one element per Vector:
+	 *	lane n of Rows[i][j] is element j of row i of matrix n.
+	 **/
+	struct MatrixLanes
+	{
+		Vector Rows[3][4];
+
+		/** Every lane holds Transform. */
+		FORCEINLINE void Splat(const Matrix& Transform)
+		{
+			for (uint32 Row = 0; Row < 3; Row++)
+			{
+				float _Elements[4];
+				Transform[Row].Store4f(_Elements);
+				for (uint32 Column = 0; Column < 4; Column++)
+				{
+					Rows[Row][Column] = Vector::Load1f(_Elements[Column]);
+				}
+			}
+		}
+
+		/** Lane n holds Transforms[n]. */
+		FORCEINLINE void Gather(const Matrix* Transforms)
+		{
+			for (uint32 Row = 0; Row < 3; Row++)
+			{
+				for (uint32 Lane = 0; Lane < WIDTH; Lane++)
+				{
+					Rows[Row][Lane] = Transforms[Lane][Row];
+				}
+				Vector::Transpose4(Rows[Row][0], Rows[Row][1], Rows[Row][2], Rows[Row][3]);
+			}
+		}
+
+		/** Halves the 3x3 part, leaving the translation as it is. */
+		FORCEINLINE void Halve()
+		{
+			for (uint32 Row = 0; Row < 3; Row++)
+			{
+				for (uint32 Column = 0; Column < 3; Column++)
+				{
+					Rows[Row][Column] = Rows[Row][Column] * VectorConstants::HALF;
+				}
+			}
+		}
+
+		FORCEINLINE Vector TransformPoint(uint32 Row, const Vector* Point) const
+		{
+			return Rows[Row][0].Mad(Point[0], Rows[Row][1].Mad(Point[1], Rows[Row][2].Mad(Point[2], Rows[Row][3])));
+		}
+	};
+
+	/** The absolute values of a MatrixLanes' 3x3 part, which is all an extents vector (w = 0) sees. */
+	struct AbsMatrixLanes
+	{
+		Vector Rows[3][3];
+
+		FORCEINLINE explicit AbsMatrixLanes(const MatrixLanes& Lanes)
+		{
+			for (uint32 Row = 0; Row < 3; Row++)
+			{
+				for (uint32 Column = 0; Column < 3; Column++)
+				{
+					Rows[Row][Column] = Lanes.Rows[Row][Column].Abs();
+				}
+			}
+		}
+
+		FORCEINLINE Vector TransformDirection(uint32 Row, const Vector* Direction) const
+		{
+			return Rows[Row][0].Mad(Direction[0], Rows[Row][1].Mad(Direction[1], Rows[Row][2] * Direction[2]));
+		}
+	};
+
+	/** Sphere::transform's radius scale, the length of the longest of the top three rows, per lane. */
+	FORCEINLINE Vector getRadiusScale(const MatrixLanes& Lanes)
+	{
+		Vector _MaxLengthSquared;
+		for (uint32 Row = 0; Row < 3; Row++)
+		{
+			const Vector* _Row = Lanes.Rows[Row];
+			Vector _LengthSquared = _Row[0].Mad(_Row[0], _Row[1].Mad(_Row[1], _Row[2] * _Row[2]));
+			_MaxLengthSquared = Row == 0 ? _LengthSquared : _MaxLengthSquared.Max(_LengthSquared);
+		}
+		return _MaxLengthSquared.Sqrt();
+	}
+
+	/** Lanes must have been halved, which turns min + max into the center and max - min into the extents. */
+	FORCEINLINE void transformAABBs4(const MatrixLanes& Lanes, const AbsMatrixLanes& AbsLanes,
+			const AABBSoA& Local, const AABBSoA& World, uint32 Index)
+	{
+		Vector _Sum[3];
+		Vector _Difference[3];
+		for (uint32 Axis = 0; Axis < 3; Axis++)
+		{
+			Vector _Min = Vector::Load4f(Local.Min[Axis] + Index);
+			Vector _Max = Vector::Load4f(Local.Max[Axis] + Index);
+			_Sum[Axis] = _Max + _Min;
+			// Made positive, as AABB::Transform does for boxes whose min is past their max
+			_Difference[Axis] = (_Max - _Min).Abs();
+		}
+		for (uint32 Axis = 0; Axis < 3; Axis++)
+		{
+			Vector _WorldCenter = Lanes.TransformPoint(Axis, _Sum);
+			Vector _WorldExtents = AbsLanes.TransformDirection(Axis, _Difference);
+			(_WorldCenter - _WorldExtents).Store4f(World.Min[Axis] + Index);
+			(_WorldCenter + _WorldExtents).Store4f(World.Max[Axis] + Index);
+		}
+	}
+
+	FORCEINLINE void transformSpheres4(const MatrixLanes& Lanes, const Vector& RadiusScale,
+			const SphereSoA& Local, const SphereSoA& World, uint32 Index)
+	{
+		Vector _Center[3];
+		for (uint32 Axis = 0; Axis < 3; Axis++)
+		{
+			_Center[Axis] = Vector::Load4f(Local.Center[Axis] + Index);
+		}
+		Vector _Radius = Vector::Load4f(Local.Radius + Index);
+		for (uint32 Axis = 0; Axis < 3; Axis++)
+		{
+			Lanes.TransformPoint(Axis, _Center).Store4f(World.Center[Axis] + Index);
+		}
+		(_Radius * RadiusScale).Store4f(World.Radius + Index);
+	}
+
+	/*
+	 *	Room for the last Count % WIDTH volumes, so the tail runs through the
+	 *	same kernel instead of reading or writing past the caller's arrays.
+	 **/
+	struct AABBTail
+	{
+		float Min[3][WIDTH];
+		float Max[3][WIDTH];
+		AABBSoA View;
+
+		FORCEINLINE AABBTail(const AABBSoA& Source, uint32 Index, uint32 Count)
+		{
+			Memory::memzero(this, sizeof(*this));
+			for (uint32 Axis = 0; Axis < 3; Axis++)
+			{
+				View.Min[Axis] = Min[Axis];
+				View.Max[Axis] = Max[Axis];
+			}
+			for (uint32 Lane = 0; Lane < Count; Lane++)
+			{
+				View.Set(Lane, Source.Get(Index + Lane));
+			}
+		}
+
+		FORCEINLINE void CopyTo(const AABBSoA& Destination, uint32 Index, uint32 Count) const
+		{
+			for (uint32 Lane = 0; Lane < Count; Lane++)
+			{
+				Destination.Set(Index + Lane, View.Get(Lane));
+			}
+		}
+	};
+
+	struct SphereTail
+	{
+		float Center[3][WIDTH];
+		float Radius[WIDTH];
+		SphereSoA View;
+
+		FORCEINLINE SphereTail(const SphereSoA& Source, uint32 Index, uint32 Count)
+		{
+			Memory::memzero(this, sizeof(*this));
+			for (uint32 Axis = 0; Axis < 3; Axis++)
+			{
+				View.Center[Axis] = Center[Axis];
+			}
+			View.Radius = Radius;
+			for (uint32 Lane = 0; Lane < Count; Lane++)
+			{
+				View.Set(Lane, Source.Get(Index + Lane));
+			}
+		}
+
+		FORCEINLINE void CopyTo(const SphereSoA& Destination, uint32 Index, uint32 Count) const
+		{
+			for (uint32 Lane = 0; Lane < Count; Lane++)
+			{
+				Destination.Set(Index + Lane, View.Get(Lane));
+			}
+		}
+	};
+
+	/** The last Count % WIDTH matrices, with the unused lanes left as identity. */
+	struct MatrixTail
+	{
+		Matrix Transforms[WIDTH];
+
+		FORCEINLINE MatrixTail(const Matrix* Source, uint32 Count)
+		{
+			for (uint32 Lane = 0; Lane < WIDTH; Lane++)
+			{
+				Transforms[Lane] = Lane < Count ? Source[Lane] : Matrix::Identity();
+			}
+		}
+	};
+}
+
+namespace BoundsBatch
+{
+	void TransformAABBs(const Matrix& Transform, const AABBSoA& Local, const AABBSoA& World, uint32 Count)
+	{
+		MatrixLanes _Lanes;
+		_Lanes.Splat(Transform);
+		_Lanes.Halve();
+		AbsMatrixLanes _AbsLanes(_Lanes);
+
+		uint32 _BlockEnd = Count & ~(WIDTH - 1);
+		for (uint32 Index = 0; Index < _BlockEnd; Index += WIDTH)
+		{
+			transformAABBs4(_Lanes, _AbsLanes, Local, World, Index);
+		}
+		if (_BlockEnd < Count)
+		{
+			AABBTail _Tail(Local, _BlockEnd, Count - _BlockEnd);
+			transformAABBs4(_Lanes, _AbsLanes, _Tail.View, _Tail.View, 0);
+			_Tail.CopyTo(World, _BlockEnd, Count - _BlockEnd);
+		}
+	}
+
+	void TransformAABBs(const Matrix* Transforms, const AABBSoA& Local, const AABBSoA& World, uint32 Count)
+	{
+		MatrixLanes _Lanes;
+		uint32 _BlockEnd = Count & ~(WIDTH - 1);
+		for (uint32 Index = 0; Index < _BlockEnd; Index += WIDTH)
+		{
+			_Lanes.Gather(Transforms + Index);
+			_Lanes.Halve();
+			transformAABBs4(_Lanes, AbsMatrixLanes(_Lanes), Local, World, Index);
+		}
+		if (_BlockEnd < Count)
+		{
+			MatrixTail _Transforms(Transforms + _BlockEnd, Count - _BlockEnd);
+			AABBTail _Tail(Local, _BlockEnd, Count - _BlockEnd);
+			_Lanes.Gather(_Transforms.Transforms);
+			_Lanes.Halve();
+			transformAABBs4(_Lanes, AbsMatrixLanes(_Lanes), _Tail.View, _Tail.View, 0);
+			_Tail.CopyTo(World, _BlockEnd, Count - _BlockEnd);
+		}
+	}
+
+	void TransformSpheres(const Matrix& Transform, const SphereSoA& Local, const SphereSoA& World, uint32 Count)
+	{
+		MatrixLanes _Lanes;
+		_Lanes.Splat(Transform);
+		Vector _RadiusScale = getRadiusScale(_Lanes);
+
+		uint32 _BlockEnd = Count & ~(WIDTH - 1);
+		for (uint32 Index = 0; Index < _BlockEnd; Index += WIDTH)
+		{
+			transformSpheres4(_Lanes, _RadiusScale, Local, World, Index);
+		}
+		if (_BlockEnd < Count)
+		{
+			SphereTail _Tail(Local, _BlockEnd, Count - _BlockEnd);
+			transformSpheres4(_Lanes, _RadiusScale, _Tail.View, _Tail.View, 0);
+			_Tail.CopyTo(World, _BlockEnd, Count - _BlockEnd);
+		}
+	}
+
+	void TransformSpheres(const Matrix* Transforms, const SphereSoA& Local, const SphereSoA& World, uint32 Count)
+	{
+		MatrixLanes _Lanes;
+		uint32 _BlockEnd = Count & ~(WIDTH - 1);
+		for (uint32 Index = 0; Index < _BlockEnd; Index += WIDTH)
+		{
+			_Lanes.Gather(Transforms + Index);
+			transformSpheres4(_Lanes, getRadiusScale(_Lanes), Local, World, Index);
+		}
+		if (_BlockEnd < Count)
+		{
+			MatrixTail _Transforms(Transforms + _BlockEnd, Count - _BlockEnd);
+			SphereTail _Tail(Local, _BlockEnd, Count - _BlockEnd);
+			_Lanes.Gather(_Transforms.Transforms);
+			transformSpheres4(_Lanes, getRadiusScale(_Lanes), _Tail.View, _Tail.View, 0);
+			_Tail.CopyTo(World, _BlockEnd, Count - _BlockEnd);
+		}
+	}
+}
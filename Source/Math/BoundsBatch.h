@@ -0,0 +1,76 @@
+#pragma once
+
+#include "aabb.h"
+#include "Sphere.h"
+
+/*
+ *	Structure of arrays view over a set of AABBs: box n spans from
+ *	(Min[0][n], Min[1][n], Min[2][n]) to (Max[0][n], Max[1][n], Max[2][n]).
+ *	The view does not own the arrays.
+ **/
+struct AABBSoA
+{
+	float* Min[3];
+	float* Max[3];
+
+	FORCEINLINE AABB Get(uint32 Index) const
+	{
+		return AABB(Spatial3D(Cartesian3D(Min[0][Index], Min[1][Index], Min[2][Index])),
+				Spatial3D(Cartesian3D(Max[0][Index], Max[1][Index], Max[2][Index])));
+	}
+
+	FORCEINLINE void Set(uint32 Index, const AABB& Box) const
+	{
+		Spatial3D _Min = Box.GetMinExtents();
+		Spatial3D _Max = Box.GetMaxExtents();
+		for (uint32 Axis = 0; Axis < 3; Axis++)
+		{
+			Min[Axis][Index] = _Min[Axis];
+			Max[Axis][Index] = _Max[Axis];
+		}
+	}
+};
+
+/** Structure of arrays view over a set of spheres, as AABBSoA. */
+struct SphereSoA
+{
+	float* Center[3];
+	float* Radius;
+
+	FORCEINLINE Sphere Get(uint32 Index) const
+	{
+		return Sphere(Spatial3D(Cartesian3D(Center[0][Index], Center[1][Index], Center[2][Index])), Radius[Index]);
+	}
+
+	FORCEINLINE void Set(uint32 Index, const Sphere& Bounds) const
+	{
+		Spatial3D _Center = Bounds.getCenter();
+		for (uint32 Axis = 0; Axis < 3; Axis++)
+		{
+			Center[Axis][Index] = _Center[Axis];
+		}
+		Radius[Index] = Bounds.getRadius();
+	}
+};
+
+/*
+ *	Local to world bounds for many volumes at once, four per Vector. They
+ *	give the same results as AABB::Transform and Sphere::transform, but the
+ *	per matrix work (absolute values, axis lengths) is done once per matrix
+ *	instead of once per volume, and the volumes stream through in SoA form.
+ *
+ *	The arrays need no alignment or padding. World may be the same view as
+ *	Local, to update bounds in place.
+ **/
+namespace BoundsBatch
+{
+	/** Transforms Count boxes by the same matrix. */
+	void TransformAABBs(const Matrix& Transform, const AABBSoA& Local, const AABBSoA& World, uint32 Count);
+	/** Transforms box n by Transforms[n]. */
+	void TransformAABBs(const Matrix* Transforms, const AABBSoA& Local, const AABBSoA& World, uint32 Count);
+
+	/** Transforms Count spheres by the same matrix. */
+	void TransformSpheres(const Matrix& Transform, const SphereSoA& Local, const SphereSoA& World, uint32 Count);
+	/** Transforms sphere n by Transforms[n]. */
+	void TransformSpheres(const Matrix* Transforms, const SphereSoA& Local, const SphereSoA& World, uint32 Count);
+}
@@ -0,0 +1,358 @@
+#include "SpatialHashGrid.h"
+#include "EngineCore/JobSystem.h"
+
+namespace
+{
+	/** A job's share of the points, and of the buckets when summing histograms. */
+	struct BuildChunk
+	{
+		uint32 Index;
+		uint32 Begin;
+		uint32 End;
+		uint32 BucketBegin;
+		uint32 BucketEnd;
+		/** Points in the chunk's buckets, then how many points come before them. */
+		uint32 NumBucketPoints;
+		int32 MinCell[3];
+		int32 MaxCell[3];
+	};
+
+	struct PairChunk
+	{
+		uint32 Begin;
+		uint32 End;
+		Array<SpatialHashGrid::IndexPair> Pairs;
+	};
+
+	FORCEINLINE uint32 splitRange(uint32 Count, uint32 Part, uint32 NumParts)
+	{
+		return (uint32)((uint64)Count * Part / NumParts);
+	}
+}
+
+SpatialHashGrid::SpatialHashGrid(float CellSize)
+	: CellSize(CellSize)
+	, InvCellSize(1.0f / CellSize)
+{
+	assertCheck(CellSize > 0.0f);
+	Clear();
+}
+
+void SpatialHashGrid::Clear()
+{
+	BucketMask = 0;
+	for (uint32 Axis = 0; Axis < 3; Axis++)
+	{
+		MinCell.Coordinates[Axis] = 0;
+		MaxCell.Coordinates[Axis] = -1;
+		Positions[Axis].clear();
+	}
+	Indices.clear();
+	CellKeys.clear();
+	BucketStarts.clear();
+	BucketStarts.resize(2, 0);
+}
+
+void SpatialHashGrid::Build(const Spatial3D* InPositions, uint32 Count)
+{
+	if (Count == 0)
+	{
+		Clear();
+		return;
+	}
+
+	// About one bucket per point keeps buckets short without many empty ones
+	uint32 _NumBuckets = Math::RoundUpToNextPowerOf2(Count);
+	BucketMask = _NumBuckets - 1;
+
+	// One histogram per job, so no more jobs than threads
+	uint32 _NumChunks = Math::Min((Count + PARALLEL_BATCH_SIZE - 1) / PARALLEL_BATCH_SIZE, JobSystem::GetNumThreads());
+	InlineArray<BuildChunk, JobSystem::MAX_THREADS> _Chunks;
+	_Chunks.resize(_NumChunks);
+	for (uint32 Chunk = 0; Chunk < _NumChunks; Chunk++)
+	{
+		_Chunks[Chunk].Index = Chunk;
+		_Chunks[Chunk].Begin = splitRange(Count, Chunk, _NumChunks);
+		_Chunks[Chunk].End = splitRange(Count, Chunk + 1, _NumChunks);
+		_Chunks[Chunk].BucketBegin = splitRange(_NumBuckets, Chunk, _NumChunks);
+		_Chunks[Chunk].BucketEnd = splitRange(_NumBuckets, Chunk + 1, _NumChunks);
+	}
+
+	PointBuckets.resize(Count);
+	Histograms.resize(_NumChunks * _NumBuckets);
+	BucketStarts.resize(_NumBuckets + 1);
+	for (uint32 Axis = 0; Axis < 3; Axis++)
+	{
+		Positions[Axis].resize(Count + WIDTH - 1);
+	}
+	Indices.resize(Count);
+	CellKeys.resize(Count);
+
+	// Count each chunk's points per bucket
+	JobSystem::ParallelFor(_Chunks.data(), _NumChunks, 1, [&](BuildChunk* Chunks, uint32 NumChunks)
+	{
+		for (BuildChunk* _Chunk = Chunks; _Chunk < Chunks + NumChunks; _Chunk++)
+		{
+			uint32* _Histogram = Histograms.data() + _Chunk->Index * _NumBuckets;
+			Memory::memzero(_Histogram, _NumBuckets * sizeof(uint32));
+
+			Cell _First = GetCell(InPositions[_Chunk->Begin]);
+			for (uint32 Axis = 0; Axis < 3; Axis++)
+			{
+				_Chunk->MinCell[Axis] = _First.Coordinates[Axis];
+				_Chunk->MaxCell[Axis] = _First.Coordinates[Axis];
+			}
+			for (uint32 Point = _Chunk->Begin; Point < _Chunk->End; Point++)
+			{
+				Cell _Cell = GetCell(InPositions[Point]);
+				uint32 _Bucket = GetBucket(_Cell);
+				PointBuckets[Point] = _Bucket;
+				_Histogram[_Bucket]++;
+				for (uint32 Axis = 0; Axis < 3; Axis++)
+				{
+					_Chunk->MinCell[Axis] = Math::Min(_Chunk->MinCell[Axis], _Cell.Coordinates[Axis]);
+					_Chunk->MaxCell[Axis] = Math::Max(_Chunk->MaxCell[Axis], _Cell.Coordinates[Axis]);
+				}
+			}
+		}
+	});
+
+	// Scan the histograms in bucket order, then chunk order within a bucket,
+	// so that each bucket's points end up in the order they were given in.
+	// Every job sums a range of buckets, the few sums are scanned here, and
+	// the jobs then scan their range from where its sum says it starts.
+	JobSystem::ParallelFor(_Chunks.data(), _NumChunks, 1, [&](BuildChunk* Chunks, uint32 NumChunks)
+	{
+		for (BuildChunk* _Chunk = Chunks; _Chunk < Chunks + NumChunks; _Chunk++)
+		{
+			uint32 _Sum = 0;
+			for (uint32 Histogram = 0; Histogram < _NumChunks; Histogram++)
+			{
+				const uint32* _Counts = Histograms.data() + Histogram * _NumBuckets;
+				for (uint32 Bucket = _Chunk->BucketBegin; Bucket < _Chunk->BucketEnd; Bucket++)
+				{
+					_Sum += _Counts[Bucket];
+				}
+			}
+			_Chunk->NumBucketPoints = _Sum;
+		}
+	});
+
+	uint32 _Start = 0;
+	MinCell = GetCell(InPositions[0]);
+	MaxCell = MinCell;
+	for (uint32 Chunk = 0; Chunk < _NumChunks; Chunk++)
+	{
+		uint32 _NumPoints = _Chunks[Chunk].NumBucketPoints;
+		_Chunks[Chunk].NumBucketPoints = _Start;
+		_Start += _NumPoints;
+		for (uint32 Axis = 0; Axis < 3; Axis++)
+		{
+			MinCell.Coordinates[Axis] = Math::Min(MinCell.Coordinates[Axis], _Chunks[Chunk].MinCell[Axis]);
+			MaxCell.Coordinates[Axis] = Math::Max(MaxCell.Coordinates[Axis], _Chunks[Chunk].MaxCell[Axis]);
+		}
+	}
+
+	JobSystem::ParallelFor(_Chunks.data(), _NumChunks, 1, [&](BuildChunk* Chunks, uint32 NumChunks)
+	{
+		for (BuildChunk* _Chunk = Chunks; _Chunk < Chunks + NumChunks; _Chunk++)
+		{
+			uint32 _Slot = _Chunk->NumBucketPoints;
+			for (uint32 Bucket = _Chunk->BucketBegin; Bucket < _Chunk->BucketEnd; Bucket++)
+			{
+				BucketStarts[Bucket] = _Slot;
+				for (uint32 Histogram = 0; Histogram < _NumChunks; Histogram++)
+				{
+					uint32& _Count = Histograms[Histogram * _NumBuckets + Bucket];
+					uint32 _NumPoints = _Count;
+					_Count = _Slot;
+					_Slot += _NumPoints;
+				}
+			}
+		}
+	});
+	BucketStarts[_NumBuckets] = Count;
+
+	// Each chunk now has its own slots in every bucket to write its points to
+	JobSystem::ParallelFor(_Chunks.data(), _NumChunks, 1, [&](BuildChunk* Chunks, uint32 NumChunks)
+	{
+		for (BuildChunk* _Chunk = Chunks; _Chunk < Chunks + NumChunks; _Chunk++)
+		{
+			uint32* _Slots = Histograms.data() + _Chunk->Index * _NumBuckets;
+			for (uint32 Point = _Chunk->Begin; Point < _Chunk->End; Point++)
+			{
+				uint32 _Slot = _Slots[PointBuckets[Point]]++;
+				const Spatial3D& _Position = InPositions[Point];
+				Positions[0][_Slot] = _Position.X();
+				Positions[1][_Slot] = _Position.Y();
+				Positions[2][_Slot] = _Position.Z();
+				Indices[_Slot] = Point;
+				CellKeys[_Slot] = GetCellKey(GetCell(_Position));
+			}
+		}
+	});
+}
+
+void SpatialHashGrid::QueryPairs(float Radius, Array<IndexPair>& OutPairs) const
+{
+	uint32 _NumPoints = GetNumPoints();
+	if (_NumPoints == 0)
+	{
+		return;
+	}
+
+	const Vector _RadiusSquared = Vector::Load1f(Radius * Radius);
+
+	uint32 _NumChunks = (_NumPoints + PARALLEL_BATCH_SIZE - 1) / PARALLEL_BATCH_SIZE;
+	Array<PairChunk> _Chunks(_NumChunks);
+	for (uint32 Chunk = 0; Chunk < _NumChunks; Chunk++)
+	{
+		_Chunks[Chunk].Begin = splitRange(_NumPoints, Chunk, _NumChunks);
+		_Chunks[Chunk].End = splitRange(_NumPoints, Chunk + 1, _NumChunks);
+	}
+
+	// Each pair is found from the point that comes first in bucket order,
+	// which only looks at the points after it in the same bucket.
+	JobSystem::ParallelFor(_Chunks, 1, [&](PairChunk* Chunks, uint32 NumChunks)
+	{
+		for (PairChunk* _Chunk = Chunks; _Chunk < Chunks + NumChunks; _Chunk++)
+		{
+			for (uint32 Slot = _Chunk->Begin; Slot < _Chunk->End; Slot++)
+			{
+				const float _X = Positions[0][Slot];
+				const float _Y = Positions[1][Slot];
+				const float _Z = Positions[2][Slot];
+				const Vector _Center[3] = { Vector::Load1f(_X), Vector::Load1f(_Y), Vector::Load1f(_Z) };
+				ForEachCell(GetCell(_X - Radius, _Y - Radius, _Z - Radius), GetCell(_X + Radius, _Y + Radius, _Z + Radius), [&](const Cell& InCell)
+				{
+					uint32 _Bucket = GetBucket(InCell);
+					ScanCell(Math::Max(BucketStarts[_Bucket], Slot + 1), BucketStarts[_Bucket + 1], GetCellKey(InCell), _Center, _RadiusSquared, [&](uint32 Other, float)
+					{
+						uint32 _IndexA = Indices[Slot];
+						uint32 _IndexB = Indices[Other];
+						_Chunk->Pairs.push_back(_IndexA < _IndexB ? IndexPair{ _IndexA, _IndexB } : IndexPair{ _IndexB, _IndexA });
+					});
+				});
+			}
+		}
+	});
+
+	uint32 _NumPairs = 0;
+	for (const PairChunk& _Chunk : _Chunks)
+	{
+		_NumPairs += (uint32)_Chunk.Pairs.size();
+	}
+	OutPairs.reserve(OutPairs.size() + _NumPairs);
+	for (const PairChunk& _Chunk : _Chunks)
+	{
+		for (const IndexPair& _Pair : _Chunk.Pairs)
+		{
+			OutPairs.push_back(_Pair);
+		}
+	}
+}
+
+uint32 SpatialHashGrid::FindNearest(const Spatial3D& Center, uint32 K, float MaxRadius, uint32* OutIndices, float* OutDistancesSquared) const
+{
+	if (K == 0 || Indices.empty())
+	{
+		return 0;
+	}
+
+	const Vector _Center[3] = { Vector::Load1f(Center.X()), Vector::Load1f(Center.Y()), Vector::Load1f(Center.Z()) };
+	const Cell _CenterCell = GetCell(Center);
+
+	// Cells in ring n, n cells away from Center's along some axis, are no
+	// closer than n - 1 cells plus the distance to the nearest face of its cell.
+	float _Inset = CellSize;
+	int32 _LastRing = 0;
+	for (uint32 Axis = 0; Axis < 3; Axis++)
+	{
+		float _Offset = Center.Inner()[Axis] - _CenterCell.Coordinates[Axis] * CellSize;
+		_Inset = Math::Min(_Inset, Math::Min(_Offset, CellSize - _Offset));
+		_LastRing = Math::Max(_LastRing, Math::Max(_CenterCell.Coordinates[Axis] - MinCell.Coordinates[Axis], MaxCell.Coordinates[Axis] - _CenterCell.Coordinates[Axis]));
+	}
+	_Inset = Math::Max(_Inset, 0.0f);
+
+	uint32 _NumFound = 0;
+	float _BoundSquared = MaxRadius * MaxRadius;
+	auto _Insert = [&](uint32 Slot, float DistanceSquared)
+	{
+		if (DistanceSquared >= _BoundSquared)
+		{
+			return;
+		}
+		uint32 _Position = _NumFound < K ? _NumFound++ : K - 1;
+		for (; _Position > 0 && OutDistancesSquared[_Position - 1] > DistanceSquared; _Position--)
+		{
+			OutIndices[_Position] = OutIndices[_Position - 1];
+			OutDistancesSquared[_Position] = OutDistancesSquared[_Position - 1];
+		}
+		OutIndices[_Position] = Indices[Slot];
+		OutDistancesSquared[_Position] = DistanceSquared;
+		if (_NumFound == K)
+		{
+			_BoundSquared = OutDistancesSquared[K - 1];
+		}
+	};
+
+	for (int32 Ring = 0; Ring <= _LastRing; Ring++)
+	{
+		if (Ring > 0)
+		{
+			float _RingDistance = (Ring - 1) * CellSize + _Inset;
+			if (_RingDistance * _RingDistance >= _BoundSquared)
+			{
+				break;
+			}
+		}
+
+		// The ring's offsets from Center's cell, clamped to the cells that have points
+		int32 _Low[3];
+		int32 _High[3];
+		bool _bEmpty = false;
+		for (uint32 Axis = 0; Axis < 3; Axis++)
+		{
+			_Low[Axis] = Math::Max(-Ring, MinCell.Coordinates[Axis] - _CenterCell.Coordinates[Axis]);
+			_High[Axis] = Math::Min(Ring, MaxCell.Coordinates[Axis] - _CenterCell.Coordinates[Axis]);
+			_bEmpty |= _Low[Axis] > _High[Axis];
+		}
+		if (_bEmpty)
+		{
+			continue;
+		}
+
+		auto _ScanOffset = [&](int32 X, int32 Y, int32 Z)
+		{
+			Cell _Cell = { { _CenterCell.Coordinates[0] + X, _CenterCell.Coordinates[1] + Y, _CenterCell.Coordinates[2] + Z } };
+			uint32 _Bucket = GetBucket(_Cell);
+			ScanCell(BucketStarts[_Bucket], BucketStarts[_Bucket + 1], GetCellKey(_Cell), _Center, Vector::Load1f(_BoundSquared), _Insert);
+		};
+		for (int32 Z = _Low[2]; Z <= _High[2]; Z++)
+		{
+			for (int32 Y = _Low[1]; Y <= _High[1]; Y++)
+			{
+				if (Math::Abs(Z) == Ring || Math::Abs(Y) == Ring)
+				{
+					for (int32 X = _Low[0]; X <= _High[0]; X++)
+					{
+						_ScanOffset(X, Y, Z);
+					}
+				}
+				else
+				{
+					// Inside the ring's faces in Y and Z, only its X faces are in it
+					if (_Low[0] == -Ring)
+					{
+						_ScanOffset(-Ring, Y, Z);
+					}
+					if (_High[0] == Ring)
+					{
+						_ScanOffset(Ring, Y, Z);
+					}
+				}
+			}
+		}
+	}
+	return _NumFound;
+}
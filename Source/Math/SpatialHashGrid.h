@@ -0,0 +1,212 @@
+#pragma once
+
+#include "Cartesian.h"
+#include "DataTypes/MArray.h"
+
+/*
+ *	Uniform grid over points, for neighbor searches among many objects of
+ *	about the same size: crowds, particles, perception. Cells are CellSize
+ *	on a side and hashed into about as many buckets as there are points,
+ *	so the grid covers unbounded space in memory proportional to the points.
+ *
+ *	Build counting sorts the points by bucket, in parallel on the JobSystem,
+ *	into one position array per axis, so that each bucket's points are
+ *	contiguous and are distance tested four at a time. It is cheap enough
+ *	to rebuild every frame, and keeps its arrays between builds.
+ *
+ *	Queries report points by their index in the array the grid was built
+ *	from. Points are within Radius of each other when their distance is less
+ *	than Radius, so spheres of radius R overlap, as Sphere::intersects without
+ *	its error margin, when their centers are within 2 * R. Cells are only told
+ *	apart within 2^20 cells of the origin.
+ **/
+class SpatialHashGrid
+{
+public:
+	enum
+	{
+		/** Fewest points a job sorts or finds pairs for. */
+		PARALLEL_BATCH_SIZE = 4096
+	};
+
+	struct IndexPair
+	{
+		/** The smaller of the two indices. */
+		uint32 IndexA;
+		uint32 IndexB;
+	};
+
+	explicit SpatialHashGrid(float CellSize);
+
+	void Build(const Spatial3D* InPositions, uint32 Count);
+	void Clear();
+
+	FORCEINLINE float GetCellSize() const { return CellSize; }
+	FORCEINLINE uint32 GetNumPoints() const { return (uint32)Indices.size(); }
+
+	/** Calls InFunction(uint32 Index, float DistanceSquared) for every point within Radius of Center. */
+	template<typename Function>
+	void QueryRadius(const Spatial3D& Center, float Radius, const Function& InFunction) const;
+
+	/** Appends every pair of points within Radius of each other to OutPairs, each pair once. */
+	void QueryPairs(float Radius, Array<IndexPair>& OutPairs) const;
+
+	/*
+	 *	Finds the K points nearest to Center and within MaxRadius of it, and
+	 *	returns how many there were. Their indices and squared distances go to
+	 *	OutIndices and OutDistancesSquared, nearest first; both need room for K.
+	 *	The search widens a ring of cells at a time until the K found so far
+	 *	are closer than the next ring, so a MaxRadius of a few cells keeps it
+	 *	short where points are sparse.
+	 **/
+	uint32 FindNearest(const Spatial3D& Center, uint32 K, float MaxRadius, uint32* OutIndices, float* OutDistancesSquared) const;
+
+private:
+	enum
+	{
+		/** Points per Vector. */
+		WIDTH = 4,
+		CELL_KEY_BITS = 21
+	};
+
+	struct Cell
+	{
+		int32 Coordinates[3];
+	};
+
+	float CellSize;
+	float InvCellSize;
+	uint32 BucketMask;
+	/** Cells that every point is in, for bounding searches. */
+	Cell MinCell;
+	Cell MaxCell;
+
+	/** Per axis, in bucket order, with WIDTH - 1 points of padding so that the last ones load as a whole Vector. */
+	Array<float> Positions[3];
+	/** Index in the built from array of each point, in bucket order. */
+	Array<uint32> Indices;
+	/** Each point's GetCellKey, in bucket order, to tell apart the cells sharing a bucket. */
+	Array<uint64> CellKeys;
+	/** Where each bucket's points start, and one past the last bucket's end. */
+	Array<uint32> BucketStarts;
+
+	/** Each point's bucket, in built from order, while building. */
+	Array<uint32> PointBuckets;
+	/** A bucket histogram per job while building, which then turns into where each job writes its points. */
+	Array<uint32> Histograms;
+
+	FORCEINLINE Cell GetCell(float X, float Y, float Z) const;
+	FORCEINLINE Cell GetCell(const Spatial3D& Position) const { return GetCell(Position.X(), Position.Y(), Position.Z()); }
+	FORCEINLINE uint32 GetBucket(const Cell& InCell) const;
+	static FORCEINLINE uint64 GetCellKey(const Cell& InCell);
+
+	/*
+	 *	Calls InFunction(uint32 Slot, float DistanceSquared) for the points of
+	 *	the cell with Key among the slots [Begin, End) of its bucket that are
+	 *	closer to Center than the square root of RadiusSquared.
+	 **/
+	template<typename Function>
+	FORCEINLINE void ScanCell(uint32 Begin, uint32 End, uint64 Key, const Vector* Center, const Vector& RadiusSquared, const Function& InFunction) const;
+
+	/** Calls InFunction(const Cell&) for the cells from Min to Max, clamped to those that have points. */
+	template<typename Function>
+	FORCEINLINE void ForEachCell(Cell Min, Cell Max, const Function& InFunction) const;
+
+	NULL_COPY_AND_ASSIGN(SpatialHashGrid);
+};
+
+FORCEINLINE SpatialHashGrid::Cell SpatialHashGrid::GetCell(float X, float Y, float Z) const
+{
+	return Cell{ { Math::Floor(X * InvCellSize), Math::Floor(Y * InvCellSize), Math::Floor(Z * InvCellSize) } };
+}
+
+FORCEINLINE uint32 SpatialHashGrid::GetBucket(const Cell& InCell) const
+{
+	// Teschner et al., Optimized Spatial Hashing for Collision Detection of Deformable Objects
+	return ((uint32)InCell.Coordinates[0] * 73856093u ^ (uint32)InCell.Coordinates[1] * 19349663u ^ (uint32)InCell.Coordinates[2] * 83492791u) & BucketMask;
+}
+
+FORCEINLINE uint64 SpatialHashGrid::GetCellKey(const Cell& InCell)
+{
+	const uint64 _Mask = (1ull << CELL_KEY_BITS) - 1;
+	return ((uint64)(uint32)InCell.Coordinates[0] & _Mask) << (2 * CELL_KEY_BITS)
+		| ((uint64)(uint32)InCell.Coordinates[1] & _Mask) << CELL_KEY_BITS
+		| ((uint64)(uint32)InCell.Coordinates[2] & _Mask);
+}
+
+template<typename Function>
+FORCEINLINE void SpatialHashGrid::ScanCell(uint32 Begin, uint32 End, uint64 Key, const Vector* Center, const Vector& RadiusSquared, const Function& InFunction) const
+{
+	for (uint32 Slot = Begin; Slot < End; Slot += WIDTH)
+	{
+		Vector _DistanceSquared = VectorConstants::ZERO;
+		for (uint32 Axis = 0; Axis < 3; Axis++)
+		{
+			Vector _Delta = Vector::Load4f(Positions[Axis].data() + Slot) - Center[Axis];
+			_DistanceSquared = _Delta.Mad(_Delta, _DistanceSquared);
+		}
+
+		uint32 _Mask = (_DistanceSquared < RadiusSquared).GetSignMask();
+		if (End - Slot < WIDTH)
+		{
+			_Mask &= (1u << (End - Slot)) - 1;
+		}
+		if (_Mask == 0)
+		{
+			continue;
+		}
+
+		float _Distances[WIDTH];
+		_DistanceSquared.Store4f(_Distances);
+		for (; _Mask != 0; _Mask &= _Mask - 1)
+		{
+			uint32 _Lane = Math::GetNumTrailingZeroes(_Mask);
+			if (CellKeys[Slot + _Lane] == Key)
+			{
+				InFunction(Slot + _Lane, _Distances[_Lane]);
+			}
+		}
+	}
+}
+
+template<typename Function>
+FORCEINLINE void SpatialHashGrid::ForEachCell(Cell Min, Cell Max, const Function& InFunction) const
+{
+	for (uint32 Axis = 0; Axis < 3; Axis++)
+	{
+		Min.Coordinates[Axis] = Math::Max(Min.Coordinates[Axis], MinCell.Coordinates[Axis]);
+		Max.Coordinates[Axis] = Math::Min(Max.Coordinates[Axis], MaxCell.Coordinates[Axis]);
+	}
+
+	Cell _Cell;
+	for (_Cell.Coordinates[2] = Min.Coordinates[2]; _Cell.Coordinates[2] <= Max.Coordinates[2]; _Cell.Coordinates[2]++)
+	{
+		for (_Cell.Coordinates[1] = Min.Coordinates[1]; _Cell.Coordinates[1] <= Max.Coordinates[1]; _Cell.Coordinates[1]++)
+		{
+			for (_Cell.Coordinates[0] = Min.Coordinates[0]; _Cell.Coordinates[0] <= Max.Coordinates[0]; _Cell.Coordinates[0]++)
+			{
+				InFunction(_Cell);
+			}
+		}
+	}
+}
+
+template<typename Function>
+void SpatialHashGrid::QueryRadius(const Spatial3D& Center, float Radius, const Function& InFunction) const
+{
+	if (Indices.empty())
+	{
+		return;
+	}
+
+	const Vector _Center[3] = { Vector::Load1f(Center.X()), Vector::Load1f(Center.Y()), Vector::Load1f(Center.Z()) };
+	const Vector _RadiusSquared = Vector::Load1f(Radius * Radius);
+	ForEachCell(GetCell(Center.X() - Radius, Center.Y() - Radius, Center.Z() - Radius),
+		GetCell(Center.X() + Radius, Center.Y() + Radius, Center.Z() + Radius),
+		[&](const Cell& InCell)
+		{
+			uint32 _Bucket = GetBucket(InCell);
+			ScanCell(BucketStarts[_Bucket], BucketStarts[_Bucket + 1], GetCellKey(InCell), _Center, _RadiusSquared,
+				[&](uint32 Slot, float DistanceSquared) { InFunction(Indices[Slot], DistanceSquared); });
+		});
+}
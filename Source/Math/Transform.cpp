@@ -2,7 +2,7 @@
 
 Matrix Transform::Inverse() const
 {
-	Matrix _Inverse(ToMatrix().Inverse());
-	return _Inverse;
+	// The last row is always (0, 0, 0, 1), so skip the general 4x4 inverse
+	return ToAffineMatrix().Inverse().ToMatrix();
 }
 
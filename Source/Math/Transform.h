@@ -3,6 +3,7 @@
 #include "Cartesian.h"
 #include "Quaternion.h"
 #include "Matrix.h"
+#include "AffineMatrix.h"
 
 class Transform
 {
@@ -33,6 +34,7 @@ public:
 	FORCEINLINE Vector InverseTransform(const Vector& vector) const;
 	FORCEINLINE Vector InverseTransform(const Spatial3D& vector, float w) const;
 	FORCEINLINE Matrix ToMatrix() const;
+	FORCEINLINE AffineMatrix ToAffineMatrix() const;
 	Matrix Inverse() const;
 	FORCEINLINE void NormalizeRotation();
 	FORCEINLINE bool IsRotationNormalized();
@@ -67,6 +69,11 @@ FORCEINLINE Matrix Transform::ToMatrix() const
 	return Matrix::TransformMatrix(m_Translation.Inner(), m_Rotation, m_Scale.Inner());
 }
 
+FORCEINLINE AffineMatrix Transform::ToAffineMatrix() const
+{
+	return AffineMatrix::TransformMatrix(m_Translation.Inner(), m_Rotation, m_Scale.Inner());
+}
+
 FORCEINLINE void Transform::NormalizeRotation()
 {
 	m_Rotation = m_Rotation.Normalized();
@@ -178,3 +185,12 @@ FORCEINLINE void Transform::SetScale(const Spatial3D& val)
 	m_Scale = val;
 }
 
+/** Translation and scale are lerped; rotation is lerped along the shorter arc and renormalized. */
+template<>
+FORCEINLINE Transform Math::Lerp(const Transform& val1, const Transform& val2,
+		const float& Amount)
+{
+	return Transform(Math::Lerp(val1.GetTranslation(), val2.GetTranslation(), Amount),
+			Math::Lerp(val1.GetRotation(), val2.GetRotation(), Amount).Normalized(),
+			Math::Lerp(val1.GetScale(), val2.GetScale(), Amount));
+}
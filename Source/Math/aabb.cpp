@@ -45,17 +45,15 @@ AABB::AABB(float* Points, uint32 Amount, uint32 Stride)
 AABB AABB::Transform(const Matrix& InTransform) const
 {
 	Vector Center(GetCenter().AsIntrinsic(1.f));
-	Vector Extents(GetExtents().AsIntrinsic(0.f));
-	Vector absExtents = Extents.Abs();
-	Matrix AbsMatrix(InTransform);
-	
-	for(uint32 Index = 0; Index < 4; Index++) 
-	{
-		AbsMatrix[Index] = AbsMatrix[Index].Abs();
-	}
+	Vector Extents(GetExtents().AsIntrinsic(0.f).Abs());
 
+	// Extents have w = 0, so only the absolute values of the top 3x3 of the matrix matter.
 	Vector newCenter = InTransform.Transform(Center);
-	Vector newExtents = AbsMatrix.Transform(absExtents);
+	Vector newExtents = Vector::Make(
+			InTransform[0].Abs().Dot3(Extents)[0],
+			InTransform[1].Abs().Dot3(Extents)[0],
+			InTransform[2].Abs().Dot3(Extents)[0],
+			0.0f);
 	return AABB(newCenter - newExtents, newCenter + newExtents);
 }
 
@@ -27,6 +27,7 @@ public:
 	FORCEINLINE Spatial3D GetMaxExtents() const;
 	FORCEINLINE void GetCenterAndExtents(Spatial3D& Center, Spatial3D& Extents) const;
 	FORCEINLINE float GetVolume() const;
+	FORCEINLINE float GetSurfaceArea() const;
 	FORCEINLINE AABB Overlap(const AABB& Other) const;
 	FORCEINLINE bool Contains(const Spatial3D& point) const;
 	FORCEINLINE bool Contains(const AABB& Other) const;
@@ -105,6 +106,12 @@ FORCEINLINE float AABB::GetVolume() const
 	return _Lengths[0] * _Lengths[1] * _Lengths[2];
 }
 
+FORCEINLINE float AABB::GetSurfaceArea() const
+{
+	Spatial3D _Lengths = m_Extents[1] - m_Extents[0];
+	return 2.0f * (_Lengths[0] * _Lengths[1] + _Lengths[1] * _Lengths[2] + _Lengths[2] * _Lengths[0]);
+}
+
 FORCEINLINE AABB AABB::Overlap(const AABB& Other) const
 {
 	return AABB(m_Extents[0].Inner().Max(Other.m_Extents[0].Inner()), m_Extents[1].Inner().Min(Other.m_Extents[1].Inner()));
@@ -200,6 +200,21 @@ struct BaseMath
 		return 31 - FloorLog2(Val);
 	}
 
+	/** Val must not be 0. */
+	static FORCEINLINE uint32 GetNumTrailingZeroes(uint32 Val)
+	{
+#if defined(COMPILER_GCC) || defined(COMPILER_CLANG)
+		return (uint32)__builtin_ctz(Val);
+#else
+		uint32 pos = 0;
+		while((Val & 1) == 0) {
+			Val >>= 1;
+			pos++;
+		}
+		return pos;
+#endif
+	}
+
 	static FORCEINLINE uint32 CeilLog2(uint32 Val)
 	{
 		if(Val <= 1) {
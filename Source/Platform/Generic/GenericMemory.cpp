@@ -1,17 +1,61 @@
 #include "GenericMemory.h"
+#include "GenericPageMemory.h"
 #include "Math/Math.h"
 #include <cstdlib>
 #include <stdio.h>
 
+#if SIMD_CPU_ARCH != SIMD_CPU_ARCH_OTHER && SIMD_SUPPORTED_LEVEL >= SIMD_LEVEL_x86_SSE2
+	#include "Platform/PlatformSIMDInclude.h"
+	#define GENERIC_MEMORY_SIMD 1
+#else
+	#define GENERIC_MEMORY_SIMD 0
+#endif
+
+// Every block is preceded by its size and the address the underlying
+// allocation starts at. Mapped blocks have the low bit of that address set.
+static const uintptr HEADER_SIZE = sizeof(void*) + sizeof(uintptr);
+
+static FORCEINLINE void* setHeader(uint8* Result, uint8* Base, uintptr Amount, bool bMapped)
+{
+	*((uintptr*)(Result - sizeof(void*))) = (uintptr)Base | (bMapped ? 1 : 0);
+	*((uintptr*)(Result - HEADER_SIZE)) = Amount;
+	return Result;
+}
+
+static FORCEINLINE uint8* getBase(void* Ptr)
+{
+	return (uint8*)(*((uintptr*)((uint8*)Ptr - sizeof(void*))) & ~(uintptr)1);
+}
+
+static FORCEINLINE bool isMapped(void* Ptr)
+{
+	return (*((uintptr*)((uint8*)Ptr - sizeof(void*))) & 1) != 0;
+}
+
+static FORCEINLINE bool shouldMap(uintptr Amount, uint32 Alignment)
+{
+	return Amount >= GenericPageMemory::MAPPED_THRESHOLD && Alignment <= GenericPageMemory::GetPageSize();
+}
+
 void* GenericMemory::Malloc(uintptr Amount, uint32 Alignment)
 {
 	Alignment = Math::Max(Amount >= 16 ? 16u : 8u, Alignment);
-	void* _ptr = ::malloc(Amount + Alignment + sizeof(void*) + sizeof(uintptr));
-	void* _Result = Align((uint8*)_ptr + sizeof(void*) + sizeof(uintptr), (uintptr)Alignment);
-	*((void**)((uint8*)_Result - sizeof(void*))) = _ptr;
-	*((uintptr*)((uint8*)_Result - sizeof(void*) - sizeof(uintptr))) = Amount;
+	if (shouldMap(Amount, Alignment))
+	{
+		uintptr _Offset = Align(HEADER_SIZE, (uintptr)Alignment);
+		uint8* _Mapping = (uint8*)GenericPageMemory::Map(_Offset + Amount, GenericPageMemory::GetPageSize());
+		if (_Mapping != nullptr)
+		{
+			return setHeader(_Mapping + _Offset, _Mapping, Amount, true);
+		}
+	}
 
-	return _Result;
+	uint8* _ptr = (uint8*)::malloc(Amount + Alignment + HEADER_SIZE);
+	if (_ptr == nullptr)
+	{
+		return nullptr;
+	}
+	return setHeader(Align(_ptr + HEADER_SIZE, (uintptr)Alignment), _ptr, Amount, false);
 }
 
 void* GenericMemory::Realloc(void* Ptr, uintptr Amount, uint32 Alignment)
@@ -29,10 +73,49 @@ void* GenericMemory::Realloc(void* Ptr, uintptr Amount, uint32 Alignment)
 		return nullptr;
 	}
 
-	void* _Result = Malloc(Amount, Alignment);
 	uintptr _Size = GenericMemory::GetAllocSize(Ptr);
-	GenericMemory::Memcpy(_Result, Ptr, Math::Min(_Size, Amount));
-	Free(Ptr);
+	uint8* _Base = getBase(Ptr);
+	uintptr _Offset = (uintptr)((uint8*)Ptr - _Base);
+	bool _bAligned = ((uintptr)Ptr & (Alignment - 1)) == 0;
+
+	if (isMapped(Ptr))
+	{
+		// Stay mapped until well below the threshold, so a buffer hovering
+		// around it does not keep moving between the heap and its own pages.
+		if (_bAligned && Amount >= GenericPageMemory::MAPPED_THRESHOLD / 2)
+		{
+			uint8* _Mapping = (uint8*)GenericPageMemory::Remap(_Base, _Offset + _Size, _Offset + Amount,
+					GenericPageMemory::GetPageSize());
+			if (_Mapping != nullptr)
+			{
+				return setHeader(_Mapping + _Offset, _Mapping, Amount, true);
+			}
+		}
+	}
+	else if (!shouldMap(Amount, Alignment))
+	{
+		// ::realloc grows or shrinks in place when it can. Size the block so
+		// the data fits both where ::realloc leaves it and where it must go.
+		uintptr _BlockSize = Math::Max((uintptr)Alignment + HEADER_SIZE, _Offset) + Amount;
+		uint8* _NewBase = (uint8*)::realloc(_Base, _BlockSize);
+		if (_NewBase == nullptr)
+		{
+			return nullptr;
+		}
+		uint8* _Result = Align(_NewBase + HEADER_SIZE, (uintptr)Alignment);
+		if (_Result != _NewBase + _Offset)
+		{
+			GenericMemory::Memmove(_Result, _NewBase + _Offset, Math::Min(_Size, Amount));
+		}
+		return setHeader(_Result, _NewBase, Amount, false);
+	}
+
+	void* _Result = Malloc(Amount, Alignment);
+	if (_Result != nullptr)
+	{
+		GenericMemory::Memcpy(_Result, Ptr, Math::Min(_Size, Amount));
+		Free(Ptr);
+	}
 
 	return _Result;
 }
@@ -41,7 +124,15 @@ void* GenericMemory::Free(void* Ptr)
 {
 	if (Ptr) 
 	{
-		::free(*((void**)((uint8*)Ptr - sizeof(void*))));
+		uint8* _Base = getBase(Ptr);
+		if (isMapped(Ptr))
+		{
+			GenericPageMemory::Unmap(_Base, (uintptr)((uint8*)Ptr - _Base) + GetAllocSize(Ptr));
+		}
+		else
+		{
+			::free(_Base);
+		}
 	}
 
 	return nullptr;
@@ -49,21 +140,183 @@ void* GenericMemory::Free(void* Ptr)
 
 uintptr GenericMemory::GetAllocSize(void* Ptr)
 {
-	return *((uintptr*)((uint8*)Ptr - sizeof(void*) - sizeof(uintptr)));
+	return *((uintptr*)((uint8*)Ptr - HEADER_SIZE));
+}
+
+#if GENERIC_MEMORY_SIMD
+
+// The widest vector the build targets, for the bulk memory operations below
+#if SIMD_SUPPORTED_LEVEL >= SIMD_LEVEL_x86_AVX2
+typedef __m256i MemoryVector;
+
+static FORCEINLINE MemoryVector loadVector(const void* Ptr) { return _mm256_loadu_si256((const __m256i*)Ptr); }
+static FORCEINLINE void storeVector(void* Ptr, MemoryVector Vector) { _mm256_storeu_si256((__m256i*)Ptr, Vector); }
+static FORCEINLINE void storeVectorAligned(void* Ptr, MemoryVector Vector) { _mm256_store_si256((__m256i*)Ptr, Vector); }
+static FORCEINLINE void streamVector(void* Ptr, MemoryVector Vector) { _mm256_stream_si256((__m256i*)Ptr, Vector); }
+#else
+typedef __m128i MemoryVector;
+
+static FORCEINLINE MemoryVector loadVector(const void* Ptr) { return _mm_loadu_si128((const __m128i*)Ptr); }
+static FORCEINLINE void storeVector(void* Ptr, MemoryVector Vector) { _mm_storeu_si128((__m128i*)Ptr, Vector); }
+static FORCEINLINE void storeVectorAligned(void* Ptr, MemoryVector Vector) { _mm_store_si128((__m128i*)Ptr, Vector); }
+static FORCEINLINE void streamVector(void* Ptr, MemoryVector Vector) { _mm_stream_si128((__m128i*)Ptr, Vector); }
+#endif
+
+static const uintptr VECTOR_SIZE = sizeof(MemoryVector);
+
+void* GenericMemory::MemsetPattern(void* Destination, const void* Pattern, uint32 PatternSize, uintptr Amount)
+{
+	assertCheck(PatternSize == 1 || PatternSize == 2 || PatternSize == 4 || PatternSize == 8 || PatternSize == 16);
+	if (PatternSize == 1)
+	{
+		return ::memset(Destination, *(const uint8*)Pattern, Amount);
+	}
+
+	// Two vectors' worth of the pattern, so a vector starting at any byte of it can be loaded
+	uint8 _Repeated[2 * sizeof(MemoryVector)];
+	for (uint32 Index = 0; Index < sizeof(_Repeated); Index++)
+	{
+		_Repeated[Index] = ((const uint8*)Pattern)[Index & (PatternSize - 1)];
+	}
+
+	uint8* _Dest = (uint8*)Destination;
+	if (Amount < VECTOR_SIZE)
+	{
+		::memcpy(_Dest, _Repeated, Amount);
+		return Destination;
+	}
+
+	// Unaligned first and last vectors around aligned stores in the middle.
+	// Each is loaded at the pattern phase of where it lands.
+	uint8* _End = _Dest + Amount;
+	storeVector(_Dest, loadVector(_Repeated));
+	storeVector(_End - VECTOR_SIZE, loadVector(_Repeated + ((Amount - VECTOR_SIZE) & (PatternSize - 1))));
+
+	uint8* _Cursor = Align(_Dest, VECTOR_SIZE);
+	MemoryVector _Vector = loadVector(_Repeated + ((uintptr)(_Cursor - _Dest) & (PatternSize - 1)));
+	for (; _Cursor + 4 * VECTOR_SIZE <= _End; _Cursor += 4 * VECTOR_SIZE)
+	{
+		storeVectorAligned(_Cursor, _Vector);
+		storeVectorAligned(_Cursor + VECTOR_SIZE, _Vector);
+		storeVectorAligned(_Cursor + 2 * VECTOR_SIZE, _Vector);
+		storeVectorAligned(_Cursor + 3 * VECTOR_SIZE, _Vector);
+	}
+	for (; _Cursor + VECTOR_SIZE <= _End; _Cursor += VECTOR_SIZE)
+	{
+		storeVectorAligned(_Cursor, _Vector);
+	}
+	return Destination;
+}
+
+void* GenericMemory::MemcpyStreaming(void* Destination, const void* Source, uintptr Amount)
+{
+	// Below this the fence and the cache misses on reading the copy back cost more than they save
+	enum { MIN_STREAMING_COPY = 4096 };
+	if (Amount < MIN_STREAMING_COPY)
+	{
+		return ::memcpy(Destination, Source, Amount);
+	}
+
+	uint8* _Dest = (uint8*)Destination;
+	const uint8* _Src = (const uint8*)Source;
+	uintptr _Head = (uintptr)(Align(_Dest, VECTOR_SIZE) - _Dest);
+	::memcpy(_Dest, _Src, _Head);
+	_Dest += _Head;
+	_Src += _Head;
+	Amount -= _Head;
+
+	for (; Amount >= 4 * VECTOR_SIZE; Amount -= 4 * VECTOR_SIZE)
+	{
+		MemoryVector _A = loadVector(_Src);
+		MemoryVector _B = loadVector(_Src + VECTOR_SIZE);
+		MemoryVector _C = loadVector(_Src + 2 * VECTOR_SIZE);
+		MemoryVector _D = loadVector(_Src + 3 * VECTOR_SIZE);
+		streamVector(_Dest, _A);
+		streamVector(_Dest + VECTOR_SIZE, _B);
+		streamVector(_Dest + 2 * VECTOR_SIZE, _C);
+		streamVector(_Dest + 3 * VECTOR_SIZE, _D);
+		_Src += 4 * VECTOR_SIZE;
+		_Dest += 4 * VECTOR_SIZE;
+	}
+	for (; Amount >= VECTOR_SIZE; Amount -= VECTOR_SIZE)
+	{
+		streamVector(_Dest, loadVector(_Src));
+		_Src += VECTOR_SIZE;
+		_Dest += VECTOR_SIZE;
+	}
+	// Streaming stores are weakly ordered, so make them visible before anyone else reads the destination
+	_mm_sfence();
+
+	::memcpy(_Dest, _Src, Amount);
+	return Destination;
 }
 
+#else
+
+void* GenericMemory::MemsetPattern(void* Destination, const void* Pattern, uint32 PatternSize, uintptr Amount)
+{
+	assertCheck(PatternSize == 1 || PatternSize == 2 || PatternSize == 4 || PatternSize == 8 || PatternSize == 16);
+	uint8* _Dest = (uint8*)Destination;
+	for (uintptr Index = 0; Index < Amount; Index++)
+	{
+		_Dest[Index] = ((const uint8*)Pattern)[Index & (PatternSize - 1)];
+	}
+	return Destination;
+}
+
+void* GenericMemory::MemcpyStreaming(void* Destination, const void* Source, uintptr Amount)
+{
+	return ::memcpy(Destination, Source, Amount);
+}
+
+#endif
+
 void GenericMemory::BigMemswap(void* A, void* B, uintptr Size)
 {
-	uint64* _ptr1 = (uint64*)A;
-	uint64* _ptr2 = (uint64*)B;
-	while (Size > GENERIC_MEMORY_SMALL_MEMSWAP_MAX) 
+	uint8* _A = (uint8*)A;
+	uint8* _B = (uint8*)B;
+#if GENERIC_MEMORY_SIMD
+	// All loads before any store, so a store to A never stalls a load from B when
+	// the two happen to be a multiple of 4KB apart
+	for (; Size >= 4 * VECTOR_SIZE; Size -= 4 * VECTOR_SIZE)
+	{
+		MemoryVector _A0 = loadVector(_A);
+		MemoryVector _A1 = loadVector(_A + VECTOR_SIZE);
+		MemoryVector _A2 = loadVector(_A + 2 * VECTOR_SIZE);
+		MemoryVector _A3 = loadVector(_A + 3 * VECTOR_SIZE);
+		MemoryVector _B0 = loadVector(_B);
+		MemoryVector _B1 = loadVector(_B + VECTOR_SIZE);
+		MemoryVector _B2 = loadVector(_B + 2 * VECTOR_SIZE);
+		MemoryVector _B3 = loadVector(_B + 3 * VECTOR_SIZE);
+		storeVector(_A, _B0);
+		storeVector(_A + VECTOR_SIZE, _B1);
+		storeVector(_A + 2 * VECTOR_SIZE, _B2);
+		storeVector(_A + 3 * VECTOR_SIZE, _B3);
+		storeVector(_B, _A0);
+		storeVector(_B + VECTOR_SIZE, _A1);
+		storeVector(_B + 2 * VECTOR_SIZE, _A2);
+		storeVector(_B + 3 * VECTOR_SIZE, _A3);
+		_A += 4 * VECTOR_SIZE;
+		_B += 4 * VECTOR_SIZE;
+	}
+	for (; Size >= VECTOR_SIZE; Size -= VECTOR_SIZE)
+	{
+		MemoryVector _Temp = loadVector(_A);
+		storeVector(_A, loadVector(_B));
+		storeVector(_B, _Temp);
+		_A += VECTOR_SIZE;
+		_B += VECTOR_SIZE;
+	}
+#endif
+	while (Size > GENERIC_MEMORY_SMALL_MEMSWAP_MAX)
 	{
-		uint64 _Temp = *_ptr1;
-		*_ptr1 = *_ptr2;
-		*_ptr2 = _Temp;
+		uint64 _Temp;
+		GenericMemory::Memcpy(&_Temp, _A, 8);
+		GenericMemory::Memcpy(_A, _B, 8);
+		GenericMemory::Memcpy(_B, &_Temp, 8);
 		Size -= 8;
-		_ptr1++;
-		_ptr2++;
+		_A += 8;
+		_B += 8;
 	}
-	SmallMemswap(_ptr1, _ptr2, Size);
+	SmallMemswap(_A, _B, Size);
 }
@@ -24,9 +24,18 @@ struct GenericMemory
 		return ::memcmp(Destination, Source, (size_t)Amount);
 	}
 
+	/*
+	 *	Fills Amount bytes with copies of Val. If Amount is not a multiple of
+	 *	sizeof(T) the last copy is cut short.
+	 **/
 	template<typename T>
 	static FORCEINLINE void* Memset(void* InDestination, T Val, uintptr Amount)
 	{
+		if (sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8 || sizeof(T) == 16)
+		{
+			return MemsetPattern(InDestination, &Val, sizeof(T), Amount);
+		}
+
 		auto* Destination = (T*)InDestination;
 		uintptr AmountT = Amount / sizeof(T);
 		uintptr remainder = Amount % sizeof(T);
@@ -50,6 +59,19 @@ struct GenericMemory
 		return ::memcpy(Destination, Source, Amount);
 	}
 
+	/*
+	 *	Fills Amount bytes with repeats of the PatternSize bytes at Pattern.
+	 *	PatternSize must be 1, 2, 4, 8 or 16.
+	 **/
+	static void* MemsetPattern(void* Destination, const void* Pattern, uint32 PatternSize, uintptr Amount);
+
+	/*
+	 *	Memcpy with non-temporal stores, which bypass the cache. Only worth it
+	 *	for large copies into memory that is written and not read back soon,
+	 *	such as a mapped GPU buffer; small copies go through Memcpy.
+	 **/
+	static void* MemcpyStreaming(void* Destination, const void* Source, uintptr Amount);
+
 	/*
 	 *	Swaps A and B
 	 **/
@@ -0,0 +1,135 @@
+#include "GenericPageMemory.h"
+#include "GenericMemory.h"
+
+#ifdef OPERATING_SYSTEM_LINUX
+	#include <sys/mman.h>
+	#include <unistd.h>
+#endif
+
+#ifdef OPERATING_SYSTEM_LINUX
+
+uintptr GenericPageMemory::GetPageSize()
+{
+	static const uintptr _PageSize = (uintptr)sysconf(_SC_PAGESIZE);
+	return _PageSize;
+}
+
+static void adviseHugePages(void* Ptr, uintptr Amount)
+{
+#if PLATFORM_MEMORY_HUGE_PAGES && defined(MADV_HUGEPAGE)
+	if (Amount >= GenericPageMemory::HUGE_PAGE_SIZE)
+	{
+		madvise(Ptr, Amount, MADV_HUGEPAGE);
+	}
+#else
+	(void)Ptr;
+	(void)Amount;
+#endif
+}
+
+void* GenericPageMemory::Map(uintptr Amount, uintptr Alignment)
+{
+	uintptr _PageSize = GetPageSize();
+	uintptr _Size = GenericMemory::Align(Amount, _PageSize);
+	uintptr _Slack = Alignment > _PageSize ? Alignment : 0;
+
+	uint8* _Mapping = (uint8*)mmap(nullptr, _Size + _Slack, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (_Mapping == (uint8*)MAP_FAILED)
+	{
+		return nullptr;
+	}
+
+	// mmap only guarantees page alignment, so map extra and trim both ends
+	uint8* _Result = GenericMemory::Align(_Mapping, _Slack != 0 ? _Slack : _PageSize);
+	if (_Result != _Mapping)
+	{
+		munmap(_Mapping, (uintptr)(_Result - _Mapping));
+	}
+	uintptr _Tail = (uintptr)(_Mapping + _Size + _Slack - (_Result + _Size));
+	if (_Tail != 0)
+	{
+		munmap(_Result + _Size, _Tail);
+	}
+
+	adviseHugePages(_Result, _Size);
+	return _Result;
+}
+
+void* GenericPageMemory::Remap(void* Ptr, uintptr OldAmount, uintptr NewAmount, uintptr Alignment)
+{
+	uintptr _PageSize = GetPageSize();
+	uintptr _OldSize = GenericMemory::Align(OldAmount, _PageSize);
+	uintptr _NewSize = GenericMemory::Align(NewAmount, _PageSize);
+	if (_OldSize == _NewSize)
+	{
+		return Ptr;
+	}
+
+	void* _Result = mremap(Ptr, _OldSize, _NewSize, 0);
+	if (_Result == MAP_FAILED)
+	{
+		if (Alignment <= _PageSize)
+		{
+			_Result = mremap(Ptr, _OldSize, _NewSize, MREMAP_MAYMOVE);
+		}
+		else
+		{
+			// Reserve an aligned range and move the pages on top of it
+			void* _Target = Map(_NewSize, Alignment);
+			if (_Target == nullptr)
+			{
+				return nullptr;
+			}
+			_Result = mremap(Ptr, _OldSize, _NewSize, MREMAP_MAYMOVE | MREMAP_FIXED, _Target);
+			if (_Result == MAP_FAILED)
+			{
+				munmap(_Target, _NewSize);
+			}
+		}
+	}
+	if (_Result == MAP_FAILED)
+	{
+		return nullptr;
+	}
+
+	adviseHugePages(_Result, _NewSize);
+	return _Result;
+}
+
+void GenericPageMemory::Unmap(void* Ptr, uintptr Amount)
+{
+	munmap(Ptr, GenericMemory::Align(Amount, GetPageSize()));
+}
+
+#else
+
+uintptr GenericPageMemory::GetPageSize()
+{
+	return 4096;
+}
+
+void* GenericPageMemory::Map(uintptr Amount, uintptr Alignment)
+{
+	(void)Amount;
+	(void)Alignment;
+	return nullptr;
+}
+
+void* GenericPageMemory::Remap(void* Ptr, uintptr OldAmount, uintptr NewAmount, uintptr Alignment)
+{
+	(void)Ptr;
+	(void)OldAmount;
+	(void)NewAmount;
+	(void)Alignment;
+	return nullptr;
+}
+
+void GenericPageMemory::Unmap(void* Ptr, uintptr Amount)
+{
+	(void)Ptr;
+	(void)Amount;
+	assertCheck(false);
+}
+
+#endif
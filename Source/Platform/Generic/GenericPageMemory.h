@@ -0,0 +1,41 @@
+#pragma once
+
+#include "EngineCore/EngineUtils.h"
+
+/*
+ *	Set to 0 to keep big mappings on regular pages. Otherwise mappings of at
+ *	least HUGE_PAGE_SIZE are advised to be backed by transparent huge pages.
+ **/
+#ifndef PLATFORM_MEMORY_HUGE_PAGES
+	#define PLATFORM_MEMORY_HUGE_PAGES 1
+#endif
+
+/*
+ *	Whole pages mapped straight from the OS, for allocations big enough that
+ *	going through the heap only adds fragmentation. A mapping can be resized
+ *	without copying: in place when the address space after it is free, and
+ *	otherwise by moving its pages.
+ *
+ *	Only implemented on Linux. Elsewhere Map and Remap return nullptr and
+ *	callers fall back to the heap.
+ **/
+struct GenericPageMemory
+{
+	enum
+	{
+		/** Allocations from this size up are mapped rather than taken from the heap. */
+		MAPPED_THRESHOLD = 256 * 1024,
+		HUGE_PAGE_SIZE = 2 * 1024 * 1024
+	};
+
+	static uintptr GetPageSize();
+
+	/** Maps at least Amount bytes aligned to Alignment, which must be a power of two. */
+	static void* Map(uintptr Amount, uintptr Alignment);
+	/*
+	 *	Resizes the mapping at Ptr, keeping its Alignment and contents. Returns
+	 *	the mapping's address, or nullptr, leaving it untouched, on failure.
+	 **/
+	static void* Remap(void* Ptr, uintptr OldAmount, uintptr NewAmount, uintptr Alignment);
+	static void Unmap(void* Ptr, uintptr Amount);
+};
@@ -50,7 +50,7 @@ public:
 		float _M[4][4];
 		for (uint32 i = 0; i < 4; i++) 
 		{
-			In[i].store4f(_M[i]);
+			In[i].Store4f(_M[i]);
 		}
 		return _M[0][0] * (_M[1][1] * _M[2][2] - _M[1][2] * _M[2][1]) - _M[1][0] * (_M[0][1] * _M[2][2] - _M[0][2] * _M[2][1]) + _M[2][0] * (_M[0][1] * _M[1][2] - _M[0][2] * _M[1][1]);
 	}
@@ -67,7 +67,7 @@ public:
 		auto* m = (BaseVector*)mat;
 		float M[4][4];
 		for(uint32 i = 0; i < 4; i++) {
-			m[i].store4f(M[i]);
+			m[i].Store4f(M[i]);
 		}
 		
 		s[0] = M[0][0] * M[1][1] - M[1][0] * M[0][1];
@@ -96,7 +96,7 @@ public:
 		BaseVector* m = (BaseVector*)src;
 		float M[4][4];
 		for(uint32 i = 0; i < 4; i++) {
-			m[i].store4f(M[i]);
+			m[i].Store4f(M[i]);
 		}
 
 		float Result[4][4];
@@ -153,6 +153,21 @@ public:
 		mat[3] = Make(0.0f, 0.0f, 0.0f, 1.0f);
 		Memory::memcpy(dest, mat, sizeof(mat));
 	}
+
+	/** Transposes the 4x4 matrix whose rows are the four vectors, in place. */
+	static FORCEINLINE void Transpose4(BaseVector& Row0, BaseVector& Row1, BaseVector& Row2, BaseVector& Row3)
+	{
+		BaseVector* _Rows[4] = { &Row0, &Row1, &Row2, &Row3 };
+		for (uint32 Row = 0; Row < 4; Row++)
+		{
+			for (uint32 Column = Row + 1; Column < 4; Column++)
+			{
+				float _Temp = _Rows[Row]->m_Vector[Column];
+				_Rows[Row]->m_Vector[Column] = _Rows[Column]->m_Vector[Row];
+				_Rows[Column]->m_Vector[Row] = _Temp;
+			}
+		}
+	}
 	
 	static FORCEINLINE BaseVector Make(uint32 x, uint32 y, uint32 z, uint32 w)
 	{
@@ -277,10 +292,10 @@ public:
 	FORCEINLINE BaseVector Max(const BaseVector& Other) const
 	{
 		return Make(
-				Math::max(m_Vector[0], Other.m_Vector[0]),
-				Math::max(m_Vector[1], Other.m_Vector[1]),
-				Math::max(m_Vector[2], Other.m_Vector[2]),
-				Math::max(m_Vector[3], Other.m_Vector[3]));
+				Math::Max(m_Vector[0], Other.m_Vector[0]),
+				Math::Max(m_Vector[1], Other.m_Vector[1]),
+				Math::Max(m_Vector[2], Other.m_Vector[2]),
+				Math::Max(m_Vector[3], Other.m_Vector[3]));
 	}
 
 	FORCEINLINE BaseVector ToNeg() const
@@ -324,6 +339,15 @@ public:
 				Math::Pow(m_Vector[3], exp.m_Vector[3]));
 	}
 
+	FORCEINLINE BaseVector Sqrt() const
+	{
+		return Make(
+				Math::Sqrt(m_Vector[0]),
+				Math::Sqrt(m_Vector[1]),
+				Math::Sqrt(m_Vector[2]),
+				Math::Sqrt(m_Vector[3]));
+	}
+
 	FORCEINLINE BaseVector rSqrt() const
 	{
 		return Make(
@@ -454,6 +478,14 @@ public:
 				(vals[2] == 0.0f) && (vals[3] == 0.0f);
 	}
 
+	/** Bit i is the sign bit of component i; for a comparison result, whether it held for component i. */
+	FORCEINLINE uint32 GetSignMask() const
+	{
+		uint32 _Bits[4];
+		Memory::memcpy(_Bits, m_Vector, sizeof(_Bits));
+		return (_Bits[0] >> 31) | ((_Bits[1] >> 31) << 1) | ((_Bits[2] >> 31) << 2) | ((_Bits[3] >> 31) << 3);
+	}
+
 
 	FORCEINLINE BaseVector operator==(const BaseVector& Other) const
 	{
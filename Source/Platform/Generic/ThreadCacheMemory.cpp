@@ -0,0 +1,408 @@
+#include "ThreadCacheMemory.h"
+#include "GenericPageMemory.h"
+#include <atomic>
+#include <mutex>
+#include <cstdlib>
+
+#ifdef OPERATING_SYSTEM_WINDOWS
+	#include <malloc.h>
+#endif
+
+namespace
+{
+	struct ThreadCache;
+
+	/** Lives in the first SPAN_HEADER_SIZE bytes of every span. */
+	struct Span
+	{
+		/** NUM_SIZE_CLASSES for spans holding a single large allocation. */
+		uint32 SizeClass;
+		uint32 BlockSize;
+		ThreadCache* Owner;
+		/** Blocks freed by threads other than the owner. */
+		std::atomic<void*> RemoteFree;
+		/** Link in the owner's PendingSpans, written by the thread queueing the span. */
+		Span* NextPending;
+		uintptr LargeSize;
+		/** Bytes mapped for a large span taken from GenericPageMemory, 0 otherwise. */
+		uintptr MappedSize;
+	};
+
+	struct SizeClassCache
+	{
+		void* FreeList;
+		uint8* BumpCursor;
+		uint8* BumpEnd;
+	};
+
+	struct ThreadCache
+	{
+		SizeClassCache Classes[ThreadCacheMemory::NUM_SIZE_CLASSES];
+		/** Spans that received remote frees since the owner last collected them. */
+		std::atomic<Span*> PendingSpans;
+		ThreadCache* NextOrphan;
+	};
+
+	static_assert(sizeof(Span) <= ThreadCacheMemory::SPAN_HEADER_SIZE, "Span header does not fit");
+
+	// All of these are constant initialized, so they work for allocations made
+	// before, and frees made after, the rest of static initialization.
+	thread_local ThreadCache* t_Cache = nullptr;
+	thread_local bool t_bExited = false;
+
+	std::mutex g_CachesMutex;
+	ThreadCache* g_OrphanCaches = nullptr;
+
+	/** Serves threads whose own cache has already been torn down. */
+	std::mutex g_SharedCacheMutex;
+	ThreadCache g_SharedCache;
+}
+
+static void* allocSystem(uintptr Amount, uintptr Alignment)
+{
+#ifdef OPERATING_SYSTEM_WINDOWS
+	return _aligned_malloc(Amount, Alignment);
+#else
+	void* _Result = nullptr;
+	return posix_memalign(&_Result, Alignment, Amount) == 0 ? _Result : nullptr;
+#endif
+}
+
+static void freeSystem(void* Ptr)
+{
+#ifdef OPERATING_SYSTEM_WINDOWS
+	_aligned_free(Ptr);
+#else
+	::free(Ptr);
+#endif
+}
+
+static FORCEINLINE Span* getSpan(void* Ptr)
+{
+	return (Span*)((uintptr)Ptr & ~(uintptr)(ThreadCacheMemory::SPAN_SIZE - 1));
+}
+
+/*
+ *	Gives the calling thread's cache back to the pool once the thread exits,
+ *	so its spans, and the blocks other threads free into them, get reused.
+ **/
+struct ThreadCacheRelease
+{
+	~ThreadCacheRelease()
+	{
+		std::lock_guard<std::mutex> _Lock(g_CachesMutex);
+		t_Cache->NextOrphan = g_OrphanCaches;
+		g_OrphanCaches = t_Cache;
+		t_Cache = nullptr;
+		t_bExited = true;
+	}
+};
+
+static ThreadCache* createCache()
+{
+	if (t_bExited)
+	{
+		return nullptr;
+	}
+
+	ThreadCache* _Cache;
+	{
+		std::lock_guard<std::mutex> _Lock(g_CachesMutex);
+		_Cache = g_OrphanCaches;
+		if (_Cache != nullptr)
+		{
+			g_OrphanCaches = _Cache->NextOrphan;
+		}
+	}
+	if (_Cache == nullptr)
+	{
+		_Cache = (ThreadCache*)allocSystem(sizeof(ThreadCache), 64);
+		if (_Cache == nullptr)
+		{
+			return nullptr;
+		}
+		GenericMemory::Memzero(_Cache, sizeof(ThreadCache));
+		_Cache->PendingSpans.store(nullptr, std::memory_order_relaxed);
+	}
+
+	t_Cache = _Cache;
+	static thread_local ThreadCacheRelease _Release;
+	(void)_Release;
+	return _Cache;
+}
+
+static void collectRemoteFrees(ThreadCache* Cache)
+{
+	Span* _Span = Cache->PendingSpans.exchange(nullptr, std::memory_order_acquire);
+	while (_Span != nullptr)
+	{
+		// Read the link before emptying RemoteFree, as that allows the span to be queued again
+		Span* _Next = _Span->NextPending;
+		void* _List = _Span->RemoteFree.exchange(nullptr, std::memory_order_acquire);
+
+		SizeClassCache& _Class = Cache->Classes[_Span->SizeClass];
+		void* _Tail = _List;
+		while (*(void**)_Tail != nullptr)
+		{
+			_Tail = *(void**)_Tail;
+		}
+		*(void**)_Tail = _Class.FreeList;
+		_Class.FreeList = _List;
+
+		_Span = _Next;
+	}
+}
+
+/*
+ *	Blocks start SPAN_HEADER_SIZE into their span and follow each other, so
+ *	every block of a class whose size is a multiple of Alignment is aligned
+ *	to it. Above 16 bytes the request is rounded up to the first such class.
+ **/
+static FORCEINLINE uint32 getSizeClass(uintptr Amount, uint32 Alignment)
+{
+	if (Alignment <= 16)
+	{
+		return ThreadCacheMemory::GetSizeClass(Amount);
+	}
+
+	uint32 _SizeClass = ThreadCacheMemory::GetSizeClass(GenericMemory::Align(Amount, (uintptr)Alignment));
+	while (ThreadCacheMemory::GetSizeClassSize(_SizeClass) % Alignment != 0)
+	{
+		_SizeClass++;
+	}
+	return _SizeClass;
+}
+
+static void* allocSmall(ThreadCache* Cache, uint32 SizeClass)
+{
+	SizeClassCache& _Class = Cache->Classes[SizeClass];
+	void* _Result = _Class.FreeList;
+	if (_Result != nullptr)
+	{
+		_Class.FreeList = *(void**)_Result;
+		return _Result;
+	}
+
+	uint32 _BlockSize = ThreadCacheMemory::GetSizeClassSize(SizeClass);
+	if ((uintptr)(_Class.BumpEnd - _Class.BumpCursor) >= _BlockSize)
+	{
+		_Result = _Class.BumpCursor;
+		_Class.BumpCursor += _BlockSize;
+		return _Result;
+	}
+
+	collectRemoteFrees(Cache);
+	_Result = _Class.FreeList;
+	if (_Result != nullptr)
+	{
+		_Class.FreeList = *(void**)_Result;
+		return _Result;
+	}
+
+	Span* _Span = (Span*)allocSystem(ThreadCacheMemory::SPAN_SIZE, ThreadCacheMemory::SPAN_SIZE);
+	if (_Span == nullptr)
+	{
+		return nullptr;
+	}
+	_Span->SizeClass = SizeClass;
+	_Span->BlockSize = _BlockSize;
+	_Span->Owner = Cache;
+	_Span->RemoteFree.store(nullptr, std::memory_order_relaxed);
+	_Span->NextPending = nullptr;
+	_Span->LargeSize = 0;
+	_Span->MappedSize = 0;
+
+	_Result = (uint8*)_Span + ThreadCacheMemory::SPAN_HEADER_SIZE;
+	_Class.BumpCursor = (uint8*)_Result + _BlockSize;
+	_Class.BumpEnd = (uint8*)_Span + ThreadCacheMemory::SPAN_SIZE;
+	return _Result;
+}
+
+static FORCEINLINE uintptr getLargeOffset(uint32 Alignment)
+{
+	Alignment = Math::Max(Alignment, (uint32)ThreadCacheMemory::MAX_SMALL_ALIGNMENT);
+	return GenericMemory::Align((uintptr)ThreadCacheMemory::SPAN_HEADER_SIZE, (uintptr)Alignment);
+}
+
+static void* allocLarge(uintptr Amount, uint32 Alignment)
+{
+	uintptr _Offset = getLargeOffset(Alignment);
+	uintptr _MappedSize = 0;
+	Span* _Span = nullptr;
+	if (Amount >= GenericPageMemory::MAPPED_THRESHOLD)
+	{
+		_Span = (Span*)GenericPageMemory::Map(_Offset + Amount, ThreadCacheMemory::SPAN_SIZE);
+		_MappedSize = _Offset + Amount;
+	}
+	if (_Span == nullptr)
+	{
+		_Span = (Span*)allocSystem(_Offset + Amount, ThreadCacheMemory::SPAN_SIZE);
+		_MappedSize = 0;
+	}
+	if (_Span == nullptr)
+	{
+		return nullptr;
+	}
+	_Span->SizeClass = ThreadCacheMemory::NUM_SIZE_CLASSES;
+	_Span->BlockSize = 0;
+	_Span->Owner = nullptr;
+	_Span->RemoteFree.store(nullptr, std::memory_order_relaxed);
+	_Span->NextPending = nullptr;
+	_Span->LargeSize = Amount;
+	_Span->MappedSize = _MappedSize;
+	return (uint8*)_Span + _Offset;
+}
+
+/** Resizes a large block without moving its contents through a copy, or returns nullptr. */
+static void* reallocLarge(Span* InSpan, void* Ptr, uintptr Amount, uint32 Alignment)
+{
+	uintptr _Offset = (uintptr)((uint8*)Ptr - (uint8*)InSpan);
+	if (Amount <= ThreadCacheMemory::MAX_SMALL_SIZE || _Offset != getLargeOffset(Alignment))
+	{
+		return nullptr;
+	}
+
+	if (InSpan->MappedSize != 0)
+	{
+		if (Amount < GenericPageMemory::MAPPED_THRESHOLD / 2)
+		{
+			return nullptr;
+		}
+		Span* _Span = (Span*)GenericPageMemory::Remap(InSpan, InSpan->MappedSize, _Offset + Amount,
+				ThreadCacheMemory::SPAN_SIZE);
+		if (_Span == nullptr)
+		{
+			return nullptr;
+		}
+		_Span->LargeSize = Amount;
+		_Span->MappedSize = _Offset + Amount;
+		return (uint8*)_Span + _Offset;
+	}
+
+	// Heap spans cannot be resized, but giving up a little of one is free
+	if (Amount <= InSpan->LargeSize && Amount >= InSpan->LargeSize / 2)
+	{
+		InSpan->LargeSize = Amount;
+		return Ptr;
+	}
+	return nullptr;
+}
+
+void* ThreadCacheMemory::Malloc(uintptr Amount, uint32 Alignment)
+{
+	if (Amount > MAX_SMALL_SIZE || Alignment > MAX_SMALL_ALIGNMENT)
+	{
+		assertCheck(Alignment < SPAN_SIZE);
+		return allocLarge(Amount, Alignment);
+	}
+
+	uint32 _SizeClass = getSizeClass(Amount, Alignment);
+	ThreadCache* _Cache = t_Cache;
+	if (_Cache == nullptr)
+	{
+		_Cache = createCache();
+	}
+	if (_Cache != nullptr)
+	{
+		return allocSmall(_Cache, _SizeClass);
+	}
+
+	std::lock_guard<std::mutex> _Lock(g_SharedCacheMutex);
+	return allocSmall(&g_SharedCache, _SizeClass);
+}
+
+void* ThreadCacheMemory::Free(void* Ptr)
+{
+	if (Ptr == nullptr)
+	{
+		return nullptr;
+	}
+
+	Span* _Span = getSpan(Ptr);
+	if (_Span->SizeClass == NUM_SIZE_CLASSES)
+	{
+		if (_Span->MappedSize != 0)
+		{
+			GenericPageMemory::Unmap(_Span, _Span->MappedSize);
+		}
+		else
+		{
+			freeSystem(_Span);
+		}
+		return nullptr;
+	}
+
+	ThreadCache* _Owner = _Span->Owner;
+	if (_Owner == t_Cache)
+	{
+		SizeClassCache& _Class = _Owner->Classes[_Span->SizeClass];
+		*(void**)Ptr = _Class.FreeList;
+		_Class.FreeList = Ptr;
+		return nullptr;
+	}
+
+	void* _Head = _Span->RemoteFree.load(std::memory_order_relaxed);
+	do
+	{
+		*(void**)Ptr = _Head;
+	}
+	while (!_Span->RemoteFree.compare_exchange_weak(_Head, Ptr,
+			std::memory_order_release, std::memory_order_relaxed));
+
+	// Only the free that makes the list non-empty queues the span, so it is
+	// never in the owner's pending list twice.
+	if (_Head == nullptr)
+	{
+		Span* _Pending = _Owner->PendingSpans.load(std::memory_order_relaxed);
+		do
+		{
+			_Span->NextPending = _Pending;
+		}
+		while (!_Owner->PendingSpans.compare_exchange_weak(_Pending, _Span,
+				std::memory_order_release, std::memory_order_relaxed));
+	}
+	return nullptr;
+}
+
+void* ThreadCacheMemory::Realloc(void* Ptr, uintptr Amount, uint32 Alignment)
+{
+	if (Ptr == nullptr)
+	{
+		return Malloc(Amount, Alignment);
+	}
+
+	if (Amount == 0)
+	{
+		Free(Ptr);
+		return nullptr;
+	}
+
+	Span* _Span = getSpan(Ptr);
+	if (_Span->SizeClass == NUM_SIZE_CLASSES)
+	{
+		void* _Resized = reallocLarge(_Span, Ptr, Amount, Alignment);
+		if (_Resized != nullptr)
+		{
+			return _Resized;
+		}
+	}
+	else if (Alignment <= MAX_SMALL_ALIGNMENT && Amount <= MAX_SMALL_SIZE
+			&& getSizeClass(Amount, Alignment) == _Span->SizeClass)
+	{
+		return Ptr;
+	}
+
+	void* _Result = Malloc(Amount, Alignment);
+	if (_Result != nullptr)
+	{
+		Memcpy(_Result, Ptr, Math::Min(GetAllocSize(Ptr), Amount));
+		Free(Ptr);
+	}
+	return _Result;
+}
+
+uintptr ThreadCacheMemory::GetAllocSize(void* Ptr)
+{
+	Span* _Span = getSpan(Ptr);
+	return _Span->SizeClass == NUM_SIZE_CLASSES ? _Span->LargeSize : _Span->BlockSize;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "GenericMemory.h"
+#include "Math/Math.h"
+
+/*
+ *	Size class allocator in the style of tcmalloc/mimalloc. Requests up to
+ *	MAX_SMALL_SIZE bytes are rounded up to one of NUM_SIZE_CLASSES classes
+ *	and carved out of SPAN_SIZE spans, each span holding a single class and
+ *	belonging to a single thread. Every thread allocates from, and frees into,
+ *	its own spans without locking or atomics.
+ *
+ *	A block freed by a thread other than the span's owner is pushed onto a
+ *	lock-free list in the span, which the owner collects once its own free
+ *	list for that class runs dry. The caches of exited threads are handed to
+ *	the next thread that starts allocating.
+ *
+ *	Spans are aligned to SPAN_SIZE, so a block finds its span, and with it its
+ *	size, by masking its address. Bigger or more aligned requests get a span of
+ *	their own straight from the system, which is released again on Free;
+ *	from GenericPageMemory::MAPPED_THRESHOLD up they are mapped pages that
+ *	Realloc resizes without copying.
+ *	Small spans are kept for reuse and never returned to the system.
+ **/
+struct ThreadCacheMemory : public GenericMemory
+{
+	enum
+	{
+		SPAN_SIZE = 64 * 1024,
+		/** Span header, blocks start right after it. */
+		SPAN_HEADER_SIZE = 64,
+		MAX_SMALL_SIZE = 8192,
+		/** Alignments above 16 up to this are served from the classes whose size is a multiple of them. */
+		MAX_SMALL_ALIGNMENT = SPAN_HEADER_SIZE,
+		NUM_SIZE_CLASSES = 32
+	};
+
+	static void* Malloc(uintptr Amount, uint32 Alignment);
+	static void* Realloc(void* Ptr, uintptr Amount, uint32 Alignment);
+	static void* Free(void* Ptr);
+	/** Usable size of the block, which for small blocks is the size of their class. */
+	static uintptr GetAllocSize(void* Ptr);
+
+	/*
+	 *	Classes step by 16 bytes up to 128, then by a quarter of the power of
+	 *	two below them, which keeps rounding waste under 25%.
+	 **/
+	static FORCEINLINE uint32 GetSizeClass(uintptr Amount);
+	static FORCEINLINE uint32 GetSizeClassSize(uint32 SizeClass);
+};
+
+FORCEINLINE uint32 ThreadCacheMemory::GetSizeClass(uintptr Amount)
+{
+	assertCheck(Amount <= MAX_SMALL_SIZE);
+	if (Amount <= 128)
+	{
+		return Amount == 0 ? 0 : (uint32)(Amount - 1) / 16;
+	}
+	uint32 _Log2 = Math::FloorLog2((uint32)(Amount - 1));
+	return 8 + (_Log2 - 7) * 4 + (uint32)((Amount - 1 - ((uintptr)1 << _Log2)) >> (_Log2 - 2));
+}
+
+FORCEINLINE uint32 ThreadCacheMemory::GetSizeClassSize(uint32 SizeClass)
+{
+	assertCheck(SizeClass < NUM_SIZE_CLASSES);
+	if (SizeClass < 8)
+	{
+		return (SizeClass + 1) * 16;
+	}
+	uint32 _Base = 128u << ((SizeClass - 8) / 4);
+	return _Base + ((SizeClass - 8) % 4 + 1) * (_Base / 4);
+}
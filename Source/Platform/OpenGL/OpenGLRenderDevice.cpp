@@ -1,19 +1,55 @@
 #include "OpenGLRenderDevice.h"
 #include "EngineCore/EngineUtils.h"
 #include "DataTypes/MArray.h"
+#include "EngineCore/LinearArena.h"
+#include "EngineCore/MemoryTracker.h"
 #include <SDL2/SDL.h>
 #include <GL/glew.h>
 
-static bool addShader(GLuint shaderProgram, const String& text, GLenum type,
+static void buildShaderText(ScratchString& output, const String& version,
+		const char* stageDefine, const String& shaderText);
+static bool addShader(GLuint shaderProgram, const ScratchString& text, GLenum type,
 		Array<GLuint>* shaders);
-static void addAllAttributes(GLuint program, const String& vertexShaderText, uint32 version);
+static void addAllAttributes(GLuint program, uint32 version);
 static bool checkShaderError(GLuint shader, int flag,
 		bool isProgram, const String& errorMessage);
 static void addShaderUniforms(GLuint shaderProgram, const String& shaderText,
-		Map<String, GLint>& uniformMap, Map<String, GLint>& samplerMap);
+		Map<StringId, GLint>& uniformMap, Map<StringId, GLint>& samplerMap);
 
 bool OpenGLRenderDevice::isInitialized = false;
 
+bool OpenGLRenderDevice::DrawParams::operator==(const DrawParams& Other) const
+{
+	return PrimitiveType == Other.PrimitiveType
+		&& FaceCulling == Other.FaceCulling
+		&& DepthFunc == Other.DepthFunc
+		&& ShouldWriteDepth == Other.ShouldWriteDepth
+		&& UseStencilTest == Other.UseStencilTest
+		&& StencilFunc == Other.StencilFunc
+		&& StencilTestMask == Other.StencilTestMask
+		&& StencilWriteMask == Other.StencilWriteMask
+		&& StencilComparisonVal == Other.StencilComparisonVal
+		&& StencilFail == Other.StencilFail
+		&& StencilPassButDepthFail == Other.StencilPassButDepthFail
+		&& StencilPass == Other.StencilPass
+		&& UseScissorTest == Other.UseScissorTest
+		&& ScissorStartX == Other.ScissorStartX
+		&& ScissorStartY == Other.ScissorStartY
+		&& ScissorWidth == Other.ScissorWidth
+		&& ScissorHeight == Other.ScissorHeight
+		&& SourceBlend == Other.SourceBlend
+		&& DestinationBlend == Other.DestinationBlend;
+}
+
+const char* OpenGLRenderDevice::GetStateChangeName(enum StateChange Change)
+{
+	static const char* names[NUM_STATE_CHANGES] = {
+		"fbo", "viewport", "shader", "vao", "blend", "scissor", "cull", "depth", "stencil"
+	};
+	assertCheck(Change < NUM_STATE_CHANGES);
+	return names[Change];
+}
+
 bool OpenGLRenderDevice::GlobalInit()
 {
 	if(isInitialized) {
@@ -47,6 +83,8 @@ bool OpenGLRenderDevice::GlobalInit()
 
 OpenGLRenderDevice::OpenGLRenderDevice(Window& window) :
 	shaderVersion(""), version(0),
+	windowWidth(0),
+	windowHeight(0),
 	boundFBO(0),
 	viewportFBO(0),
 	boundVAO(0),
@@ -65,8 +103,18 @@ OpenGLRenderDevice::OpenGLRenderDevice(Window& window) :
 	blendingEnabled(false),
 	shouldWriteDepth(false),
 	stencilTestEnabled(false),
-	scissorTestEnabled(false)
+	scissorTestEnabled(false),
+	gpuTimersSupported(false),
+	gpuTimerFrame(0),
+	gpuTimerDepth(0),
+	lastGPUFrameTime(0.0),
+	gpuClockSyncNs(0),
+	gpuClockSyncTicks(0),
+	gpuTimeline(nullptr)
 {
+	Memory::memset(&frameStats, 0, sizeof(frameStats));
+	Memory::memset(&lastFrameStats, 0, sizeof(lastFrameStats));
+
 	context = SDL_GL_CreateContext(window.getWindowHandle());
 	glewExperimental = GL_TRUE;
 	GLenum res = glewInit();
@@ -75,26 +123,53 @@ OpenGLRenderDevice::OpenGLRenderDevice(Window& window) :
 		throw std::runtime_error("Render device could not be initialized");
 	}
 
-	struct FBOData fboWindowData;
-	fboWindowData.Width = window.getWidth();
-	fboWindowData.Height = window.getHeight();
-	fboMap[0] = fboWindowData;
+	windowWidth = window.getWidth();
+	windowHeight = window.getHeight();
 
 	glEnable(GL_DEPTH_TEST);
 	glDepthFunc(DRAW_FUNC_ALWAYS);
 	glDepthMask(GL_FALSE);
 //	glEnable(GL_FRAMEBUFFER_SRGB);
 	glFrontFace(GL_CW);
+
+	initGPUTimers();
 }
 
 OpenGLRenderDevice::~OpenGLRenderDevice()
 {
+	uint32 numLeaked = GetNumVertexArrays() + GetNumRenderTargets() + GetNumShaderPrograms();
+	if(numLeaked != 0) {
+		DEBUG_LOG(LOG_TYPE_RENDERER, LOG_WARNING,
+				"Releasing %u vertex arrays, %u render targets and %u shader programs still alive at shutdown",
+				GetNumVertexArrays(), GetNumRenderTargets(), GetNumShaderPrograms());
+	}
+	for(uint32 i = 0; i < GetNumVertexArrays(); i++) {
+		destroyVertexArray(i);
+	}
+	for(uint32 i = 0; i < GetNumRenderTargets(); i++) {
+		destroyRenderTarget(i);
+	}
+	for(uint32 i = 0; i < GetNumShaderPrograms(); i++) {
+		destroyShaderProgram(i);
+	}
+
+	if(gpuTimersSupported) {
+		for(uint32 i = 0; i < GPU_TIMER_FRAMES; i++) {
+			glDeleteQueries(2 * MAX_GPU_TIMERS_PER_FRAME, gpuTimerFrames[i].queries);
+		}
+	}
 	SDL_GL_DeleteContext(context);
 }
 
-void OpenGLRenderDevice::clear(uint32 fbo, bool shouldClearColor, bool shouldClearDepth,
+void OpenGLRenderDevice::clear(RenderTargetHandle target, bool shouldClearColor, bool shouldClearDepth,
 		bool shouldClearStencil, const Color& color, uint32 stencil)
 {
+	uint32 fbo;
+	int32 width, height;
+	if(!findRenderTarget(target, fbo, width, height)) {
+		return;
+	}
+	frameStats.Clears++;
 	setFBO(fbo);
 	uint32 flags = 0;
 	if(shouldClearColor) {
@@ -132,23 +207,36 @@ void OpenGLRenderDevice::clear(uint32 fbo, bool shouldClearColor, bool shouldCle
  * + Otherwise, perform an instanced draw call for the number of desired
  * instances
  */
-void OpenGLRenderDevice::draw(uint32 fbo, uint32 shader, uint32 vao,
-		const DrawParams& drawParams,
+void OpenGLRenderDevice::draw(RenderTargetHandle target, ShaderProgramHandle shader,
+		VertexArrayHandle vertexArray, const DrawParams& drawParams,
 		uint32 numInstances, uint32 numElements)
 {
 	if(numInstances == 0) {
 		return;
 	}
+	uint32 fbo;
+	int32 width, height;
+	uint32 shaderIndex = shaderPrograms.handles.GetDenseIndex(shader);
+	uint32 vertexArrayIndex = vertexArrays.handles.GetDenseIndex(vertexArray);
+	if(!findRenderTarget(target, fbo, width, height)
+			|| shaderIndex == HandlePool<ShaderProgramTag>::INVALID_INDEX
+			|| vertexArrayIndex == HandlePool<VertexArrayTag>::INVALID_INDEX) {
+		return;
+	}
+	frameStats.DrawCalls++;
+	frameStats.Instances += numInstances;
+	frameStats.Indices += (uint64)numElements * numInstances;
+
 	setFBO(fbo);
-	setViewport(fbo);
+	setViewport(fbo, width, height);
 	setBlending(drawParams.SourceBlend, drawParams.DestinationBlend);
 	setScissorTest(drawParams.UseScissorTest,
 			drawParams.ScissorStartX, drawParams.ScissorStartY,
 			drawParams.ScissorWidth, drawParams.ScissorHeight);
 	setFaceCulling(drawParams.FaceCulling);
 	setDepthTest(drawParams.ShouldWriteDepth, drawParams.DepthFunc);
-	setShader(shader);
-	setVAO(vao);
+	setShader(shaderPrograms.programs[shaderIndex]);
+	setVAO(vertexArrays.vaos[vertexArrayIndex]);
 
 	if(numInstances == 1) {
 		glDrawElements(drawParams.PrimitiveType, (GLsizei)numElements, GL_UNSIGNED_INT, 0);
@@ -158,9 +246,172 @@ void OpenGLRenderDevice::draw(uint32 fbo, uint32 shader, uint32 vao,
 	}
 }
 
+void OpenGLRenderDevice::EndStatsFrame()
+{
+	lastFrameStats = frameStats;
+	Memory::memset(&frameStats, 0, sizeof(frameStats));
+}
+
+void OpenGLRenderDevice::LogLastFrameStats() const
+{
+	const DeviceStats& stats = lastFrameStats;
+	DEBUG_LOG(LOG_TYPE_RENDERER, LOG_INFO,
+			"%u draws, %llu instances, %llu indices, %u clears",
+			stats.DrawCalls, (unsigned long long)stats.Instances,
+			(unsigned long long)stats.Indices, stats.Clears);
+	DEBUG_LOG(LOG_TYPE_RENDERER, LOG_INFO,
+			"uploaded %llu vertex bytes (%u reallocations), %llu uniform bytes, created %llu texture bytes",
+			(unsigned long long)stats.VertexBufferBytesUploaded, stats.VertexBufferReallocations,
+			(unsigned long long)stats.UniformBufferBytesUploaded,
+			(unsigned long long)stats.TextureBytesCreated);
+
+	String stateChanges;
+	for(uint32 i = 0; i < NUM_STATE_CHANGES; i++) {
+		stateChanges += " " + String(GetStateChangeName((enum StateChange)i)) + " "
+			+ FString::toString(stats.StateChangesApplied[i]) + "/"
+			+ FString::toString(stats.StateChangesApplied[i] + stats.StateChangesElided[i]);
+	}
+	DEBUG_LOG(LOG_TYPE_RENDERER, LOG_INFO, "state changes applied/requested:%s",
+			stateChanges.c_str());
+	if(gpuTimersSupported) {
+		DEBUG_LOG(LOG_TYPE_RENDERER, LOG_INFO, "gpu frame: %.3f ms", lastGPUFrameTime);
+	}
+	DEBUG_LOG(LOG_TYPE_RENDERER, LOG_INFO,
+			"live: %u vertex arrays (%llu bytes), %u render targets, %u shader programs",
+			GetNumVertexArrays(), (unsigned long long)GetVertexArrayBytes(),
+			GetNumRenderTargets(), GetNumShaderPrograms());
+}
+
+uint64 OpenGLRenderDevice::GetVertexArrayBytes() const
+{
+	uint64 bytes = 0;
+	for(uint32 i = 0; i < GetNumVertexArrays(); i++) {
+		const uintptr* bufferSizes = vertexArrays.bufferSizes[i];
+		for(uint32 j = 0; j < vertexArrays.numBuffers[i]; j++) {
+			bytes += bufferSizes[j];
+		}
+	}
+	return bytes;
+}
+
+void OpenGLRenderDevice::initGPUTimers()
+{
+	for(uint32 i = 0; i < GPU_TIMER_FRAMES; i++) {
+		gpuTimerFrames[i].numTimers = 0;
+		gpuTimerFrames[i].lastEndQuery = 0;
+	}
+
+	// Timestamp queries are core from 3.3; Mesa, llvmpipe included, exposes
+	// them on the 3.2 context through ARB_timer_query.
+	gpuTimersSupported = GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+	if(!gpuTimersSupported) {
+		DEBUG_LOG(LOG_TYPE_RENDERER, LOG_WARNING,
+				"Timer queries are not supported, GPU times will not be profiled");
+		return;
+	}
+
+	for(uint32 i = 0; i < GPU_TIMER_FRAMES; i++) {
+		glGenQueries(2 * MAX_GPU_TIMERS_PER_FRAME, gpuTimerFrames[i].queries);
+	}
+	gpuTimeline = Profiler::RegisterTimeline("GPU");
+	syncGPUClock();
+}
+
+void OpenGLRenderDevice::syncGPUClock()
+{
+	glGetInteger64v(GL_TIMESTAMP, &gpuClockSyncNs);
+	gpuClockSyncTicks = Time::getTicks();
+}
+
+uint32 OpenGLRenderDevice::BeginGPUTimer(const char* Name)
+{
+	GPUTimerFrame& frame = gpuTimerFrames[gpuTimerFrame];
+	if(!gpuTimersSupported || frame.numTimers == MAX_GPU_TIMERS_PER_FRAME) {
+		return INVALID_GPU_TIMER;
+	}
+
+	uint32 timer = frame.numTimers++;
+	frame.names[timer] = Name;
+	frame.depths[timer] = gpuTimerDepth++;
+	glQueryCounter(frame.queries[2 * timer], GL_TIMESTAMP);
+	return timer;
+}
+
+void OpenGLRenderDevice::EndGPUTimer(uint32 Timer)
+{
+	if(Timer == INVALID_GPU_TIMER) {
+		return;
+	}
+	GPUTimerFrame& frame = gpuTimerFrames[gpuTimerFrame];
+	assertCheck(Timer < frame.numTimers);
+	gpuTimerDepth--;
+	frame.lastEndQuery = frame.queries[2 * Timer + 1];
+	glQueryCounter(frame.lastEndQuery, GL_TIMESTAMP);
+}
+
+void OpenGLRenderDevice::EndGPUTimerFrame()
+{
+	if(!gpuTimersSupported) {
+		return;
+	}
+	assertCheck(gpuTimerDepth == 0);
+
+	// The GPU finishes frames in order, so stop at the first one still in flight
+	gpuTimerFrame = (gpuTimerFrame + 1) % GPU_TIMER_FRAMES;
+	syncGPUClock();
+	for(uint32 i = 0; i < GPU_TIMER_FRAMES; i++) {
+		GPUTimerFrame& frame = gpuTimerFrames[(gpuTimerFrame + i) % GPU_TIMER_FRAMES];
+		if(frame.numTimers == 0) {
+			continue;
+		}
+		if(!readGPUTimerFrame(frame)) {
+			break;
+		}
+		frame.numTimers = 0;
+	}
+
+	GPUTimerFrame& nextFrame = gpuTimerFrames[gpuTimerFrame];
+	if(nextFrame.numTimers != 0) {
+		DEBUG_LOG(LOG_TYPE_RENDERER, LOG_WARNING,
+				"GPU is more than %d frames behind, dropping its timers", (int32)GPU_TIMER_FRAMES);
+		nextFrame.numTimers = 0;
+	}
+}
+
+bool OpenGLRenderDevice::readGPUTimerFrame(GPUTimerFrame& frame)
+{
+	// Queries complete in the order they were issued, so the last one being
+	// available means all of them are.
+	GLint available = 0;
+	glGetQueryObjectiv(frame.lastEndQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+	if(!available) {
+		return false;
+	}
+
+	const double ticksPerNs = Time::getTicksPerSecond() / 1000000000.0;
+	GLuint64 frameStart = ~(GLuint64)0;
+	GLuint64 frameEnd = 0;
+	for(uint32 i = 0; i < frame.numTimers; i++) {
+		GLuint64 start;
+		GLuint64 end;
+		glGetQueryObjectui64v(frame.queries[2 * i], GL_QUERY_RESULT, &start);
+		glGetQueryObjectui64v(frame.queries[2 * i + 1], GL_QUERY_RESULT, &end);
+		frameStart = start < frameStart ? start : frameStart;
+		frameEnd = end > frameEnd ? end : frameEnd;
+
+		uint64 startTicks = gpuClockSyncTicks
+			+ (int64)((double)((GLint64)start - gpuClockSyncNs) * ticksPerNs);
+		uint64 endTicks = gpuClockSyncTicks
+			+ (int64)((double)((GLint64)end - gpuClockSyncNs) * ticksPerNs);
+		Profiler::RecordEvent(gpuTimeline, frame.names[i], startTicks, endTicks, frame.depths[i]);
+	}
+	lastGPUFrameTime = (double)(frameEnd - frameStart) / 1000000.0;
+	return true;
+}
+
 void OpenGLRenderDevice::setFBO(uint32 fbo)
 {
-	if(fbo == boundFBO) {
+	if(!countStateChange(STATE_FBO, fbo != boundFBO)) {
 		return;
 	}
 //	if(fbo == 0) {
@@ -172,18 +423,37 @@ void OpenGLRenderDevice::setFBO(uint32 fbo)
 	boundFBO = fbo;
 }
 
-void OpenGLRenderDevice::setViewport(uint32 fbo)
+void OpenGLRenderDevice::setViewport(uint32 fbo, int32 width, int32 height)
 {
-	if(fbo == viewportFBO) {
+	if(!countStateChange(STATE_VIEWPORT, fbo != viewportFBO)) {
 		return;
 	}
-	glViewport(0, 0, fboMap[fbo].Width, fboMap[fbo].Height);
+	glViewport(0, 0, width, height);
 	viewportFBO = fbo;
 }
 
+bool OpenGLRenderDevice::findRenderTarget(RenderTargetHandle target, uint32& fbo,
+		int32& width, int32& height) const
+{
+	if(!target.IsValid()) {
+		fbo = 0;
+		width = windowWidth;
+		height = windowHeight;
+		return true;
+	}
+	uint32 index = renderTargets.handles.GetDenseIndex(target);
+	if(index == HandlePool<RenderTargetTag>::INVALID_INDEX) {
+		return false;
+	}
+	fbo = renderTargets.fbos[index];
+	width = renderTargets.widths[index];
+	height = renderTargets.heights[index];
+	return true;
+}
+
 void OpenGLRenderDevice::setShader(uint32 shader)
 {
-	if(shader == boundShader) {
+	if(!countStateChange(STATE_SHADER, shader != boundShader)) {
 		return;
 	}
 	glUseProgram(shader);
@@ -192,7 +462,7 @@ void OpenGLRenderDevice::setShader(uint32 shader)
 
 void OpenGLRenderDevice::setVAO(uint32 vao)
 {
-	if(vao == boundVAO) {
+	if(!countStateChange(STATE_VAO, vao != boundVAO)) {
 		return;
 	}
 	glBindVertexArray(vao);
@@ -201,7 +471,7 @@ void OpenGLRenderDevice::setVAO(uint32 vao)
 
 void OpenGLRenderDevice::setBlending(enum BlendFunc sourceBlend, enum BlendFunc destBlend)
 {
-	if(sourceBlend == currentSourceBlend && destBlend == currentDestBlend) {
+	if(!countStateChange(STATE_BLEND, sourceBlend != currentSourceBlend || destBlend != currentDestBlend)) {
 		return;
 	} else if(sourceBlend == BLEND_FUNC_NONE || destBlend == BLEND_FUNC_NONE) {
 		glDisable(GL_BLEND);
@@ -220,6 +490,7 @@ void OpenGLRenderDevice::setBlending(enum BlendFunc sourceBlend, enum BlendFunc
 void OpenGLRenderDevice::setScissorTest(bool enable, uint32 startX, uint32 startY,
 			uint32 Width, uint32 Height)
 {
+	countStateChange(STATE_SCISSOR, enable || scissorTestEnabled);
 	if(!enable) {
 		if(!scissorTestEnabled) {
 			return;
@@ -238,7 +509,7 @@ void OpenGLRenderDevice::setScissorTest(bool enable, uint32 startX, uint32 start
 
 void OpenGLRenderDevice::setFaceCulling(enum FaceCulling cullingMode)
 {
-	if(cullingMode == currentFaceCulling) {
+	if(!countStateChange(STATE_FACE_CULLING, cullingMode != currentFaceCulling)) {
 		return;
 	}
 	
@@ -255,6 +526,7 @@ void OpenGLRenderDevice::setFaceCulling(enum FaceCulling cullingMode)
 
 void OpenGLRenderDevice::setDepthTest(bool shouldWrite, enum DrawFunc depthFunc)
 {
+	countStateChange(STATE_DEPTH, shouldWrite != shouldWriteDepth || depthFunc != currentDepthFunc);
 	if(shouldWrite != shouldWriteDepth) {
 		glDepthMask(shouldWrite ? GL_TRUE : GL_FALSE);
 		shouldWriteDepth = shouldWrite;
@@ -272,6 +544,11 @@ void OpenGLRenderDevice::setStencilTest(bool enable, enum DrawFunc stencilFunc,
 		enum StencilOp stencilFail, enum StencilOp stencilPassButDepthFail,
 		enum StencilOp stencilPass)
 {
+	countStateChange(STATE_STENCIL, enable != stencilTestEnabled || stencilFunc != currentStencilFunc
+			|| stencilTestMask != currentStencilTestMask || stencilComparisonVal != currentStencilComparisonVal
+			|| stencilFail != currentStencilFail || stencilPass != currentStencilPass
+			|| stencilPassButDepthFail != currentStencilPassButDepthFail
+			|| stencilWriteMask != currentStencilWriteMask);
 	if(enable != stencilTestEnabled) {
 		if(enable) {
 			glEnable(GL_STENCIL_TEST);
@@ -309,7 +586,7 @@ void OpenGLRenderDevice::setStencilWriteMask(uint32 mask)
 	currentStencilWriteMask = mask;
 }
 
-uint32 OpenGLRenderDevice::CreateRenderTarget(uint32 Texture, int32 Width, int32 Height, enum FramebufferAttachment Attachment, uint32 AttachmentNumber, uint32 MipLevel)
+OpenGLRenderDevice::RenderTargetHandle OpenGLRenderDevice::CreateRenderTarget(uint32 Texture, int32 Width, int32 Height, enum FramebufferAttachment Attachment, uint32 AttachmentNumber, uint32 MipLevel)
 {
 	uint32 FBO;
 	glGenFramebuffers(1, &FBO);
@@ -318,30 +595,39 @@ uint32 OpenGLRenderDevice::CreateRenderTarget(uint32 Texture, int32 Width, int32
 	GLenum attachmentTypeGL = Attachment + AttachmentNumber;
 	glFramebufferTexture2D(GL_FRAMEBUFFER, attachmentTypeGL, GL_TEXTURE_2D, Texture, MipLevel);
 
-	struct FBOData data;
-	data.Width = Width;
-	data.Height = Height;
-	fboMap[FBO] = data;
-
-	return FBO;
+	RenderTargetHandle Target = renderTargets.handles.Allocate();
+	renderTargets.fbos.push_back(FBO);
+	renderTargets.widths.push_back(Width);
+	renderTargets.heights.push_back(Height);
+	return Target;
 }
 
-uint32 OpenGLRenderDevice::ReleaseRenderTarget(uint32 fbo)
+OpenGLRenderDevice::RenderTargetHandle OpenGLRenderDevice::ReleaseRenderTarget(RenderTargetHandle Target)
 {
-	if (fbo == 0) { return 0; }
+	if (!Target.IsValid()) { return RenderTargetHandle(); }
 
-	Map<uint32, FBOData>::iterator it = fboMap.find(fbo);
-	if(it == fboMap.end()) {
-		return 0;
+	uint32 index = renderTargets.handles.GetDenseIndex(Target);
+	if(index == HandlePool<RenderTargetTag>::INVALID_INDEX) {
+		return RenderTargetHandle();
 	}
 
+	destroyRenderTarget(index);
+	renderTargets.handles.Free(Target, renderTargets.fbos, renderTargets.widths, renderTargets.heights);
+	return RenderTargetHandle();
+}
+
+void OpenGLRenderDevice::destroyRenderTarget(uint32 index)
+{
+	GLuint fbo = renderTargets.fbos[index];
+	if(boundFBO == fbo) {
+		setFBO(0);
+	}
 	glDeleteFramebuffers(1, &fbo);
-	fboMap.erase(it);
-	return 0;
 }
 
-uint32 OpenGLRenderDevice::CreateVertexArray(const float** VertexData, const uint32* VertexElementSizes, uint32 NumVertexComponents, uint32 NumInstanceComponents, uint32 NumVertices, const uint32* Indices, uint32 NumIndices, enum BufferUsage Usage)
+OpenGLRenderDevice::VertexArrayHandle OpenGLRenderDevice::CreateVertexArray(const float** VertexData, const uint32* VertexElementSizes, uint32 NumVertexComponents, uint32 NumInstanceComponents, uint32 NumVertices, const uint32* Indices, uint32 NumIndices, enum BufferUsage Usage, const enum ElementFormat* VertexElementFormats)
 {
+	MEMORY_TAG_SCOPE(MEMORY_TAG_RENDERER);
 	unsigned int numBuffers = NumVertexComponents + NumInstanceComponents + 1;
 
 	GLuint VAO;
@@ -370,6 +656,13 @@ uint32 OpenGLRenderDevice::CreateVertexArray(const float** VertexData, const uin
 		glBufferData(GL_ARRAY_BUFFER, dataSize, bufferData, attribUsage);
 		bufferSizes[i] = dataSize;
 
+		if (VertexElementFormats != nullptr && VertexElementFormats[i] == ELEMENT_FORMAT_COMPACT_TRANSFORM)
+		{
+			assertCheck(_ElementSize == 8);
+			_Attribute = setCompactTransformAttributes(_Attribute, inInstancedMode);
+			continue;
+		}
+
 		// Because OpenGL doesn't support attributes with more than 4
 		// elements, each set of 4 elements gets its own attribute.
 		uint32 elementSizeDiv = _ElementSize/4;
@@ -402,63 +695,93 @@ uint32 OpenGLRenderDevice::CreateVertexArray(const float** VertexData, const uin
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indicesSize, Indices, Usage);
 	bufferSizes[numBuffers-1] = indicesSize;
 
-	struct VertexArray vaoData;
-	vaoData.buffers = buffers;
-	vaoData.bufferSizes = bufferSizes;
-	vaoData.numBuffers = numBuffers;
-	vaoData.numElements = NumIndices;
-	vaoData.usage = Usage;
-	vaoData.instanceComponentsStartIndex = NumVertexComponents;
-	vaoMap[VAO] = vaoData;
-	return VAO;
+	VertexArrayHandle VertexArray = vertexArrays.handles.Allocate();
+	vertexArrays.vaos.push_back(VAO);
+	vertexArrays.buffers.push_back(buffers);
+	vertexArrays.bufferSizes.push_back(bufferSizes);
+	vertexArrays.numBuffers.push_back(numBuffers);
+	vertexArrays.instanceComponentsStartIndex.push_back(NumVertexComponents);
+	vertexArrays.usages.push_back(Usage);
+	return VertexArray;
+}
+
+uint32 OpenGLRenderDevice::setCompactTransformAttributes(uint32 firstAttribute, bool instanced)
+{
+	static const GLsizei STRIDE = 32;
+	glEnableVertexAttribArray(firstAttribute);
+	glVertexAttribPointer(firstAttribute, 4, GL_FLOAT, GL_FALSE, STRIDE, (const GLvoid*)0);
+	glEnableVertexAttribArray(firstAttribute + 1);
+	glVertexAttribPointer(firstAttribute + 1, 4, GL_SHORT, GL_TRUE, STRIDE, (const GLvoid*)16);
+	glEnableVertexAttribArray(firstAttribute + 2);
+	glVertexAttribPointer(firstAttribute + 2, 2, GL_FLOAT, GL_FALSE, STRIDE, (const GLvoid*)24);
+	if (instanced)
+	{
+		for (uint32 i = 0; i < 3; i++)
+		{
+			glVertexAttribDivisor(firstAttribute + i, 1);
+		}
+	}
+	return firstAttribute + 3;
 }
 
-void OpenGLRenderDevice::UpdateVertexArrayBuffer(uint32 vao, uint32 bufferIndex,
+void OpenGLRenderDevice::UpdateVertexArrayBuffer(VertexArrayHandle vertexArray, uint32 bufferIndex,
 			const void* data, uintptr dataSize)
 {
-	if(vao == 0) {
+	if(!vertexArray.IsValid()) {
 		return;
 	}
 
-	Map<uint32, VertexArray>::iterator it = vaoMap.find(vao);
-	if(it == vaoMap.end()) {
+	uint32 index = vertexArrays.handles.GetDenseIndex(vertexArray);
+	if(index == HandlePool<VertexArrayTag>::INVALID_INDEX) {
 		return;
 	}
-	const struct VertexArray* vaoData = &it->second;
 	enum BufferUsage usage;
-	if(bufferIndex >= vaoData->instanceComponentsStartIndex) {
+	if(bufferIndex >= vertexArrays.instanceComponentsStartIndex[index]) {
 		usage = USAGE_DYNAMIC_DRAW;
 	} else {
-		usage = vaoData->usage;
+		usage = vertexArrays.usages[index];
 	}
 
-	setVAO(vao);
-	glBindBuffer(GL_ARRAY_BUFFER, vaoData->buffers[bufferIndex]);
-	if(vaoData->bufferSizes[bufferIndex] >= dataSize) {
+	uintptr* bufferSizes = vertexArrays.bufferSizes[index];
+	frameStats.VertexBufferBytesUploaded += dataSize;
+	setVAO(vertexArrays.vaos[index]);
+	glBindBuffer(GL_ARRAY_BUFFER, vertexArrays.buffers[index][bufferIndex]);
+	if(bufferSizes[bufferIndex] >= dataSize) {
 		glBufferSubData(GL_ARRAY_BUFFER, 0, dataSize, data);
 	} else {
+		frameStats.VertexBufferReallocations++;
 		glBufferData(GL_ARRAY_BUFFER, dataSize, data, usage);
-		vaoData->bufferSizes[bufferIndex] = dataSize;
+		bufferSizes[bufferIndex] = dataSize;
 	}	
 }
 
-uint32 OpenGLRenderDevice::ReleaseVertexArray(uint32 vao)
+OpenGLRenderDevice::VertexArrayHandle OpenGLRenderDevice::ReleaseVertexArray(VertexArrayHandle vertexArray)
 {
-	if(vao == 0) {
-		return 0;
+	if(!vertexArray.IsValid()) {
+		return VertexArrayHandle();
 	}
-	Map<uint32, VertexArray>::iterator it = vaoMap.find(vao);
-	if(it == vaoMap.end()) {
-		return 0;
+	uint32 index = vertexArrays.handles.GetDenseIndex(vertexArray);
+	if(index == HandlePool<VertexArrayTag>::INVALID_INDEX) {
+		return VertexArrayHandle();
+	}
+
+	destroyVertexArray(index);
+	vertexArrays.handles.Free(vertexArray, vertexArrays.vaos, vertexArrays.buffers,
+			vertexArrays.bufferSizes, vertexArrays.numBuffers,
+			vertexArrays.instanceComponentsStartIndex, vertexArrays.usages);
+	return VertexArrayHandle();
+}
+
+void OpenGLRenderDevice::destroyVertexArray(uint32 index)
+{
+	GLuint vao = vertexArrays.vaos[index];
+	if(boundVAO == vao) {
+		setVAO(0);
 	}
-	const struct VertexArray* vaoData = &it->second;
-	
 	glDeleteVertexArrays(1, &vao);
-	glDeleteBuffers(vaoData->numBuffers, vaoData->buffers);
-	delete[] vaoData->buffers;
-	delete[] vaoData->bufferSizes;
-	vaoMap.erase(it);
-	return 0;
+	glDeleteBuffers(vertexArrays.numBuffers[index], vertexArrays.buffers[index]);
+	delete[] vertexArrays.buffers[index];
+	delete[] vertexArrays.bufferSizes[index];
 }
 
 uint32 OpenGLRenderDevice::CreateSampler(enum SamplerFilter minFilter, enum SamplerFilter magFilter,
@@ -532,6 +855,17 @@ static GLint getOpenGLInternalFormat(enum OpenGLRenderDevice::PixelFormat format
 }
 
 
+/** Bytes per pixel of the GL_UNSIGNED_BYTE data passed to CreateTexture2D. */
+static uint32 getPixelFormatSize(enum OpenGLRenderDevice::PixelFormat format)
+{
+	switch(format) {
+	case OpenGLRenderDevice::FORMAT_R: return 1;
+	case OpenGLRenderDevice::FORMAT_RG: return 2;
+	case OpenGLRenderDevice::FORMAT_RGB: return 3;
+	default: return 4;
+	};
+}
+
 uint32 OpenGLRenderDevice::CreateTexture2D(int32 Width, int32 Height, const void* data,
 			enum PixelFormat dataFormat, enum PixelFormat internalFormatIn,
 			bool generateMipmaps, bool compress)
@@ -549,6 +883,7 @@ uint32 OpenGLRenderDevice::CreateTexture2D(int32 Width, int32 Height, const void
 	glTexParameteri(textureTarget, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 	glTexImage2D(textureTarget, 0, internalFormat, Width, Height, 0, format,
 			GL_UNSIGNED_BYTE, data);
+	frameStats.TextureBytesCreated += (uint64)Width * Height * getPixelFormatSize(dataFormat);
 
 	if(generateMipmaps) {
 		glGenerateMipmap(textureTarget);
@@ -595,6 +930,7 @@ uint32 OpenGLRenderDevice::CreateDDSTexture2D(uint32 Width, uint32 Height, const
 		unsigned int size = ((Width+3)/4)*((Height+3)/4)*blockSize;
 		glCompressedTexImage2D(GL_TEXTURE_2D, level, format, Width, Height, 
 			0, size, buffer + offset);
+		frameStats.TextureBytesCreated += size;
 
 		offset += size;
 		Width  /= 2;
@@ -625,6 +961,7 @@ uint32 OpenGLRenderDevice::createUniformBuffer(const void* data, uintptr dataSiz
 
 void OpenGLRenderDevice::updateUniformBuffer(uint32 buffer, const void* data, uintptr dataSize)
 {
+	frameStats.UniformBufferBytesUploaded += dataSize;
 	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
 	void* dest = glMapBuffer(GL_UNIFORM_BUFFER, GL_WRITE_ONLY);
 	Memory::memcpy(dest, data, dataSize);
@@ -640,92 +977,119 @@ uint32 OpenGLRenderDevice::releaseUniformBuffer(uint32 buffer)
 	return 0;
 }
 
-uint32 OpenGLRenderDevice::createShaderProgram(const String& shaderText)
+OpenGLRenderDevice::ShaderProgramHandle OpenGLRenderDevice::createShaderProgram(const String& shaderText)
 {
+	MEMORY_TAG_SCOPE(MEMORY_TAG_RENDERER);
 	GLuint shaderProgram = glCreateProgram();
 
 	if(shaderProgram == 0) 
 	{
 		DEBUG_LOG(LOG_TYPE_RENDERER, LOG_ERROR, "Error creating shader program\n");
-        return (uint32)-1;
+        return ShaderProgramHandle();
     }
 
+	ScratchScope scratch;
 	String version = getShaderVersion();
-	String vertexShaderText = "#version " + version +
-		"\n#define VS_BUILD\n#define GLSL_VERSION " + version + "\n" + shaderText;
-	String fragmentShaderText = "#version " + version +
-		"\n#define FS_BUILD\n#define GLSL_VERSION " + version + "\n" + shaderText;
+	ScratchString vertexShaderText;
+	ScratchString fragmentShaderText;
+	buildShaderText(vertexShaderText, version, "VS_BUILD", shaderText);
+	buildShaderText(fragmentShaderText, version, "FS_BUILD", shaderText);
 
-	ShaderProgram programData;
+	Array<uint32> shaders;
 	if(!addShader(shaderProgram, vertexShaderText, GL_VERTEX_SHADER,
-				&programData.shaders)) {
-		return (uint32)-1; 
+				&shaders)) {
+		return ShaderProgramHandle();
 	}
 	if(!addShader(shaderProgram, fragmentShaderText, GL_FRAGMENT_SHADER,
-				&programData.shaders)) {
-		return (uint32)-1;
+				&shaders)) {
+		return ShaderProgramHandle();
 	}
 	
 	glLinkProgram(shaderProgram);
 	if(checkShaderError(shaderProgram, GL_LINK_STATUS,
 				true, "Error linking shader program")) {
-		return (uint32)-1;
+		return ShaderProgramHandle();
 	}
 
     glValidateProgram(shaderProgram);
 	if(checkShaderError(shaderProgram, GL_VALIDATE_STATUS,
 				true, "Invalid shader program")) {
-		return (uint32)-1;
+		return ShaderProgramHandle();
 	}
 
-	addAllAttributes(shaderProgram, vertexShaderText, getVersion());
-	addShaderUniforms(shaderProgram, shaderText, programData.uniformMap,
-			programData.samplerMap);
-
-	shaderProgramMap[shaderProgram] = programData;
-	return shaderProgram;
+	addAllAttributes(shaderProgram, getVersion());
+	Map<StringId, int32> uniformMap;
+	Map<StringId, int32> samplerMap;
+	addShaderUniforms(shaderProgram, shaderText, uniformMap, samplerMap);
+
+	ShaderProgramHandle shader = shaderPrograms.handles.Allocate();
+	shaderPrograms.programs.push_back(shaderProgram);
+	shaderPrograms.shaders.push_back(std::move(shaders));
+	shaderPrograms.uniformMaps.push_back(std::move(uniformMap));
+	shaderPrograms.samplerMaps.push_back(std::move(samplerMap));
+	return shader;
 }
 
-void OpenGLRenderDevice::setShaderUniformBuffer(uint32 shader, const String& uniformBufferName,
+void OpenGLRenderDevice::setShaderUniformBuffer(ShaderProgramHandle shader, StringId uniformBufferName,
 			uint32 buffer)
 {
-	setShader(shader);
-	glBindBufferBase(GL_UNIFORM_BUFFER, 
-			shaderProgramMap[shader].uniformMap[uniformBufferName],
-			buffer);
+	uint32 index = shaderPrograms.handles.GetDenseIndex(shader);
+	if(index == HandlePool<ShaderProgramTag>::INVALID_INDEX) {
+		return;
+	}
+	GLuint program = shaderPrograms.programs[index];
+	setShader(program);
+	// Each block gets the binding point matching its index, so programs with
+	// more than one block don't all read from binding 0.
+	GLuint blockIndex = shaderPrograms.uniformMaps[index][uniformBufferName];
+	glUniformBlockBinding(program, blockIndex, blockIndex);
+	glBindBufferBase(GL_UNIFORM_BUFFER, blockIndex, buffer);
 }
 
-void OpenGLRenderDevice::setShaderSampler(uint32 shader, const String& samplerName,
+void OpenGLRenderDevice::setShaderSampler(ShaderProgramHandle shader, StringId samplerName,
 		uint32 texture, uint32 sampler, uint32 unit)
 {
-	setShader(shader);
+	uint32 index = shaderPrograms.handles.GetDenseIndex(shader);
+	if(index == HandlePool<ShaderProgramTag>::INVALID_INDEX) {
+		return;
+	}
+	setShader(shaderPrograms.programs[index]);
 	glActiveTexture(GL_TEXTURE0 + unit);
 	glBindTexture(GL_TEXTURE_2D, texture);
 	glBindSampler(unit, sampler);
-	glUniform1i(shaderProgramMap[shader].samplerMap[samplerName], unit);
+	glUniform1i(shaderPrograms.samplerMaps[index][samplerName], unit);
 }
 
 
-uint32 OpenGLRenderDevice::releaseShaderProgram(uint32 shader)
+OpenGLRenderDevice::ShaderProgramHandle OpenGLRenderDevice::releaseShaderProgram(ShaderProgramHandle shader)
 {
-	if(shader == 0) {
-		return 0;
+	if(!shader.IsValid()) {
+		return ShaderProgramHandle();
 	}
-	Map<uint32, ShaderProgram>::iterator programIt = shaderProgramMap.find(shader);
-	if(programIt == shaderProgramMap.end()) {
-		return 0;
+	uint32 index = shaderPrograms.handles.GetDenseIndex(shader);
+	if(index == HandlePool<ShaderProgramTag>::INVALID_INDEX) {
+		return ShaderProgramHandle();
 	}
-	const struct ShaderProgram* shaderProgram = &programIt->second; 
 
-	for(Array<uint32>::const_iterator it = shaderProgram->shaders.begin();
-			it != shaderProgram->shaders.end(); ++it) 
+	destroyShaderProgram(index);
+	shaderPrograms.handles.Free(shader, shaderPrograms.programs, shaderPrograms.shaders,
+			shaderPrograms.uniformMaps, shaderPrograms.samplerMaps);
+	return ShaderProgramHandle();
+}
+
+void OpenGLRenderDevice::destroyShaderProgram(uint32 index)
+{
+	GLuint program = shaderPrograms.programs[index];
+	if(boundShader == program) {
+		setShader(0);
+	}
+	const Array<uint32>& shaders = shaderPrograms.shaders[index];
+	for(Array<uint32>::const_iterator it = shaders.begin(); it != shaders.end(); ++it) 
 	{
-		glDetachShader(shader, *it);
+		glDetachShader(program, *it);
 		glDeleteShader(*it);
 	}
-	glDeleteProgram(shader);
-	shaderProgramMap.erase(programIt);
-	return 0;
+	glDeleteProgram(program);
 }
 uint32 OpenGLRenderDevice::getVersion()
 {
@@ -781,7 +1145,16 @@ String OpenGLRenderDevice::getShaderVersion()
 	return shaderVersion;
 }
 
-static bool addShader(GLuint shaderProgram, const String& text, GLenum type,
+static void buildShaderText(ScratchString& output, const String& version,
+		const char* stageDefine, const String& shaderText)
+{
+	output.reserve(shaderText.size() + 64);
+	output.append("#version ").append(version.c_str()).append("\n#define ")
+		.append(stageDefine).append("\n#define GLSL_VERSION ").append(version.c_str())
+		.append("\n").append(shaderText.data(), shaderText.size());
+}
+
+static bool addShader(GLuint shaderProgram, const ScratchString& text, GLenum type,
 		Array<GLuint>* shaders)
 {
 	GLuint shader = glCreateShader(type);
@@ -842,7 +1215,7 @@ static bool checkShaderError(GLuint shader, int flag,
 	return false;
 }
 
-static void addAllAttributes(GLuint program, const String& vertexShaderText, uint32 version)
+static void addAllAttributes(GLuint program, uint32 version)
 {
 	if(version >= 320) {
 		// Layout is enabled. Return.
@@ -860,7 +1233,8 @@ static void addAllAttributes(GLuint program, const String& vertexShaderText, uin
 
 //	DEBUG_LOG_TEMP2("Adding attributes!");
 //	DEBUG_LOG_TEMP("%i %i", numActiveAttribs, maxAttribNameLength);
-	Array<GLchar> nameData(maxAttribNameLength);
+	ScratchScope scratch;
+	ScratchArray<GLchar> nameData(maxAttribNameLength);
 	for(GLint attrib = 0; attrib < numActiveAttribs; ++attrib) {
 		GLint arraySize = 0;
 		GLenum type = 0;
@@ -875,8 +1249,9 @@ static void addAllAttributes(GLuint program, const String& vertexShaderText, uin
 }
 
 static void addShaderUniforms(GLuint shaderProgram, const String& shaderText,
-		Map<String, GLint>& uniformMap, Map<String, GLint>& samplerMap)
+		Map<StringId, GLint>& uniformMap, Map<StringId, GLint>& samplerMap)
 {
+	ScratchScope scratch;
 	GLint numBlocks;
 	glGetProgramiv(shaderProgram, GL_ACTIVE_UNIFORM_BLOCKS, &numBlocks);
 	for(int32 block = 0; block < numBlocks; ++block) {
@@ -884,9 +1259,9 @@ static void addShaderUniforms(GLuint shaderProgram, const String& shaderText,
 		glGetActiveUniformBlockiv(shaderProgram, block,
 				GL_UNIFORM_BLOCK_NAME_LENGTH, &nameLen);
 
-		Array<GLchar> name(nameLen);
+		ScratchArray<GLchar> name(nameLen);
 		glGetActiveUniformBlockName(shaderProgram, block, nameLen, NULL, &name[0]);
-		String uniformBlockName((char*)&name[0], nameLen-1);
+		StringId uniformBlockName = StringId::Intern((char*)&name[0], nameLen-1);
 		uniformMap[uniformBlockName] = glGetUniformBlockIndex(shaderProgram, &name[0]);
 	}
 
@@ -894,7 +1269,7 @@ static void addShaderUniforms(GLuint shaderProgram, const String& shaderText,
 	glGetProgramiv(shaderProgram, GL_ACTIVE_UNIFORMS, &numBlocks);
 	
 	// Would get GL_ACTIVE_UNIFORM_MAX_LENGTH, but buggy on some drivers
-	Array<GLchar> uniformName(256); 
+	ScratchArray<GLchar> uniformName(256);
 	for(int32 uniform = 0; uniform < numUniforms; ++uniform) {
 		GLint arraySize = 0;
 		GLenum type = 0;
@@ -906,7 +1281,7 @@ static void addShaderUniforms(GLuint shaderProgram, const String& shaderText,
 					"Non-sampler2d uniforms currently unsupported!");
 			continue;
 		}
-		String name((char*)&uniformName[0], actualLength - 1);
+		StringId name = StringId::Intern((char*)&uniformName[0], actualLength - 1);
 		samplerMap[name] = glGetUniformLocation(shaderProgram, (char*)&uniformName[0]);
 	}
 }
@@ -3,6 +3,9 @@
 #include "EngineCore/Window.h"
 #include "Math/Color.h"
 #include "DataTypes/MMap.h"
+#include "DataTypes/MStringId.h"
+#include "EngineCore/Profiler.h"
+#include "EngineCore/HandlePool.h"
 #include <SDL2/SDL.h>
 #include <GL/glew.h>
 
@@ -40,6 +43,22 @@ public:
 		USAGE_DYNAMIC_READ = GL_DYNAMIC_READ,
 	};
 
+	/*
+	 *	Layout of a vertex array element. Element sizes are always given in
+	 *	4 byte units, whatever the format.
+	 **/
+	enum ElementFormat
+	{
+		/** Tightly packed floats, split into vec4 attributes. */
+		ELEMENT_FORMAT_FLOAT,
+		/*
+		 *	32 byte packed transform, size 8: float4(translation, scale.x),
+		 *	snorm16x4 rotation quaternion, float2(scale.y, scale.z).
+		 *	Bound as three attributes; see Rendering/InstanceData.h.
+		 **/
+		ELEMENT_FORMAT_COMPACT_TRANSFORM,
+	};
+
 	enum SamplerFilter
 	{
 		FILTER_NEAREST = GL_NEAREST,
@@ -154,19 +173,73 @@ public:
 		uint32 ScissorHeight = 0;
 		enum BlendFunc SourceBlend = BLEND_FUNC_NONE;
 		enum BlendFunc DestinationBlend = BLEND_FUNC_NONE;
+
+		bool operator==(const DrawParams& Other) const;
+		bool operator!=(const DrawParams& Other) const { return !(*this == Other); }
+		bool UsesBlending() const { return SourceBlend != BLEND_FUNC_NONE && DestinationBlend != BLEND_FUNC_NONE; }
 	};
 	
+	enum StateChange
+	{
+		STATE_FBO,
+		STATE_VIEWPORT,
+		STATE_SHADER,
+		STATE_VAO,
+		STATE_BLEND,
+		STATE_SCISSOR,
+		STATE_FACE_CULLING,
+		STATE_DEPTH,
+		STATE_STENCIL,
+		NUM_STATE_CHANGES
+	};
+
+	/*
+	 *	Work the device did over one frame. A state change is applied when it
+	 *	reached GL, and elided when the cached state already matched.
+	 **/
+	struct DeviceStats
+	{
+		uint32 DrawCalls;
+		uint32 Clears;
+		uint64 Instances;
+		uint64 Indices;
+		uint32 StateChangesApplied[NUM_STATE_CHANGES];
+		uint32 StateChangesElided[NUM_STATE_CHANGES];
+		uint64 VertexBufferBytesUploaded;
+		/** Uploads that outgrew their buffer and had to reallocate it. */
+		uint32 VertexBufferReallocations;
+		uint64 UniformBufferBytesUploaded;
+		uint64 TextureBytesCreated;
+	};
+
+	enum
+	{
+		/** Frames a GPU timer may take to finish before its results are dropped. */
+		GPU_TIMER_FRAMES = 4,
+		MAX_GPU_TIMERS_PER_FRAME = 64,
+		INVALID_GPU_TIMER = 0xFFFFFFFF
+	};
+
+	struct VertexArrayTag {};
+	struct RenderTargetTag {};
+	struct ShaderProgramTag {};
+	typedef Handle<VertexArrayTag> VertexArrayHandle;
+	/** The invalid handle stands for the window's framebuffer. */
+	typedef Handle<RenderTargetTag> RenderTargetHandle;
+	typedef Handle<ShaderProgramTag> ShaderProgramHandle;
+
 	static bool GlobalInit();
+	static const char* GetStateChangeName(enum StateChange Change);
 
 	OpenGLRenderDevice(Window& Window);
 	virtual ~OpenGLRenderDevice();
 
-	uint32 CreateRenderTarget(uint32 Texture, int32 Width, int32 Height, enum FramebufferAttachment Attachment, uint32 attachmentNumber, uint32 MipLevel);
-	uint32 ReleaseRenderTarget(uint32 FBO);
+	RenderTargetHandle CreateRenderTarget(uint32 Texture, int32 Width, int32 Height, enum FramebufferAttachment Attachment, uint32 attachmentNumber, uint32 MipLevel);
+	RenderTargetHandle ReleaseRenderTarget(RenderTargetHandle Target);
 
-	uint32 CreateVertexArray(const float** VertexData, const uint32* VertexElementSizes, uint32 NumVertexComponents, uint32 NumInstanceComponents, uint32 NumVertices, const uint32* Indices, uint32 NumIndices, enum BufferUsage Usage);
-	void UpdateVertexArrayBuffer(uint32 VAO, uint32 BufferIndex, const void* Data, uintptr DataSize);
-	uint32 ReleaseVertexArray(uint32 VAO);
+	VertexArrayHandle CreateVertexArray(const float** VertexData, const uint32* VertexElementSizes, uint32 NumVertexComponents, uint32 NumInstanceComponents, uint32 NumVertices, const uint32* Indices, uint32 NumIndices, enum BufferUsage Usage, const enum ElementFormat* VertexElementFormats = nullptr);
+	void UpdateVertexArrayBuffer(VertexArrayHandle VertexArray, uint32 BufferIndex, const void* Data, uintptr DataSize);
+	VertexArrayHandle ReleaseVertexArray(VertexArrayHandle VertexArray);
 
 	uint32 CreateSampler(enum SamplerFilter MinFilter, enum SamplerFilter MagFilter, enum SamplerWrapMode WrapU, enum SamplerWrapMode WrapV, float Anisotropy);
 	uint32 ReleaseSampler(uint32 Sampler);
@@ -179,49 +252,108 @@ public:
 	void updateUniformBuffer(uint32 Buffer, const void* data, uintptr dataSize);
 	uint32 releaseUniformBuffer(uint32 Buffer);
 
-	uint32 createShaderProgram(const String& shaderText);
-	void setShaderUniformBuffer(uint32 shader, const String& uniformBufferName,
+	/** Returns an invalid handle if the program fails to compile or link. */
+	ShaderProgramHandle createShaderProgram(const String& shaderText);
+	void setShaderUniformBuffer(ShaderProgramHandle shader, StringId uniformBufferName,
 			uint32 Buffer);
-	void setShaderSampler(uint32 shader, const String& samplerName,
+	void setShaderSampler(ShaderProgramHandle shader, StringId samplerName,
 		uint32 Texture, uint32 sampler, uint32 unit);
-	uint32 releaseShaderProgram(uint32 shader);
+	ShaderProgramHandle releaseShaderProgram(ShaderProgramHandle shader);
 
-	void clear(uint32 fbo,
+	void clear(RenderTargetHandle target,
 			bool shouldClearColor, bool shouldClearDepth, bool shouldClearStencil,
 			const Color& color, uint32 stencil);
-	void draw(uint32 fbo, uint32 shader, uint32 vao, const DrawParams& drawParams,
-			uint32 numInstances, uint32 numElements);
+	void draw(RenderTargetHandle target, ShaderProgramHandle shader, VertexArrayHandle vertexArray,
+			const DrawParams& drawParams, uint32 numInstances, uint32 numElements);
+
+	/** Counters of the frame in progress. */
+	inline const DeviceStats& GetFrameStats() const { return frameStats; }
+	/** Counters of the frame closed by the last EndStatsFrame. */
+	inline const DeviceStats& GetLastFrameStats() const { return lastFrameStats; }
+	/** Closes the frame's counters and starts new ones; call once per frame, after present. */
+	void EndStatsFrame();
+	/** Logs the last frame's counters along with live object counts. */
+	void LogLastFrameStats() const;
+
+	/*
+	 *	Starts timing the commands issued until the matching EndGPUTimer, as
+	 *	seen by the GPU. Timers nest. Name must be a string literal. Returns
+	 *	INVALID_GPU_TIMER, which EndGPUTimer ignores, when timer queries are
+	 *	unsupported or the frame ran out of timers.
+	 **/
+	uint32 BeginGPUTimer(const char* Name);
+	void EndGPUTimer(uint32 Timer);
+	/*
+	 *	Closes the frame's timers, and hands every earlier frame whose results
+	 *	are ready to the profiler on a "GPU" timeline. Never waits on the GPU:
+	 *	results arrive a few frames late. Call once per frame, after present
+	 *	and before Profiler::EndFrame.
+	 **/
+	void EndGPUTimerFrame();
+	/** Milliseconds from the first to the last timestamp of the newest frame read back. */
+	inline double GetLastGPUFrameTime() const { return lastGPUFrameTime; }
+	inline bool SupportsGPUTimers() const { return gpuTimersSupported; }
+
+	inline uint32 GetNumVertexArrays() const { return vertexArrays.handles.GetNum(); }
+	/** Does not count the window's framebuffer. */
+	inline uint32 GetNumRenderTargets() const { return renderTargets.handles.GetNum(); }
+	inline uint32 GetNumShaderPrograms() const { return shaderPrograms.handles.GetNum(); }
+	/** Bytes allocated for the buffers of every live vertex array. */
+	uint64 GetVertexArrayBytes() const;
 private:
-	struct VertexArray
+	/*
+	 *	Live objects of each kind, one Array per field, all indexed by the
+	 *	dense index their handle maps to.
+	 **/
+	struct VertexArrayPool
 	{
-		uint32* buffers;
-		uintptr* bufferSizes;
-		uint32  numBuffers;
-		uint32  numElements;
-		uint32  instanceComponentsStartIndex;
-		enum BufferUsage usage;
+		HandlePool<VertexArrayTag> handles;
+		Array<GLuint> vaos;
+		/** Buffer names, with the index buffer last. */
+		Array<uint32*> buffers;
+		Array<uintptr*> bufferSizes;
+		Array<uint32> numBuffers;
+		Array<uint32> instanceComponentsStartIndex;
+		Array<enum BufferUsage> usages;
 	};
 
-	struct ShaderProgram
+	struct RenderTargetPool
 	{
-		Array<uint32>      shaders;
-		Map<String, int32> uniformMap;
-		Map<String, int32> samplerMap;
+		HandlePool<RenderTargetTag> handles;
+		Array<GLuint> fbos;
+		Array<int32> widths;
+		Array<int32> heights;
 	};
 
-	struct FBOData
+	struct ShaderProgramPool
 	{
-		int32 Width;
-		int32 Height;
+		HandlePool<ShaderProgramTag> handles;
+		Array<GLuint> programs;
+		Array<Array<uint32> > shaders;
+		Array<Map<StringId, int32> > uniformMaps;
+		Array<Map<StringId, int32> > samplerMaps;
+	};
+
+	/** Each timer owns the begin and end timestamp queries at 2*i and 2*i + 1. */
+	struct GPUTimerFrame
+	{
+		GLuint queries[2 * MAX_GPU_TIMERS_PER_FRAME];
+		const char* names[MAX_GPU_TIMERS_PER_FRAME];
+		uint32 depths[MAX_GPU_TIMERS_PER_FRAME];
+		uint32 numTimers;
+		/** The end query issued last, which with nested timers is not the last timer's. */
+		GLuint lastEndQuery;
 	};
 
 	static bool isInitialized;
 	DeviceContext context;
 	String shaderVersion;
 	uint32 version;
-	Map<uint32, VertexArray> vaoMap;
-	Map<uint32, FBOData> fboMap;
-	Map<uint32, ShaderProgram> shaderProgramMap;
+	VertexArrayPool vertexArrays;
+	RenderTargetPool renderTargets;
+	ShaderProgramPool shaderPrograms;
+	int32 windowWidth;
+	int32 windowHeight;
 
 	uint32 boundFBO;
 	uint32 viewportFBO;
@@ -242,9 +374,27 @@ private:
 	bool shouldWriteDepth;
 	bool stencilTestEnabled;
 	bool scissorTestEnabled;
+	DeviceStats frameStats;
+	DeviceStats lastFrameStats;
+	bool gpuTimersSupported;
+	GPUTimerFrame gpuTimerFrames[GPU_TIMER_FRAMES];
+	/** Frame timers are being issued into; the ones after it are oldest first. */
+	uint32 gpuTimerFrame;
+	uint32 gpuTimerDepth;
+	double lastGPUFrameTime;
+	/** A GL_TIMESTAMP and Time::getTicks read together, to put GPU times on the CPU clock. */
+	GLint64 gpuClockSyncNs;
+	uint64 gpuClockSyncTicks;
+	Profiler::ThreadBuffer* gpuTimeline;
 	
+	inline bool countStateChange(enum StateChange change, bool applied);
 	void setFBO(uint32 fbo);
-	void setViewport(uint32 fbo);
+	void setViewport(uint32 fbo, int32 width, int32 height);
+	/** Looks up target's framebuffer and size, or returns false if target was released. */
+	bool findRenderTarget(RenderTargetHandle target, uint32& fbo, int32& width, int32& height) const;
+	void destroyVertexArray(uint32 index);
+	void destroyRenderTarget(uint32 index);
+	void destroyShaderProgram(uint32 index);
 	void setVAO(uint32 vao);
 	void setShader(uint32 shader);
 	void setFaceCulling(enum FaceCulling faceCulling);
@@ -256,8 +406,24 @@ private:
 	void setStencilWriteMask(uint32 mask);
 	void setScissorTest(bool enable, uint32 startX = 0, uint32 startY = 0,
 			uint32 Width = 0, uint32 Height = 0);
+	/** Binds the attributes of an ELEMENT_FORMAT_COMPACT_TRANSFORM element, returns the next free attribute. */
+	static uint32 setCompactTransformAttributes(uint32 firstAttribute, bool instanced);
+	void initGPUTimers();
+	void syncGPUClock();
+	/** Records a finished frame's timers, or returns false without waiting if the GPU is not done. */
+	bool readGPUTimerFrame(GPUTimerFrame& frame);
 
 	uint32 getVersion();
 	String getShaderVersion();
 	NULL_COPY_AND_ASSIGN(OpenGLRenderDevice)
 };
+
+inline bool OpenGLRenderDevice::countStateChange(enum StateChange change, bool applied)
+{
+	if(applied) {
+		frameStats.StateChangesApplied[change]++;
+	} else {
+		frameStats.StateChangesElided[change]++;
+	}
+	return applied;
+}
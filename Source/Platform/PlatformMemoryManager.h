@@ -1,4 +1,13 @@
 #pragma once
 
-#include "Generic/GenericMemory.h"
-typedef GenericMemory PlatformMemory;
+/*
+ *	Define PLATFORM_MEMORY_GENERIC to send every allocation straight to the
+ *	system allocator instead of the thread caching one.
+ **/
+#ifdef PLATFORM_MEMORY_GENERIC
+	#include "Generic/GenericMemory.h"
+	typedef GenericMemory PlatformMemory;
+#else
+	#include "Generic/ThreadCacheMemory.h"
+	typedef ThreadCacheMemory PlatformMemory;
+#endif
@@ -15,25 +15,29 @@
 #ifdef OS_WINDOWS
 	#include <Windows.h>
 	#include <iostream>
-	static double g_freq;
+	static uint64 g_freq;
 	static bool g_timerInitialized = false;
 #endif
 
 #ifdef OS_LINUX
-	#include <sys/time.h>
-	static const long NANOSECONDS_PER_SECOND = 1000000000L;
-#endif
-
-#ifdef OS_OTHER
-	#include <SDL2/SDL.h>
+	#include <errno.h>
 #endif
 
 #ifdef OS_OTHER_CPP11
 	#include <chrono>
-	static std::chrono::system_clock::time_point m_epoch = std::chrono::high_resolution_clock::now();
 #endif
 
-double SDLTiming::getTime()
+#include <atomic>
+#include <thread>
+
+/** Converts a count of a counter running at frequency ticks per second, without overflowing. */
+static FORCEINLINE uint64 countToNanoseconds(uint64 count, uint64 frequency)
+{
+	return (count / frequency) * SDLTiming::NANOSECONDS_PER_SECOND +
+		((count % frequency) * SDLTiming::NANOSECONDS_PER_SECOND) / frequency;
+}
+
+uint64 SDLTiming::getNanoseconds()
 {
 	#ifdef OS_WINDOWS
 		if(!g_timerInitialized)
@@ -42,7 +46,7 @@ double SDLTiming::getTime()
 			if(!QueryPerformanceFrequency(&li))
 				std::cerr << "QueryPerformanceFrequency failed in timer initialization"  << std::endl;
 			
-			g_freq = double(li.QuadPart);
+			g_freq = (uint64)li.QuadPart;
 			g_timerInitialized = true;
 		}
 	
@@ -50,25 +54,131 @@ double SDLTiming::getTime()
 		if(!QueryPerformanceCounter(&li))
 			std::cerr << "QueryPerformanceCounter failed in get time!" << std::endl;
 		
-		return double(li.QuadPart)/g_freq;
+		return countToNanoseconds((uint64)li.QuadPart, g_freq);
 	#endif
 
 	#ifdef OS_LINUX
 		timespec ts;
-		clock_gettime(CLOCK_REALTIME, &ts);
-		return (double)(((long) ts.tv_sec * NANOSECONDS_PER_SECOND) + ts.tv_nsec)/((double)(NANOSECONDS_PER_SECOND));
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (uint64)ts.tv_sec * NANOSECONDS_PER_SECOND + (uint64)ts.tv_nsec;
 	#endif
 
 	#ifdef OS_OTHER_CPP11
-		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - m_epoch).count() / 1000000000.0;
+		return (uint64)std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now().time_since_epoch()).count();
 	#endif
 
 	#ifdef OS_OTHER
-		return (double)SDL_GetTicks()/1000.0;
+		return countToNanoseconds(SDL_GetPerformanceCounter(), SDL_GetPerformanceFrequency());
 	#endif
 }
 
+double SDLTiming::getTime()
+{
+	return (double)getNanoseconds() / (double)NANOSECONDS_PER_SECOND;
+}
+
 void SDLTiming::sleep(uint32 milliseconds)
 {
 	SDL_Delay(milliseconds);
 }
+
+static const uint64 MIN_SLEEP_MARGIN = 50000;
+static const uint64 MAX_SLEEP_MARGIN = 2000000;
+/** 0 until the first sleepUntil measures how late the OS wakes up. */
+static std::atomic<uint64> g_sleepMargin(0);
+
+static FORCEINLINE uint64 clampSleepMargin(uint64 margin)
+{
+	return margin < MIN_SLEEP_MARGIN ? MIN_SLEEP_MARGIN : (margin > MAX_SLEEP_MARGIN ? MAX_SLEEP_MARGIN : margin);
+}
+
+/** Sleeps until roughly deadline, usually a little after it. */
+static void osSleepUntil(uint64 deadline)
+{
+	#ifdef OS_LINUX
+		timespec ts;
+		ts.tv_sec = (time_t)(deadline / SDLTiming::NANOSECONDS_PER_SECOND);
+		ts.tv_nsec = (long)(deadline % SDLTiming::NANOSECONDS_PER_SECOND);
+		while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {}
+	#else
+		uint64 now = SDLTiming::getNanoseconds();
+		if(deadline > now) {
+			SDL_Delay((uint32)((deadline - now) / 1000000));
+		}
+	#endif
+}
+
+/** Sleeps until deadline and returns how late it woke up. */
+static uint64 measureOversleep(uint64 deadline)
+{
+	osSleepUntil(deadline);
+	uint64 now = SDLTiming::getNanoseconds();
+	return now > deadline ? now - deadline : 0;
+}
+
+static uint64 calibrateSleepMargin()
+{
+	uint64 worst = 0;
+	for(uint32 i = 0; i < 8; i++) {
+		uint64 late = measureOversleep(SDLTiming::getNanoseconds() + 200000);
+		worst = late > worst ? late : worst;
+	}
+	return clampSleepMargin(worst + worst / 4);
+}
+
+uint64 SDLTiming::getSleepMargin()
+{
+	uint64 margin = g_sleepMargin.load(std::memory_order_relaxed);
+	if(margin == 0) {
+		margin = calibrateSleepMargin();
+		g_sleepMargin.store(margin, std::memory_order_relaxed);
+	}
+	return margin;
+}
+
+void SDLTiming::sleepUntil(uint64 deadline)
+{
+	uint64 margin = getSleepMargin();
+	uint64 now = getNanoseconds();
+	if(deadline > now + margin) {
+		uint64 wakeTime = deadline - margin;
+		uint64 late = measureOversleep(wakeTime);
+		// Grow the margin at once when the OS woke up too late for it, shrink it slowly otherwise
+		uint64 wanted = clampSleepMargin(late + late / 4);
+		margin = wanted > margin ? wanted : margin - (margin - wanted) / 32;
+		g_sleepMargin.store(margin, std::memory_order_relaxed);
+	}
+
+	while(getNanoseconds() < deadline) {
+	#if SIMD_CPU_ARCH != SIMD_CPU_ARCH_OTHER
+		_mm_pause();
+	#else
+		std::this_thread::yield();
+	#endif
+	}
+}
+
+#if SIMD_CPU_ARCH != SIMD_CPU_ARCH_OTHER
+static double measureTicksPerSecond()
+{
+	// Spin rather than sleep, the scheduler would make the window longer than asked
+	double startTime = SDLTiming::getTime();
+	uint64 startTicks = SDLTiming::getTicks();
+	double endTime;
+	do {
+		endTime = SDLTiming::getTime();
+	} while(endTime - startTime < 0.01);
+	return (double)(SDLTiming::getTicks() - startTicks)/(endTime - startTime);
+}
+#endif
+
+double SDLTiming::getTicksPerSecond()
+{
+#if SIMD_CPU_ARCH != SIMD_CPU_ARCH_OTHER
+	static const double ticksPerSecond = measureTicksPerSecond();
+	return ticksPerSecond;
+#else
+	return 1000000000.0;
+#endif
+}
@@ -3,10 +3,53 @@
 
 #include "EngineCore/EngineUtils.h"
 
+#if defined(COMPILER_MSVC)
+	#include <intrin.h>
+#elif SIMD_CPU_ARCH != SIMD_CPU_ARCH_OTHER
+	#include <x86intrin.h>
+#else
+	#include <chrono>
+#endif
+
 struct SDLTiming
 {
+	enum
+	{
+		NANOSECONDS_PER_SECOND = 1000000000
+	};
+
+	/** Seconds on the same monotonic clock as getNanoseconds. */
 	static double getTime();
+	/** Monotonic, from an unspecified start. Never jumps when the wall clock is adjusted. */
+	static uint64 getNanoseconds();
 	static void sleep(uint32 milliseconds);
+	/*
+	 *	Sleeps until getNanoseconds reaches deadline. The OS sleep ends early
+	 *	by a margin learned from how late it has been waking up, and the rest
+	 *	is spun, so this returns within microseconds of the deadline.
+	 **/
+	static void sleepUntil(uint64 deadline);
+	/** How long before a deadline sleepUntil stops sleeping and starts spinning. */
+	static uint64 getSleepMargin();
+
+	/*
+	 *	Cheapest available monotonic tick count, for profiling. This is the
+	 *	time stamp counter on x86, which assumes an invariant TSC (anything
+	 *	from the last decade), so convert with getTicksPerSecond.
+	 **/
+	static FORCEINLINE uint64 getTicks();
+	/** Measured once against getTime on first use, which takes a few milliseconds. */
+	static double getTicksPerSecond();
 };
 
+FORCEINLINE uint64 SDLTiming::getTicks()
+{
+#if SIMD_CPU_ARCH != SIMD_CPU_ARCH_OTHER
+	return __rdtsc();
+#else
+	return (uint64)std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
 #endif
@@ -170,6 +170,12 @@ public:
 		mat[2] = newScale*Make((xz2-yw2), (yz2+xw2), (1.0f-(xx2+yy2)), translation[2]);
 		mat[3] = Make(0.0f, 0.0f, 0.0f, 1.0f);
 	}
+
+	/** Transposes the 4x4 matrix whose rows are the four vectors, in place. */
+	static FORCEINLINE void Transpose4(SSEVector& row0, SSEVector& row1, SSEVector& row2, SSEVector& row3)
+	{
+		_MM_TRANSPOSE4_PS(row0.data, row1.data, row2.data, row3.data);
+	}
 	
 	static FORCEINLINE SSEVector Make(uint32 x, uint32 y, uint32 z, uint32 w)
 	{
@@ -279,10 +285,8 @@ public:
 	
 	FORCEINLINE SSEVector Abs() const
 	{
-		static const SSEVector sign_mask(
-			SSEVector::Make((uint32)0x7FFFFFFF, 0x7FFFFFFF, 0x7FFFFFFF, 0x7FFFFFFF));
 		SSEVector vec;
-		vec.data = _mm_and_ps(data, sign_mask.data);
+		vec.data = _mm_andnot_ps(_mm_set1_ps(-0.f), data);
 		return vec;
 	}
 
@@ -361,6 +365,13 @@ public:
 				Math::Pow((*this)[3], exp[3]));
 	}
 
+	FORCEINLINE SSEVector Sqrt() const
+	{
+		SSEVector vec;
+		vec.data = _mm_sqrt_ps(data);
+		return vec;
+	}
+
 	FORCEINLINE SSEVector rSqrt() const
 	{
 		const SSEVector ONE(SSEVector::Load1f(1.0f));
@@ -476,6 +487,12 @@ public:
 		return !_mm_movemask_ps(data);
 	}
 
+	/** Bit i is the sign bit of component i; for a comparison result, whether it held for component i. */
+	FORCEINLINE uint32 GetSignMask() const
+	{
+		return (uint32)_mm_movemask_ps(data);
+	}
+
 	FORCEINLINE SSEVector operator==(const SSEVector& other) const
 	{
 		SSEVector vec;
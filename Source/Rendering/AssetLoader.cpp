@@ -1,11 +1,16 @@
 #include "AssetLoader.h"
+#include "EngineCore/Profiler.h"
+#include "EngineCore/MemoryTracker.h"
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
 
-bool AssetLoader::LoadAsset(const String& fileName,	Array<IndexedModel>& models, Array<uint32>& modelMaterialIndices, Array<MaterialSpec>& materials)
+bool AssetLoader::LoadAsset(const String& fileName,	Array<IndexedModel>& models, Array<uint32>& modelMaterialIndices, Array<MaterialSpec>& materials,
+		enum InstanceData::Format InstanceFormat)
 {
+	PROFILE_SCOPE("AssetLoader::LoadAsset");
+	MEMORY_TAG_SCOPE(MEMORY_TAG_ASSETS);
 	Assimp::Importer importer;
 	const aiScene* scene = importer.ReadFile(fileName.c_str(), 
 											 aiProcess_Triangulate |
@@ -29,7 +34,19 @@ bool AssetLoader::LoadAsset(const String& fileName,	Array<IndexedModel>& models,
 		newModel.allocateElement(3); // Normals
 		newModel.allocateElement(3); // Tangents
 		newModel.setInstancedElementStartIndex(4); // Begin instanced data
-		newModel.allocateElement(16); // Transform matrix
+		switch(InstanceFormat) {
+		case InstanceData::FORMAT_AFFINE_MATRIX:
+			newModel.allocateElement(12); // Affine transform matrix
+			break;
+		case InstanceData::FORMAT_COMPACT_TRANSFORM:
+			newModel.allocateElement(8, RenderDevice::ELEMENT_FORMAT_COMPACT_TRANSFORM);
+			break;
+		default:
+			newModel.allocateElement(16); // Transform matrix
+			break;
+		}
+
+		newModel.reserve(model->mNumVertices, model->mNumFaces * 3);
 
 		const aiVector3D aiZeroVector(0.0f, 0.0f, 0.0f);
 		for(uint32 i = 0; i < model->mNumVertices; i++) {
@@ -52,7 +69,7 @@ bool AssetLoader::LoadAsset(const String& fileName,	Array<IndexedModel>& models,
 					face.mIndices[2]);
 		}
 
-		models.push_back(newModel);
+		models.push_back(std::move(newModel));
 	}
 
 	for(uint32 i = 0; i < scene->mNumMaterials; i++) {
@@ -65,7 +82,7 @@ bool AssetLoader::LoadAsset(const String& fileName,	Array<IndexedModel>& models,
 				material->GetTexture(aiTextureType_DIFFUSE, 0, &texturePath)
 				!= AI_SUCCESS) {
 			String str(texturePath.data);
-			spec.textureNames["diffuse"] = str;
+			spec.textureNames[STRING_ID("diffuse")] = str;
 		}
 		materials.push_back(spec);
 	}
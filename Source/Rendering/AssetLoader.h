@@ -2,8 +2,11 @@
 
 #include "IndexedModel.h"
 #include "Material.h"
+#include "InstanceData.h"
 
 namespace AssetLoader
 {
-	bool LoadAsset(const String& fileName, Array<IndexedModel>& models, Array<uint32>& modelMaterialIndices, Array<MaterialSpec>& materials);
+	/** InstanceFormat selects the per-instance element allocated for every model. */
+	bool LoadAsset(const String& fileName, Array<IndexedModel>& models, Array<uint32>& modelMaterialIndices, Array<MaterialSpec>& materials,
+			enum InstanceData::Format InstanceFormat = InstanceData::FORMAT_MATRIX);
 }
@@ -1,11 +1,15 @@
 #include "DDSTexture.h"
 #include "EngineCore/MemoryManager.h"
+#include "EngineCore/Profiler.h"
+#include "EngineCore/MemoryTracker.h"
 
 DDSTexture::~DDSTexture() {
 	cleanup();
 }
 
 bool DDSTexture::Load(const char* fileName) {
+	PROFILE_SCOPE("DDSTexture::Load");
+	MEMORY_TAG_SCOPE(MEMORY_TAG_ASSETS);
 	unsigned char header[124];
 	FILE* fp = fopen(fileName, "rb");
 	if (fp == NULL) {
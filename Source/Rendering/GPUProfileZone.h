@@ -0,0 +1,29 @@
+#pragma once
+
+#include "RenderDevice.h"
+#include "EngineCore/Profiler.h"
+
+#if MARS_PROFILING
+	/** Times the GPU work issued in the rest of the enclosing scope. Name must be a string literal. */
+	#define PROFILE_GPU_SCOPE(Device, Name) GPUProfileZone PROFILE_CONCAT(_GPUProfileZone, __LINE__)(Device, "" Name)
+#else
+	#define PROFILE_GPU_SCOPE(Device, Name)
+#endif
+
+class GPUProfileZone
+{
+public:
+	FORCEINLINE GPUProfileZone(RenderDevice& DeviceIn, const char* Name) :
+		Device(&DeviceIn),
+		Timer(DeviceIn.BeginGPUTimer(Name)) {}
+
+	FORCEINLINE ~GPUProfileZone()
+	{
+		Device->EndGPUTimer(Timer);
+	}
+private:
+	RenderDevice* Device;
+	uint32 Timer;
+
+	NULL_COPY_AND_ASSIGN(GPUProfileZone);
+};
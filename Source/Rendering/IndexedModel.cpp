@@ -1,59 +1,68 @@
 #include "IndexedModel.h"
+#include "EngineCore/LinearArena.h"
 
 void IndexedModel::addElement1f(uint32 elementIndex, float e0)
 {
 	assertCheck(elementIndex < elementSizes.size());
-	elements[elementIndex].push_back(e0);
+	float* dest = elements[elementIndex].PushBackUninitialized(1);
+	dest[0] = e0;
 }
 
 void IndexedModel::addElement2f(uint32 elementIndex, float e0, float e1)
 {
 	assertCheck(elementIndex < elementSizes.size());
-	elements[elementIndex].push_back(e0);
-	elements[elementIndex].push_back(e1);
+	float* dest = elements[elementIndex].PushBackUninitialized(2);
+	dest[0] = e0;
+	dest[1] = e1;
 }
 
 void IndexedModel::addElement3f(uint32 elementIndex, float e0, float e1, float e2)
 {
 	assertCheck(elementIndex < elementSizes.size());
-	elements[elementIndex].push_back(e0);
-	elements[elementIndex].push_back(e1);
-	elements[elementIndex].push_back(e2);
+	float* dest = elements[elementIndex].PushBackUninitialized(3);
+	dest[0] = e0;
+	dest[1] = e1;
+	dest[2] = e2;
 }
 
 void IndexedModel::addElement4f(uint32 elementIndex, float e0, float e1, float e2, float e3)
 {
 	assertCheck(elementIndex < elementSizes.size());
-	elements[elementIndex].push_back(e0);
-	elements[elementIndex].push_back(e1);
-	elements[elementIndex].push_back(e2);
-	elements[elementIndex].push_back(e3);
+	float* dest = elements[elementIndex].PushBackUninitialized(4);
+	dest[0] = e0;
+	dest[1] = e1;
+	dest[2] = e2;
+	dest[3] = e3;
 }
 
 void IndexedModel::addIndices1i(uint32 i0)
 {
-	indices.push_back(i0);
+	uint32* dest = indices.PushBackUninitialized(1);
+	dest[0] = i0;
 }
 
 void IndexedModel::addIndices2i(uint32 i0, uint32 i1)
 {
-	indices.push_back(i0);
-	indices.push_back(i1);
+	uint32* dest = indices.PushBackUninitialized(2);
+	dest[0] = i0;
+	dest[1] = i1;
 }
 
 void IndexedModel::addIndices3i(uint32 i0, uint32 i1, uint32 i2)
 {
-	indices.push_back(i0);
-	indices.push_back(i1);
-	indices.push_back(i2);
+	uint32* dest = indices.PushBackUninitialized(3);
+	dest[0] = i0;
+	dest[1] = i1;
+	dest[2] = i2;
 }
 
 void IndexedModel::addIndices4i(uint32 i0, uint32 i1, uint32 i2, uint32 i3)
 {
-	indices.push_back(i0);
-	indices.push_back(i1);
-	indices.push_back(i2);
-	indices.push_back(i3);
+	uint32* dest = indices.PushBackUninitialized(4);
+	dest[0] = i0;
+	dest[1] = i1;
+	dest[2] = i2;
+	dest[3] = i3;
 }
 
 uint32 IndexedModel::getNumIndices() const
@@ -61,12 +70,29 @@ uint32 IndexedModel::getNumIndices() const
 	return indices.size();
 }
 
-void IndexedModel::allocateElement(uint32 elementSize)
+uint32 IndexedModel::getInstancedElementStartIndex() const
+{
+	return instancedElementsStartIndex;
+}
+
+void IndexedModel::allocateElement(uint32 elementSize,
+		enum RenderDevice::ElementFormat format)
 {
 	elementSizes.push_back(elementSize);
+	elementFormats.push_back(format);
 	elements.push_back(Array<float>());
 }
 
+void IndexedModel::reserve(uint32 numVertices, uint32 numIndices)
+{
+	uint32 numVertexElements = instancedElementsStartIndex == ((uint32)-1) ?
+		(uint32)elementSizes.size() : instancedElementsStartIndex;
+	for(uint32 i = 0; i < numVertexElements; i++) {
+		elements[i].reserve(elements[i].size() + elementSizes[i] * numVertices);
+	}
+	indices.reserve(indices.size() + numIndices);
+}
+
 void IndexedModel::setInstancedElementStartIndex(uint32 elementIndex)
 {
 	instancedElementsStartIndex = elementIndex;
@@ -80,7 +106,7 @@ void IndexedModel::setInstancedElementStartIndex(uint32 elementIndex)
 //	elements.clear();
 //}
 
-uint32 IndexedModel::createVertexArray(RenderDevice& device,
+RenderDevice::VertexArrayHandle IndexedModel::createVertexArray(RenderDevice& device,
 		enum RenderDevice::BufferUsage usage) const
 {
 	uint32 numVertexComponents = elementSizes.size();
@@ -88,7 +114,9 @@ uint32 IndexedModel::createVertexArray(RenderDevice& device,
 		0 : (numVertexComponents - instancedElementsStartIndex);
 	numVertexComponents -= numInstanceComponents;
 
-	Array<const float*> vertexDataArray;
+	ScratchScope scratch;
+	ScratchArray<const float*> vertexDataArray;
+	vertexDataArray.reserve(numVertexComponents);
 	for(uint32 i = 0; i < numVertexComponents; i++) {
 		vertexDataArray.push_back(&(elements[i][0]));
 	}
@@ -101,5 +129,5 @@ uint32 IndexedModel::createVertexArray(RenderDevice& device,
 	
 	return device.CreateVertexArray(vertexData, vertexElementSizes,
 			numVertexComponents, numInstanceComponents, numVertices, &indices[0],
-			numIndices, usage);
+			numIndices, usage, &elementFormats[0]);
 }
@@ -7,11 +7,14 @@ class IndexedModel
 public:
 	IndexedModel() :
 		instancedElementsStartIndex((uint32)-1) {}
-	uint32 createVertexArray(RenderDevice& device,
+	RenderDevice::VertexArrayHandle createVertexArray(RenderDevice& device,
 			enum RenderDevice::BufferUsage usage) const;
 
-	void allocateElement(uint32 elementSize);
+	void allocateElement(uint32 elementSize,
+			enum RenderDevice::ElementFormat format = RenderDevice::ELEMENT_FORMAT_FLOAT);
 	void setInstancedElementStartIndex(uint32 elementIndex);
+	/** Makes room for numVertices more vertices and numIndices more indices. */
+	void reserve(uint32 numVertices, uint32 numIndices);
 
 	void addElement1f(uint32 elementIndex, float e0);
 	void addElement2f(uint32 elementIndex, float e0, float e1);
@@ -24,9 +27,11 @@ public:
 	void addIndices4i(uint32 i0, uint32 i1, uint32 i2, uint32 i3);
 
 	uint32 getNumIndices() const;
+	uint32 getInstancedElementStartIndex() const;
 private:
 	Array<uint32> indices;
 	Array<uint32> elementSizes;
+	Array<enum RenderDevice::ElementFormat> elementFormats;
 	Array<Array<float> > elements;
 	uint32 instancedElementsStartIndex;
 };
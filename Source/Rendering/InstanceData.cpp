@@ -0,0 +1,44 @@
+#include "InstanceData.h"
+
+static FORCEINLINE int16 quantizeSnorm16(float Val)
+{
+	Val = Math::Clamp(Val, -1.0f, 1.0f) * 32767.0f;
+	return (int16)(Val >= 0.0f ? Val + 0.5f : Val - 0.5f);
+}
+
+void InstanceData::PackCompactTransforms(CompactInstanceTransform* Dest,
+		const Transform* Transforms, uint32 NumTransforms)
+{
+	for (uint32 Index = 0; Index < NumTransforms; Index++)
+	{
+		const Transform& _Transform = Transforms[Index];
+		CompactInstanceTransform& _Packed = Dest[Index];
+		Vector _Scale = _Transform.GetScale().AsIntrinsic();
+
+		// Translation goes out in one store with scale.x folded into w
+		_Transform.GetTranslation().AsIntrinsic().Select(VectorConstants::MASK_W,
+				_Scale.Replicate(0)).Store4f(_Packed.TranslationScaleX);
+
+		float _Rotation[4];
+		_Transform.GetRotation().AsIntrinsic().Store4f(_Rotation);
+		_Packed.Rotation[0] = quantizeSnorm16(_Rotation[0]);
+		_Packed.Rotation[1] = quantizeSnorm16(_Rotation[1]);
+		_Packed.Rotation[2] = quantizeSnorm16(_Rotation[2]);
+		_Packed.Rotation[3] = quantizeSnorm16(_Rotation[3]);
+
+		_Packed.ScaleYZ[0] = _Scale[1];
+		_Packed.ScaleYZ[1] = _Scale[2];
+	}
+}
+
+Transform InstanceData::UnpackCompactTransform(const CompactInstanceTransform& Packed)
+{
+	static const float SNORM16_SCALE = 1.0f / 32767.0f;
+	Quaternion _Rotation(Packed.Rotation[0] * SNORM16_SCALE, Packed.Rotation[1] * SNORM16_SCALE,
+			Packed.Rotation[2] * SNORM16_SCALE, Packed.Rotation[3] * SNORM16_SCALE);
+
+	return Transform(
+			Spatial3D(Packed.TranslationScaleX[0], Packed.TranslationScaleX[1], Packed.TranslationScaleX[2]),
+			_Rotation.Normalized(),
+			Spatial3D(Packed.TranslationScaleX[3], Packed.ScaleYZ[0], Packed.ScaleYZ[1]));
+}
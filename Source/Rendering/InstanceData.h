@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Math/Transform.h"
+
+/*
+ *	Per-instance transform packed into 32 bytes, half the size of a Matrix.
+ *	Laid out as RenderDevice::ELEMENT_FORMAT_COMPACT_TRANSFORM expects; the
+ *	vertex shader rebuilds translation * rotation * scale from it, see
+ *	Resources/Shaders/compactInstanceShader.glsl.
+ *
+ *	Unlike the matrix path, only the model transform fits in here, so the
+ *	view projection has to come from a uniform.
+ **/
+struct CompactInstanceTransform
+{
+	float TranslationScaleX[4];
+	/** Normalized quaternion, x y z w, quantized to 1/32767. */
+	int16 Rotation[4];
+	float ScaleYZ[2];
+};
+
+namespace InstanceData
+{
+	/** Per-instance transform layouts a model can be loaded with. */
+	enum Format
+	{
+		/** Matrix, 64 bytes, usually with the view projection already applied. */
+		FORMAT_MATRIX,
+		/** AffineMatrix, 48 bytes, model transform only. */
+		FORMAT_AFFINE_MATRIX,
+		/** CompactInstanceTransform, 32 bytes, model transform only. */
+		FORMAT_COMPACT_TRANSFORM,
+	};
+
+	/** Packs NumTransforms transforms into Dest, which must hold as many elements. */
+	void PackCompactTransforms(CompactInstanceTransform* Dest,
+			const Transform* Transforms, uint32 NumTransforms);
+
+	Transform UnpackCompactTransform(const CompactInstanceTransform& Packed);
+}
@@ -1,13 +1,14 @@
 #pragma once
 
 #include "DataTypes/MMap.h"
+#include "DataTypes/MStringId.h"
 #include "Math/Cartesian.h"
 #include "Math/Matrix.h"
 
 struct MaterialSpec
 {
-	Map<String, String> textureNames;
-	Map<String, float> floats;
-	Map<String, Cartesian3D> vectors;
-	Map<String, Matrix> matrices;
+	Map<StringId, String> textureNames;
+	Map<StringId, float> floats;
+	Map<StringId, Cartesian3D> vectors;
+	Map<StringId, Matrix> matrices;
 };
@@ -0,0 +1,209 @@
+#include "RenderQueue.h"
+#include "EngineCore/Profiler.h"
+#include "EngineCore/MemoryTracker.h"
+#include <algorithm>
+
+bool SamplerSet::operator==(const SamplerSet& Other) const
+{
+	if (NumBindings != Other.NumBindings)
+	{
+		return false;
+	}
+
+	for (uint32 Index = 0; Index < NumBindings; Index++)
+	{
+		if (Textures[Index]->getId() != Other.Textures[Index]->getId()
+				|| Samplers[Index]->getId() != Other.Samplers[Index]->getId()
+				|| Names[Index] != Other.Names[Index])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool RenderQueue::DrawItemLess::operator()(const DrawItem& A, const DrawItem& B) const
+{
+	if (A.bBlended != B.bBlended)
+	{
+		return !A.bBlended;
+	}
+
+	// Blended draws are expected to arrive already sorted, so they keep submission order
+	if (A.bBlended)
+	{
+		return A.Sequence < B.Sequence;
+	}
+
+	if (A.ShaderId != B.ShaderId) { return A.ShaderId < B.ShaderId; }
+	if (A.VertexArrayId != B.VertexArrayId) { return A.VertexArrayId < B.VertexArrayId; }
+	if (A.SamplerSetIndex != B.SamplerSetIndex) { return A.SamplerSetIndex < B.SamplerSetIndex; }
+	if (A.DrawParamsIndex != B.DrawParamsIndex) { return A.DrawParamsIndex < B.DrawParamsIndex; }
+	return A.Sequence < B.Sequence;
+}
+
+void RenderQueue::Submit(Shader& InShader, VertexArray& InVertexArray,
+		const RenderDevice::DrawParams& DrawParams, const Matrix& InTransform,
+		const SamplerSet* Samplers)
+{
+	SubmitInstance(InShader, InVertexArray, DrawParams, &InTransform, sizeof(Matrix), Samplers);
+}
+
+void RenderQueue::Submit(Shader& InShader, VertexArray& InVertexArray,
+		const RenderDevice::DrawParams& DrawParams, const AffineMatrix& InTransform,
+		const SamplerSet* Samplers)
+{
+	SubmitInstance(InShader, InVertexArray, DrawParams, &InTransform, sizeof(AffineMatrix), Samplers);
+}
+
+void RenderQueue::Submit(Shader& InShader, VertexArray& InVertexArray,
+		const RenderDevice::DrawParams& DrawParams, const CompactInstanceTransform& InTransform,
+		const SamplerSet* Samplers)
+{
+	SubmitInstance(InShader, InVertexArray, DrawParams, &InTransform, sizeof(CompactInstanceTransform), Samplers);
+}
+
+void RenderQueue::SubmitInstance(Shader& InShader, VertexArray& InVertexArray,
+		const RenderDevice::DrawParams& DrawParams, const void* Instance,
+		uint32 InstanceSize, const SamplerSet* Samplers)
+{
+	DrawItem _Item;
+	_Item.ItemShader = &InShader;
+	_Item.ItemVertexArray = &InVertexArray;
+	_Item.Samplers = Samplers;
+	_Item.ShaderId = InShader.getId().GetValue();
+	_Item.VertexArrayId = InVertexArray.getId().GetValue();
+	_Item.DrawParamsIndex = FindOrAddDrawParams(DrawParams);
+	_Item.SamplerSetIndex = FindOrAddSamplerSet(Samplers);
+	_Item.Sequence = (uint32)Items.size();
+	_Item.InstanceOffset = (uint32)InstanceBytes.size();
+	_Item.InstanceSize = InstanceSize;
+	_Item.bBlended = DrawParams.UsesBlending();
+
+	Items.push_back(_Item);
+	Memory::memcpy(InstanceBytes.PushBackUninitialized(InstanceSize), Instance, InstanceSize);
+}
+
+void RenderQueue::Flush()
+{
+	PROFILE_SCOPE("RenderQueue::Flush");
+	MEMORY_TAG_SCOPE(MEMORY_TAG_RENDERER);
+	NumDrawsIssued = 0;
+	if (Items.empty())
+	{
+		return;
+	}
+
+	std::sort(Items.begin(), Items.end(), DrawItemLess());
+
+	const DrawItem* _Items = &Items[0];
+	uint32 _BatchStart = 0;
+	for (uint32 Index = 1; Index <= Items.size(); Index++)
+	{
+		if (Index == Items.size() || !IsSameBatch(_Items[_BatchStart], _Items[Index]))
+		{
+			DrawBatch(_Items + _BatchStart, _Items + Index);
+			_BatchStart = Index;
+		}
+	}
+
+	Items.clear();
+	InstanceBytes.clear();
+	UniqueDrawParams.clear();
+	UniqueSamplerSets.clear();
+}
+
+// A frame rarely uses more than a handful of distinct draw states, so a linear
+// scan is cheaper than hashing and keeps the batch key down to small integers.
+uint32 RenderQueue::FindOrAddDrawParams(const RenderDevice::DrawParams& DrawParams)
+{
+	for (uint32 Index = (uint32)UniqueDrawParams.size(); Index > 0; Index--)
+	{
+		if (UniqueDrawParams[Index - 1] == DrawParams)
+		{
+			return Index - 1;
+		}
+	}
+	UniqueDrawParams.push_back(DrawParams);
+	return (uint32)UniqueDrawParams.size() - 1;
+}
+
+uint32 RenderQueue::FindOrAddSamplerSet(const SamplerSet* Samplers)
+{
+	if (Samplers == nullptr)
+	{
+		return (uint32)-1;
+	}
+
+	for (uint32 Index = (uint32)UniqueSamplerSets.size(); Index > 0; Index--)
+	{
+		const SamplerSet* _Other = UniqueSamplerSets[Index - 1];
+		if (_Other == Samplers || *_Other == *Samplers)
+		{
+			return Index - 1;
+		}
+	}
+	UniqueSamplerSets.push_back(Samplers);
+	return (uint32)UniqueSamplerSets.size() - 1;
+}
+
+bool RenderQueue::IsSameBatch(const DrawItem& A, const DrawItem& B)
+{
+	return A.ShaderId == B.ShaderId
+		&& A.VertexArrayId == B.VertexArrayId
+		&& A.SamplerSetIndex == B.SamplerSetIndex
+		&& A.DrawParamsIndex == B.DrawParamsIndex
+		&& A.bBlended == B.bBlended;
+}
+
+void RenderQueue::DrawBatch(const DrawItem* Begin, const DrawItem* End)
+{
+	Shader& _Shader = *Begin->ItemShader;
+	VertexArray& _VertexArray = *Begin->ItemVertexArray;
+	const RenderDevice::DrawParams& _DrawParams = UniqueDrawParams[Begin->DrawParamsIndex];
+	uint32 _NumInstances = (uint32)(End - Begin);
+
+	if (Begin->Samplers != nullptr)
+	{
+		const SamplerSet& _Samplers = *Begin->Samplers;
+		for (uint32 Unit = 0; Unit < _Samplers.NumBindings; Unit++)
+		{
+			_Shader.setSampler(_Samplers.Names[Unit], *_Samplers.Textures[Unit],
+					*_Samplers.Samplers[Unit], Unit);
+		}
+	}
+
+	if (!_VertexArray.hasInstanceBuffer())
+	{
+		// Nothing to gather transforms into; the shader only gets gl_InstanceID.
+		PROFILE_SCOPE("Draw");
+		Context->draw(_Shader, _VertexArray, _DrawParams, _NumInstances);
+		NumDrawsIssued++;
+		return;
+	}
+
+	// Items are sorted by submission order within a batch, so when nothing
+	// else was submitted in between their transforms are already contiguous.
+	uint32 _InstanceSize = Begin->InstanceSize;
+	const uint8* _InstanceData = &InstanceBytes[Begin->InstanceOffset];
+	if ((End - 1)->InstanceOffset - Begin->InstanceOffset != (_NumInstances - 1) * _InstanceSize)
+	{
+		BatchInstanceBytes.resize(_NumInstances * _InstanceSize);
+		uint8* _Dest = &BatchInstanceBytes[0];
+		for (const DrawItem* Item = Begin; Item != End; ++Item, _Dest += _InstanceSize)
+		{
+			assertCheck(Item->InstanceSize == _InstanceSize);
+			Memory::memcpy(_Dest, &InstanceBytes[Item->InstanceOffset], _InstanceSize);
+		}
+		_InstanceData = &BatchInstanceBytes[0];
+	}
+
+	{
+		PROFILE_SCOPE("Upload");
+		_VertexArray.updateBuffer(_VertexArray.getInstanceBufferIndex(), _InstanceData,
+				_NumInstances * _InstanceSize);
+	}
+	PROFILE_SCOPE("Draw");
+	Context->draw(_Shader, _VertexArray, _DrawParams, _NumInstances);
+	NumDrawsIssued++;
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "RenderContext.h"
+#include "InstanceData.h"
+#include "Math/AffineMatrix.h"
+#include "DataTypes/MArray.h"
+
+/*
+ *	Set of textures bound to a shader's samplers for a queued draw.
+ *	Texture unit N is used for the Nth binding.
+ *
+ *	The set, and everything it points to, must stay alive until the queue
+ *	it was submitted to has been flushed.
+ **/
+struct SamplerSet
+{
+	enum
+	{
+		MAX_BINDINGS = 8
+	};
+
+	SamplerSet() : NumBindings(0) {}
+
+	inline void Add(StringId Name, Texture& InTexture, Sampler& InSampler);
+	bool operator==(const SamplerSet& Other) const;
+
+	StringId Names[MAX_BINDINGS];
+	Texture* Textures[MAX_BINDINGS];
+	Sampler* Samplers[MAX_BINDINGS];
+	uint32 NumBindings;
+};
+
+inline void SamplerSet::Add(StringId Name, Texture& InTexture, Sampler& InSampler)
+{
+	assertCheck(NumBindings < MAX_BINDINGS);
+	Names[NumBindings] = Name;
+	Textures[NumBindings] = &InTexture;
+	Samplers[NumBindings] = &InSampler;
+	NumBindings++;
+}
+
+/*
+ *	Collects the draws of a frame and coalesces the ones that share a vertex
+ *	array, shader, sampler set and draw state into a single instanced draw.
+ *
+ *	Each submission carries its own transform, in whichever instance format
+ *	the vertex array was created with (see InstanceData::Format). On Flush,
+ *	transforms of a batch are gathered contiguously and uploaded into the
+ *	vertex array's instance buffer before the one draw call.
+ *
+ *	Opaque batches are sorted by state to minimize binds. Blended draws keep
+ *	their submission order, are drawn after all opaque ones, and are only
+ *	merged with the blended draw submitted directly before them.
+ **/
+class RenderQueue
+{
+public:
+	RenderQueue(RenderContext& ContextIn) :
+		Context(&ContextIn) {}
+
+	void Submit(Shader& InShader, VertexArray& InVertexArray,
+			const RenderDevice::DrawParams& DrawParams, const Matrix& InTransform,
+			const SamplerSet* Samplers = nullptr);
+	void Submit(Shader& InShader, VertexArray& InVertexArray,
+			const RenderDevice::DrawParams& DrawParams, const AffineMatrix& InTransform,
+			const SamplerSet* Samplers = nullptr);
+	void Submit(Shader& InShader, VertexArray& InVertexArray,
+			const RenderDevice::DrawParams& DrawParams, const CompactInstanceTransform& InTransform,
+			const SamplerSet* Samplers = nullptr);
+
+	/** Issues every queued draw, then empties the queue. Storage is kept for the next frame. */
+	void Flush();
+
+	inline uint32 GetNumSubmitted() const;
+	inline uint32 GetNumDrawsIssued() const;
+private:
+	struct DrawItem
+	{
+		Shader* ItemShader;
+		VertexArray* ItemVertexArray;
+		const SamplerSet* Samplers;
+		uint32 ShaderId;
+		uint32 VertexArrayId;
+		uint32 DrawParamsIndex;
+		uint32 SamplerSetIndex;
+		uint32 Sequence;
+		uint32 InstanceOffset;
+		uint32 InstanceSize;
+		bool bBlended;
+	};
+
+	struct DrawItemLess
+	{
+		bool operator()(const DrawItem& A, const DrawItem& B) const;
+	};
+
+	RenderContext* Context;
+	Array<DrawItem> Items;
+	Array<uint8> InstanceBytes;
+	Array<uint8> BatchInstanceBytes;
+	Array<RenderDevice::DrawParams> UniqueDrawParams;
+	Array<const SamplerSet*> UniqueSamplerSets;
+	uint32 NumDrawsIssued = 0;
+
+	void SubmitInstance(Shader& InShader, VertexArray& InVertexArray,
+			const RenderDevice::DrawParams& DrawParams, const void* Instance,
+			uint32 InstanceSize, const SamplerSet* Samplers);
+	uint32 FindOrAddDrawParams(const RenderDevice::DrawParams& DrawParams);
+	uint32 FindOrAddSamplerSet(const SamplerSet* Samplers);
+	static bool IsSameBatch(const DrawItem& A, const DrawItem& B);
+	void DrawBatch(const DrawItem* Begin, const DrawItem* End);
+
+	NULL_COPY_AND_ASSIGN(RenderQueue);
+};
+
+inline uint32 RenderQueue::GetNumSubmitted() const
+{
+	return (uint32)Items.size();
+}
+
+/** Number of draw calls issued by the last Flush. */
+inline uint32 RenderQueue::GetNumDrawsIssued() const
+{
+	return NumDrawsIssued;
+}
@@ -9,7 +9,7 @@ class RenderTarget
 public:
 	RenderTarget(RenderDevice& deviceIn) :
 		device(&deviceIn),
-		deviceId(0) {}
+		deviceId() {}
 
 	// TODO: Ensure texture isn't compressed. Otherwise, render target creation fails.
 	inline RenderTarget(RenderDevice& deviceIn,
@@ -49,15 +49,15 @@ public:
 		deviceId = device->ReleaseRenderTarget(deviceId);
 	}
 
-	inline uint32 getId();
+	inline RenderDevice::RenderTargetHandle getId();
 private:
 	RenderDevice* device;
-	uint32 deviceId;
+	RenderDevice::RenderTargetHandle deviceId;
 
 	NULL_COPY_AND_ASSIGN(RenderTarget);
 };
 
-inline uint32 RenderTarget::getId()
+inline RenderDevice::RenderTargetHandle RenderTarget::getId()
 {
 	return deviceId;
 }
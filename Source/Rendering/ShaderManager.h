@@ -16,28 +16,28 @@ public:
 		deviceId = device->releaseShaderProgram(deviceId);
 	}
 
-	inline void setUniformBuffer(const String& name, UniformBuffer& buffer);
-	inline void setSampler(const String& name, Texture& texture, Sampler& sampler,
+	inline void setUniformBuffer(StringId name, UniformBuffer& buffer);
+	inline void setSampler(StringId name, Texture& texture, Sampler& sampler,
 			uint32 unit);
-	inline uint32 getId();
+	inline RenderDevice::ShaderProgramHandle getId();
 private:
 	RenderDevice* device;
-	uint32 deviceId;
+	RenderDevice::ShaderProgramHandle deviceId;
 
 	NULL_COPY_AND_ASSIGN(Shader);
 };
 
-inline uint32 Shader::getId()
+inline RenderDevice::ShaderProgramHandle Shader::getId()
 {
 	return deviceId;
 }
 
-inline void Shader::setUniformBuffer(const String& name, UniformBuffer& buffer)
+inline void Shader::setUniformBuffer(StringId name, UniformBuffer& buffer)
 {
 	device->setShaderUniformBuffer(deviceId, name, buffer.getId());
 }
 
-inline void Shader::setSampler(const String& name, Texture& texture, Sampler& sampler,
+inline void Shader::setSampler(StringId name, Texture& texture, Sampler& sampler,
 		uint32 unit)
 {
 	device->setShaderSampler(deviceId, name, texture.getId(), sampler.getId(), unit);
@@ -10,7 +10,8 @@ public:
 			enum RenderDevice::BufferUsage usage) :
 		device(&deviceIn),
 		deviceId(model.createVertexArray(deviceIn, usage)),
-		numIndices(model.getNumIndices()) {}
+		numIndices(model.getNumIndices()),
+		instanceBufferIndex(model.getInstancedElementStartIndex()) {}
 	inline ~VertexArray()
 	{
 		deviceId = device->ReleaseVertexArray(deviceId);
@@ -18,17 +19,20 @@ public:
 
 	inline void updateBuffer(uint32 bufferIndex, const void* data, uintptr dataSize);
 
-	inline uint32 getId();
+	inline RenderDevice::VertexArrayHandle getId();
 	inline uint32 getNumIndices();
+	inline uint32 getInstanceBufferIndex() const;
+	inline bool hasInstanceBuffer() const;
 private:
 	RenderDevice* device;
-	uint32 deviceId;
+	RenderDevice::VertexArrayHandle deviceId;
 	uint32 numIndices;
+	uint32 instanceBufferIndex;
 
 	NULL_COPY_AND_ASSIGN(VertexArray);
 };
 
-inline uint32 VertexArray::getId()
+inline RenderDevice::VertexArrayHandle VertexArray::getId()
 {
 	return deviceId;
 }
@@ -38,6 +42,17 @@ inline uint32 VertexArray::getNumIndices()
 	return numIndices;
 }
 
+/** Index of the buffer holding per-instance data, or (uint32)-1 if the model has none. */
+inline uint32 VertexArray::getInstanceBufferIndex() const
+{
+	return instanceBufferIndex;
+}
+
+inline bool VertexArray::hasInstanceBuffer() const
+{
+	return instanceBufferIndex != (uint32)-1;
+}
+
 inline void VertexArray::updateBuffer(uint32 bufferIndex,
 		const void* data, uintptr dataSize)
 {
@@ -4,9 +4,18 @@
 #include "EngineCore/MemoryManager.h"
 #include "EngineCore/EngineUtils.h"
 #include "Rendering/RenderContext.h"
+#include "Rendering/RenderQueue.h"
+#include "Rendering/GPUProfileZone.h"
 #include "Rendering/AssetLoader.h"
 
 #include "EngineCore/TimerManager.h"
+#include "EngineCore/Profiler.h"
+#include "EngineCore/FrameStats.h"
+#include "EngineCore/LinearArena.h"
+#include "EngineCore/MemoryTracker.h"
+#include "EngineCore/JobSystem.h"
+#include "EngineCore/TripleBuffer.h"
+#include "EngineCore/FramePacing.h"
 #include "tests.hpp"
 
 #include "Math/Transform.h"
@@ -14,6 +23,20 @@
 #include "Math/aabb.h"
 #include "Math/Plane.h"
 #include "Math/Intersects.h"
+#include <thread>
+
+/*
+ *	What the render thread gets from one simulation step: the instances as
+ *	they were before and after it, so it can draw any point in between.
+ **/
+struct SceneSnapshot
+{
+	Array<Transform> Previous;
+	Array<Transform> Current;
+	/** When Current is due on screen, on the Time::getTime clock. Previous was due a step earlier. */
+	double Time;
+	uint64 Tick;
+};
 
 // NOTE: Profiling reveals that in the current instanced rendering system:
 // - Updating the buffer takes more time than
@@ -22,6 +45,8 @@
 static int RunApp(Application* App)
 {
 	Tests::RunTests();
+	Profiler::SetThreadName("Main");
+	JobSystem::Init();
 	Window _Window(*App, 1500, 1000, "MARS Engine");
 
 	// Begin scene creation
@@ -48,28 +73,27 @@ static int RunApp(Application* App)
 	String _ShaderText;
 	FString::loadTextFileWithIncludes(_ShaderText, "./Resources/Shaders/basicShader.glsl", "#include");
 	Shader _Shader(_Device, _ShaderText);
-	_Shader.setSampler("diffuse", _Texture, _Sampler, 0);
+	SamplerSet _Samplers;
+	_Samplers.Add(STRING_ID("diffuse"), _Texture, _Sampler);
+	RenderQueue _Queue(_Context);
 	
 	Matrix _Perspective(Matrix::Perspective(Math::ToRad(70.0f/2.0f),	4.0f/3.0f, 0.1f, 1000.0f));
-	float _Amount = 0.0f;
 	Color _Color(0.0f, 0.5f, 0.5f);
 	float _RandZ = 20.0f;
 	float _RandScaleX = _RandZ * _Window.getWidth()/(float)_Window.getHeight();
 	float _RandScaleY = _RandZ;
 	
 	uint32 _NumInstances = 100;
-	Matrix _TransformMatrix(Matrix::Identity());
 	Transform _Transform;
-	Array<Matrix> _TransformMatrixArray;
-	Array<Matrix> _TransformMatrixBaseArray;
+	SceneSnapshot _InitialSnapshot = SceneSnapshot();
 	for (uint32 Index = 0; Index < _NumInstances; Index++) 
 	{
-		_TransformMatrixArray.push_back(Matrix::Identity());
 		_Transform.SetTranslation(Cartesian3D((Math::Randf() * _RandScaleX)-_RandScaleX/2.0f,	(Math::Randf() * _RandScaleY)-_RandScaleY/2.0f, _RandZ));
-		_TransformMatrixBaseArray.push_back(_Transform.ToMatrix());
+		_InitialSnapshot.Previous.push_back(_Transform);
 	}
-
-	_Transform.SetTranslation(Cartesian3D(0.0f,0.0f,0.0f));
+	_InitialSnapshot.Current = _InitialSnapshot.Previous;
+	Array<Matrix> _TransformMatrixArray;
+	_TransformMatrixArray.resize(_NumInstances, Matrix::Identity());
 	
 	RenderDevice::DrawParams drawParams;
 	drawParams.PrimitiveType = RenderDevice::PRIMITIVE_TRIANGLES;
@@ -78,55 +102,141 @@ static int RunApp(Application* App)
 	drawParams.DepthFunc = RenderDevice::DRAW_FUNC_LESS;
 	// End scene creation
 
+	float frameTime = 1.f/60.f;
+
+	// Simulation runs on its own thread at a fixed step, and only ever hands
+	// finished steps to rendering, so a slow frame on either side does not
+	// hold up the other
+	TripleBuffer<SceneSnapshot> _Snapshots(_InitialSnapshot);
+	std::atomic<bool> _bSimulating(true);
+	std::thread _SimulationThread([&]() {
+		Profiler::SetThreadName("Simulation");
+		Array<Transform> _Instances(_InitialSnapshot.Current);
+		float _Amount = 0.0f;
+		uint64 _Tick = 0;
+		FixedStepScheduler _Scheduler(Time::toNanoseconds(frameTime));
+		while(_bSimulating.load(std::memory_order_acquire)) {
+			uint64 _Due;
+			{
+				PROFILE_SCOPE("Sleep");
+				_Due = _Scheduler.WaitForStep();
+			}
+
+			PROFILE_SCOPE("Update");
+			SceneSnapshot& _Snapshot = _Snapshots.GetWriteBuffer();
+			_Snapshot.Previous = _Instances;
+			// Begin scene update
+			Quaternion _Rotation(Spatial3D(Cartesian3D(1.f)).Normalized().Inner(), _Amount*10.0f/11.0f);
+			for(uint32 i = 0; i < _Instances.size(); i++) {
+				_Instances[i].SetRotation(_Rotation);
+			}
+			_Amount += (float)frameTime/2.0f;
+			// End scene update
+			_Snapshot.Current = _Instances;
+			_Snapshot.Time = Time::toSeconds(_Due);
+			_Snapshot.Tick = ++_Tick;
+			_Snapshots.Publish();
+		}
+	});
+
 	uint32 fps = 0;
 	double lastTime = Time::getTime();
 	double fpsTimeCounter = 0.0;
-	double updateTimer = 1.0;
-	float frameTime = 1.f/60.f;
+	uint64 _LastTick = 0;
+	// Render at the simulation's rate; interpolation takes care of the phase between the two
+	FrameLimiter _FrameLimiter(Time::toNanoseconds(frameTime));
+	// Anything slower than two update steps counts as a hitch
+	FrameStats _SecondStats(2000.0 * frameTime);
+	FrameStats _RunStats(2000.0 * frameTime);
+	FrameSample _Sample = FrameSample();
+	double _LastPresentTime = lastTime;
 	while(App->GetIsRunning()) {
 		double currentTime = Time::getTime();
 		double passedTime = currentTime - lastTime;
 		lastTime = currentTime;
 
 		fpsTimeCounter += passedTime;
-		updateTimer += passedTime;
 
 		if(fpsTimeCounter >= 1.0) {
 			double msPerFrame = 1000.0/(double)fps;
-			DEBUG_LOG("FPS", "NONE", "%f ms (%d fps)", msPerFrame, fps);
+			DEBUG_LOG("FPS", LOG_INFO, "%f ms (%d fps)", msPerFrame, fps);
+			Profiler::LogFrameSummary();
+			_Device.LogLastFrameStats();
+			MemoryTracker::LogStats();
+			_SecondStats.Log("last second");
+			_SecondStats.Reset();
 			fpsTimeCounter = 0;
 			fps = 0;
 		}
-		
-		bool shouldRender = false;
-		while(updateTimer >= frameTime) {
-			App->HandleMessage(frameTime);
-			// Begin scene update
-			_Transform.SetRotation(Quaternion(Spatial3D(Cartesian3D(1.f)).Normalized().Inner(), _Amount*10.0f/11.0f));
-			for(uint32 i = 0; i < _TransformMatrixArray.size(); i++) {
-				_TransformMatrixArray[i] = (_Perspective * _TransformMatrixBaseArray[i] * _Transform.ToMatrix());
-			}
-			_VertexArray.updateBuffer(4, &_TransformMatrixArray[0],
-					_TransformMatrixArray.size() * sizeof(Matrix));
-			_Amount += (float)frameTime/2.0f;
-			// End scene update
 
-			updateTimer -= frameTime;
-			shouldRender = true;
+		{
+			PROFILE_SCOPE("Sleep");
+			double _SleepStart = Time::getTime();
+			_FrameLimiter.Wait();
+			_Sample.SleepTime += (Time::getTime() - _SleepStart) * 1000.0;
 		}
-		
-		if(shouldRender) {
+
+		// Window events have to be handled on the thread that created the window
+		App->HandleMessage(passedTime);
+
+		if(_Snapshots.Acquire()) {
+			_Sample.NumUpdates += (uint32)(_Snapshots.GetReadBuffer().Tick - _LastTick);
+			_LastTick = _Snapshots.GetReadBuffer().Tick;
+		}
+		{
+			PROFILE_SCOPE("Interpolate");
+			const SceneSnapshot& _Snapshot = _Snapshots.GetReadBuffer();
+			// One step behind the simulation, so there is always a step on either side to blend
+			float _Alpha = Math::Clamp((float)((Time::getTime() - _Snapshot.Time) / frameTime), 0.0f, 1.0f);
+			const Transform* _Previous = _Snapshot.Previous.data();
+			const Transform* _Current = _Snapshot.Current.data();
+			Matrix* _FirstMatrix = _TransformMatrixArray.data();
+			JobSystem::ParallelFor(_TransformMatrixArray, 256, [&](Matrix* Matrices, uint32 Count) {
+				uint32 _First = (uint32)(Matrices - _FirstMatrix);
+				for(uint32 i = 0; i < Count; i++) {
+					Transform _Blended = Math::Lerp(_Previous[_First + i], _Current[_First + i], _Alpha);
+					Matrices[i] = _Perspective * _Blended.ToMatrix();
+				}
+			});
+		}
+		{
+			PROFILE_SCOPE("Render");
+			PROFILE_GPU_SCOPE(_Device, "Render");
 			// Begin scene render
 			_Context.clear(_Color, true);
-			_Context.draw(_Shader, _VertexArray, drawParams, _NumInstances);
+			for(uint32 i = 0; i < _NumInstances; i++) {
+				_Queue.Submit(_Shader, _VertexArray, drawParams, _TransformMatrixArray[i], &_Samplers);
+			}
+			PROFILE_GPU_SCOPE(_Device, "RenderQueue::Flush");
+			_Queue.Flush();
 			// End scene render
-			
+		}
+		double _PresentStart = Time::getTime();
+		{
+			PROFILE_SCOPE("Present");
 			_Window.present();
-			fps++;
-		} else {
-			Time::sleep(1);
 		}
+		double _PresentEnd = Time::getTime();
+		fps++;
+		_Device.EndGPUTimerFrame();
+		Profiler::EndFrame();
+		_Device.EndStatsFrame();
+		FrameArena::EndFrame();
+		MemoryTracker::EndFrame();
+
+		_Sample.PresentTime = (_PresentEnd - _PresentStart) * 1000.0;
+		_Sample.FrameTime = (_PresentEnd - _LastPresentTime) * 1000.0;
+		_LastPresentTime = _PresentEnd;
+		_SecondStats.AddFrame(_Sample);
+		_RunStats.AddFrame(_Sample);
+		_Sample = FrameSample();
 	}
+	_bSimulating.store(false, std::memory_order_release);
+	_SimulationThread.join();
+	Profiler::WriteChromeTrace("profile.json");
+	_RunStats.Log("run");
+	_RunStats.WriteCSV("framestats.csv");
+	_RunStats.WriteJSON("framestats.json");
 	return 0;
 }
 
@@ -143,7 +253,9 @@ int main(int argc, char** argv)
 	USE_PARAMATER(argc) USE_PARAMATER(argv)
 	Application* _App = Application::StartApplication();
 	int32 _Results = RunApp(_App);
+	JobSystem::Shutdown();
 	delete _App;
+	MemoryTracker::ReportLeaks();
 	return _Results;
 }
 
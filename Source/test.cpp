@@ -1,10 +1,29 @@
 #include "tests.hpp"
 #include "EngineCore/TimerManager.h"
+#include "EngineCore/Profiler.h"
+#include "EngineCore/FrameStats.h"
+#include "EngineCore/LinearArena.h"
+#include "EngineCore/MemoryTracker.h"
+#include "EngineCore/JobSystem.h"
+#include "EngineCore/TripleBuffer.h"
+#include "EngineCore/FramePacing.h"
 #include "Math/Transform.h"
 #include "Math/Sphere.h"
 #include "Math/aabb.h"
 #include "Math/Plane.h"
 #include "Math/Intersects.h"
+#include "Math/BoundsBatch.h"
+#include "Math/BVH.h"
+#include "Math/AABBTree.h"
+#include "Math/SpatialHashGrid.h"
+#include "Rendering/InstanceData.h"
+#include "DataTypes/MMap.h"
+#include "DataTypes/MStringId.h"
+#include "EngineCore/HandlePool.h"
+#include "Platform/Generic/ThreadCacheMemory.h"
+#include "Platform/Generic/GenericPageMemory.h"
+#include <algorithm>
+#include <thread>
 
 static void testMathTypesMemoryLayout()
 {
@@ -139,6 +158,61 @@ static void testAABB()
 	assert(Math::Abs(aabb1Transformed.GetExtents()[2]-1.5f) < 1.e-4f);
 }
 
+static void testBoundsBatch()
+{
+	// Two full blocks of four and a tail, so both paths are covered
+	enum { COUNT = 11 };
+	float _Local[10][COUNT];
+	float _World[10][COUNT];
+	Matrix _Transforms[COUNT];
+	AABBSoA _LocalBoxes = { { _Local[0], _Local[1], _Local[2] }, { _Local[3], _Local[4], _Local[5] } };
+	AABBSoA _WorldBoxes = { { _World[0], _World[1], _World[2] }, { _World[3], _World[4], _World[5] } };
+	SphereSoA _LocalSpheres = { { _Local[6], _Local[7], _Local[8] }, _Local[9] };
+	SphereSoA _WorldSpheres = { { _World[6], _World[7], _World[8] }, _World[9] };
+
+	for (uint32 Index = 0; Index < COUNT; Index++)
+	{
+		Spatial3D _Center(Cartesian3D(Math::Randf(-10.0f, 10.0f), Math::Randf(-10.0f, 10.0f), Math::Randf(-10.0f, 10.0f)));
+		Spatial3D _Extents(Cartesian3D(Math::Randf(0.1f, 3.0f), Math::Randf(0.1f, 3.0f), Math::Randf(0.1f, 3.0f)));
+		_LocalBoxes.Set(Index, AABB(_Center - _Extents, _Center + _Extents));
+		_LocalSpheres.Set(Index, Sphere(_Center, Math::Randf(0.1f, 3.0f)));
+		_Transforms[Index] = Transform(_Center * 0.5f,
+				Quaternion(Spatial3D(1.242f, 2.2432f, 3.75354f * Index).Normalized().Inner(), 0.3f * Index),
+				Spatial3D(Cartesian3D(Math::Randf(0.5f, 2.0f), Math::Randf(0.5f, 2.0f), Math::Randf(0.5f, 2.0f)))).ToMatrix();
+	}
+
+	BoundsBatch::TransformAABBs(_Transforms[3], _LocalBoxes, _WorldBoxes, COUNT);
+	BoundsBatch::TransformSpheres(_Transforms[3], _LocalSpheres, _WorldSpheres, COUNT);
+	for (uint32 Index = 0; Index < COUNT; Index++)
+	{
+		assert(_WorldBoxes.Get(Index).Equals(_LocalBoxes.Get(Index).Transform(_Transforms[3]), 1.e-3f));
+		assert(_WorldSpheres.Get(Index).equals(_LocalSpheres.Get(Index).transform(_Transforms[3]), 1.e-3f));
+	}
+
+	BoundsBatch::TransformAABBs(_Transforms, _LocalBoxes, _WorldBoxes, COUNT);
+	BoundsBatch::TransformSpheres(_Transforms, _LocalSpheres, _WorldSpheres, COUNT);
+	for (uint32 Index = 0; Index < COUNT; Index++)
+	{
+		assert(_WorldBoxes.Get(Index).Equals(_LocalBoxes.Get(Index).Transform(_Transforms[Index]), 1.e-3f));
+		assert(_WorldSpheres.Get(Index).equals(_LocalSpheres.Get(Index).transform(_Transforms[Index]), 1.e-3f));
+	}
+
+	// In place, and nothing past Count is touched
+	AABB _Expected = _LocalBoxes.Get(0).Transform(_Transforms[0]);
+	float _Guard = _Local[0][1];
+	BoundsBatch::TransformAABBs(_Transforms, _LocalBoxes, _LocalBoxes, 1);
+	assert(_LocalBoxes.Get(0).Equals(_Expected, 1.e-3f));
+	assert(_Local[0][1] == _Guard);
+
+	// Inverted boxes, as Overlap returns for boxes that do not touch, come out as if they were not
+	AABB _Inverted(Spatial3D(1.0f, 2.0f, 3.0f), Spatial3D(-1.0f, 0.0f, 1.0f));
+	_Expected = AABB(_Inverted.GetMaxExtents(), _Inverted.GetMinExtents()).Transform(_Transforms[0]);
+	assert(_Inverted.Transform(_Transforms[0]).Equals(_Expected, 1.e-3f));
+	_LocalBoxes.Set(0, _Inverted);
+	BoundsBatch::TransformAABBs(_Transforms, _LocalBoxes, _WorldBoxes, 1);
+	assert(_WorldBoxes.Get(0).Equals(_Expected, 1.e-3f));
+}
+
 static void testMath()
 {
 	testMathTypesMemoryLayout();
@@ -182,6 +256,39 @@ static void testMath()
 	assert(_Mul.Equals(_Rotation));
 }
 
+static void testAffineMatrix()
+{
+	assert(sizeof(AffineMatrix) == 12 * sizeof(float));
+
+	Transform _Transform(Spatial3D(5.64635f, 1.325345f, 2.02523f),
+			Quaternion(Spatial3D(1.242f, 2.2432f, 3.75354f).Normalized().Inner(), 2.54343f),
+			Spatial3D(1.4215f, 0.123141f, 3.7423f));
+	Transform _Transform2(Spatial3D(-3.0f, 0.5f, 12.0f),
+			Quaternion(Spatial3D(0.0f, 1.0f, 0.0f), 0.75f), Spatial3D(2.0f, 2.0f, 2.0f));
+	Matrix _Mat(_Transform.ToMatrix());
+	Matrix _Mat2(_Transform2.ToMatrix());
+	AffineMatrix _Affine(_Transform.ToAffineMatrix());
+	AffineMatrix _Affine2(_Transform2.ToAffineMatrix());
+
+	assert(_Affine.ToMatrix() == _Mat);
+	assert(AffineMatrix(_Mat) == _Affine);
+	assert(Math::Abs(_Affine.Determinant3x3() - _Mat.Determinant4x4()) < 1.e-4f);
+	assert((_Affine * _Affine2).ToMatrix().Equals(_Mat * _Mat2));
+	assert((_Affine * AffineMatrix::Identity()).Equals(_Affine));
+
+	Vector _Point = Vector::Make(1.337f, 3.778f, -2.419f, 1.0f);
+	Vector _Direction = Vector::Make(1.337f, 3.778f, -2.419f, 0.0f);
+	assert(Spatial3D(_Affine.TransformPoint(_Point)).Inner().Equals(Spatial3D(_Mat.Transform(_Point)).Inner()));
+	assert(Spatial3D(_Affine.TransformDirection(_Direction)).Inner().Equals(Spatial3D(_Mat.Transform(_Direction)).Inner()));
+
+	assert(_Affine.Inverse().ToMatrix().Equals(_Mat.Inverse()));
+	assert((_Affine.Inverse() * _Affine).Equals(AffineMatrix::Identity()));
+
+	AffineMatrix _Rigid(Transform(Spatial3D(1.0f, -2.0f, 3.0f), Quaternion(Spatial3D(0.0f, 0.0f, 1.0f), 1.2f),
+			Spatial3D(1.0f, 1.0f, 1.0f)).ToAffineMatrix());
+	assert(_Rigid.InverseRigid().Equals(_Rigid.Inverse()));
+}
+
 static void testPlane()
 {
 	Plane plane1(Spatial3D(1.0f,0.0f,0.0f),-1.0f);
@@ -332,309 +439,1306 @@ static void testIntersects()
 	assert(Math::Equals(boundingSphere.getRadius(), 1.5f, 1.e-4f));
 }
 
-void testMemory()
+static void checkBVHQueries(const BVH& Tree, const Array<AABB>& Boxes)
 {
-//	int32 v1[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
-//	int32 v2[] = {10, 11, 12, 13, 14, 15, 16, 17, 18, 19};
-//
-//	for(uint32 i = 0; i < ARRAY_SIZE_IN_ELEMENTS(v1); i++) {
-//		DEBUG_LOG_TEMP("%i, %i", v1[i], v2[i]);
-//	}
-//
-//	Memory::memswap(v1, v2, sizeof(v1));
-//	DEBUG_LOG_TEMP("%i", sizeof(v1));
-//
-//	for(uint32 i = 0; i < ARRAY_SIZE_IN_ELEMENTS(v1); i++) {
-//		DEBUG_LOG_TEMP("%i, %i", v1[i], v2[i]);
-//	}
+	Array<uint8> _Found(Boxes.size());
+	auto _Mark = [&](uint32 Index)
+	{
+		assert(_Found[Index] == 0);
+		_Found[Index] = 1;
+	};
 
+	for (uint32 Query = 0; Query < 20; Query++)
+	{
+		Spatial3D _Center(Math::Randf(-60.0f, 60.0f), Math::Randf(-60.0f, 60.0f), Math::Randf(-60.0f, 60.0f));
+		AABB _Box(_Center - Spatial3D(5.0f, 5.0f, 5.0f), _Center + Spatial3D(8.0f, 3.0f, 5.0f));
+		Sphere _Sphere(_Center, 6.0f);
+		Spatial3D _Direction = Spatial3D(Math::Randf(-1.0f, 1.0f), Math::Randf(-1.0f, 1.0f), Math::Randf(-1.0f, 1.0f)).Normalized();
+		if (Query == 0)
+		{
+			_Direction = Spatial3D(0.0f, 0.0f, 1.0f);
+		}
+
+		Memory::memzero(_Found.data(), _Found.size());
+		Tree.QueryAABB(_Box, _Mark);
+		for (uint32 Index = 0; Index < Boxes.size(); Index++)
+		{
+			assert(_Found[Index] == (Boxes[Index].Intersects(_Box) ? 1 : 0));
+		}
+
+		Memory::memzero(_Found.data(), _Found.size());
+		Tree.QuerySphere(_Sphere, _Mark);
+		for (uint32 Index = 0; Index < Boxes.size(); Index++)
+		{
+			assert(_Found[Index] == (Intersects::intersectSphereAABB(_Sphere, Boxes[Index]) ? 1 : 0));
+		}
+
+		// Rays hit the box itself, so the closest hit is where the ray enters the nearest box
+		Memory::memzero(_Found.data(), _Found.size());
+		Tree.QueryRay(_Center, _Direction, 100.0f, _Mark);
+		float _Closest = 101.0f;
+		for (uint32 Index = 0; Index < Boxes.size(); Index++)
+		{
+			float _Near, _Far;
+			bool _bHit = Boxes[Index].IntersectRay(_Center, _Direction, _Near, _Far) && _Far >= 0.0f && _Near <= 100.0f;
+			assert(_Found[Index] == (_bHit ? 1 : 0));
+			if (_bHit)
+			{
+				_Closest = Math::Min(_Closest, Math::Max(_Near, 0.0f));
+			}
+		}
+
+		uint32 _HitIndex;
+		float _HitDistance;
+		bool _bHit = Tree.Raycast(_Center, _Direction, 100.0f,
+			[&](uint32 Index, float& Distance)
+			{
+				float _Far;
+				bool _bBoxHit = Boxes[Index].IntersectRay(_Center, _Direction, Distance, _Far);
+				Distance = Math::Max(Distance, 0.0f);
+				return _bBoxHit;
+			},
+			_HitIndex, _HitDistance);
+		assert(_bHit == (_Closest <= 100.0f));
+		assert(!_bHit || Math::Abs(_HitDistance - _Closest) < 1.e-3f);
+	}
 }
 
+static void testBVH()
+{
+	BVH _Tree;
+	_Tree.Build(nullptr, 0);
+	assert(_Tree.GetNumNodes() == 0);
+	_Tree.QueryAABB(AABB(Spatial3D(-1.0f, -1.0f, -1.0f), Spatial3D(1.0f, 1.0f, 1.0f)), [](uint32) { assert(false); });
+
+	// Big enough to split in parallel, with a clump that SAH cannot separate
+	Array<AABB> _Boxes;
+	for (uint32 Index = 0; Index < 10000; Index++)
+	{
+		Spatial3D _Center = Index % 100 == 0
+				? Spatial3D(1.0f, 2.0f, 3.0f)
+				: Spatial3D(Math::Randf(-50.0f, 50.0f), Math::Randf(-50.0f, 50.0f), Math::Randf(-50.0f, 50.0f));
+		Spatial3D _Extents(Math::Randf(0.1f, 2.0f), Math::Randf(0.1f, 2.0f), Math::Randf(0.1f, 2.0f));
+		_Boxes.push_back(AABB(_Center - _Extents, _Center + _Extents));
+	}
 
-void Tests::RunTests()
+	JobSystem::Init(3);
+	_Tree.Build(_Boxes.data(), (uint32)_Boxes.size());
+	JobSystem::Shutdown();
+	assert(_Tree.GetNumBoxes() == _Boxes.size());
+	assert(_Tree.GetBounds().Contains(AABB(Spatial3D(-49.0f, -49.0f, -49.0f), Spatial3D(49.0f, 49.0f, 49.0f))));
+	checkBVHQueries(_Tree, _Boxes);
+
+	for (uint32 Index = 0; Index < _Boxes.size(); Index++)
+	{
+		_Boxes[Index] = _Boxes[Index].Translate(Spatial3D(Math::Randf(-3.0f, 3.0f), Math::Randf(-3.0f, 3.0f), Math::Randf(-3.0f, 3.0f)));
+	}
+	_Tree.Refit(_Boxes.data());
+	checkBVHQueries(_Tree, _Boxes);
+
+	_Boxes.resize(3);
+	_Tree.Build(_Boxes.data(), (uint32)_Boxes.size());
+	assert(_Tree.GetNumNodes() == 1);
+	checkBVHQueries(_Tree, _Boxes);
+}
+
+static void checkAABBTreePairs(const AABBTree& Tree, const Array<uint32>& Proxies)
 {
-	testSphere();
-	testAABB();
-	testMath();
-	testPlane();
-	testIntersects();
-	testMemory();
+	auto _Less = [](const AABBTree::ProxyPair& A, const AABBTree::ProxyPair& B)
+	{
+		return A.ProxyA != B.ProxyA ? A.ProxyA < B.ProxyA : A.ProxyB < B.ProxyB;
+	};
+
+	Array<AABBTree::ProxyPair> _Pairs;
+	Tree.QueryPairs(_Pairs);
+	std::sort(_Pairs.begin(), _Pairs.end(), _Less);
+
+	Array<AABBTree::ProxyPair> _Expected;
+	for (uint32 A = 0; A < Proxies.size(); A++)
+	{
+		for (uint32 B = A + 1; B < Proxies.size(); B++)
+		{
+			if (Tree.GetFatBounds(Proxies[A]).Intersects(Tree.GetFatBounds(Proxies[B])))
+			{
+				_Expected.push_back(AABBTree::ProxyPair{ Math::Min(Proxies[A], Proxies[B]), Math::Max(Proxies[A], Proxies[B]) });
+			}
+		}
+	}
+	std::sort(_Expected.begin(), _Expected.end(), _Less);
+
+	assert(_Pairs.size() == _Expected.size());
+	for (uint32 Index = 0; Index < _Pairs.size(); Index++)
+	{
+		assert(_Pairs[Index].ProxyA == _Expected[Index].ProxyA && _Pairs[Index].ProxyB == _Expected[Index].ProxyB);
+	}
+
+	AABB _Query(Spatial3D(-10.0f, -10.0f, -10.0f), Spatial3D(12.0f, 6.0f, 10.0f));
+	uint32 _NumFound = 0;
+	Tree.Query(_Query, [&](uint32 Proxy)
+	{
+		assert(Tree.GetFatBounds(Proxy).Intersects(_Query));
+		_NumFound++;
+	});
+	uint32 _NumExpected = 0;
+	for (uint32 Index = 0; Index < Proxies.size(); Index++)
+	{
+		_NumExpected += Tree.GetFatBounds(Proxies[Index]).Intersects(_Query) ? 1 : 0;
+	}
+	assert(_NumFound == _NumExpected);
+}
+
+static void testAABBTree()
+{
+	AABBTree _Tree(0.5f);
+	assert(_Tree.GetHeight() == 0);
+	_Tree.Query(AABB(Spatial3D(-1.0f, -1.0f, -1.0f), Spatial3D(1.0f, 1.0f, 1.0f)), [](uint32) { assert(false); });
+
+	Array<uint32> _Proxies;
+	Array<AABB> _Boxes;
+	for (uint32 Index = 0; Index < 1000; Index++)
+	{
+		Spatial3D _Center(Math::Randf(-50.0f, 50.0f), Math::Randf(-50.0f, 50.0f), Math::Randf(-50.0f, 50.0f));
+		Spatial3D _Extents(Math::Randf(0.1f, 2.0f), Math::Randf(0.1f, 2.0f), Math::Randf(0.1f, 2.0f));
+		_Boxes.push_back(AABB(_Center - _Extents, _Center + _Extents));
+		_Proxies.push_back(_Tree.CreateProxy(_Boxes.back(), Index));
+	}
+	_Tree.Validate();
+	assert(_Tree.GetNumProxies() == 1000);
+	assert(_Tree.GetUserData(_Proxies[123]) == 123);
+	assert(_Tree.GetFatBounds(_Proxies[5]) == _Boxes[5].Eexpand(0.5f));
+	// Rotations keep it within a few times the ~10 levels a balanced tree would need
+	assert(_Tree.GetHeight() < 30);
+	checkAABBTreePairs(_Tree, _Proxies);
+
+	// Small moves stay inside the fat bounds, big ones are reinserted
+	assert(!_Tree.MoveProxy(_Proxies[0], _Boxes[0].Translate(Spatial3D(0.2f, -0.2f, 0.0f))));
+	assert(_Tree.MoveProxy(_Proxies[0], _Boxes[0].Translate(Spatial3D(0.0f, 3.0f, 0.0f)), Spatial3D(0.0f, 1.0f, 0.0f)));
+	assert(_Tree.GetFatBounds(_Proxies[0]).GetMaxExtents().Y() > _Boxes[0].GetMaxExtents().Y() + 3.0f + 2.0f);
+	for (uint32 Step = 0; Step < 10; Step++)
+	{
+		for (uint32 Index = 0; Index < _Boxes.size(); Index++)
+		{
+			Spatial3D _Displacement(Math::Randf(-1.0f, 1.0f), Math::Randf(-1.0f, 1.0f), Math::Randf(-1.0f, 1.0f));
+			_Boxes[Index] = _Boxes[Index].Translate(_Displacement);
+			_Tree.MoveProxy(_Proxies[Index], _Boxes[Index], _Displacement);
+			assert(_Tree.GetFatBounds(_Proxies[Index]).Contains(_Boxes[Index]));
+		}
+	}
+	_Tree.Validate();
+	checkAABBTreePairs(_Tree, _Proxies);
+
+	// Destroyed proxies leave no pairs behind, and their nodes are reused
+	for (uint32 Index = 0; Index < 600; Index++)
+	{
+		uint32 _Victim = Math::Rand() % _Proxies.size();
+		_Tree.DestroyProxy(_Proxies[_Victim]);
+		_Proxies[_Victim] = _Proxies.back();
+		_Proxies.pop_back();
+	}
+	_Tree.Validate();
+	checkAABBTreePairs(_Tree, _Proxies);
+	uint32 _Reused = _Tree.CreateProxy(_Boxes[0], 7);
+	assert(_Reused < 1999);
+	_Proxies.push_back(_Reused);
+	_Tree.Validate();
+	checkAABBTreePairs(_Tree, _Proxies);
+
+	while (!_Proxies.empty())
+	{
+		_Tree.DestroyProxy(_Proxies.back());
+		_Proxies.pop_back();
+	}
+	_Tree.Validate();
+	assert(_Tree.GetHeight() == 0 && _Tree.GetNumProxies() == 0);
 }
 
-inline void naiveMatrixMultiply(float* output, float* input, float* other)
+static void checkSpatialHashGrid(const SpatialHashGrid& Grid, const Array<Spatial3D>& Points)
 {
-	float* m = (float*)input;
-	float* r = (float*)other;
-	float* ret = (float*)output;
-	for (unsigned int i = 0 ; i < 4; i++) 
+	Array<uint8> _Found(Points.size());
+	for (uint32 Query = 0; Query < 20; Query++)
+	{
+		Spatial3D _Center(Math::Randf(-30.0f, 30.0f), Math::Randf(-30.0f, 30.0f), Math::Randf(-30.0f, 30.0f));
+		float _Radius = Query % 2 == 0 ? Math::Randf(0.1f, 1.0f) : Math::Randf(1.0f, 8.0f);
+
+		Memory::memzero(_Found.data(), _Found.size());
+		Grid.QueryRadius(_Center, _Radius, [&](uint32 Index, float DistanceSquared)
+		{
+			assert(_Found[Index] == 0);
+			assert(Math::Equals(DistanceSquared, _Center.DistSquared(Points[Index]), 1.e-3f));
+			_Found[Index] = 1;
+		});
+		for (uint32 Index = 0; Index < Points.size(); Index++)
+		{
+			assert(_Found[Index] == (_Center.DistSquared(Points[Index]) < _Radius * _Radius ? 1 : 0));
+		}
+
+		// Ties aside, the nearest K are the first K of every point sorted by distance
+		const uint32 _K = 8;
+		uint32 _Nearest[_K];
+		float _NearestDistances[_K];
+		uint32 _NumNearest = Grid.FindNearest(_Center, _K, _Radius, _Nearest, _NearestDistances);
+		Array<float> _Distances;
+		for (uint32 Index = 0; Index < Points.size(); Index++)
+		{
+			float _DistanceSquared = _Center.DistSquared(Points[Index]);
+			if (_DistanceSquared < _Radius * _Radius)
+			{
+				_Distances.push_back(_DistanceSquared);
+			}
+		}
+		std::sort(_Distances.begin(), _Distances.end());
+		assert(_NumNearest == Math::Min(_K, (uint32)_Distances.size()));
+		for (uint32 Index = 0; Index < _NumNearest; Index++)
+		{
+			assert(Math::Equals(_NearestDistances[Index], _Distances[Index], 1.e-3f));
+			assert(Math::Equals(_Center.DistSquared(Points[_Nearest[Index]]), _Distances[Index], 1.e-3f));
+		}
+	}
+
+	const float _PairRadius = 0.8f;
+	Array<SpatialHashGrid::IndexPair> _Pairs;
+	Grid.QueryPairs(_PairRadius, _Pairs);
+	std::sort(_Pairs.begin(), _Pairs.end(), [](const SpatialHashGrid::IndexPair& A, const SpatialHashGrid::IndexPair& B)
 	{
-		for (unsigned int j = 0 ; j < 4; j++) 
+		return A.IndexA != B.IndexA ? A.IndexA < B.IndexA : A.IndexB < B.IndexB;
+	});
+	uint32 _NumPairs = 0;
+	for (uint32 A = 0; A < Points.size(); A++)
+	{
+		for (uint32 B = A + 1; B < Points.size(); B++)
 		{
-			ret[i*4+j] = 0.0f;
-			for(unsigned int k = 0; k < 4; k++) {
-				ret[i*4+j] += m[k*4+j] * r[i*4+k];
+			if (Points[A].DistSquared(Points[B]) < _PairRadius * _PairRadius)
+			{
+				assert(_NumPairs < _Pairs.size() && _Pairs[_NumPairs].IndexA == A && _Pairs[_NumPairs].IndexB == B);
+				_NumPairs++;
 			}
 		}
 	}
+	assert(_NumPairs == _Pairs.size());
 }
 
-inline void naiveCrossProduct(float* output, float* v1, float* v2)
+static void testSpatialHashGrid()
 {
-	float out0 = v1[1] * v2[2] - v1[2] * v2[1];
-	float out1 = v1[2] * v2[0] - v1[0] * v2[2];
-	float out2 = v1[0] * v2[1] - v1[1] * v2[0];
-	output[0] = out0;
-	output[1] = out1;
-	output[2] = out2;
+	SpatialHashGrid _Grid(1.0f);
+	_Grid.Build(nullptr, 0);
+	_Grid.QueryRadius(Spatial3D(0.0f, 0.0f, 0.0f), 10.0f, [](uint32, float) { assert(false); });
+	uint32 _Nearest;
+	float _NearestDistance;
+	assert(_Grid.FindNearest(Spatial3D(0.0f, 0.0f, 0.0f), 1, 10.0f, &_Nearest, &_NearestDistance) == 0);
+
+	// Enough points to sort in parallel, some on top of each other and some far out
+	Array<Spatial3D> _Points;
+	for (uint32 Index = 0; Index < 10000; Index++)
+	{
+		_Points.push_back(Index % 50 == 0
+				? Spatial3D(0.5f, -1.0f, 2.0f)
+				: Spatial3D(Math::Randf(-30.0f, 30.0f), Math::Randf(-30.0f, 30.0f), Math::Randf(-30.0f, 30.0f)));
+	}
+	_Points[1] = Spatial3D(1000.0f, -1000.0f, 0.0f);
+
+	JobSystem::Init(3);
+	_Grid.Build(_Points.data(), (uint32)_Points.size());
+	assert(_Grid.GetNumPoints() == _Points.size());
+	checkSpatialHashGrid(_Grid, _Points);
+	JobSystem::Shutdown();
+
+	// Rebuilding smaller, on one thread, reuses the arrays
+	_Points.resize(777);
+	_Grid.Build(_Points.data(), (uint32)_Points.size());
+	checkSpatialHashGrid(_Grid, _Points);
+	assert(_Grid.FindNearest(Spatial3D(999.0f, -1000.0f, 0.0f), 1, 1.e6f, &_Nearest, &_NearestDistance) == 1);
+	assert(_Nearest == 1 && Math::Equals(_NearestDistance, 1.0f, 1.e-3f));
 }
 
-inline void naiveQuatMul(float* output, float* a, float* b)
+static void testCompactInstanceTransform()
 {
-	const float w = (a[3] * b[3]) - (a[0] * b[0]) - (a[1] * b[1]) - (a[2] * b[2]);
-	const float x = (a[0]* b[3]) + (a[3] * b[0]) + (a[1] * b[2]) - (a[2] * b[1]);
-	const float y = (a[1] * b[3]) + (a[3] * b[1]) + (a[2] * b[0]) - (a[0] * b[2]);
-	const float z = (a[2] * b[3]) + (a[3] * b[2]) + (a[0] * b[1]) - (a[1] * b[0]);
+	assert(sizeof(CompactInstanceTransform) == 32);
+
+	Transform Transforms[3] = {
+		Transform(),
+		Transform(Spatial3D(1.0f, -2.0f, 3.0f), Quaternion(Spatial3D(0.0f, 1.0f, 0.0f), 0.5f), Spatial3D(2.0f, 2.0f, 2.0f)),
+		Transform(Spatial3D(-10.0f, 0.5f, 100.0f), Quaternion(Spatial3D(Cartesian3D(1.0f)).Normalized(), -2.0f), Spatial3D(0.5f, 3.0f, 1.0f))
+	};
+	CompactInstanceTransform Packed[3];
+	InstanceData::PackCompactTransforms(Packed, Transforms, 3);
 
-	output[0] = x;
-	output[1] = y;
-	output[2] = z;
-	output[3] = w;
+	for (uint32 i = 0; i < 3; i++)
+	{
+		assert(Packed[i].TranslationScaleX[0] == Transforms[i].GetTranslation().X());
+		assert(Packed[i].TranslationScaleX[3] == Transforms[i].GetScale().X());
+		assert(Packed[i].ScaleYZ[1] == Transforms[i].GetScale().Z());
+
+		Transform Unpacked = InstanceData::UnpackCompactTransform(Packed[i]);
+		assert(Unpacked.ToMatrix().Equals(Transforms[i].ToMatrix(), 1.e-3f));
+	}
+	assert(Packed[0].Rotation[3] == 32767);
 }
 
-inline void naiveQuatRotate(float* output, float* a, float* b)
+static void testProfiler()
 {
-	float conjugate[4];
-	float temp[4];
-	conjugate[0] = -a[0];
-	conjugate[1] = -a[1];
-	conjugate[2] = -a[2];
-	conjugate[3] = a[3];
-	naiveQuatMul(temp, a, b);
-	naiveQuatMul(output, temp, conjugate);
+#if MARS_PROFILING
+	Profiler::EndFrame();
+	{
+		PROFILE_SCOPE("Outer");
+		{
+			PROFILE_SCOPE("Inner");
+		}
+	}
+	Profiler::EndFrame();
+
+	const ProfileEvent* _Outer = nullptr;
+	const ProfileEvent* _Inner = nullptr;
+	const ProfileEvent* _Frame = nullptr;
+	const Array<ProfileEvent>& _Events = Profiler::GetLastFrame();
+	assert(_Events.size() == 3);
+	for (const ProfileEvent& _Event : _Events)
+	{
+		if (strcmp(_Event.Name, "Outer") == 0) { _Outer = &_Event; }
+		if (strcmp(_Event.Name, "Inner") == 0) { _Inner = &_Event; }
+		if (strcmp(_Event.Name, "Frame") == 0) { _Frame = &_Event; }
+	}
+	assert(_Outer != nullptr && _Inner != nullptr && _Frame != nullptr);
+	assert(_Inner->Depth == _Outer->Depth + 1);
+	assert(_Outer->StartTicks <= _Inner->StartTicks && _Inner->EndTicks <= _Outer->EndTicks);
+	assert(_Frame->StartTicks <= _Outer->StartTicks && _Outer->EndTicks <= _Frame->EndTicks);
+#endif
 }
 
-inline void naiveTransformCreate(float* output, float* translation, float* rotation, float* scale)
+static void testFrameStats()
 {
-	Spatial3D translationVec(translation[0],translation[1],translation[2]);
-	Spatial3D scaleVec(scale[0],scale[1],scale[2]);
-	Quaternion rotationVec(rotation[0],rotation[1],rotation[2],rotation[3]);
-	Spatial3D nullTranslation(0.0f);
-	Spatial3D nullScale(1.0f);
-	Matrix translationMatrix = Matrix::Translate(translationVec.Inner());
-	Matrix rotationMatrix = Matrix::TransformMatrix(nullTranslation.Inner(), rotationVec, nullScale.Inner());
-	Matrix scaleMatrix = Matrix::Scale(scaleVec.Inner());
-	float temp[16];
-	naiveMatrixMultiply(temp, (float*)&scaleMatrix, (float*)&rotationMatrix);
-	naiveMatrixMultiply(output, temp, (float*)&translationMatrix);
+	FrameHistogram _Histogram;
+	assert(_Histogram.GetPercentile(50.0) == 0.0);
+	for (uint32 i = 1; i <= 100; i++)
+	{
+		_Histogram.Add((double)i * 0.5 - 0.01);
+	}
+	assert(_Histogram.GetCount() == 100);
+	assert(Math::Abs(_Histogram.GetPercentile(50.0) - 25.0) < 1.e-6);
+	assert(Math::Abs(_Histogram.GetPercentile(99.0) - 49.5) < 1.e-6);
+	assert(Math::Abs(_Histogram.GetPercentile(100.0) - 49.99) < 1.e-6);
+
+	// Overflowing samples report the exact maximum
+	_Histogram.Add(250.0);
+	assert(_Histogram.GetPercentile(100.0) == 250.0);
+	assert(_Histogram.GetMax() == 250.0);
+
+	FrameStats _Stats(33.3);
+	FrameSample _Sample = { 16.0, 2.0, 4.0, 1 };
+	_Stats.AddFrame(_Sample);
+	_Sample.FrameTime = 50.0;
+	_Sample.NumUpdates = 3;
+	_Stats.AddFrame(_Sample);
+	assert(_Stats.GetNumFrames() == 2);
+	assert(_Stats.GetNumHitches() == 1);
+	assert(_Stats.GetMaxUpdatesPerFrame() == 3);
+	assert(Math::Abs(_Stats.GetCPUTimes().GetPercentile(50.0) - 10.0) <= 0.1 + 1.e-6);
 }
 
-inline void naiveMatrixInverse(void* dest, void* src)
+static bool hasBytePattern(const void* Ptr, uintptr Amount)
 {
-	int i, j, k;
-	float* s = (float*)dest;
-	float* t = (float*)src;
-	const int D = 4;
+	for (uintptr Index = 0; Index < Amount; Index++)
+	{
+		if (((const uint8*)Ptr)[Index] != (uint8)(Index * 7))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static void fillBytePattern(void* Ptr, uintptr Amount)
+{
+	for (uintptr Index = 0; Index < Amount; Index++)
+	{
+		((uint8*)Ptr)[Index] = (uint8)(Index * 7);
+	}
+}
 
-	// Forward elimination
-	for (i = 0; i < D - 1 ; i++) {
-		int pivot = i;
+/** Grows a block from the heap into mapped pages and back, checking its contents survive every step. */
+template<typename MemoryType>
+static void testReallocContents()
+{
+	static const uintptr _Sizes[] = { 100, 40, 5000, 1 << 20, 3 << 20, 400 * 1024, 200, 64 };
+	void* _Block = MemoryType::Malloc(_Sizes[0], 16);
+	fillBytePattern(_Block, _Sizes[0]);
+	for (uint32 Index = 1; Index < ARRAY_SIZE_IN_ELEMENTS(_Sizes); Index++)
+	{
+		uintptr _Kept = Math::Min(_Sizes[Index - 1], _Sizes[Index]);
+		_Block = MemoryType::Realloc(_Block, _Sizes[Index], 64);
+		assert(((uintptr)_Block & 63) == 0);
+		assert(MemoryType::GetAllocSize(_Block) >= _Sizes[Index]);
+		assert(hasBytePattern(_Block, _Kept));
+		fillBytePattern(_Block, _Sizes[Index]);
+	}
+	MemoryType::Free(_Block);
+}
 
-		float pivotsize = t[i*4+i];
+static void testGenericMemory()
+{
+	testReallocContents<GenericMemory>();
+
+	// Mapped blocks are resized in place or by moving pages, never copied twice
+	void* _Mapped = GenericMemory::Malloc(GenericPageMemory::MAPPED_THRESHOLD, 16);
+	fillBytePattern(_Mapped, GenericPageMemory::MAPPED_THRESHOLD);
+	_Mapped = GenericMemory::Realloc(_Mapped, 16 * GenericPageMemory::MAPPED_THRESHOLD, 16);
+	assert(GenericMemory::GetAllocSize(_Mapped) == 16 * GenericPageMemory::MAPPED_THRESHOLD);
+	assert(hasBytePattern(_Mapped, GenericPageMemory::MAPPED_THRESHOLD));
+	GenericMemory::Free(_Mapped);
+}
 
-		if (pivotsize < 0)
-			pivotsize = -pivotsize;
+static void testThreadCacheMemory()
+{
+	testReallocContents<ThreadCacheMemory>();
 
-		for (j = i + 1; j < D; j++) {
-			float tmp = t[j*4+i];
+	for (uintptr Amount = 1; Amount <= ThreadCacheMemory::MAX_SMALL_SIZE; Amount++)
+	{
+		uint32 _SizeClass = ThreadCacheMemory::GetSizeClass(Amount);
+		assert(_SizeClass < ThreadCacheMemory::NUM_SIZE_CLASSES);
+		assert(ThreadCacheMemory::GetSizeClassSize(_SizeClass) >= Amount);
+		assert(_SizeClass == 0 || ThreadCacheMemory::GetSizeClassSize(_SizeClass - 1) < Amount);
+		assert(ThreadCacheMemory::GetSizeClassSize(_SizeClass) % 16 == 0);
+	}
+	assert(ThreadCacheMemory::GetSizeClass(ThreadCacheMemory::MAX_SMALL_SIZE) == ThreadCacheMemory::NUM_SIZE_CLASSES - 1);
+
+	// Freed blocks are reused by the next allocation of their class
+	void* _Small = ThreadCacheMemory::Malloc(24, 16);
+	assert(((uintptr)_Small & 15) == 0);
+	assert(ThreadCacheMemory::GetAllocSize(_Small) == 32);
+	ThreadCacheMemory::Free(_Small);
+	assert(ThreadCacheMemory::Malloc(20, 16) == _Small);
+
+	Memory::memset(_Small, (uint8)7, 20);
+	void* _Grown = ThreadCacheMemory::Realloc(_Small, 30, 16);
+	assert(_Grown == _Small);
+	_Grown = ThreadCacheMemory::Realloc(_Grown, 20000, 16);
+	assert(ThreadCacheMemory::GetAllocSize(_Grown) == 20000);
+	assert(((uint8*)_Grown)[0] == 7 && ((uint8*)_Grown)[19] == 7);
+	ThreadCacheMemory::Free(_Grown);
+
+	// Cache line alignment is served from the size classes, not a span of its own
+	for (uint32 Alignment = 32; Alignment <= ThreadCacheMemory::MAX_SMALL_ALIGNMENT; Alignment *= 2)
+	{
+		for (uintptr Amount = 1; Amount <= 1000; Amount += 37)
+		{
+			void* _Block = ThreadCacheMemory::Malloc(Amount, Alignment);
+			assert(((uintptr)_Block & (Alignment - 1)) == 0);
+			assert(ThreadCacheMemory::GetAllocSize(_Block) >= Amount && ThreadCacheMemory::GetAllocSize(_Block) < Amount + 256);
+			assert(ThreadCacheMemory::GetAllocSize(_Block) % Alignment == 0);
+			ThreadCacheMemory::Free(_Block);
+		}
+	}
 
-			if (tmp < 0)
-				tmp = -tmp;
+	void* _Aligned = ThreadCacheMemory::Malloc(100, 256);
+	assert(((uintptr)_Aligned & 255) == 0);
+	ThreadCacheMemory::Free(_Aligned);
 
-			if (tmp > pivotsize) {
-				pivot = j;
-				pivotsize = tmp;
-			}
+	// Blocks allocated on one thread and freed on another go back to the
+	// owning cache, which a later thread adopts and allocates them from.
+	enum { NUM_BLOCKS = 4096 };
+	void* _Blocks[NUM_BLOCKS];
+	std::thread _Producer([&_Blocks]()
+	{
+		for (uint32 i = 0; i < NUM_BLOCKS; i++)
+		{
+			_Blocks[i] = ThreadCacheMemory::Malloc(48, 16);
+			*(uint32*)_Blocks[i] = i;
 		}
+	});
+	_Producer.join();
+	for (uint32 i = 0; i < NUM_BLOCKS; i++)
+	{
+		assert(*(uint32*)_Blocks[i] == i);
+		ThreadCacheMemory::Free(_Blocks[i]);
+	}
+	std::thread _Consumer([&_Blocks]()
+	{
+		for (uint32 i = 0; i < NUM_BLOCKS; i++)
+		{
+			_Blocks[i] = ThreadCacheMemory::Malloc(48, 16);
+		}
+		for (uint32 i = 0; i < NUM_BLOCKS; i++)
+		{
+			ThreadCacheMemory::Free(_Blocks[i]);
+		}
+	});
+	_Consumer.join();
+}
 
-		if (pivotsize == 0) {
-			return;
+static void testLinearArena()
+{
+	LinearArena _Arena(1024);
+	void* _First = _Arena.Allocate(10);
+	void* _Second = _Arena.Allocate(8, 64);
+	assert(((uintptr)_First & 15) == 0 && ((uintptr)_Second & 63) == 0);
+	assert((uint8*)_Second >= (uint8*)_First + 10);
+
+	// Rewinding hands out the same memory again, even across chained blocks
+	LinearArena::Marker _Mark = _Arena.GetMarker();
+	void* _Third = _Arena.Allocate(100);
+	void* _Big = _Arena.Allocate(4000);
+	Memory::memset(_Big, (uint8)1, 4000);
+	_Arena.Rewind(_Mark);
+	assert(_Arena.Allocate(100) == _Third);
+
+	// A Reset after chaining leaves one block that fits the whole frame
+	_Arena.Allocate(4000);
+	_Arena.Reset();
+	assert(_Arena.GetBlockSize() >= 1024 + 4000);
+	uint8* _Merged = (uint8*)_Arena.Allocate(4000);
+	assert((uint8*)_Arena.Allocate(1000) == _Merged + 4000);
+
+	ScratchScope _OuterScope;
+	void* _Start;
+	{
+		ScratchScope _Scope;
+		_Start = ScratchAllocator::Allocate(16);
+		ScratchArray<uint32> _Values;
+		for (uint32 i = 0; i < 1000; i++)
+		{
+			_Values.push_back(i);
 		}
+		assert(_Values[999] == 999);
+		ScratchString _Text("scratch");
+		_Text += " memory";
+		assert(_Text == "scratch memory");
+	}
+	assert(ScratchAllocator::Allocate(16) == _Start);
+}
 
-		if (pivot != i) {
-			for (j = 0; j < D; j++) {
-				float tmp;
+static void testMemoryTracker()
+{
+#if MARS_MEMORY_TRACKING
+	MemoryTagStats _Before = MemoryTracker::GetTagStats(MEMORY_TAG_MATH);
+	void* _Block;
+	{
+		MEMORY_TAG_SCOPE(MEMORY_TAG_MATH);
+		_Block = Memory::malloc(1000);
+	}
+	assert(MemoryTracker::GetCurrentTag() == MEMORY_TAG_UNTAGGED);
+	assert(Memory::getAllocSize(_Block) == 1000);
+	assert(MemoryTracker::GetTagStats(MEMORY_TAG_MATH).CurrentBytes == _Before.CurrentBytes + 1000);
+
+	// Reallocating keeps the block charged to its original tag
+	_Block = Memory::realloc(_Block, 3000);
+	MemoryTagStats _After = MemoryTracker::GetTagStats(MEMORY_TAG_MATH);
+	assert(_After.CurrentBytes == _Before.CurrentBytes + 3000);
+	assert(_After.PeakBytes >= _After.CurrentBytes);
+
+	Memory::free(_Block);
+	assert(MemoryTracker::GetTagStats(MEMORY_TAG_MATH).CurrentBytes == _Before.CurrentBytes);
+
+	MemoryTracker::EndFrame();
+	assert(MemoryTracker::GetTagStats(MEMORY_TAG_MATH).FrameAllocations >= 2);
+#endif
+}
 
-				tmp = t[i*4+j];
-				t[i*4+j] = t[pivot*4+j];
-				t[pivot*4+j] = tmp;
+static void testArray()
+{
+	// Stays inline until it outgrows its inline capacity, keeping its elements when it spills
+	InlineArray<uint32, 4> _Small;
+	for (uint32 i = 0; i < 4; i++)
+	{
+		_Small.push_back(i);
+	}
+	assert(_Small.IsInline() && _Small.capacity() == 4);
+	_Small.push_back(4);
+	assert(!_Small.IsInline());
+	for (uint32 i = 0; i < 5; i++)
+	{
+		assert(_Small[i] == i);
+	}
+	_Small.resize(2);
+	_Small.shrink_to_fit();
+	assert(_Small.IsInline() && _Small.size() == 2 && _Small[1] == 1);
+
+	InlineArray<String, 2> _Moved;
+	_Moved.push_back("a");
+	_Moved.push_back("b");
+	InlineArray<String, 2> _Target(std::move(_Moved));
+	assert(_Moved.empty() && _Target.size() == 2 && _Target[1] == "b");
+
+	// Empty arrays move without copying from their null data, and moves never throw,
+	// so standard containers move rather than copy them
+	Array<uint32> _Empty;
+	Array<uint32> _FromEmpty(std::move(_Empty));
+	assert(_FromEmpty.empty() && _FromEmpty.data() == nullptr);
+	static_assert(std::is_nothrow_move_constructible<Array<String>>::value, "Array moves must be noexcept");
+	static_assert(std::is_nothrow_move_assignable<Array<String>>::value, "Array moves must be noexcept");
+
+	// Elements that need their constructors, inserted, erased and pushed from themselves
+	Array<String> _Strings;
+	for (uint32 i = 0; i < 100; i++)
+	{
+		_Strings.push_back(FString::toString(i));
+	}
+	_Strings.push_back(_Strings[0]);
+	_Strings.insert(_Strings.begin() + 1, "inserted");
+	_Strings.erase(_Strings.begin() + 2, _Strings.begin() + 12);
+	assert(_Strings.size() == 92);
+	assert(_Strings[1] == "inserted" && _Strings[2] == "11" && _Strings.back() == "0");
+	Array<String> _Copy(_Strings);
+	assert(_Copy == _Strings);
+	_Copy.clear();
+	_Copy.swap(_Strings);
+	assert(_Strings.empty() && _Copy.size() == 92);
+
+	// Arrays of arrays grow by moving the inner arrays bytewise
+	Array<Array<float>> _Nested;
+	for (uint32 i = 0; i < 50; i++)
+	{
+		_Nested.push_back(Array<float>(i + 1, (float)i));
+	}
+	assert(_Nested[49].size() == 50 && _Nested[49][49] == 49.0f && _Nested[3][0] == 3.0f);
 
-				tmp = s[i*4+j];
-				s[i*4+j] = s[pivot*4+j];
-				s[pivot*4+j] = tmp;
-			}
-		}
+	Array<float> _Floats;
+	for (uint32 i = 0; i < 1000; i++)
+	{
+		float* _Dest = _Floats.PushBackUninitialized(3);
+		_Dest[0] = (float)i;
+		_Dest[1] = 0.0f;
+		_Dest[2] = 1.0f;
+	}
+	assert(_Floats.size() == 3000 && _Floats[2997] == 999.0f && _Floats[2999] == 1.0f);
+}
 
-		for (j = i + 1; j < D; j++) {
-			float f = t[j*4+i] / t[i*4+i];
+static void testMap()
+{
+	// Enough keys to grow several times, with every other one erased and re-added
+	Map<uint32, uint32> _Numbers;
+	for (uint32 i = 0; i < 10000; i++)
+	{
+		_Numbers[i] = i * 3;
+	}
+	for (uint32 i = 0; i < 10000; i += 2)
+	{
+		assert(_Numbers.erase(i) == 1);
+	}
+	assert(_Numbers.size() == 5000 && _Numbers.erase(0u) == 0);
+	for (uint32 i = 0; i < 10000; i++)
+	{
+		Map<uint32, uint32>::iterator _It = _Numbers.find(i);
+		assert((i % 2 == 0) == (_It == _Numbers.end()));
+		assert(_It == _Numbers.end() || _It->second == i * 3);
+	}
+	uint64 _Sum = 0;
+	for (const std::pair<uint32, uint32>& _Entry : _Numbers)
+	{
+		_Sum += _Entry.first;
+	}
+	assert(_Sum == 25000000ull);
 
-			for (k = 0; k < D; k++) {
-				t[j*4+k] -= f * t[i*4+k];
-				s[j*4+k] -= f * s[i*4+k];
+	// Inserting and erasing in a loop reuses deleted slots instead of growing forever
+	uintptr _Capacity = _Numbers.capacity();
+	for (uint32 i = 0; i < 100000; i++)
+	{
+		_Numbers[20000 + i] = i;
+		_Numbers.erase(20000 + i);
+	}
+	assert(_Numbers.capacity() == _Capacity && _Numbers.size() == 5000);
+
+	// String keys can be looked up without building a String
+	Map<String, String> _Names;
+	_Names["diffuse"] = "bricks.dds";
+	_Names.insert(std::make_pair(String("normal"), String("bricks_n.dds")));
+	assert(!_Names.try_emplace("diffuse", "other.dds").second);
+	assert(_Names.count("diffuse") == 1 && _Names.find("normal")->second == "bricks_n.dds");
+	assert(_Names.find("specular") == _Names.end());
+
+	Map<String, String> _Copy(_Names);
+	_Names.clear();
+	assert(_Names.empty() && _Copy.size() == 2 && _Copy["diffuse"] == "bricks.dds");
+	Map<String, String> _Moved(std::move(_Copy));
+	assert(_Copy.empty() && _Moved.size() == 2);
+}
+
+/** Checks Memset left Amount bytes at Ptr holding repeats of Val, and the bytes around them alone. */
+template<typename T>
+static void testMemsetPattern(T Val)
+{
+	uint8 _Buffer[300];
+	for (uintptr Offset = 0; Offset < 40; Offset += 3)
+	{
+		for (uintptr Amount = 0; Amount < 250; Amount += 7)
+		{
+			Memory::memset(_Buffer, (uint8)0xCD, sizeof(_Buffer));
+			Memory::memset(_Buffer + Offset, Val, Amount);
+			for (uintptr Index = 0; Index < sizeof(_Buffer); Index++)
+			{
+				bool _bFilled = Index >= Offset && Index < Offset + Amount;
+				uint8 _Expected = _bFilled ? ((const uint8*)&Val)[(Index - Offset) % sizeof(T)] : (uint8)0xCD;
+				assert(_Buffer[Index] == _Expected);
 			}
 		}
 	}
+}
 
-	// Backward substitution
-	for (i = D - 1; i >= 0; --i) {
-		float f;
-
-		if ((f = t[i*4+i]) == 0) {
-			return;
+void testMemory()
+{
+	struct Pattern16 { uint64 Low, High; };
+	Pattern16 _Pattern16 = { 0x0706050403020100ull, 0x0F0E0D0C0B0A0908ull };
+	testMemsetPattern<uint8>(0x5A);
+	testMemsetPattern<uint16>(0x0102);
+	testMemsetPattern<int32>(0x01020304);
+	testMemsetPattern<uint64>(0x0102030405060708ull);
+	testMemsetPattern<Pattern16>(_Pattern16);
+
+	uint8 _A[200];
+	uint8 _B[200];
+	for (uintptr Size = 0; Size < 150; Size += 5)
+	{
+		fillBytePattern(_A, sizeof(_A));
+		Memory::memset(_B, (uint8)0xEE, sizeof(_B));
+		Memory::memswap(_A + 1, _B + 3, Size);
+		for (uintptr Index = 0; Index < Size; Index++)
+		{
+			assert(_A[Index + 1] == 0xEE);
+			assert(_B[Index + 3] == (uint8)((Index + 1) * 7));
 		}
+		assert(_A[Size + 1] == (uint8)((Size + 1) * 7));
+		assert(_B[Size + 3] == 0xEE);
+	}
 
-		for (j = 0; j < D; j++) {
-			t[i*4+j] /= f;
-			s[i*4+j] /= f;
-		}
+	// Big enough to go through the streaming stores, starting off alignment at both ends
+	const uintptr _CopySize = 64 * 1024 + 13;
+	uint8* _Source = (uint8*)Memory::malloc(_CopySize + 16);
+	uint8* _Dest = (uint8*)Memory::malloc(_CopySize + 16);
+	fillBytePattern(_Source + 5, _CopySize);
+	Memory::memset(_Dest, (uint8)0, _CopySize + 16);
+	Memory::memcpyStreaming(_Dest + 3, _Source + 5, _CopySize);
+	assert(hasBytePattern(_Dest + 3, _CopySize));
+	assert(_Dest[2] == 0 && _Dest[_CopySize + 3] == 0);
+	Memory::free(_Source);
+	Memory::free(_Dest);
+}
+
+static void testHandlePool()
+{
+	struct TestTag {};
+	typedef HandlePool<TestTag> TestPool;
+	TestPool _Pool;
+	Array<uint32> _Values;
+	Array<String> _Names;
+
+	assert(!TestPool::HandleType().IsValid());
+	assert(_Pool.Find(TestPool::HandleType()) == TestPool::INVALID_INDEX);
+
+	TestPool::HandleType _Handles[4];
+	for (uint32 Index = 0; Index < 4; Index++)
+	{
+		_Handles[Index] = _Pool.Allocate();
+		_Values.push_back(Index * 10);
+		_Names.push_back(FString::toString(Index));
+		assert(_Handles[Index].IsValid());
+		assert(_Pool.GetDenseIndex(_Handles[Index]) == Index);
+	}
+	assert(_Pool.GetNum() == 4);
+
+	// The last object moves into the freed dense index, in every column
+	_Pool.Free(_Handles[1], _Values, _Names);
+	assert(_Pool.GetNum() == 3 && _Values.size() == 3 && _Names.size() == 3);
+	assert(!_Pool.IsValid(_Handles[1]));
+	assert(_Pool.Find(_Handles[1]) == TestPool::INVALID_INDEX);
+	uint32 _Moved = _Pool.GetDenseIndex(_Handles[3]);
+	assert(_Moved == 1 && _Values[_Moved] == 30 && _Names[_Moved] == "3");
+	assert(_Pool.GetHandle(_Moved) == _Handles[3]);
+	assert(_Values[_Pool.GetDenseIndex(_Handles[0])] == 0);
+	assert(_Values[_Pool.GetDenseIndex(_Handles[2])] == 20);
+
+	// The freed slot is reused under a new generation, so the old handle stays stale
+	TestPool::HandleType _Reused = _Pool.Allocate();
+	_Values.push_back(40);
+	_Names.push_back("4");
+	assert(_Reused.GetIndex() == _Handles[1].GetIndex());
+	assert(_Reused.GetGeneration() == _Handles[1].GetGeneration() + 1);
+	assert(_Reused != _Handles[1]);
+	assert(!_Pool.IsValid(_Handles[1]));
+	assert(_Values[_Pool.GetDenseIndex(_Reused)] == 40);
+
+	// Freeing the last dense index moves nothing
+	_Pool.Free(_Reused, _Values, _Names);
+	assert(_Values.size() == 3 && _Values[_Pool.GetDenseIndex(_Handles[3])] == 30);
+
+	// Generations wrap around without ever reaching 0
+	TestPool::HandleType _Cycled = _Pool.Allocate();
+	_Values.push_back(0);
+	_Names.push_back("");
+	for (uint32 Index = 0; Index < TestPool::HandleType::MAX_GENERATION; Index++)
+	{
+		_Pool.Free(_Cycled, _Values, _Names);
+		_Cycled = _Pool.Allocate();
+		_Values.push_back(Index);
+		_Names.push_back("");
+		assert(_Cycled.GetGeneration() != 0);
+	}
+	assert(_Cycled.GetIndex() == _Handles[1].GetIndex() && _Pool.IsValid(_Cycled));
 
-		for (j = 0; j < i; j++) {
-			f = t[j*4+i];
+	for (uint32 Index = 0; Index < _Pool.GetNum(); Index++)
+	{
+		assert(_Pool.GetDenseIndex(_Pool.GetHandle(Index)) == Index);
+	}
+}
 
-			for (k = 0; k < D; k++) {
-				t[j*4+k] -= f * t[i*4+k];
-				s[j*4+k] -= f * s[i*4+k];
+static void testStringId()
+{
+	static_assert(STRING_ID("diffuse").GetValue() == StringId::HashLiteral("diffuse"),
+			"STRING_ID must be a constant expression");
+	assert(!StringId().IsValid());
+
+	// Literal and runtime ids agree, and interning records the text once
+	const String _Runtime = String("test") + "StringId.diffuse";
+	uint32 _NumInterned = StringId::GetNumInterned();
+	assert(STRING_ID("testStringId.diffuse").GetString() == nullptr);
+	StringId _Interned = StringId::Intern(_Runtime);
+	assert(_Interned == STRING_ID("testStringId.diffuse"));
+	assert(StringId::Intern("testStringId.diffuse") == _Interned);
+	assert(StringId::Intern("testStringId.diffuse.extra", 20) == _Interned);
+	assert(StringId::GetNumInterned() == _NumInterned + 1);
+	assert(strcmp(_Interned.GetString(), "testStringId.diffuse") == 0);
+	assert(STRING_ID("testStringId.normal") != _Interned);
+
+	Map<StringId, int32> _Locations;
+	_Locations[STRING_ID("testStringId.diffuse")] = 3;
+	_Locations[StringId::Intern("testStringId.normal")] = 4;
+	assert(_Locations.find(_Interned)->second == 3);
+	assert(_Locations[STRING_ID("testStringId.normal")] == 4);
+
+	// Threads racing to intern the same names all get one copy of each
+	const uint32 _NumThreads = 4;
+	const uint32 _NumNames = 500;
+	_NumInterned = StringId::GetNumInterned();
+	std::thread _Threads[_NumThreads];
+	for (uint32 Thread = 0; Thread < _NumThreads; Thread++)
+	{
+		_Threads[Thread] = std::thread([=]()
+		{
+			for (uint32 Index = 0; Index < _NumNames; Index++)
+			{
+				uint32 _Name = (Index + Thread * 97) % _NumNames;
+				String _Text = "testStringId.thread." + FString::toString(_Name);
+				assert(StringId::Intern(_Text) == StringId(StringId::Hash(_Text.data(), _Text.size())));
 			}
+		});
+	}
+	for (uint32 Thread = 0; Thread < _NumThreads; Thread++)
+	{
+		_Threads[Thread].join();
+	}
+	assert(StringId::GetNumInterned() == _NumInterned + _NumNames);
+	for (uint32 Index = 0; Index < _NumNames; Index++)
+	{
+		String _Text = "testStringId.thread." + FString::toString(Index);
+		assert(StringId::Intern(_Text).GetString() == _Text);
+	}
+}
+
+static void testLogger()
+{
+	FILE* _File = tmpfile();
+	assert(_File != nullptr);
+	Logger::SetOutput(_File);
+
+	// Enough to wrap every thread's buffer several times
+	const uint32 _NumThreads = 4;
+	const uint32 _NumMessages = 5000;
+	std::thread _Threads[_NumThreads];
+	for (uint32 Thread = 0; Thread < _NumThreads; Thread++)
+	{
+		_Threads[Thread] = std::thread([=]()
+		{
+			for (uint32 Index = 0; Index < _NumMessages; Index++)
+			{
+				String _Text = "text" + FString::toString(Index);
+				DEBUG_LOG("Test", LOG_INFO, "thread %u message %u %s %.1f", Thread, Index, _Text.c_str(), 0.5);
+			}
+		});
+	}
+	for (uint32 Thread = 0; Thread < _NumThreads; Thread++)
+	{
+		_Threads[Thread].join();
+	}
+	DEBUG_LOG("Test", LOG_DEBUG, "no arguments, %% escaped");
+	Logger::Flush();
+	Logger::SetOutput(nullptr);
+
+	uint32 _NextIndex[_NumThreads] = {};
+	uint32 _NumLines = 0;
+	bool _bSawLast = false;
+	char _Line[256];
+	rewind(_File);
+	while (fgets(_Line, sizeof(_Line), _File) != nullptr)
+	{
+		uint32 _Thread, _Index, _TextIndex;
+		const char* _Message = strstr(_Line, "): ");
+		assert(strncmp(_Line, "[Test] [", 8) == 0 && _Message != nullptr);
+		if (strcmp(_Message, "): no arguments, % escaped\n") == 0)
+		{
+			_bSawLast = true;
+			continue;
 		}
+		assert(strstr(_Line, "[Info]") != nullptr);
+		assert(sscanf(_Message, "): thread %u message %u text%u 0.5", &_Thread, &_Index, &_TextIndex) == 3);
+		// Each thread's messages come out whole and in order
+		assert(_Thread < _NumThreads && _Index == _NextIndex[_Thread] && _TextIndex == _Index);
+		_NextIndex[_Thread]++;
+		_NumLines++;
+	}
+	assert(_NumLines == _NumThreads * _NumMessages && _bSawLast);
+	fclose(_File);
+
+	// Far more threads than there are buffers, one after another, reuse those of the exited ones
+	_File = tmpfile();
+	assert(_File != nullptr);
+	Logger::SetOutput(_File);
+	const uint32 _NumShortThreads = 200;
+	for (uint32 Thread = 0; Thread < _NumShortThreads; Thread++)
+	{
+		std::thread([=]() { DEBUG_LOG("Test", LOG_INFO, "short thread %u", Thread); }).join();
+		Logger::Flush();
 	}
+	Logger::SetOutput(nullptr);
+
+	uint32 _NextThread = 0;
+	rewind(_File);
+	while (fgets(_Line, sizeof(_Line), _File) != nullptr)
+	{
+		uint32 _Thread;
+		assert(sscanf(strstr(_Line, "): "), "): short thread %u", &_Thread) == 1 && _Thread == _NextThread);
+		_NextThread++;
+	}
+	assert(_NextThread == _NumShortThreads);
+	fclose(_File);
 }
 
-void Tests::runPerformanceTests()
+struct JobTestCounters
 {
-	double startTime = Time::getTime();
-	Transform transform;
-	Matrix transformMat = transform.ToMatrix();
-	// Performance results for release build on AMD Athlon X4 860K
-	// 100M sets of 8 dot3 products = 0.602984 seconds (or 1.122339)
-	// 100M sets of 8 naive dot3 products = ~0.66 seconds (or 1.177717)
-	// Vectorized ~ 1.1x faster
-
-	// 100M sets of 8 dot4 products = 0.749585 seconds (or 1.19)
-	// 100M sets of 8 naive dot4 products = ~1.15 seconds (or 1.478542)
-	// Vectorized ~ 1.5x faster
-
-	// 100M sets of 8 cross products = 0.421812 seconds (or 0.816521)
-	// 100M sets of 8 generic cross products = 1.787127 seconds
-	// 100M sets of 8 naive cross products = 1.908947 seconds
-	// Vectorized ~ 2 to 4.5x faster
-
-	// 100M sets of 8 quaternion multiplies = 1.981629 seconds
-	// 100M sets of 8 generic quaternion multiplies = 5.189267 seconds (now replaced with naive method)
-	// 100M sets of 8 naive quaternion multiplies = 4.489309 seconds
-	// Vectorized ~ 2.27x faster
-
-// NOTE: From this point on, some of the algorithmic improvements
-// could also be applied to the non-vectorized techniques
-
-	// 100M sets of 8 quaternion rotates = 2.076706 seconds
-	// 100M sets of 8 generic quaternion rotates = 5.436006 seconds
-	// 100M sets of 8 naive quaternion rotates = 7.881377 seconds
-	// Vectorized ~ 3.79x faster
-
-	// 100M sets of 2 matrix multiplies = 1.244078 seconds
-	// 100M sets of 2 generic matrix multiplies = 3.678728 seconds
-	// 100M sets of 2 naive matrix multiplies = 32.592669 seconds
-	// Vectorized ~ 26.2x faster
-
-	// 100M sets of 2 transform matrix generations = 0.142155 seconds (???) (Probably more like 1.8 seconds in reality)
-	// 100M sets of 2 naive transform matrix generations = 34.912099 seconds
-	// Vectorized ~ 245x faster?????  (Probably more like 20x in reality)
-
-	// 100M sets of 2 matrix inverses = 3.439625 seconds
-	// 100M sets of 2 generic matrix inverses = 7.160924 seconds
-	// 100M sets of 2 naive matrix inverses = 26.904145 seconds
-	// 100M sets of 2 UE4 matrix inverses = 6.570406 seconds
-	// 100M sets of 2 algorithmically faster matrix inverses = 6.578339 seconds
-	// Vectorized ~ 7.82x faster
-
-	Vector vec1s[8] = {
-		Vector::Make(1.0f,1.0f,1.0f,1.0f),
-		Vector::Make(1.0f,1.0f,1.0f,1.0f),
-		Vector::Make(1.0f,1.0f,1.0f,1.0f),
-		Vector::Make(1.0f,1.0f,1.0f,1.0f),
-		Vector::Make(1.0f,1.0f,1.0f,1.0f),
-		Vector::Make(1.0f,1.0f,1.0f,1.0f),
-		Vector::Make(1.0f,1.0f,1.0f,1.0f),
-		Vector::Make(1.0f,1.0f,1.0f,1.0f),
+	std::atomic<uint32>* Counter;
+	uint32 NumGrandchildren;
+};
+
+static void countJob(Job* InJob, void* Data)
+{
+	const JobTestCounters& _Counters = *(const JobTestCounters*)Data;
+	_Counters.Counter->fetch_add(1);
+	JobTestCounters _Leaf = { _Counters.Counter, 0 };
+	for (uint32 Index = 0; Index < _Counters.NumGrandchildren; Index++)
+	{
+		JobSystem::Run(JobSystem::CreateChildJob(InJob, &countJob, _Leaf));
+	}
+}
+
+/** More jobs than a thread's ring holds, under roots that stay in flight meanwhile and must not be reused. */
+static void checkJobsBeyondRing()
+{
+	std::atomic<uint32> _Counter(0);
+	Job* _Root = JobSystem::CreateJob([](Job*, void*) {});
+	JobTestCounters _Leaves = { &_Counter, 0 };
+	for (uint32 Index = 0; Index < 3 * JobSystem::MAX_JOBS_PER_THREAD; Index++)
+	{
+		JobSystem::Run(JobSystem::CreateChildJob(_Root, &countJob, _Leaves));
+	}
+	JobSystem::Run(_Root);
+	JobSystem::Wait(_Root);
+	assert(_Counter.load() == 3 * JobSystem::MAX_JOBS_PER_THREAD);
+
+	Array<uint8> _Items(100000);
+	std::atomic<uint32> _Sum(0);
+	JobSystem::ParallelFor(_Items, 1, [&](uint8*, uint32 Count) { _Sum.fetch_add(Count); });
+	assert(_Sum.load() == _Items.size());
+}
+
+static void testJobSystem()
+{
+	Array<uint32> _Items;
+	_Items.resize(100000, 0);
+	auto _Increment = [](uint32* Items, uint32 Count)
+	{
+		// 100000 items in batches of 64 would be more than MAX_PARALLEL_FOR_BATCHES
+		assert(Count <= (100000 + JobSystem::MAX_PARALLEL_FOR_BATCHES - 1) / JobSystem::MAX_PARALLEL_FOR_BATCHES);
+		for (uint32 Index = 0; Index < Count; Index++)
+		{
+			Items[Index]++;
+		}
 	};
-	Vector vec2s[8] = {
-		Vector::Make(1.0f,1.0f,1.0f,1.0f),
-		Vector::Make(1.0f,1.0f,1.0f,1.0f),
-		Vector::Make(1.0f,1.0f,1.0f,1.0f),
-		Vector::Make(1.0f,1.0f,1.0f,1.0f),
-		Vector::Make(1.0f,1.0f,1.0f,1.0f),
-		Vector::Make(1.0f,1.0f,1.0f,1.0f),
-		Vector::Make(1.0f,1.0f,1.0f,1.0f),
-		Vector::Make(1.0f,1.0f,1.0f,1.0f),
+
+	// Before Init everything runs inline
+	assert(JobSystem::GetNumThreads() == 1);
+	JobSystem::ParallelFor(_Items, 64, _Increment);
+
+	JobSystem::Init(3);
+	assert(JobSystem::GetNumThreads() == 4);
+	for (uint32 Pass = 0; Pass < 10; Pass++)
+	{
+		JobSystem::ParallelFor(_Items, 64, _Increment);
+	}
+	for (uint32 Index = 0; Index < _Items.size(); Index++)
+	{
+		assert(_Items[Index] == 11);
+	}
+	JobSystem::ParallelFor(_Items.data(), 0, 64, _Increment);
+
+	// The root finishes only after its children and their children
+	std::atomic<uint32> _Counter(0);
+	Job* _Root = JobSystem::CreateJob([](Job*, void*) {});
+	JobTestCounters _Counters = { &_Counter, 3 };
+	for (uint32 Index = 0; Index < 500; Index++)
+	{
+		JobSystem::Run(JobSystem::CreateChildJob(_Root, &countJob, _Counters));
+	}
+	JobSystem::Run(_Root);
+	JobSystem::Wait(_Root);
+	assert(JobSystem::IsFinished(_Root) && _Counter.load() == 500 * 4);
+	checkJobsBeyondRing();
+
+	// Jobs run inline on threads the system does not know
+	std::thread _Outside([&]()
+	{
+		JobSystem::ParallelFor(_Items, 64, _Increment);
+	});
+	_Outside.join();
+	assert(_Items[0] == 12 && _Items[_Items.size() - 1] == 12);
+
+	JobSystem::Shutdown();
+	assert(JobSystem::GetNumThreads() == 1);
+
+	JobSystem::Init(1);
+	JobSystem::ParallelFor(_Items, 64, _Increment);
+	JobSystem::Shutdown();
+	assert(_Items[500] == 13);
+
+	// With no workers everything queues up on the one thread
+	JobSystem::Init(0);
+	checkJobsBeyondRing();
+	JobSystem::Shutdown();
+}
+
+static void testTripleBuffer()
+{
+	struct Pair
+	{
+		uint64 First;
+		uint64 Second;
 	};
+	TripleBuffer<Pair> _Buffer(Pair{ 0, 0 });
+	assert(!_Buffer.Acquire());
+
+	_Buffer.GetWriteBuffer() = Pair{ 1, 1 };
+	_Buffer.Publish();
+	_Buffer.GetWriteBuffer() = Pair{ 2, 2 };
+	_Buffer.Publish();
+	assert(_Buffer.Acquire() && _Buffer.GetReadBuffer().First == 2);
+	assert(!_Buffer.Acquire() && _Buffer.GetReadBuffer().First == 2);
+
+	// The consumer only ever sees whole values, in order, and always gets the last one
+	const uint64 _NumValues = 200000;
+	std::thread _Producer([&]()
+	{
+		for (uint64 Value = 3; Value <= _NumValues; Value++)
+		{
+			Pair& _Pair = _Buffer.GetWriteBuffer();
+			_Pair.First = Value;
+			_Pair.Second = Value * 3;
+			_Buffer.Publish();
+		}
+	});
+	uint64 _Last = 2;
+	while (_Last != _NumValues)
+	{
+		if (_Buffer.Acquire())
+		{
+			const Pair& _Pair = _Buffer.GetReadBuffer();
+			assert(_Pair.First > _Last && _Pair.Second == _Pair.First * 3);
+			_Last = _Pair.First;
+		}
+	}
+	_Producer.join();
+	assert(!_Buffer.Acquire());
+
+	Transform _From(Spatial3D(Cartesian3D(0.0f, 0.0f, 0.0f)));
+	Transform _To(Spatial3D(Cartesian3D(2.0f, 4.0f, 6.0f)), Quaternion(Spatial3D(Cartesian3D(0.0f, 0.0f, 1.0f)), 1.0f), Spatial3D(Cartesian3D(3.0f)));
+	Transform _Half = Math::Lerp(_From, _To, 0.5f);
+	assert(_Half.GetTranslation() == Spatial3D(Cartesian3D(1.0f, 2.0f, 3.0f)));
+	assert(_Half.GetScale() == Spatial3D(Cartesian3D(2.0f)));
+	assert(Math::Abs(_Half.GetRotation().GetAngle() - 0.5f) < 1.e-3f);
+	assert(Math::Lerp(_From, _To, 1.0f).ToMatrix().Equals(_To.ToMatrix()));
+}
 
-	float point1Floats[8][4];
-	float point2Floats[8][4];
-	float temp = 4.0f;
-	for(uint32 i = 0; i < 8; i++) {
-//		vec1s[i] = Vector::make(Math::randf()*2.0f-1.0f, Math::randf()*2.0f-1.0f, Math::randf()*2.0f-1.0f, Math::randf()*2.0f-1.0f);
-//		vec2s[i] = Vector::make(Math::randf()*2.0f-1.0f, Math::randf()*2.0f-1.0f, Math::randf()*2.0f-1.0f, Math::randf()*2.0f-1.0f);
-		vec1s[i] = vec1s[i] / Vector::Make(temp,temp,temp,temp);
-		vec2s[i] = vec2s[i] / Vector::Make(temp,temp,temp,temp);
-		vec1s[i].Store4f(point1Floats[i]);
-		vec2s[i].Store4f(point2Floats[i]);
-	}
-	for(uint32 i = 0; i < 100000000; i++) {
-//		naiveQuatRotate(point1Floats[0],point1Floats[0],point2Floats[0]);
-//		naiveQuatRotate(point1Floats[1],point1Floats[1],point2Floats[1]);
-//		naiveQuatRotate(point1Floats[2],point1Floats[2],point2Floats[2]);
-//		naiveQuatRotate(point1Floats[3],point1Floats[3],point2Floats[3]);
-//		naiveQuatRotate(point1Floats[4],point1Floats[4],point2Floats[4]);
-//		naiveQuatRotate(point1Floats[5],point1Floats[5],point2Floats[5]);
-//		naiveQuatRotate(point1Floats[6],point1Floats[6],point2Floats[6]);
-//		naiveQuatRotate(point1Floats[7],point1Floats[7],point2Floats[7]);
-//		naiveMatrixMultiply(point1Floats[0], point1Floats[0], point1Floats[0]);
-//		naiveMatrixMultiply(point2Floats[4], point2Floats[4], point2Floats[4]);
-//		Vector::matrixInverse(&vec1s[0], &vec1s[0]);
-//		Vector::matrixInverse(&vec1s[4], &vec1s[4]);
-//		Vector::matrixMul(&vec1s[0], &vec1s[0], &vec1s[0]);
-//		Vector::matrixMul(&vec1s[4], &vec1s[4], &vec1s[4]);
-//		Vector::createTransformMatrix(&vec1s[0], vec1s[0], vec2s[0], vec2s[0]);
-//		Vector::createTransformMatrix(&vec1s[4], vec1s[4], vec2s[4], vec2s[4]);
-//		naiveTransformCreate(point1Floats[0], point1Floats[0], point2Floats[0], point2Floats[0]);
-//		naiveTransformCreate(point1Floats[4], point1Floats[4], point2Floats[4], point2Floats[4]);
-//		vec1s[0] = vec1s[0].quatRotateVec(vec2s[0]);
-//		vec1s[0] = vec1s[0].quatRotateVec(vec2s[0]);
-//		vec1s[1] = vec1s[1].quatRotateVec(vec2s[1]);
-//		vec1s[2] = vec1s[2].quatRotateVec(vec2s[2]);
-//		vec1s[3] = vec1s[3].quatRotateVec(vec2s[3]);
-//		vec1s[4] = vec1s[4].quatRotateVec(vec2s[4]);
-//		vec1s[5] = vec1s[5].quatRotateVec(vec2s[5]);
-//		vec1s[6] = vec1s[6].quatRotateVec(vec2s[6]);
-//		vec1s[7] = vec1s[7].quatRotateVec(vec2s[7]);
-		for(uint32 j = 0; j < 8; j++) {
-//			vec1s[j] = vec1s[j].dot4(vec2s[j]);
-//			float dotProduct0 = point1Floats[j][0]*point2Floats[j][0]+point1Floats[j][1]*point2Floats[j][1]+point1Floats[j][2]*point2Floats[j][2]+point1Floats[j][3]*point2Floats[j][3];
-//			point1Floats[j][0] = dotProduct0;
-//			point1Floats[j][1] = dotProduct0;
-//			point1Floats[j][2] = dotProduct0;
-//			point1Floats[j][3] = dotProduct0;
+static void testFramePacing()
+{
+	uint64 _Start = Time::getNanoseconds();
+	assert(Math::Abs(Time::getTime() - Time::toSeconds(_Start)) < 0.1);
+	assert(Time::getSleepMargin() > 0);
+
+	// Deadlines are a period apart however long each frame takes, and are never returned early
+	const uint64 _Period = 2000000;
+	FrameLimiter _Limiter(_Period);
+	uint64 _LastDeadline = _Limiter.Wait();
+	uint64 _TotalLateness = 0;
+	for (uint32 Frame = 0; Frame < 20; Frame++)
+	{
+		uint64 _Deadline = _Limiter.Wait();
+		uint64 _Now = Time::getNanoseconds();
+		assert(_Now >= _Deadline);
+		_TotalLateness += _Now - _Deadline;
+		if (_Deadline != _LastDeadline + _Period)
+		{
+			// Only when the thread was descheduled for over a period
+			assert(_Deadline > _LastDeadline + _Period);
 		}
+		_LastDeadline = _Deadline;
 	}
-	for(uint32 i = 0; i < 8; i++) {
-//		vec1s[i]=vec1s[i].load4f(point1Floats[i]);
-//		vec2s[i]=vec2s[i].load4f(point2Floats[i]);
+	// Loose, as the machine running the tests may be busy
+	assert(_TotalLateness / 20 < 1000000);
+
+	// A late caller gets up to MaxLateSteps back to back, and the rest are dropped
+	const uint64 _Step = 1000000;
+	FixedStepScheduler _Scheduler(_Step, 2);
+	uint64 _First = _Scheduler.WaitForStep();
+	Time::sleepUntil(_First + 10 * _Step + _Step / 2);
+	uint64 _Late = _Scheduler.WaitForStep();
+	assert(_Scheduler.GetNumDroppedSteps() >= 7);
+	assert(_Late == _First + (1 + _Scheduler.GetNumDroppedSteps()) * _Step);
+	assert(_Scheduler.WaitForStep() == _Late + _Step);
+	assert(_Scheduler.GetNumSteps() == 3);
+}
+
+void Tests::RunTests()
+{
+	testSphere();
+	testAABB();
+	testBoundsBatch();
+	testMath();
+	testAffineMatrix();
+	testPlane();
+	testIntersects();
+	testBVH();
+	testAABBTree();
+	testSpatialHashGrid();
+	testCompactInstanceTransform();
+	testProfiler();
+	testFrameStats();
+	testGenericMemory();
+	testThreadCacheMemory();
+	testLinearArena();
+	testMemoryTracker();
+	testArray();
+	testMap();
+	testHandlePool();
+	testStringId();
+	testLogger();
+	testJobSystem();
+	testTripleBuffer();
+	testFramePacing();
+	testMemory();
+}
+
+/** The fill Memset used to do, one element at a time. */
+static void scalarMemset32(void* Dest, int32 Val, uintptr Amount)
+{
+	int32* _Dest = (int32*)Dest;
+	for (uintptr Index = 0; Index < Amount / sizeof(int32); Index++)
+	{
+		::memcpy(_Dest + Index, &Val, sizeof(int32));
+	}
+}
+
+/** Runs Body Repetitions times and logs the throughput it reached over Amount bytes. */
+template<typename BodyType>
+static void benchmarkMemory(const char* Name, uintptr Amount, uint32 Repetitions, BodyType Body)
+{
+	Body();
+	double _StartTime = Time::getTime();
+	for (uint32 Index = 0; Index < Repetitions; Index++)
+	{
+		Body();
+	}
+	double _Seconds = Time::getTime() - _StartTime;
+	DEBUG_LOG_TEMP("%-32s %9.2f GB/s", Name, (double)Amount * Repetitions / _Seconds / (1024.0 * 1024.0 * 1024.0));
+}
+
+void Tests::runMemoryBenchmarks()
+{
+	// Once in cache and once well past it, where the streaming copy is meant to win
+	static const uintptr _Sizes[] = { 16 * 1024, 64 * 1024 * 1024 };
+	for (uint32 SizeIndex = 0; SizeIndex < ARRAY_SIZE_IN_ELEMENTS(_Sizes); SizeIndex++)
+	{
+		uintptr _Size = _Sizes[SizeIndex];
+		uint32 _Repetitions = (uint32)((uintptr)4 * 1024 * 1024 * 1024 / _Size);
+		uint8* _A = (uint8*)Memory::malloc(_Size);
+		uint8* _B = (uint8*)Memory::malloc(_Size);
+		uint8* _Temp = (uint8*)Memory::malloc(_Size);
+		Memory::memset(_A, (uint8)1, _Size);
+		Memory::memset(_B, (uint8)2, _Size);
+
+		DEBUG_LOG_TEMP("%u KB blocks", (uint32)(_Size / 1024));
+		benchmarkMemory("libc memset", _Size, _Repetitions, [=]() { ::memset(_A, 0x5A, _Size); });
+		benchmarkMemory("Memory::memset int32", _Size, _Repetitions, [=]() { Memory::memset(_A, (int32)0x01020304, _Size); });
+		benchmarkMemory("per element int32 fill", _Size, _Repetitions, [=]() { scalarMemset32(_A, 0x01020304, _Size); });
+		benchmarkMemory("libc memcpy x3 swap", _Size, _Repetitions, [=]() {
+			::memcpy(_Temp, _A, _Size);
+			::memcpy(_A, _B, _Size);
+			::memcpy(_B, _Temp, _Size);
+		});
+		benchmarkMemory("Memory::memswap", _Size, _Repetitions, [=]() { Memory::memswap(_A, _B, _Size); });
+		benchmarkMemory("libc memcpy", _Size, _Repetitions, [=]() { ::memcpy(_A, _B, _Size); });
+		benchmarkMemory("Memory::memcpyStreaming", _Size, _Repetitions, [=]() { Memory::memcpyStreaming(_A, _B, _Size); });
+
+		Memory::free(_A);
+		Memory::free(_B);
+		Memory::free(_Temp);
 	}
-	Vector pointVector=vec1s[0]+vec1s[1]+vec1s[2]+vec1s[3]+vec1s[4]+vec1s[5]+vec1s[6]+vec1s[7];
-	Vector point=transformMat.Transform(pointVector);
-	double passedTime = Time::getTime() - startTime;
-	DEBUG_LOG_TEMP("%f", passedTime);
-	DEBUG_LOG_TEMP("%f %f %f", point[0], point[1], point[2]);
-	DEBUG_LOG_TEMP("%f %f %f", pointVector[0], pointVector[1], pointVector[2]);
 }
 
+static void emptyJob(Job*, void*) {}
 
+void Tests::runJobBenchmarks()
+{
+	const uint32 _NumItems = 1 << 20;
+	const uint32 _NumJobs = 2000;
+	const uint32 _Repetitions = 20;
+	Array<Matrix> _Matrices;
+	_Matrices.resize(_NumItems, Matrix::Identity());
+	const Matrix _Rotation(Matrix::Translate(Cartesian3D(1.f, 2.f, 3.f)) * Matrix::Scale(1.0001f));
+	auto _Transform = [&](Matrix* Items, uint32 Count)
+	{
+		for (uint32 Index = 0; Index < Count; Index++)
+		{
+			Items[Index] = _Rotation * Items[Index];
+		}
+	};
+
+	const uint32 _MaxWorkers = std::thread::hardware_concurrency() > 1 ? std::thread::hardware_concurrency() - 1 : 0;
+	for (uint32 NumWorkers = 0; ; NumWorkers = NumWorkers == 0 ? 1 : NumWorkers * 2)
+	{
+		NumWorkers = NumWorkers > _MaxWorkers ? _MaxWorkers : NumWorkers;
+		JobSystem::Init(NumWorkers);
+		JobSystem::ParallelFor(_Matrices, 1024, _Transform);
+
+		double _StartTime = Time::getTime();
+		for (uint32 Index = 0; Index < _Repetitions; Index++)
+		{
+			JobSystem::ParallelFor(_Matrices, 1024, _Transform);
+		}
+		double _ForSeconds = (Time::getTime() - _StartTime) / _Repetitions;
+
+		_StartTime = Time::getTime();
+		for (uint32 Index = 0; Index < _Repetitions; Index++)
+		{
+			Job* _Root = JobSystem::CreateJob(&emptyJob);
+			for (uint32 JobIndex = 0; JobIndex < _NumJobs; JobIndex++)
+			{
+				JobSystem::Run(JobSystem::CreateChildJob(_Root, &emptyJob));
+			}
+			JobSystem::Run(_Root);
+			JobSystem::Wait(_Root);
+		}
+		double _JobSeconds = (Time::getTime() - _StartTime) / (_Repetitions * _NumJobs);
+		JobSystem::Shutdown();
+
+		DEBUG_LOG_TEMP("%2u threads: ParallelFor %8.3f ms for %u matrix products, %6.1f ns per empty job",
+				NumWorkers + 1, _ForSeconds * 1000.0, _NumItems, _JobSeconds * 1e9);
+		if (NumWorkers == _MaxWorkers)
+		{
+			break;
+		}
+	}
+}
@@ -3,5 +3,6 @@
 namespace Tests
 {
 	void RunTests();
-	void runPerformanceTests();
+	void runMemoryBenchmarks();
+	void runJobBenchmarks();
 };
@@ -0,0 +1,436 @@
+#include "Benchmark.h"
+// Ahead of MString.h, whose String macro breaks rapidjson's headers. Its
+// warnings are rapidjson's own, so they are kept out of this target's.
+#if defined(COMPILER_GCC) || defined(COMPILER_CLANG)
+	#pragma GCC diagnostic push
+	#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+	#if defined(COMPILER_GCC)
+		#pragma GCC diagnostic ignored "-Wclass-memaccess"
+	#endif
+#endif
+#include "rapidjson/document.h"
+#include "rapidjson/error/en.h"
+#include "rapidjson/filereadstream.h"
+#if defined(COMPILER_GCC) || defined(COMPILER_CLANG)
+	#pragma GCC diagnostic pop
+#endif
+#include "EngineCore/TimerManager.h"
+#include "DataTypes/MArray.h"
+#include "DataTypes/MString.h"
+#include "Math/Math.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+namespace
+{
+	struct Entry
+	{
+		const char* Name;
+		Benchmark::BenchmarkFunction Function;
+		uint32 ItemsPerIteration;
+	};
+
+	/** Filled during static initialization, so it must not need constructing. */
+	Entry g_Benchmarks[Benchmark::MAX_BENCHMARKS];
+	uint32 g_NumBenchmarks = 0;
+
+	struct Options
+	{
+		const char* Filter;
+		const char* JsonPath;
+		const char* BaselinePath;
+		uint32 Repetitions;
+		uint32 WarmupRepetitions;
+		uint64 MinTimeNanoseconds;
+		/** Slowdown over the baseline, in percent, that counts as a regression. */
+		double Threshold;
+		bool bList;
+
+		Options() :
+			Filter(""),
+			JsonPath(nullptr),
+			BaselinePath(nullptr),
+			Repetitions(15),
+			WarmupRepetitions(3),
+			MinTimeNanoseconds(10000000),
+			Threshold(5.0),
+			bList(false) {}
+	};
+
+	/** Nanoseconds per item. */
+	struct Result
+	{
+		const char* Name;
+		uint64 Iterations;
+		uint32 ItemsPerIteration;
+		double Median;
+		double Mad;
+		double Min;
+		double Mean;
+	};
+
+	struct BaselineEntry
+	{
+		String Name;
+		double Median;
+		double Mad;
+	};
+
+	const char* matchOption(const char* Argument, const char* Option)
+	{
+		uintptr _Length = strlen(Option);
+		return strncmp(Argument, Option, _Length) == 0 && Argument[_Length] == '=' ? Argument + _Length + 1 : nullptr;
+	}
+
+	void printUsage(const char* Program)
+	{
+		printf("Usage: %s [options]\n"
+			"  --filter=TEXT       only run benchmarks whose name contains TEXT\n"
+			"  --repetitions=N     timed repetitions per benchmark (15)\n"
+			"  --warmup=N          untimed repetitions before them (3)\n"
+			"  --min-time=MS       least time a repetition runs for (10)\n"
+			"  --json=PATH         write the results as JSON, - for stdout and the tables to stderr\n"
+			"  --baseline=PATH     compare with the JSON of an earlier run; exits with 1 on a regression\n"
+			"  --threshold=PERCENT slowdown that counts as a regression (5)\n"
+			"  --list              list the benchmarks and exit\n", Program);
+	}
+
+	bool parseOptions(int32 Argc, char** Argv, Options& Out)
+	{
+		for (int32 Index = 1; Index < Argc; Index++)
+		{
+			const char* _Argument = Argv[Index];
+			const char* _Value;
+			if ((_Value = matchOption(_Argument, "--filter")) != nullptr)
+			{
+				Out.Filter = _Value;
+			}
+			else if ((_Value = matchOption(_Argument, "--repetitions")) != nullptr)
+			{
+				Out.Repetitions = (uint32)Math::Max(atoi(_Value), 1);
+			}
+			else if ((_Value = matchOption(_Argument, "--warmup")) != nullptr)
+			{
+				Out.WarmupRepetitions = (uint32)Math::Max(atoi(_Value), 0);
+			}
+			else if ((_Value = matchOption(_Argument, "--min-time")) != nullptr)
+			{
+				Out.MinTimeNanoseconds = Time::toNanoseconds(Math::Max(atof(_Value), 0.001) / 1000.0);
+			}
+			else if ((_Value = matchOption(_Argument, "--json")) != nullptr)
+			{
+				Out.JsonPath = _Value;
+			}
+			else if ((_Value = matchOption(_Argument, "--baseline")) != nullptr)
+			{
+				Out.BaselinePath = _Value;
+			}
+			else if ((_Value = matchOption(_Argument, "--threshold")) != nullptr)
+			{
+				Out.Threshold = atof(_Value);
+			}
+			else if (strcmp(_Argument, "--list") == 0)
+			{
+				Out.bList = true;
+			}
+			else
+			{
+				printUsage(Argv[0]);
+				return false;
+			}
+		}
+		return true;
+	}
+
+	uint64 timeRun(const Entry& Benchmark, uint64 Iterations)
+	{
+		uint64 _Start = Time::getNanoseconds();
+		Benchmark.Function(Iterations);
+		return Time::getNanoseconds() - _Start;
+	}
+
+	/** Finds an iteration count that takes at least the minimum time, which also warms the caches up. */
+	uint64 calibrate(const Entry& Benchmark, uint64 MinTimeNanoseconds)
+	{
+		uint64 _Iterations = 1;
+		while (true)
+		{
+			uint64 _Time = timeRun(Benchmark, _Iterations);
+			if (_Time >= MinTimeNanoseconds || _Iterations >= ((uint64)1 << 40))
+			{
+				return _Iterations;
+			}
+			// Aim a fifth past the minimum, growing at most a hundredfold while the times are too short to trust
+			double _Scale = _Time == 0 ? 100.0 : Math::Min(1.2 * (double)MinTimeNanoseconds / (double)_Time, 100.0);
+			_Iterations = Math::Max((uint64)((double)_Iterations * _Scale), _Iterations + 1);
+		}
+	}
+
+	double median(Array<double>& Values)
+	{
+		std::sort(Values.begin(), Values.end());
+		uintptr _Middle = Values.size() / 2;
+		return Values.size() % 2 != 0 ? Values[_Middle] : 0.5 * (Values[_Middle - 1] + Values[_Middle]);
+	}
+
+	Result run(const Entry& Benchmark, const Options& InOptions)
+	{
+		Result _Result;
+		_Result.Name = Benchmark.Name;
+		_Result.ItemsPerIteration = Benchmark.ItemsPerIteration;
+		_Result.Iterations = calibrate(Benchmark, InOptions.MinTimeNanoseconds);
+		for (uint32 Index = 0; Index < InOptions.WarmupRepetitions; Index++)
+		{
+			timeRun(Benchmark, _Result.Iterations);
+		}
+
+		const double _Items = (double)_Result.Iterations * (double)Benchmark.ItemsPerIteration;
+		Array<double> _Times;
+		for (uint32 Index = 0; Index < InOptions.Repetitions; Index++)
+		{
+			_Times.push_back((double)timeRun(Benchmark, _Result.Iterations) / _Items);
+		}
+
+		double _Total = 0.0;
+		for (uintptr Index = 0; Index < _Times.size(); Index++)
+		{
+			_Total += _Times[Index];
+		}
+		_Result.Mean = _Total / (double)_Times.size();
+		_Result.Median = median(_Times);
+		_Result.Min = _Times[0];
+		for (uintptr Index = 0; Index < _Times.size(); Index++)
+		{
+			_Times[Index] = fabs(_Times[Index] - _Result.Median);
+		}
+		_Result.Mad = median(_Times);
+		return _Result;
+	}
+
+	void writeJson(FILE* File, const Array<Result>& Results)
+	{
+		char _Date[32];
+		time_t _Now = time(nullptr);
+		strftime(_Date, sizeof(_Date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&_Now));
+
+		fprintf(File, "{\n");
+		fprintf(File, "  \"context\": {\n");
+		fprintf(File, "    \"date\": \"%s\",\n", _Date);
+#if defined(__VERSION__)
+		fprintf(File, "    \"compiler\": \"%s\",\n", __VERSION__);
+#endif
+#if defined(NDEBUG)
+		fprintf(File, "    \"assertions\": false,\n");
+#else
+		fprintf(File, "    \"assertions\": true,\n");
+#endif
+#if defined(SIMD_CPU_ARCH_x86) || defined(SIMD_CPU_ARCH_x86_64)
+		fprintf(File, "    \"platform_vector\": \"SSEVector\",\n");
+#else
+		fprintf(File, "    \"platform_vector\": \"BaseVector\",\n");
+#endif
+		fprintf(File, "    \"time_unit\": \"ns per item\"\n");
+		fprintf(File, "  },\n");
+		fprintf(File, "  \"benchmarks\": [\n");
+		for (uintptr Index = 0; Index < Results.size(); Index++)
+		{
+			const Result& _Result = Results[Index];
+			fprintf(File, "    {\"name\": \"%s\", \"iterations\": %llu, \"items_per_iteration\": %u, "
+					"\"median_ns\": %.4f, \"mad_ns\": %.4f, \"min_ns\": %.4f, \"mean_ns\": %.4f}%s\n",
+					_Result.Name, (unsigned long long)_Result.Iterations, _Result.ItemsPerIteration,
+					_Result.Median, _Result.Mad, _Result.Min, _Result.Mean,
+					Index + 1 < Results.size() ? "," : "");
+		}
+		fprintf(File, "  ]\n");
+		fprintf(File, "}\n");
+	}
+
+	/** Reads back the benchmarks of what writeJson wrote. */
+	bool readBaseline(const char* Path, Array<BaselineEntry>& Out)
+	{
+		FILE* _File = fopen(Path, "rb");
+		if (_File == nullptr)
+		{
+			fprintf(stderr, "Could not open baseline %s\n", Path);
+			return false;
+		}
+		char _ReadBuffer[4096];
+		rapidjson::FileReadStream _Stream(_File, _ReadBuffer, sizeof(_ReadBuffer));
+		rapidjson::Document _Json;
+		_Json.ParseStream(_Stream);
+		fclose(_File);
+		if (_Json.HasParseError())
+		{
+			fprintf(stderr, "Could not parse baseline %s at offset %llu: %s\n", Path,
+					(unsigned long long)_Json.GetErrorOffset(), rapidjson::GetParseError_En(_Json.GetParseError()));
+			return false;
+		}
+
+		rapidjson::Value::ConstMemberIterator _Benchmarks = _Json.IsObject() ? _Json.FindMember("benchmarks") : _Json.MemberEnd();
+		if (!_Json.IsObject() || _Benchmarks == _Json.MemberEnd() || !_Benchmarks->value.IsArray())
+		{
+			fprintf(stderr, "Baseline %s has no benchmarks array\n", Path);
+			return false;
+		}
+		const rapidjson::Value& _Array = _Benchmarks->value;
+		for (rapidjson::SizeType Index = 0; Index < _Array.Size(); Index++)
+		{
+			const rapidjson::Value& _Benchmark = _Array[Index];
+			if (!_Benchmark.IsObject())
+			{
+				continue;
+			}
+			rapidjson::Value::ConstMemberIterator _Name = _Benchmark.FindMember("name");
+			rapidjson::Value::ConstMemberIterator _Median = _Benchmark.FindMember("median_ns");
+			rapidjson::Value::ConstMemberIterator _Mad = _Benchmark.FindMember("mad_ns");
+			if (_Name != _Benchmark.MemberEnd() && _Name->value.IsString()
+					&& _Median != _Benchmark.MemberEnd() && _Median->value.IsNumber()
+					&& _Mad != _Benchmark.MemberEnd() && _Mad->value.IsNumber())
+			{
+				BaselineEntry _Entry;
+				_Entry.Name.assign(_Name->value.GetString(), _Name->value.GetStringLength());
+				_Entry.Median = _Median->value.GetDouble();
+				_Entry.Mad = _Mad->value.GetDouble();
+				Out.push_back(_Entry);
+			}
+		}
+		return true;
+	}
+
+	/*
+	 *	A benchmark regressed when its median is slower than the baseline's by
+	 *	more than the threshold, and by more than three times the larger MAD,
+	 *	so that noisy benchmarks do not fail on their noise alone.
+	 **/
+	uint32 compareWithBaseline(FILE* Report, const Array<Result>& Results, const Array<BaselineEntry>& Baseline, double Threshold)
+	{
+		uint32 _NumRegressions = 0;
+		fprintf(Report, "\n%-44s %12s %12s %9s\n", "Compared with baseline", "Before", "After", "Change");
+		for (uintptr Index = 0; Index < Results.size(); Index++)
+		{
+			const Result& _Result = Results[Index];
+			const BaselineEntry* _Before = nullptr;
+			for (uintptr BaselineIndex = 0; BaselineIndex < Baseline.size(); BaselineIndex++)
+			{
+				if (Baseline[BaselineIndex].Name == _Result.Name)
+				{
+					_Before = &Baseline[BaselineIndex];
+					break;
+				}
+			}
+			if (_Before == nullptr || _Before->Median <= 0.0)
+			{
+				continue;
+			}
+
+			double _Change = 100.0 * (_Result.Median - _Before->Median) / _Before->Median;
+			double _Noise = 3.0 * Math::Max(_Result.Mad, _Before->Mad);
+			bool _bRegressed = _Change > Threshold && _Result.Median - _Before->Median > _Noise;
+			_NumRegressions += _bRegressed ? 1 : 0;
+			fprintf(Report, "%-44s %12.3f %12.3f %+8.1f%%%s\n", _Result.Name, _Before->Median, _Result.Median, _Change,
+					_bRegressed ? "  REGRESSION" : "");
+		}
+		return _NumRegressions;
+	}
+}
+
+Benchmark::Registration::Registration(const char* Name, BenchmarkFunction Function, uint32 ItemsPerIteration)
+{
+	if (g_NumBenchmarks == MAX_BENCHMARKS)
+	{
+		fprintf(stderr, "More than %u benchmarks, %s is left out\n", (uint32)MAX_BENCHMARKS, Name);
+		return;
+	}
+	Entry& _Entry = g_Benchmarks[g_NumBenchmarks++];
+	_Entry.Name = Name;
+	_Entry.Function = Function;
+	_Entry.ItemsPerIteration = ItemsPerIteration == 0 ? 1 : ItemsPerIteration;
+}
+
+#if !defined(COMPILER_GCC) && !defined(COMPILER_CLANG)
+void Benchmark::UseCharPointer(const volatile char*) {}
+#endif
+
+int32 Benchmark::RunAll(int32 Argc, char** Argv)
+{
+	Options _Options;
+	if (!parseOptions(Argc, Argv, _Options))
+	{
+		return 2;
+	}
+
+	// Registration order depends on link order; sorting keeps runs comparable
+	std::sort(g_Benchmarks, g_Benchmarks + g_NumBenchmarks, [](const Entry& A, const Entry& B)
+	{
+		return strcmp(A.Name, B.Name) < 0;
+	});
+
+	Array<BaselineEntry> _Baseline;
+	if (_Options.BaselinePath != nullptr && !readBaseline(_Options.BaselinePath, _Baseline))
+	{
+		return 2;
+	}
+
+	// With the JSON on stdout, everything else goes to stderr so that stdout parses
+	bool _bJsonToStdout = _Options.JsonPath != nullptr && strcmp(_Options.JsonPath, "-") == 0;
+	FILE* _Report = _bJsonToStdout ? stderr : stdout;
+
+	Array<Result> _Results;
+	if (!_Options.bList)
+	{
+#if !defined(NDEBUG)
+		fprintf(_Report, "Warning: assertions are enabled, build with CMAKE_BUILD_TYPE=Release for meaningful numbers\n");
+#endif
+		fprintf(_Report, "%-44s %12s %10s %14s\n", "Benchmark", "ns/item", "MAD", "Iterations");
+	}
+	for (uint32 Index = 0; Index < g_NumBenchmarks; Index++)
+	{
+		const Entry& _Entry = g_Benchmarks[Index];
+		if (strstr(_Entry.Name, _Options.Filter) == nullptr)
+		{
+			continue;
+		}
+		if (_Options.bList)
+		{
+			fprintf(_Report, "%s\n", _Entry.Name);
+			continue;
+		}
+
+		Result _Result = run(_Entry, _Options);
+		fprintf(_Report, "%-44s %12.3f %9.1f%% %14llu\n", _Result.Name, _Result.Median,
+				_Result.Median > 0.0 ? 100.0 * _Result.Mad / _Result.Median : 0.0,
+				(unsigned long long)_Result.Iterations);
+		fflush(_Report);
+		_Results.push_back(_Result);
+	}
+
+	if (_Options.JsonPath != nullptr)
+	{
+		FILE* _File = _bJsonToStdout ? stdout : fopen(_Options.JsonPath, "w");
+		if (_File == nullptr)
+		{
+			fprintf(stderr, "Could not write %s\n", _Options.JsonPath);
+			return 2;
+		}
+		writeJson(_File, _Results);
+		if (!_bJsonToStdout)
+		{
+			fclose(_File);
+		}
+	}
+
+	if (_Options.BaselinePath != nullptr)
+	{
+		uint32 _NumRegressions = compareWithBaseline(_Report, _Results, _Baseline, _Options.Threshold);
+		if (_NumRegressions != 0)
+		{
+			fprintf(_Report, "%u regressions over %.1f%%\n", _NumRegressions, _Options.Threshold);
+			return 1;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "EngineCore/EngineUtils.h"
+
+#if defined(COMPILER_MSVC)
+	#include <intrin.h>
+#endif
+
+/*
+ *	Microbenchmark harness. Benchmarks register themselves at static
+ *	initialization with BENCHMARK, and the runner times each one: it picks
+ *	an iteration count that fills the minimum time per repetition, runs a
+ *	few untimed warmup repetitions, then reports the median and median
+ *	absolute deviation of the timed ones, per item processed.
+ *
+ *	A benchmark is a function of the iteration count. Everything it
+ *	computes has to reach DoNotOptimize, and inputs the compiler could see
+ *	through should go through Escape first, or the loop may be folded away.
+ **/
+namespace Benchmark
+{
+	typedef void (*BenchmarkFunction)(uint64 Iterations);
+
+	enum
+	{
+		MAX_BENCHMARKS = 512
+	};
+
+	struct Registration
+	{
+		/** Name must be a literal. ItemsPerIteration is what the reported times are divided by. */
+		Registration(const char* Name, BenchmarkFunction Function, uint32 ItemsPerIteration = 1);
+	};
+
+	/** Parses the command line, runs the benchmarks that match it and returns the exit code. */
+	int32 RunAll(int32 Argc, char** Argv);
+
+#if defined(COMPILER_GCC) || defined(COMPILER_CLANG)
+	/** Makes the compiler assume Value is read, so whatever produced it has to be computed. */
+	template<typename T>
+	FORCEINLINE void DoNotOptimize(const T& Value)
+	{
+		asm volatile("" : : "r,m"(Value) : "memory");
+	}
+
+	/** Makes the compiler assume the memory at Pointer may be read or written from here on. */
+	FORCEINLINE void Escape(const void* Pointer)
+	{
+		asm volatile("" : : "g"(Pointer) : "memory");
+	}
+
+	/** Makes the compiler assume all memory may have been read and written. */
+	FORCEINLINE void ClobberMemory()
+	{
+		asm volatile("" : : : "memory");
+	}
+#else
+	void UseCharPointer(const volatile char* Pointer);
+
+	template<typename T>
+	FORCEINLINE void DoNotOptimize(const T& Value)
+	{
+		UseCharPointer(&reinterpret_cast<const volatile char&>(Value));
+		_ReadWriteBarrier();
+	}
+
+	FORCEINLINE void Escape(const void* Pointer)
+	{
+		UseCharPointer((const volatile char*)Pointer);
+		_ReadWriteBarrier();
+	}
+
+	FORCEINLINE void ClobberMemory()
+	{
+		_ReadWriteBarrier();
+	}
+#endif
+}
+
+#define BENCHMARK_CONCAT_INNER(A, B) A##B
+#define BENCHMARK_CONCAT(A, B) BENCHMARK_CONCAT_INNER(A, B)
+
+/** Registers Function under Name, a string literal. */
+#define BENCHMARK_REGISTER(Name, Function, ItemsPerIteration) \
+	static Benchmark::Registration BENCHMARK_CONCAT(g_BenchmarkRegistration, __COUNTER__)(Name, Function, ItemsPerIteration)
+
+/*
+ *	Defines and registers a benchmark under Name, a string literal; the
+ *	body follows, with the iteration count in Iterations:
+ *
+ *	BENCHMARK_NAMED(matrixMultiply, "Matrix/Multiply", 8)
+ *	{
+ *		for (uint64 Iteration = 0; Iteration < Iterations; Iteration++) { ... }
+ *	}
+ **/
+#define BENCHMARK_NAMED(Function, Name, ItemsPerIteration) \
+	static void Function(uint64 Iterations); \
+	BENCHMARK_REGISTER(Name, &Function, ItemsPerIteration); \
+	static void Function(uint64 Iterations)
+
+/** BENCHMARK_NAMED, with the function's name as the benchmark's. */
+#define BENCHMARK(Function, ItemsPerIteration) BENCHMARK_NAMED(Function, #Function, ItemsPerIteration)
@@ -0,0 +1,323 @@
+#include "Benchmark.h"
+#include "Math/Transform.h"
+#include "Math/Sphere.h"
+#include "Math/aabb.h"
+#include "Math/Plane.h"
+#include "Math/Intersects.h"
+#include "Math/BoundsBatch.h"
+
+/*
+ *	The math types built on PlatformVector. Each iteration runs a batch of
+ *	independent calls over a scene with a mix of hits and misses, so the
+ *	branchy tests are not timed on a single always taken path.
+ **/
+namespace
+{
+	enum
+	{
+		BATCH = 8,
+		NUM_CLOUD_POINTS = 64
+	};
+
+	FORCEINLINE Spatial3D randomPoint(float Range)
+	{
+		return Spatial3D(Cartesian3D(Math::Randf(-Range, Range), Math::Randf(-Range, Range), Math::Randf(-Range, Range)));
+	}
+
+	FORCEINLINE Quaternion randomRotation()
+	{
+		return Quaternion(randomPoint(1.0f).Normalized(), Math::Randf(-MATH_PI, MATH_PI));
+	}
+
+	struct MathInputs
+	{
+		Matrix Matrices[BATCH];
+		Matrix OtherMatrices[BATCH];
+		Quaternion Rotations[BATCH];
+		Quaternion OtherRotations[BATCH];
+		Transform Transforms[BATCH];
+		Transform OtherTransforms[BATCH];
+		Vector Vectors[BATCH];
+		Spatial3D Points[BATCH];
+		Spatial3D OtherPoints[BATCH];
+		/** Normalized. */
+		Spatial3D Directions[BATCH];
+		AABB Boxes[BATCH];
+		AABB OtherBoxes[BATCH];
+		Sphere Spheres[BATCH];
+		Sphere OtherSpheres[BATCH];
+		/** Normalized. */
+		Plane Planes[BATCH];
+		Plane OtherPlanes[BATCH];
+		float Cloud[NUM_CLOUD_POINTS * 3];
+
+		MathInputs()
+		{
+			for (uint32 Index = 0; Index < BATCH; Index++)
+			{
+				Rotations[Index] = randomRotation();
+				OtherRotations[Index] = randomRotation();
+				Transforms[Index] = Transform(randomPoint(10.0f), Rotations[Index], Spatial3D(Cartesian3D(Math::Randf(0.5f, 2.0f))));
+				OtherTransforms[Index] = Transform(randomPoint(10.0f), OtherRotations[Index], Spatial3D(Cartesian3D(Math::Randf(0.5f, 2.0f))));
+				Matrices[Index] = Transforms[Index].ToMatrix();
+				OtherMatrices[Index] = OtherTransforms[Index].ToMatrix();
+				Vectors[Index] = randomPoint(10.0f).AsIntrinsic(1.0f);
+				Points[Index] = randomPoint(10.0f);
+				OtherPoints[Index] = randomPoint(10.0f);
+				Directions[Index] = randomPoint(1.0f).Normalized();
+
+				Spatial3D _Extents(Cartesian3D(Math::Randf(0.5f, 3.0f), Math::Randf(0.5f, 3.0f), Math::Randf(0.5f, 3.0f)));
+				Boxes[Index] = AABB(Points[Index] - _Extents, Points[Index] + _Extents);
+				Spatial3D _Center = randomPoint(10.0f);
+				OtherBoxes[Index] = AABB(_Center - _Extents, _Center + _Extents);
+				Spheres[Index] = Sphere(randomPoint(10.0f), Math::Randf(0.5f, 3.0f));
+				OtherSpheres[Index] = Sphere(randomPoint(10.0f), Math::Randf(0.5f, 3.0f));
+				Planes[Index] = Plane(randomPoint(1.0f).Normalized(), Math::Randf(-5.0f, 5.0f));
+				OtherPlanes[Index] = Plane(randomPoint(1.0f).Normalized(), Math::Randf(-5.0f, 5.0f));
+			}
+			for (uint32 Index = 0; Index < NUM_CLOUD_POINTS * 3; Index++)
+			{
+				Cloud[Index] = Math::Randf(-10.0f, 10.0f);
+			}
+		}
+	};
+
+	const MathInputs& getInputs()
+	{
+		static const MathInputs s_Inputs;
+		return s_Inputs;
+	}
+}
+
+/*
+ *	Benchmarks Expression over the batch. Expression sees the inputs as In,
+ *	the position in the batch as Index, and scratch outputs for the
+ *	functions that take them.
+ **/
+#define BENCHMARK_MATH(Function, Name, Expression) \
+	BENCHMARK_NAMED(Function, Name, BATCH) \
+	{ \
+		const MathInputs& In = getInputs(); \
+		Benchmark::Escape(&In); \
+		float _Near, _Far; \
+		bool _bInside, _bPartial; \
+		Spatial3D _Point; \
+		for (uint64 Iteration = 0; Iteration < Iterations; Iteration++) \
+		{ \
+			for (uint32 Index = 0; Index < BATCH; Index++) \
+			{ \
+				Benchmark::DoNotOptimize(Expression); \
+			} \
+		} \
+		(void)_Near; (void)_Far; (void)_bInside; (void)_bPartial; (void)_Point; \
+	}
+
+BENCHMARK_MATH(matrixMultiply, "Matrix/Multiply", In.Matrices[Index] * In.OtherMatrices[Index]);
+BENCHMARK_MATH(matrixInverse, "Matrix/Inverse", In.Matrices[Index].Inverse());
+BENCHMARK_MATH(matrixTranspose, "Matrix/Transpose", In.Matrices[Index].Transpose());
+BENCHMARK_MATH(matrixDeterminant4x4, "Matrix/Determinant4x4", In.Matrices[Index].Determinant4x4());
+BENCHMARK_MATH(matrixDeterminant3x3, "Matrix/Determinant3x3", In.Matrices[Index].Determinant3x3());
+BENCHMARK_MATH(matrixTransformVector, "Matrix/Transform", In.Matrices[Index].Transform(In.Vectors[Index]));
+BENCHMARK_MATH(matrixTransformMatrix, "Matrix/TransformMatrix",
+		Matrix::TransformMatrix(In.Points[Index].Inner(), In.Rotations[Index], In.OtherPoints[Index].Inner()));
+BENCHMARK_MATH(matrixGetRotation, "Matrix/GetRotation", In.Matrices[Index].GetRotation());
+BENCHMARK_MATH(matrixToNormalMatrix, "Matrix/ToNormalMatrix", In.Matrices[Index].ToNormalMatrix());
+
+BENCHMARK_MATH(quaternionMultiply, "Quaternion/Multiply", In.Rotations[Index] * In.OtherRotations[Index]);
+BENCHMARK_MATH(quaternionRotate, "Quaternion/Rotate", In.Rotations[Index].Rotate(In.Points[Index]));
+BENCHMARK_MATH(quaternionNormalized, "Quaternion/Normalized", In.Rotations[Index].Normalized());
+BENCHMARK_MATH(quaternionInverse, "Quaternion/Inverse", In.Rotations[Index].Inverse());
+BENCHMARK_MATH(quaternionLerp, "Quaternion/Lerp", Math::Lerp(In.Rotations[Index], In.OtherRotations[Index], 0.3f));
+BENCHMARK_MATH(quaternionSlerp, "Quaternion/Slerp", In.Rotations[Index].Slerp(In.OtherRotations[Index], 0.3f));
+BENCHMARK_MATH(quaternionFromAxisAngle, "Quaternion/FromAxisAngle", Quaternion(In.Directions[Index], 0.7f));
+
+BENCHMARK_MATH(transformToMatrix, "Transform/ToMatrix", In.Transforms[Index].ToMatrix());
+BENCHMARK_MATH(transformToAffineMatrix, "Transform/ToAffineMatrix", In.Transforms[Index].ToAffineMatrix());
+BENCHMARK_MATH(transformTransforms, "Transform/Transforms", In.Transforms[Index].Transforms(In.Vectors[Index]));
+BENCHMARK_MATH(transformInverseTransform, "Transform/InverseTransform", In.Transforms[Index].InverseTransform(In.Vectors[Index]));
+BENCHMARK_MATH(transformInverse, "Transform/Inverse", In.Transforms[Index].Inverse());
+BENCHMARK_MATH(transformLerp, "Transform/Lerp", Math::Lerp(In.Transforms[Index], In.OtherTransforms[Index], 0.3f));
+
+BENCHMARK_MATH(aabbIntersects, "AABB/Intersects", In.Boxes[Index].Intersects(In.OtherBoxes[Index]));
+BENCHMARK_MATH(aabbContainsPoint, "AABB/ContainsPoint", In.Boxes[Index].Contains(In.OtherPoints[Index]));
+BENCHMARK_MATH(aabbIntersectRay, "AABB/IntersectRay", In.Boxes[Index].IntersectRay(In.OtherPoints[Index], In.Directions[Index], _Near, _Far));
+BENCHMARK_MATH(aabbIntersectLine, "AABB/IntersectLine", In.Boxes[Index].IntersectLine(In.OtherPoints[Index], In.Points[Index]));
+BENCHMARK_MATH(aabbTransform, "AABB/Transform", In.Boxes[Index].Transform(In.Matrices[Index]));
+BENCHMARK_MATH(aabbAddAABB, "AABB/AddAABB", In.Boxes[Index].AddAABB(In.OtherBoxes[Index]));
+BENCHMARK_MATH(aabbOverlap, "AABB/Overlap", In.Boxes[Index].Overlap(In.OtherBoxes[Index]));
+BENCHMARK_MATH(aabbFromPoints, "AABB/FromPoints", AABB(const_cast<float*>(In.Cloud), NUM_CLOUD_POINTS));
+
+BENCHMARK_MATH(sphereIntersects, "Sphere/Intersects", In.Spheres[Index].intersects(In.OtherSpheres[Index]));
+BENCHMARK_MATH(sphereIntersectRay, "Sphere/IntersectRay", In.Spheres[Index].intersectRay(In.OtherPoints[Index], In.Directions[Index], _Near, _Far));
+BENCHMARK_MATH(sphereIntersectLine, "Sphere/IntersectLine", In.Spheres[Index].intersectLine(In.OtherPoints[Index], In.Points[Index]));
+BENCHMARK_MATH(sphereTransform, "Sphere/Transform", In.Spheres[Index].transform(In.Matrices[Index]));
+BENCHMARK_MATH(sphereFromPoints, "Sphere/FromPoints", Sphere(const_cast<float*>(In.Cloud), NUM_CLOUD_POINTS));
+
+BENCHMARK_MATH(planeNormalized, "Plane/Normalized", In.Planes[Index].normalized());
+BENCHMARK_MATH(planeDot, "Plane/Dot", In.Planes[Index].dot(In.Points[Index]));
+BENCHMARK_MATH(planeTransform, "Plane/Transform", In.Planes[Index].transform(In.Matrices[Index]));
+BENCHMARK_MATH(planeIntersectLine, "Plane/IntersectLine", In.Planes[Index].intersectLine(In.OtherPoints[Index], In.Points[Index]));
+BENCHMARK_MATH(planeIntersectRay, "Plane/IntersectRay", In.Planes[Index].intersectRay(In.OtherPoints[Index], In.Directions[Index]));
+BENCHMARK_MATH(planeIntersectPlanes, "Plane/IntersectPlanes",
+		In.Planes[Index].intersectPlanes(_Point, In.OtherPlanes[Index], In.Planes[(Index + 1) % BATCH]));
+BENCHMARK_MATH(planeReflect, "Plane/Reflect", In.Planes[Index].reflect(In.Points[Index]));
+
+BENCHMARK_MATH(intersectsPlaneAABB, "Intersects/PlaneAABB", Intersects::intersectPlaneAABB(In.Boxes[Index], In.Planes[Index], _bInside, _bPartial));
+BENCHMARK_MATH(intersectsPlaneSphere, "Intersects/PlaneSphere", Intersects::intersectPlaneSphere(In.Spheres[Index], In.Planes[Index], _bInside, _bPartial));
+BENCHMARK_MATH(intersectsSphereAABB, "Intersects/SphereAABB", Intersects::intersectSphereAABB(In.Spheres[Index], In.Boxes[Index]));
+
+/*
+ *	World bounds for a scene's worth of volumes, per volume against the SoA
+ *	batch kernels, with one shared matrix and with a matrix per volume.
+ **/
+namespace
+{
+	enum
+	{
+		NUM_BOUNDS = 1024
+	};
+
+	struct BoundsInputs
+	{
+		AABB Boxes[NUM_BOUNDS];
+		Sphere Spheres[NUM_BOUNDS];
+		Matrix Transforms[NUM_BOUNDS];
+		float Local[10][NUM_BOUNDS];
+		float World[10][NUM_BOUNDS];
+		AABBSoA LocalBoxes;
+		AABBSoA WorldBoxes;
+		SphereSoA LocalSpheres;
+		SphereSoA WorldSpheres;
+
+		BoundsInputs()
+		{
+			for (uint32 Axis = 0; Axis < 3; Axis++)
+			{
+				LocalBoxes.Min[Axis] = Local[Axis];
+				LocalBoxes.Max[Axis] = Local[Axis + 3];
+				WorldBoxes.Min[Axis] = World[Axis];
+				WorldBoxes.Max[Axis] = World[Axis + 3];
+				LocalSpheres.Center[Axis] = Local[Axis + 6];
+				WorldSpheres.Center[Axis] = World[Axis + 6];
+			}
+			LocalSpheres.Radius = Local[9];
+			WorldSpheres.Radius = World[9];
+
+			const MathInputs& _Inputs = getInputs();
+			for (uint32 Index = 0; Index < NUM_BOUNDS; Index++)
+			{
+				Boxes[Index] = _Inputs.Boxes[Index % BATCH].Translate(randomPoint(1.0f));
+				Spheres[Index] = _Inputs.Spheres[Index % BATCH].translate(randomPoint(1.0f));
+				Transforms[Index] = _Inputs.Matrices[Index % BATCH];
+				LocalBoxes.Set(Index, Boxes[Index]);
+				LocalSpheres.Set(Index, Spheres[Index]);
+			}
+		}
+	};
+
+	BoundsInputs& getBoundsInputs()
+	{
+		static BoundsInputs s_Inputs;
+		return s_Inputs;
+	}
+}
+
+BENCHMARK_NAMED(boundsAABBTransform, "Bounds/AABB/Transform", NUM_BOUNDS)
+{
+	BoundsInputs& In = getBoundsInputs();
+	for (uint64 Iteration = 0; Iteration < Iterations; Iteration++)
+	{
+		Benchmark::Escape(&In);
+		for (uint32 Index = 0; Index < NUM_BOUNDS; Index++)
+		{
+			In.WorldBoxes.Set(Index, In.Boxes[Index].Transform(In.Transforms[0]));
+		}
+		Benchmark::ClobberMemory();
+	}
+}
+
+BENCHMARK_NAMED(boundsAABBTransformBatch, "Bounds/AABB/TransformBatch", NUM_BOUNDS)
+{
+	BoundsInputs& In = getBoundsInputs();
+	for (uint64 Iteration = 0; Iteration < Iterations; Iteration++)
+	{
+		Benchmark::Escape(&In);
+		BoundsBatch::TransformAABBs(In.Transforms[0], In.LocalBoxes, In.WorldBoxes, NUM_BOUNDS);
+		Benchmark::ClobberMemory();
+	}
+}
+
+BENCHMARK_NAMED(boundsAABBTransformEach, "Bounds/AABB/TransformEach", NUM_BOUNDS)
+{
+	BoundsInputs& In = getBoundsInputs();
+	for (uint64 Iteration = 0; Iteration < Iterations; Iteration++)
+	{
+		Benchmark::Escape(&In);
+		for (uint32 Index = 0; Index < NUM_BOUNDS; Index++)
+		{
+			In.WorldBoxes.Set(Index, In.Boxes[Index].Transform(In.Transforms[Index]));
+		}
+		Benchmark::ClobberMemory();
+	}
+}
+
+BENCHMARK_NAMED(boundsAABBTransformEachBatch, "Bounds/AABB/TransformEachBatch", NUM_BOUNDS)
+{
+	BoundsInputs& In = getBoundsInputs();
+	for (uint64 Iteration = 0; Iteration < Iterations; Iteration++)
+	{
+		Benchmark::Escape(&In);
+		BoundsBatch::TransformAABBs(In.Transforms, In.LocalBoxes, In.WorldBoxes, NUM_BOUNDS);
+		Benchmark::ClobberMemory();
+	}
+}
+
+BENCHMARK_NAMED(boundsSphereTransform, "Bounds/Sphere/Transform", NUM_BOUNDS)
+{
+	BoundsInputs& In = getBoundsInputs();
+	for (uint64 Iteration = 0; Iteration < Iterations; Iteration++)
+	{
+		Benchmark::Escape(&In);
+		for (uint32 Index = 0; Index < NUM_BOUNDS; Index++)
+		{
+			In.WorldSpheres.Set(Index, In.Spheres[Index].transform(In.Transforms[0]));
+		}
+		Benchmark::ClobberMemory();
+	}
+}
+
+BENCHMARK_NAMED(boundsSphereTransformBatch, "Bounds/Sphere/TransformBatch", NUM_BOUNDS)
+{
+	BoundsInputs& In = getBoundsInputs();
+	for (uint64 Iteration = 0; Iteration < Iterations; Iteration++)
+	{
+		Benchmark::Escape(&In);
+		BoundsBatch::TransformSpheres(In.Transforms[0], In.LocalSpheres, In.WorldSpheres, NUM_BOUNDS);
+		Benchmark::ClobberMemory();
+	}
+}
+
+BENCHMARK_NAMED(boundsSphereTransformEach, "Bounds/Sphere/TransformEach", NUM_BOUNDS)
+{
+	BoundsInputs& In = getBoundsInputs();
+	for (uint64 Iteration = 0; Iteration < Iterations; Iteration++)
+	{
+		Benchmark::Escape(&In);
+		for (uint32 Index = 0; Index < NUM_BOUNDS; Index++)
+		{
+			In.WorldSpheres.Set(Index, In.Spheres[Index].transform(In.Transforms[Index]));
+		}
+		Benchmark::ClobberMemory();
+	}
+}
+
+BENCHMARK_NAMED(boundsSphereTransformEachBatch, "Bounds/Sphere/TransformEachBatch", NUM_BOUNDS)
+{
+	BoundsInputs& In = getBoundsInputs();
+	for (uint64 Iteration = 0; Iteration < Iterations; Iteration++)
+	{
+		Benchmark::Escape(&In);
+		BoundsBatch::TransformSpheres(In.Transforms, In.LocalSpheres, In.WorldSpheres, NUM_BOUNDS);
+		Benchmark::ClobberMemory();
+	}
+}
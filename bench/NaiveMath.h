@@ -0,0 +1,155 @@
+#pragma once
+
+#include "Math/Transform.h"
+
+/*
+ *	Plain scalar versions of the vector math kernels, kept as baselines for
+ *	the benchmarks of the vectorized ones.
+ **/
+
+inline void naiveMatrixMultiply(float* output, float* input, float* other)
+{
+	float* m = (float*)input;
+	float* r = (float*)other;
+	float* ret = (float*)output;
+	for (unsigned int i = 0 ; i < 4; i++) 
+	{
+		for (unsigned int j = 0 ; j < 4; j++) 
+		{
+			ret[i*4+j] = 0.0f;
+			for(unsigned int k = 0; k < 4; k++) {
+				ret[i*4+j] += m[k*4+j] * r[i*4+k];
+			}
+		}
+	}
+}
+
+inline void naiveCrossProduct(float* output, float* v1, float* v2)
+{
+	float out0 = v1[1] * v2[2] - v1[2] * v2[1];
+	float out1 = v1[2] * v2[0] - v1[0] * v2[2];
+	float out2 = v1[0] * v2[1] - v1[1] * v2[0];
+	output[0] = out0;
+	output[1] = out1;
+	output[2] = out2;
+}
+
+inline void naiveQuatMul(float* output, float* a, float* b)
+{
+	const float w = (a[3] * b[3]) - (a[0] * b[0]) - (a[1] * b[1]) - (a[2] * b[2]);
+	const float x = (a[0]* b[3]) + (a[3] * b[0]) + (a[1] * b[2]) - (a[2] * b[1]);
+	const float y = (a[1] * b[3]) + (a[3] * b[1]) + (a[2] * b[0]) - (a[0] * b[2]);
+	const float z = (a[2] * b[3]) + (a[3] * b[2]) + (a[0] * b[1]) - (a[1] * b[0]);
+
+	output[0] = x;
+	output[1] = y;
+	output[2] = z;
+	output[3] = w;
+}
+
+inline void naiveQuatRotate(float* output, float* a, float* b)
+{
+	float conjugate[4];
+	float temp[4];
+	conjugate[0] = -a[0];
+	conjugate[1] = -a[1];
+	conjugate[2] = -a[2];
+	conjugate[3] = a[3];
+	naiveQuatMul(temp, a, b);
+	naiveQuatMul(output, temp, conjugate);
+}
+
+inline void naiveTransformCreate(float* output, float* translation, float* rotation, float* scale)
+{
+	Spatial3D translationVec(translation[0],translation[1],translation[2]);
+	Spatial3D scaleVec(scale[0],scale[1],scale[2]);
+	Quaternion rotationVec(rotation[0],rotation[1],rotation[2],rotation[3]);
+	Spatial3D nullTranslation(0.0f);
+	Spatial3D nullScale(1.0f);
+	Matrix translationMatrix = Matrix::Translate(translationVec.Inner());
+	Matrix rotationMatrix = Matrix::TransformMatrix(nullTranslation.Inner(), rotationVec, nullScale.Inner());
+	Matrix scaleMatrix = Matrix::Scale(scaleVec.Inner());
+	float temp[16];
+	naiveMatrixMultiply(temp, (float*)&scaleMatrix, (float*)&rotationMatrix);
+	naiveMatrixMultiply(output, temp, (float*)&translationMatrix);
+}
+
+inline void naiveMatrixInverse(void* dest, void* src)
+{
+	int i, j, k;
+	float* s = (float*)dest;
+	float* t = (float*)src;
+	const int D = 4;
+
+	// Forward elimination
+	for (i = 0; i < D - 1 ; i++) {
+		int pivot = i;
+
+		float pivotsize = t[i*4+i];
+
+		if (pivotsize < 0)
+			pivotsize = -pivotsize;
+
+		for (j = i + 1; j < D; j++) {
+			float tmp = t[j*4+i];
+
+			if (tmp < 0)
+				tmp = -tmp;
+
+			if (tmp > pivotsize) {
+				pivot = j;
+				pivotsize = tmp;
+			}
+		}
+
+		if (pivotsize == 0) {
+			return;
+		}
+
+		if (pivot != i) {
+			for (j = 0; j < D; j++) {
+				float tmp;
+
+				tmp = t[i*4+j];
+				t[i*4+j] = t[pivot*4+j];
+				t[pivot*4+j] = tmp;
+
+				tmp = s[i*4+j];
+				s[i*4+j] = s[pivot*4+j];
+				s[pivot*4+j] = tmp;
+			}
+		}
+
+		for (j = i + 1; j < D; j++) {
+			float f = t[j*4+i] / t[i*4+i];
+
+			for (k = 0; k < D; k++) {
+				t[j*4+k] -= f * t[i*4+k];
+				s[j*4+k] -= f * s[i*4+k];
+			}
+		}
+	}
+
+	// Backward substitution
+	for (i = D - 1; i >= 0; --i) {
+		float f;
+
+		if ((f = t[i*4+i]) == 0) {
+			return;
+		}
+
+		for (j = 0; j < D; j++) {
+			t[i*4+j] /= f;
+			s[i*4+j] /= f;
+		}
+
+		for (j = 0; j < i; j++) {
+			f = t[j*4+i];
+
+			for (k = 0; k < D; k++) {
+				t[j*4+k] -= f * t[i*4+k];
+				s[j*4+k] -= f * s[i*4+k];
+			}
+		}
+	}
+}
@@ -0,0 +1,517 @@
+#include "Benchmark.h"
+#include "Math/BVH.h"
+#include "Math/AABBTree.h"
+#include "Math/SpatialHashGrid.h"
+#include <algorithm>
+
+/*
+ *	Queries against a scene of boxes through the spatial structures, next
+ *	to the brute force loop over every box that they replace.
+ **/
+namespace
+{
+	enum
+	{
+		NUM_SCENE_BOXES = 10000,
+		NUM_QUERIES = 64
+	};
+
+	struct SpatialScene
+	{
+		Array<AABB> Boxes;
+		Spatial3D QueryPoints[NUM_QUERIES];
+		Spatial3D QueryDirections[NUM_QUERIES];
+		AABB QueryBoxes[NUM_QUERIES];
+		BVH Tree;
+
+		SpatialScene()
+		{
+			for (uint32 Index = 0; Index < NUM_SCENE_BOXES; Index++)
+			{
+				Spatial3D _Center(Math::Randf(-100.0f, 100.0f), Math::Randf(-100.0f, 100.0f), Math::Randf(-100.0f, 100.0f));
+				Spatial3D _Extents(Math::Randf(0.1f, 2.0f), Math::Randf(0.1f, 2.0f), Math::Randf(0.1f, 2.0f));
+				Boxes.push_back(AABB(_Center - _Extents, _Center + _Extents));
+			}
+			for (uint32 Index = 0; Index < NUM_QUERIES; Index++)
+			{
+				QueryPoints[Index] = Spatial3D(Math::Randf(-100.0f, 100.0f), Math::Randf(-100.0f, 100.0f), Math::Randf(-100.0f, 100.0f));
+				QueryDirections[Index] = Spatial3D(Math::Randf(-1.0f, 1.0f), Math::Randf(-1.0f, 1.0f), Math::Randf(-1.0f, 1.0f)).Normalized();
+				QueryBoxes[Index] = AABB(QueryPoints[Index] - Spatial3D(5.0f, 5.0f, 5.0f), QueryPoints[Index] + Spatial3D(5.0f, 5.0f, 5.0f));
+			}
+			Tree.Build(Boxes.data(), (uint32)Boxes.size());
+		}
+	};
+
+	SpatialScene& getScene()
+	{
+		static SpatialScene s_Scene;
+		return s_Scene;
+	}
+
+	/** Where the ray enters Box, as the closest hit test a game would run per object. */
+	FORCEINLINE bool intersectRayBox(const AABB& Box, const Spatial3D& Start, const Spatial3D& Direction, float& Distance)
+	{
+		float _Far;
+		bool _bHit = Box.IntersectRay(Start, Direction, Distance, _Far) && _Far >= 0.0f;
+		Distance = Math::Max(Distance, 0.0f);
+		return _bHit;
+	}
+}
+
+BENCHMARK_NAMED(bvhBuild, "BVH/Build", NUM_SCENE_BOXES)
+{
+	SpatialScene& _Scene = getScene();
+	BVH _Tree;
+	for (uint64 Iteration = 0; Iteration < Iterations; Iteration++)
+	{
+		_Tree.Build(_Scene.Boxes.data(), (uint32)_Scene.Boxes.size());
+		Benchmark::DoNotOptimize(_Tree.GetNumNodes());
+	}
+}
+
+BENCHMARK_NAMED(bvhRefit, "BVH/Refit", NUM_SCENE_BOXES)
+{
+	SpatialScene& _Scene = getScene();
+	for (uint64 Iteration = 0; Iteration < Iterations; Iteration++)
+	{
+		_Scene.Tree.Refit(_Scene.Boxes.data());
+		Benchmark::ClobberMemory();
+	}
+}
+
+BENCHMARK_NAMED(bvhRaycast, "BVH/Raycast", NUM_QUERIES)
+{
+	const SpatialScene& _Scene = getScene();
+	for (uint64 Iteration = 0; Iteration < Iterations; Iteration++)
+	{
+		for (uint32 Query = 0; Query < NUM_QUERIES; Query++)
+		{
+			const Spatial3D& _Start = _Scene.QueryPoints[Query];
+			const Spatial3D& _Direction = _Scene.QueryDirections[Query];
+			uint32 _Index = 0;
+			float _Distance = 0.0f;
+			_Scene.Tree.Raycast(_Start, _Direction, 1000.0f,
+				[&](uint32 Index, float& Distance) { return intersectRayBox(_Scene.Boxes[Index], _Start, _Direction, Distance); },
+				_Index, _Distance);
+			Benchmark::DoNotOptimize(_Index);
+		}
+	}
+}
+
+BENCHMARK_NAMED(bruteForceRaycast, "BVH/BruteForceRaycast", NUM_QUERIES)
+{
+	const SpatialScene& _Scene = getScene();
+	for (uint64 Iteration = 0; Iteration < Iterations; Iteration++)
+	{
+		for (uint32 Query = 0; Query < NUM_QUERIES; Query++)
+		{
+			uint32 _Index = 0;
+			float _Best = 1000.0f;
+			for (uint32 Box = 0; Box < _Scene.Boxes.size(); Box++)
+			{
+				float _Distance;
+				if (intersectRayBox(_Scene.Boxes[Box], _Scene.QueryPoints[Query], _Scene.QueryDirections[Query], _Distance) && _Distance < _Best)
+				{
+					_Best = _Distance;
+					_Index = Box;
+				}
+			}
+			Benchmark::DoNotOptimize(_Index);
+		}
+	}
+}
+
+BENCHMARK_NAMED(bvhQueryAABB, "BVH/QueryAABB", NUM_QUERIES)
+{
+	const SpatialScene& _Scene = getScene();
+	for (uint64 Iteration = 0; Iteration < Iterations; Iteration++)
+	{
+		for (uint32 Query = 0; Query < NUM_QUERIES; Query++)
+		{
+			uint32 _Found = 0;
+			_Scene.Tree.QueryAABB(_Scene.QueryBoxes[Query], [&](uint32) { _Found++; });
+			Benchmark::DoNotOptimize(_Found);
+		}
+	}
+}
+
+BENCHMARK_NAMED(bruteForceQueryAABB, "BVH/BruteForceQueryAABB", NUM_QUERIES)
+{
+	const SpatialScene& _Scene = getScene();
+	for (uint64 Iteration = 0; Iteration < Iterations; Iteration++)
+	{
+		for (uint32 Query = 0; Query < NUM_QUERIES; Query++)
+		{
+			uint32 _Found = 0;
+			for (uint32 Box = 0; Box < _Scene.Boxes.size(); Box++)
+			{
+				_Found += _Scene.Boxes[Box].Intersects(_Scene.QueryBoxes[Query]) ? 1 : 0;
+			}
+			Benchmark::DoNotOptimize(_Found);
+		}
+	}
+}
+
+BENCHMARK_NAMED(bvhQuerySphere, "BVH/QuerySphere", NUM_QUERIES)
+{
+	const SpatialScene& _Scene = getScene();
+	for (uint64 Iteration = 0; Iteration < Iterations; Iteration++)
+	{
+		for (uint32 Query = 0; Query < NUM_QUERIES; Query++)
+		{
+			uint32 _Found = 0;
+			_Scene.Tree.QuerySphere(Sphere(_Scene.QueryPoints[Query], 5.0f), [&](uint32) { _Found++; });
+			Benchmark::DoNotOptimize(_Found);
+		}
+	}
+}
+
+namespace
+{
+	/*
+	 *	NumProxies boxes spread so that each overlaps about one other whatever
+	 *	the count, in a broadphase tree, each with a velocity it bounces around
+	 *	the scene at.
+	 **/
+	template<uint32 NumProxies>
+	struct BroadphaseScene
+	{
+		Array<AABB> Boxes;
+		Array<Spatial3D> Velocities;
+		Array<uint32> Proxies;
+		AABB QueryBoxes[NUM_QUERIES];
+		AABBTree Tree;
+		float HalfSize;
+
+		BroadphaseScene()
+		{
+			HalfSize = 1.2f * Math::Pow((float)NumProxies, 1.0f / 3.0f);
+			const float _HalfSize = HalfSize;
+			for (uint32 Index = 0; Index < NumProxies; Index++)
+			{
+				Spatial3D _Center(Math::Randf(-_HalfSize, _HalfSize), Math::Randf(-_HalfSize, _HalfSize), Math::Randf(-_HalfSize, _HalfSize));
+				Spatial3D _Extents(Math::Randf(0.1f, 1.0f), Math::Randf(0.1f, 1.0f), Math::Randf(0.1f, 1.0f));
+				Boxes.push_back(AABB(_Center - _Extents, _Center + _Extents));
+				Velocities.push_back(Spatial3D(Math::Randf(-0.05f, 0.05f), Math::Randf(-0.05f, 0.05f), Math::Randf(-0.05f, 0.05f)));
+				Proxies.push_back(Tree.CreateProxy(Boxes.back(), Index));
+			}
+			for (uint32 Index = 0; Index < NUM_QUERIES; Index++)
+			{
+				Spatial3D _Center(Math::Randf(-_HalfSize, _HalfSize), Math::Randf(-_HalfSize, _HalfSize), Math::Randf(-_HalfSize, _HalfSize));
+				QueryBoxes[Index] = AABB(_Center - Spatial3D(2.0f, 2.0f, 2.0f), _Center + Spatial3D(2.0f, 2.0f, 2.0f));
+			}
+		}
+	};
+
+	/** Benchmarks that move proxies get their own scene, so the others always see the same tree. */
+	template<uint32 NumProxies>
+	BroadphaseScene<NumProxies>& getBroadphaseScene(bool bMoving = false)
+	{
+		static BroadphaseScene<NumProxies> s_Scene;
+		static BroadphaseScene<NumProxies> s_MovingScene;
+		return bMoving ? s_MovingScene : s_Scene;
+	}
+
+	template<uint32 NumProxies>
+	void aabbTreeCreate(uint64 Iterations)
+	{
+		const BroadphaseScene<NumProxies>& _Scene = getBroadphaseScene<NumProxies>();
+		for (uint64 Iteration = 0; Iteration < Iterations; Iteration++)
+		{
+			AABBTree _Tree;
+			for (uint32 Index = 0; Index < NumProxies; Index++)
+			{
+				_Tree.CreateProxy(_Scene.Boxes[Index], Index);
+			}
+			Benchmark::DoNotOptimize(_Tree.GetHeight());
+		}
+	}
+
+	/** One frame: every proxy moves by its velocity, turning back at the edges of the scene. */
+	template<uint32 NumProxies>
+	void aabbTreeMove(uint64 Iterations)
+	{
+		BroadphaseScene<NumProxies>& _Scene = getBroadphaseScene<NumProxies>(true);
+		for (uint64 Iteration = 0; Iteration < Iterations; Iteration++)
+		{
+			for (uint32 Index = 0; Index < NumProxies; Index++)
+			{
+				Spatial3D& _Velocity = _Scene.Velocities[Index];
+				Spatial3D _Center = _Scene.Boxes[Index].GetCenter();
+				for (uint32 Axis = 0; Axis < 3; Axis++)
+				{
+					if (Math::Abs(_Center.Inner()[Axis]) > _Scene.HalfSize && _Center.Inner()[Axis] * _Velocity.Inner()[Axis] > 0.0f)
+					{
+						_Velocity.Inner().Set(Axis, -_Velocity.Inner()[Axis]);
+					}
+				}
+				_Scene.Boxes[Index] = _Scene.Boxes[Index].Translate(_Velocity);
+				_Scene.Tree.MoveProxy(_Scene.Proxies[Index], _Scene.Boxes[Index], _Velocity);
+			}
+			Benchmark::ClobberMemory();
+		}
+	}
+
+	template<uint32 NumProxies>
+	void aabbTreePairs(uint64 Iterations)
+	{
+		const BroadphaseScene<NumProxies>& _Scene = getBroadphaseScene<NumProxies>();
+		Array<AABBTree::ProxyPair> _Pairs;
+		for (uint64 Iteration = 0; Iteration < Iterations; Iteration++)
+		{
+			_Pairs.clear();
+			_Scene.Tree.QueryPairs(_Pairs);
+			Benchmark::DoNotOptimize(_Pairs.size());
+		}
+	}
+
+	/** The same pairs by testing the fat bounds of every proxy against every later one. */
+	template<uint32 NumProxies>
+	void bruteForcePairs(uint64 Iterations)
+	{
+		const BroadphaseScene<NumProxies>& _Scene = getBroadphaseScene<NumProxies>();
+		Array<AABB> _FatBounds;
+		for (uint32 Index = 0; Index < NumProxies; Index++)
+		{
+			_FatBounds.push_back(_Scene.Tree.GetFatBounds(_Scene.Proxies[Index]));
+		}
+		Array<AABBTree::ProxyPair> _Pairs;
+		for (uint64 Iteration = 0; Iteration < Iterations; Iteration++)
+		{
+			_Pairs.clear();
+			for (uint32 A = 0; A < NumProxies; A++)
+			{
+				for (uint32 B = A + 1; B < NumProxies; B++)
+				{
+					if (_FatBounds[A].Intersects(_FatBounds[B]))
+					{
+						_Pairs.push_back(AABBTree::ProxyPair{ A, B });
+					}
+				}
+			}
+			Benchmark::DoNotOptimize(_Pairs.size());
+		}
+	}
+
+	template<uint32 NumProxies>
+	void aabbTreeQuery(uint64 Iterations)
+	{
+		const BroadphaseScene<NumProxies>& _Scene = getBroadphaseScene<NumProxies>();
+		for (uint64 Iteration = 0; Iteration < Iterations; Iteration++)
+		{
+			for (uint32 Query = 0; Query < NUM_QUERIES; Query++)
+			{
+				uint32 _Found = 0;
+				_Scene.Tree.Query(_Scene.QueryBoxes[Query], [&](uint32) { _Found++; });
+				Benchmark::DoNotOptimize(_Found);
+			}
+		}
+	}
+
+	template<uint32 NumProxies>
+	void bruteForceQuery(uint64 Iterations)
+	{
+		const BroadphaseScene<NumProxies>& _Scene = getBroadphaseScene<NumProxies>();
+		for (uint64 Iteration = 0; Iteration < Iterations; Iteration++)
+		{
+			for (uint32 Query = 0; Query < NUM_QUERIES; Query++)
+			{
+				uint32 _Found = 0;
+				for (uint32 Index = 0; Index < NumProxies; Index++)
+				{
+					_Found += _Scene.Tree.GetFatBounds(_Scene.Proxies[Index]).Intersects(_Scene.QueryBoxes[Query]) ? 1 : 0;
+				}
+				Benchmark::DoNotOptimize(_Found);
+			}
+		}
+	}
+}
+
+BENCHMARK_REGISTER("AABBTree/Create/1000", &aabbTreeCreate<1000>, 1000);
+BENCHMARK_REGISTER("AABBTree/Create/10000", &aabbTreeCreate<10000>, 10000);
+BENCHMARK_REGISTER("AABBTree/Create/100000", &aabbTreeCreate<100000>, 100000);
+BENCHMARK_REGISTER("AABBTree/Move/1000", &aabbTreeMove<1000>, 1000);
+BENCHMARK_REGISTER("AABBTree/Move/10000", &aabbTreeMove<10000>, 10000);
+BENCHMARK_REGISTER("AABBTree/Move/100000", &aabbTreeMove<100000>, 100000);
+BENCHMARK_REGISTER("AABBTree/Pairs/1000", &aabbTreePairs<1000>, 1000);
+BENCHMARK_REGISTER("AABBTree/Pairs/10000", &aabbTreePairs<10000>, 10000);
+BENCHMARK_REGISTER("AABBTree/Pairs/100000", &aabbTreePairs<100000>, 100000);
+// Brute force pairs at 100000 proxies take seconds per iteration.
+BENCHMARK_REGISTER("AABBTree/BruteForcePairs/1000", &bruteForcePairs<1000>, 1000);
+BENCHMARK_REGISTER("AABBTree/BruteForcePairs/10000", &bruteForcePairs<10000>, 10000);
+BENCHMARK_REGISTER("AABBTree/Query/1000", &aabbTreeQuery<1000>, NUM_QUERIES);
+BENCHMARK_REGISTER("AABBTree/Query/10000", &aabbTreeQuery<10000>, NUM_QUERIES);
+BENCHMARK_REGISTER("AABBTree/Query/100000", &aabbTreeQuery<100000>, NUM_QUERIES);
+BENCHMARK_REGISTER("AABBTree/BruteForceQuery/1000", &bruteForceQuery<1000>, NUM_QUERIES);
+BENCHMARK_REGISTER("AABBTree/BruteForceQuery/10000", &bruteForceQuery<10000>, NUM_QUERIES);
+BENCHMARK_REGISTER("AABBTree/BruteForceQuery/100000", &bruteForceQuery<100000>, NUM_QUERIES);
+
+namespace
+{
+	enum
+	{
+		NUM_NEAREST = 8
+	};
+
+	/** NumPoints uniform agents, each with about two others within GRID_RADIUS, in a grid of cells that size. */
+	const float GRID_RADIUS = 1.5f;
+
+	template<uint32 NumPoints>
+	struct GridScene
+	{
+		Array<Spatial3D> Points;
+		Spatial3D QueryPoints[NUM_QUERIES];
+		SpatialHashGrid Grid;
+
+		GridScene()
+			: Grid(GRID_RADIUS)
+		{
+			float _HalfSize = Math::Pow((float)NumPoints, 1.0f / 3.0f);
+			for (uint32 Index = 0; Index < NumPoints; Index++)
+			{
+				Points.push_back(Spatial3D(Math::Randf(-_HalfSize, _HalfSize), Math::Randf(-_HalfSize, _HalfSize), Math::Randf(-_HalfSize, _HalfSize)));
+			}
+			for (uint32 Index = 0; Index < NUM_QUERIES; Index++)
+			{
+				QueryPoints[Index] = Points[Index * (NumPoints / NUM_QUERIES)];
+			}
+			Grid.Build(Points.data(), NumPoints);
+		}
+	};
+
+	template<uint32 NumPoints>
+	GridScene<NumPoints>& getGridScene()
+	{
+		static GridScene<NumPoints> s_Scene;
+		return s_Scene;
+	}
+
+	template<uint32 NumPoints>
+	void gridBuild(uint64 Iterations)
+	{
+		GridScene<NumPoints>& _Scene = getGridScene<NumPoints>();
+		for (uint64 Iteration = 0; Iteration < Iterations; Iteration++)
+		{
+			_Scene.Grid.Build(_Scene.Points.data(), NumPoints);
+			Benchmark::ClobberMemory();
+		}
+	}
+
+	template<uint32 NumPoints>
+	void gridPairs(uint64 Iterations)
+	{
+		const GridScene<NumPoints>& _Scene = getGridScene<NumPoints>();
+		Array<SpatialHashGrid::IndexPair> _Pairs;
+		for (uint64 Iteration = 0; Iteration < Iterations; Iteration++)
+		{
+			_Pairs.clear();
+			_Scene.Grid.QueryPairs(GRID_RADIUS, _Pairs);
+			Benchmark::DoNotOptimize(_Pairs.size());
+		}
+	}
+
+	template<uint32 NumPoints>
+	void gridBruteForcePairs(uint64 Iterations)
+	{
+		const GridScene<NumPoints>& _Scene = getGridScene<NumPoints>();
+		Array<SpatialHashGrid::IndexPair> _Pairs;
+		for (uint64 Iteration = 0; Iteration < Iterations; Iteration++)
+		{
+			_Pairs.clear();
+			for (uint32 A = 0; A < NumPoints; A++)
+			{
+				for (uint32 B = A + 1; B < NumPoints; B++)
+				{
+					if (_Scene.Points[A].DistSquared(_Scene.Points[B]) < GRID_RADIUS * GRID_RADIUS)
+					{
+						_Pairs.push_back(SpatialHashGrid::IndexPair{ A, B });
+					}
+				}
+			}
+			Benchmark::DoNotOptimize(_Pairs.size());
+		}
+	}
+
+	template<uint32 NumPoints>
+	void gridQueryRadius(uint64 Iterations)
+	{
+		const GridScene<NumPoints>& _Scene = getGridScene<NumPoints>();
+		for (uint64 Iteration = 0; Iteration < Iterations; Iteration++)
+		{
+			for (uint32 Query = 0; Query < NUM_QUERIES; Query++)
+			{
+				uint32 _Found = 0;
+				_Scene.Grid.QueryRadius(_Scene.QueryPoints[Query], GRID_RADIUS, [&](uint32, float) { _Found++; });
+				Benchmark::DoNotOptimize(_Found);
+			}
+		}
+	}
+
+	template<uint32 NumPoints>
+	void gridBruteForceQueryRadius(uint64 Iterations)
+	{
+		const GridScene<NumPoints>& _Scene = getGridScene<NumPoints>();
+		for (uint64 Iteration = 0; Iteration < Iterations; Iteration++)
+		{
+			for (uint32 Query = 0; Query < NUM_QUERIES; Query++)
+			{
+				uint32 _Found = 0;
+				for (uint32 Index = 0; Index < NumPoints; Index++)
+				{
+					_Found += _Scene.QueryPoints[Query].DistSquared(_Scene.Points[Index]) < GRID_RADIUS * GRID_RADIUS ? 1 : 0;
+				}
+				Benchmark::DoNotOptimize(_Found);
+			}
+		}
+	}
+
+	template<uint32 NumPoints>
+	void gridFindNearest(uint64 Iterations)
+	{
+		const GridScene<NumPoints>& _Scene = getGridScene<NumPoints>();
+		uint32 _Nearest[NUM_NEAREST];
+		float _Distances[NUM_NEAREST];
+		for (uint64 Iteration = 0; Iteration < Iterations; Iteration++)
+		{
+			for (uint32 Query = 0; Query < NUM_QUERIES; Query++)
+			{
+				uint32 _NumFound = _Scene.Grid.FindNearest(_Scene.QueryPoints[Query], NUM_NEAREST, 4.0f * GRID_RADIUS, _Nearest, _Distances);
+				Benchmark::DoNotOptimize(_NumFound);
+				Benchmark::DoNotOptimize(_Nearest[0]);
+			}
+		}
+	}
+
+	template<uint32 NumPoints>
+	void gridBruteForceFindNearest(uint64 Iterations)
+	{
+		const GridScene<NumPoints>& _Scene = getGridScene<NumPoints>();
+		Array<float> _Distances(NumPoints);
+		for (uint64 Iteration = 0; Iteration < Iterations; Iteration++)
+		{
+			for (uint32 Query = 0; Query < NUM_QUERIES; Query++)
+			{
+				for (uint32 Index = 0; Index < NumPoints; Index++)
+				{
+					_Distances[Index] = _Scene.QueryPoints[Query].DistSquared(_Scene.Points[Index]);
+				}
+				std::nth_element(_Distances.begin(), _Distances.begin() + NUM_NEAREST, _Distances.end());
+				Benchmark::DoNotOptimize(_Distances[NUM_NEAREST]);
+			}
+		}
+	}
+}
+
+BENCHMARK_REGISTER("HashGrid/Build/10000", &gridBuild<10000>, 10000);
+BENCHMARK_REGISTER("HashGrid/Build/100000", &gridBuild<100000>, 100000);
+BENCHMARK_REGISTER("HashGrid/Pairs/10000", &gridPairs<10000>, 10000);
+BENCHMARK_REGISTER("HashGrid/Pairs/100000", &gridPairs<100000>, 100000);
+BENCHMARK_REGISTER("HashGrid/BruteForcePairs/10000", &gridBruteForcePairs<10000>, 10000);
+BENCHMARK_REGISTER("HashGrid/QueryRadius/10000", &gridQueryRadius<10000>, NUM_QUERIES);
+BENCHMARK_REGISTER("HashGrid/QueryRadius/100000", &gridQueryRadius<100000>, NUM_QUERIES);
+BENCHMARK_REGISTER("HashGrid/BruteForceQueryRadius/10000", &gridBruteForceQueryRadius<10000>, NUM_QUERIES);
+BENCHMARK_REGISTER("HashGrid/BruteForceQueryRadius/100000", &gridBruteForceQueryRadius<100000>, NUM_QUERIES);
+BENCHMARK_REGISTER("HashGrid/FindNearest/10000", &gridFindNearest<10000>, NUM_QUERIES);
+BENCHMARK_REGISTER("HashGrid/FindNearest/100000", &gridFindNearest<100000>, NUM_QUERIES);
+BENCHMARK_REGISTER("HashGrid/BruteForceFindNearest/10000", &gridBruteForceFindNearest<10000>, NUM_QUERIES);
+BENCHMARK_REGISTER("HashGrid/BruteForceFindNearest/100000", &gridBruteForceFindNearest<100000>, NUM_QUERIES);
@@ -0,0 +1,390 @@
+#include "Benchmark.h"
+#include "NaiveMath.h"
+#include "Platform/Generic/GenericVectorMath.h"
+
+#if defined(SIMD_CPU_ARCH_x86) || defined(SIMD_CPU_ARCH_x86_64)
+	#include "Platform/sse/sseVecmath.hpp"
+	#define BENCHMARK_SSE_VECTOR 1
+#else
+	#define BENCHMARK_SSE_VECTOR 0
+#endif
+
+/*
+ *	Every kernel is timed for BaseVector and, where it is available,
+ *	SSEVector, under "BaseVector/Name" and "SSEVector/Name". Each iteration
+ *	runs a batch of independent calls, so the numbers are throughput.
+ **/
+namespace
+{
+	enum
+	{
+		BATCH = 8
+	};
+
+	/** Positive, so Pow, rSqrt and the like stay in range; kept away from 0 for Reciprocal. */
+	template<typename VectorType>
+	struct VectorInputs
+	{
+		VectorType A[BATCH];
+		VectorType B[BATCH];
+		/** Rows of well conditioned matrices. */
+		VectorType MatrixA[BATCH][4];
+		VectorType MatrixB[BATCH][4];
+
+		VectorInputs()
+		{
+			for (uint32 Index = 0; Index < BATCH; Index++)
+			{
+				A[Index] = VectorType::Make(Math::Randf(0.25f, 1.0f), Math::Randf(0.25f, 1.0f), Math::Randf(0.25f, 1.0f), Math::Randf(0.25f, 1.0f));
+				B[Index] = VectorType::Make(Math::Randf(0.25f, 1.0f), Math::Randf(0.25f, 1.0f), Math::Randf(0.25f, 1.0f), Math::Randf(0.25f, 1.0f));
+				for (uint32 Row = 0; Row < 4; Row++)
+				{
+					float _Values[4];
+					float _Other[4];
+					for (uint32 Column = 0; Column < 4; Column++)
+					{
+						_Values[Column] = Math::Randf(-0.5f, 0.5f) + (Row == Column ? 4.0f : 0.0f);
+						_Other[Column] = Math::Randf(-0.5f, 0.5f) + (Row == Column ? 2.0f : 0.0f);
+					}
+					MatrixA[Index][Row] = VectorType::Load4f(_Values);
+					MatrixB[Index][Row] = VectorType::Load4f(_Other);
+				}
+			}
+		}
+	};
+
+	template<typename Kernel, typename VectorType>
+	void runVectorKernel(uint64 Iterations)
+	{
+		VectorInputs<VectorType> _Inputs;
+		Benchmark::Escape(&_Inputs);
+		for (uint64 Iteration = 0; Iteration < Iterations; Iteration++)
+		{
+			for (uint32 Index = 0; Index < BATCH; Index++)
+			{
+				Benchmark::DoNotOptimize(Kernel::Run(_Inputs.A[Index], _Inputs.B[Index]));
+			}
+		}
+	}
+
+	/** The two implementations spell these differently. */
+	FORCEINLINE void matrixMultiply(BaseVector* Result, const BaseVector* A, const BaseVector* B) { BaseVector::MatrixMul(Result, A, B); }
+	FORCEINLINE void sinCos(const BaseVector& Value, BaseVector* Sin, BaseVector* Cos) { Value.Sincos(Sin, Cos); }
+#if BENCHMARK_SSE_VECTOR
+	FORCEINLINE void matrixMultiply(SSEVector* Result, const SSEVector* A, const SSEVector* B) { SSEVector::matrixMul(Result, A, B); }
+	FORCEINLINE void sinCos(const SSEVector& Value, SSEVector* Sin, SSEVector* Cos) { Value.sincos(Sin, Cos); }
+#endif
+
+	template<typename VectorType>
+	void runMatrixMultiply(uint64 Iterations)
+	{
+		VectorInputs<VectorType> _Inputs;
+		Benchmark::Escape(&_Inputs);
+		VectorType _Result[4];
+		for (uint64 Iteration = 0; Iteration < Iterations; Iteration++)
+		{
+			for (uint32 Index = 0; Index < BATCH; Index++)
+			{
+				matrixMultiply(_Result, _Inputs.MatrixA[Index], _Inputs.MatrixB[Index]);
+				Benchmark::DoNotOptimize(_Result);
+			}
+		}
+	}
+
+	template<typename VectorType>
+	void runMatrixInverse(uint64 Iterations)
+	{
+		VectorInputs<VectorType> _Inputs;
+		Benchmark::Escape(&_Inputs);
+		VectorType _Result[4];
+		for (uint64 Iteration = 0; Iteration < Iterations; Iteration++)
+		{
+			for (uint32 Index = 0; Index < BATCH; Index++)
+			{
+				VectorType::MatrixInverse(_Result, _Inputs.MatrixA[Index]);
+				Benchmark::DoNotOptimize(_Result);
+			}
+		}
+	}
+
+	template<typename VectorType>
+	void runMatrixDeterminant4x4(uint64 Iterations)
+	{
+		VectorInputs<VectorType> _Inputs;
+		Benchmark::Escape(&_Inputs);
+		for (uint64 Iteration = 0; Iteration < Iterations; Iteration++)
+		{
+			for (uint32 Index = 0; Index < BATCH; Index++)
+			{
+				Benchmark::DoNotOptimize(VectorType::MatrixDeterminant4x4(nullptr, nullptr, _Inputs.MatrixA[Index]));
+			}
+		}
+	}
+
+	template<typename VectorType>
+	void runMatrixDeterminant3x3(uint64 Iterations)
+	{
+		VectorInputs<VectorType> _Inputs;
+		Benchmark::Escape(&_Inputs);
+		for (uint64 Iteration = 0; Iteration < Iterations; Iteration++)
+		{
+			for (uint32 Index = 0; Index < BATCH; Index++)
+			{
+				Benchmark::DoNotOptimize(VectorType::MatrixDeterminant3x3Vector(_Inputs.MatrixA[Index]));
+			}
+		}
+	}
+
+	template<typename VectorType>
+	void runCreateTransformMatrix(uint64 Iterations)
+	{
+		VectorInputs<VectorType> _Inputs;
+		Benchmark::Escape(&_Inputs);
+		VectorType _Result[4];
+		for (uint64 Iteration = 0; Iteration < Iterations; Iteration++)
+		{
+			for (uint32 Index = 0; Index < BATCH; Index++)
+			{
+				VectorType::CreateTransformMatrix(_Result, _Inputs.A[Index], _Inputs.B[Index].Normalize4(), _Inputs.B[Index]);
+				Benchmark::DoNotOptimize(_Result);
+			}
+		}
+	}
+
+	template<typename VectorType>
+	void runSinCos(uint64 Iterations)
+	{
+		VectorInputs<VectorType> _Inputs;
+		Benchmark::Escape(&_Inputs);
+		VectorType _Sin, _Cos;
+		for (uint64 Iteration = 0; Iteration < Iterations; Iteration++)
+		{
+			for (uint32 Index = 0; Index < BATCH; Index++)
+			{
+				sinCos(_Inputs.A[Index], &_Sin, &_Cos);
+				Benchmark::DoNotOptimize(_Sin);
+				Benchmark::DoNotOptimize(_Cos);
+			}
+		}
+	}
+
+	template<typename VectorType>
+	void runLoadStore(uint64 Iterations)
+	{
+		float _Values[BATCH][4];
+		for (uint32 Index = 0; Index < BATCH; Index++)
+		{
+			VectorInputs<VectorType>().A[Index].Store4f(_Values[Index]);
+		}
+		Benchmark::Escape(_Values);
+		for (uint64 Iteration = 0; Iteration < Iterations; Iteration++)
+		{
+			for (uint32 Index = 0; Index < BATCH; Index++)
+			{
+				VectorType _Vector = VectorType::Load4f(_Values[Index]);
+				(_Vector + _Vector).Store4f(_Values[Index]);
+			}
+			Benchmark::ClobberMemory();
+		}
+	}
+}
+
+#if BENCHMARK_SSE_VECTOR
+	#define BENCHMARK_VECTOR_FUNCTION(Name, Function) \
+		BENCHMARK_REGISTER("BaseVector/" #Name, &Function<BaseVector>, BATCH); \
+		BENCHMARK_REGISTER("SSEVector/" #Name, &Function<SSEVector>, BATCH)
+#else
+	#define BENCHMARK_VECTOR_FUNCTION(Name, Function) \
+		BENCHMARK_REGISTER("BaseVector/" #Name, &Function<BaseVector>, BATCH)
+#endif
+
+/** Benchmarks Expression, in terms of the vectors A and B, for every vector implementation. */
+#define BENCHMARK_VECTOR(Name, Expression) \
+	namespace \
+	{ \
+		struct Name##Kernel \
+		{ \
+			template<typename VectorType> \
+			static FORCEINLINE auto Run(const VectorType& A, const VectorType& B) -> decltype(Expression) \
+			{ \
+				(void)B; \
+				return Expression; \
+			} \
+		}; \
+		template<typename VectorType> \
+		void run##Name(uint64 Iterations) { runVectorKernel<Name##Kernel, VectorType>(Iterations); } \
+	} \
+	BENCHMARK_VECTOR_FUNCTION(Name, run##Name)
+
+BENCHMARK_VECTOR(Add, A + B);
+BENCHMARK_VECTOR(Subtract, A - B);
+BENCHMARK_VECTOR(Multiply, A * B);
+BENCHMARK_VECTOR(Divide, A / B);
+BENCHMARK_VECTOR(Mad, A.Mad(B, A));
+BENCHMARK_VECTOR(Negate, -A);
+BENCHMARK_VECTOR(ToNeg, A.ToNeg());
+BENCHMARK_VECTOR(Abs, A.Abs());
+BENCHMARK_VECTOR(Sign, A.Sign());
+BENCHMARK_VECTOR(Min, A.Min(B));
+BENCHMARK_VECTOR(Max, A.Max(B));
+BENCHMARK_VECTOR(Replicate, A.Replicate(2));
+BENCHMARK_VECTOR(Dot3, A.Dot3(B));
+BENCHMARK_VECTOR(Dot4, A.Dot4(B));
+BENCHMARK_VECTOR(Cross3, A.Cross3(B));
+BENCHMARK_VECTOR(Pow, A.Pow(B));
+BENCHMARK_VECTOR(rSqrt, A.rSqrt());
+BENCHMARK_VECTOR(Reciprocal, A.Reciprocal());
+BENCHMARK_VECTOR(rLen3, A.rLen3());
+BENCHMARK_VECTOR(rLen4, A.rLen4());
+BENCHMARK_VECTOR(Normalize3, A.Normalize3());
+BENCHMARK_VECTOR(Normalize4, A.Normalize4());
+BENCHMARK_VECTOR(QuatMul, A.QuatMul(B));
+BENCHMARK_VECTOR(QuatRotateVec, A.QuatRotateVec(B));
+BENCHMARK_VECTOR(Equal, A == B);
+BENCHMARK_VECTOR(NotEqual, A != B);
+BENCHMARK_VECTOR(Less, A < B);
+BENCHMARK_VECTOR(LessEqual, A <= B);
+BENCHMARK_VECTOR(Greater, A > B);
+BENCHMARK_VECTOR(GreaterEqual, A >= B);
+BENCHMARK_VECTOR(Equals, A.Equals(B, 1.e-4f));
+BENCHMARK_VECTOR(NotEquals, A.NotEquals(B, 1.e-4f));
+BENCHMARK_VECTOR(And, A & B);
+BENCHMARK_VECTOR(Or, A | B);
+BENCHMARK_VECTOR(Xor, A ^ B);
+BENCHMARK_VECTOR(Select, A.Select(A < B, B));
+BENCHMARK_VECTOR(IsZero3f, A.IsZero3f());
+BENCHMARK_VECTOR(IsZero4f, A.IsZero4f());
+BENCHMARK_VECTOR(Index, A[1]);
+
+BENCHMARK_VECTOR_FUNCTION(SinCos, runSinCos);
+BENCHMARK_VECTOR_FUNCTION(LoadStore, runLoadStore);
+BENCHMARK_VECTOR_FUNCTION(MatrixMul, runMatrixMultiply);
+BENCHMARK_VECTOR_FUNCTION(MatrixInverse, runMatrixInverse);
+BENCHMARK_VECTOR_FUNCTION(MatrixDeterminant4x4, runMatrixDeterminant4x4);
+BENCHMARK_VECTOR_FUNCTION(MatrixDeterminant3x3, runMatrixDeterminant3x3);
+BENCHMARK_VECTOR_FUNCTION(CreateTransformMatrix, runCreateTransformMatrix);
+
+/*
+ *	The scalar baselines. The inputs are the same shape as the vector
+ *	benchmarks' so the numbers line up.
+ **/
+namespace
+{
+	struct NaiveInputs
+	{
+		float A[BATCH][4];
+		float B[BATCH][4];
+		float MatrixA[BATCH][16];
+		float MatrixB[BATCH][16];
+
+		NaiveInputs()
+		{
+			VectorInputs<BaseVector> _Inputs;
+			for (uint32 Index = 0; Index < BATCH; Index++)
+			{
+				_Inputs.A[Index].Store4f(A[Index]);
+				_Inputs.B[Index].Store4f(B[Index]);
+				for (uint32 Row = 0; Row < 4; Row++)
+				{
+					_Inputs.MatrixA[Index][Row].Store4f(MatrixA[Index] + Row * 4);
+					_Inputs.MatrixB[Index][Row].Store4f(MatrixB[Index] + Row * 4);
+				}
+			}
+		}
+	};
+}
+
+BENCHMARK_NAMED(naiveCross3, "Naive/Cross3", BATCH)
+{
+	NaiveInputs _Inputs;
+	Benchmark::Escape(&_Inputs);
+	float _Result[4];
+	for (uint64 Iteration = 0; Iteration < Iterations; Iteration++)
+	{
+		for (uint32 Index = 0; Index < BATCH; Index++)
+		{
+			naiveCrossProduct(_Result, _Inputs.A[Index], _Inputs.B[Index]);
+			Benchmark::DoNotOptimize(_Result);
+		}
+	}
+}
+
+BENCHMARK_NAMED(naiveQuatMul, "Naive/QuatMul", BATCH)
+{
+	NaiveInputs _Inputs;
+	Benchmark::Escape(&_Inputs);
+	float _Result[4];
+	for (uint64 Iteration = 0; Iteration < Iterations; Iteration++)
+	{
+		for (uint32 Index = 0; Index < BATCH; Index++)
+		{
+			naiveQuatMul(_Result, _Inputs.A[Index], _Inputs.B[Index]);
+			Benchmark::DoNotOptimize(_Result);
+		}
+	}
+}
+
+BENCHMARK_NAMED(naiveQuatRotateVec, "Naive/QuatRotateVec", BATCH)
+{
+	NaiveInputs _Inputs;
+	Benchmark::Escape(&_Inputs);
+	float _Result[4];
+	for (uint64 Iteration = 0; Iteration < Iterations; Iteration++)
+	{
+		for (uint32 Index = 0; Index < BATCH; Index++)
+		{
+			naiveQuatRotate(_Result, _Inputs.A[Index], _Inputs.B[Index]);
+			Benchmark::DoNotOptimize(_Result);
+		}
+	}
+}
+
+BENCHMARK_NAMED(naiveMatrixMul, "Naive/MatrixMul", BATCH)
+{
+	NaiveInputs _Inputs;
+	Benchmark::Escape(&_Inputs);
+	float _Result[16];
+	for (uint64 Iteration = 0; Iteration < Iterations; Iteration++)
+	{
+		for (uint32 Index = 0; Index < BATCH; Index++)
+		{
+			naiveMatrixMultiply(_Result, _Inputs.MatrixA[Index], _Inputs.MatrixB[Index]);
+			Benchmark::DoNotOptimize(_Result);
+		}
+	}
+}
+
+BENCHMARK_NAMED(naiveMatrixInverse, "Naive/MatrixInverse", BATCH)
+{
+	NaiveInputs _Inputs;
+	Benchmark::Escape(&_Inputs);
+	const Matrix _Identity(Matrix::Identity());
+	float _Source[16];
+	float _Result[16];
+	for (uint64 Iteration = 0; Iteration < Iterations; Iteration++)
+	{
+		for (uint32 Index = 0; Index < BATCH; Index++)
+		{
+			// Eliminates in place, into a result that starts as the identity
+			memcpy(_Source, _Inputs.MatrixA[Index], sizeof(_Source));
+			memcpy(_Result, &_Identity, sizeof(_Result));
+			naiveMatrixInverse(_Result, _Source);
+			Benchmark::DoNotOptimize(_Result);
+		}
+	}
+}
+
+BENCHMARK_NAMED(naiveCreateTransformMatrix, "Naive/CreateTransformMatrix", BATCH)
+{
+	NaiveInputs _Inputs;
+	Benchmark::Escape(&_Inputs);
+	float _Result[16];
+	for (uint64 Iteration = 0; Iteration < Iterations; Iteration++)
+	{
+		for (uint32 Index = 0; Index < BATCH; Index++)
+		{
+			naiveTransformCreate(_Result, _Inputs.A[Index], _Inputs.B[Index], _Inputs.B[Index]);
+			Benchmark::DoNotOptimize(_Result);
+		}
+	}
+}